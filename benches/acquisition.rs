@@ -0,0 +1,205 @@
+//! The overhead the crate adds on top of the SDK: allocating and pooling frame buffers, taking the camera
+//! handle, marshalling FFI arguments and device discovery. Runs against `SimCamera` with instant readout and
+//! transfer, so the numbers only contain the wrapper and a memcpy of the frame.
+//!
+//! `cargo bench --features simulation --bench acquisition`
+use std::hint::black_box;
+use std::sync::{Arc, OnceLock};
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use qhyccd_rs::{
+    set_backend, Camera, Control, FramePool, LiveStreamOptions, Sdk, SdkOptions, SimCamera,
+    SimulationConfig, StreamMode,
+};
+
+/// frame sizes of typical sensors, width x height
+const SIZES: [(u32, u32); 3] = [(640, 480), (1920, 1080), (6248, 4176)];
+
+/// the simulated SDK shared by all benchmarks, the backend can only be set once per process
+fn simulator() -> &'static SimCamera {
+    static SIMULATOR: OnceLock<Arc<SimCamera>> = OnceLock::new();
+    SIMULATOR.get_or_init(|| {
+        let simulator = Arc::new(SimCamera::default());
+        set_backend(simulator.clone()).expect("set_backend failed");
+        simulator
+    })
+}
+
+fn open_camera(config: SimulationConfig, mode: StreamMode) -> (Sdk, Camera) {
+    simulator().configure(config);
+    let sdk = Sdk::new().expect("SDK::new failed");
+    let camera = sdk.cameras().last().expect("no camera found").clone();
+    camera.open().expect("open failed");
+    camera
+        .set_stream_mode(mode)
+        .expect("set_stream_mode failed");
+    camera.init().expect("init failed");
+    camera
+        .set_parameter(Control::Exposure, 1.0)
+        .expect("set_parameter failed");
+    (sdk, camera)
+}
+
+/// without readout and transfer times, so the benchmarks measure the wrapper and not the timing model
+fn instant() -> SimulationConfig {
+    SimulationConfig {
+        pixel_rate: f64::INFINITY,
+        usb_bandwidth: f64::INFINITY,
+        ..Default::default()
+    }
+}
+
+fn sized(width: u32, height: u32) -> SimulationConfig {
+    SimulationConfig {
+        width,
+        height,
+        ..instant()
+    }
+}
+
+fn single_frame(c: &mut Criterion) {
+    let mut group = c.benchmark_group("single_frame");
+    for (width, height) in SIZES {
+        let (_sdk, camera) = open_camera(sized(width, height), StreamMode::SingleFrameMode);
+        let size = camera.get_image_size().expect("get_image_size failed");
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("allocating", &label), &size, |b, &size| {
+            b.iter(|| {
+                camera
+                    .start_single_frame_exposure()
+                    .expect("start_single_frame_exposure failed");
+                black_box(
+                    camera
+                        .get_single_frame(size)
+                        .expect("get_single_frame failed"),
+                )
+            })
+        });
+        let mut buffer = vec![0u8; size];
+        group.bench_function(BenchmarkId::new("into", &label), |b| {
+            b.iter(|| {
+                camera
+                    .start_single_frame_exposure()
+                    .expect("start_single_frame_exposure failed");
+                black_box(
+                    camera
+                        .get_single_frame_into(&mut buffer)
+                        .expect("get_single_frame_into failed"),
+                )
+            })
+        });
+        let pool = FramePool::for_camera(&camera, 2).expect("FramePool::for_camera failed");
+        group.bench_function(BenchmarkId::new("pooled", &label), |b| {
+            b.iter(|| {
+                camera
+                    .start_single_frame_exposure()
+                    .expect("start_single_frame_exposure failed");
+                black_box(
+                    camera
+                        .get_single_frame_pooled(&pool)
+                        .expect("get_single_frame_pooled failed"),
+                )
+            })
+        });
+    }
+    group.finish();
+}
+
+fn live_frame(c: &mut Criterion) {
+    let mut group = c.benchmark_group("live_frame");
+    for (width, height) in SIZES {
+        let (_sdk, camera) = open_camera(sized(width, height), StreamMode::LiveMode);
+        camera.begin_live().expect("begin_live failed");
+        let size = camera.get_image_size().expect("get_image_size failed");
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("allocating", &label), &size, |b, &size| {
+            b.iter(|| black_box(camera.get_live_frame(size).expect("get_live_frame failed")))
+        });
+        let pool = FramePool::for_camera(&camera, 2).expect("FramePool::for_camera failed");
+        group.bench_function(BenchmarkId::new("pooled", &label), |b| {
+            b.iter(|| {
+                black_box(
+                    camera
+                        .get_live_frame_pooled(&pool)
+                        .expect("get_live_frame_pooled failed"),
+                )
+            })
+        });
+        camera.end_live().expect("end_live failed");
+        group.bench_function(BenchmarkId::new("stream", &label), |b| {
+            let stream = camera
+                .begin_live_stream(LiveStreamOptions::default())
+                .expect("begin_live_stream failed");
+            b.iter(|| black_box(stream.next_frame().expect("next_frame failed")));
+            stream.stop().expect("stop failed");
+        });
+    }
+    group.finish();
+}
+
+fn parameters(c: &mut Criterion) {
+    let mut group = c.benchmark_group("parameters");
+    let (_sdk, camera) = open_camera(sized(640, 480), StreamMode::SingleFrameMode);
+    group.bench_function("get_parameter", |b| {
+        b.iter(|| {
+            black_box(
+                camera
+                    .get_parameter(Control::Gain)
+                    .expect("get_parameter failed"),
+            )
+        })
+    });
+    group.bench_function("set_parameter", |b| {
+        let mut gain = 0.0;
+        b.iter(|| {
+            gain = (gain + 1.0) % 100.0;
+            camera
+                .set_parameter(Control::Gain, black_box(gain))
+                .expect("set_parameter failed")
+        })
+    });
+    group.bench_function("get_parameter_min_max_step", |b| {
+        b.iter(|| {
+            black_box(
+                camera
+                    .get_parameter_min_max_step(Control::Gain)
+                    .expect("get_parameter_min_max_step failed"),
+            )
+        })
+    });
+    group.bench_function("is_control_available", |b| {
+        b.iter(|| black_box(camera.is_control_available(black_box(Control::Offset))))
+    });
+    group.bench_function("get_ccd_info", |b| {
+        b.iter(|| black_box(camera.get_ccd_info().expect("get_ccd_info failed")))
+    });
+    group.finish();
+}
+
+fn discovery(c: &mut Criterion) {
+    let mut group = c.benchmark_group("discovery");
+    for cameras in [1, 8, 32] {
+        simulator().configure(SimulationConfig {
+            cameras,
+            filter_wheel: true,
+            ..instant()
+        });
+        group.bench_with_input(BenchmarkId::new("new", cameras), &cameras, |b, _| {
+            b.iter(|| black_box(Sdk::new().expect("SDK::new failed")))
+        });
+        let options = SdkOptions {
+            parallel: true,
+            probe_filter_wheels: false,
+            keep_open: false,
+        };
+        group.bench_with_input(BenchmarkId::new("deferred", cameras), &cameras, |b, _| {
+            b.iter(|| black_box(Sdk::new_with(options.clone()).expect("SDK::new_with failed")))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, single_frame, live_frame, parameters, discovery);
+criterion_main!(benches);
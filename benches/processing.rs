@@ -0,0 +1,162 @@
+//! The image processing paths that run on every frame after it left the camera: debayering, software
+//! binning, statistics and star detection and writing FITS files, plain and Rice compressed. These do not
+//! touch the SDK.
+//!
+//! `cargo bench --bench processing`
+use std::hint::black_box;
+use std::io;
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use qhyccd_rs::{
+    BayerMode, BinningMode, Calibration, DebayerAlgorithm, FitsHeader, ImageData, MasterFrame,
+    StarOptions,
+};
+
+/// frame sizes of typical sensors, width x height
+const SIZES: [(u32, u32); 2] = [(1920, 1080), (6248, 4176)];
+
+/// a 16 bit frame with some structure, so the compressed paths do not only see a constant
+fn raw_frame(width: u32, height: u32) -> ImageData {
+    let mut state = 0x2545_f491_u32;
+    let data = (0..width as usize * height as usize)
+        .flat_map(|index| {
+            // xorshift noise on top of a gradient, like sky background with read noise
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            let value = (index % width as usize) as u32 * 4 + 1000 + (state & 0xff);
+            (value as u16).to_ne_bytes()
+        })
+        .collect();
+    ImageData {
+        data,
+        width,
+        height,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+fn debayer(c: &mut Criterion) {
+    let mut group = c.benchmark_group("debayer");
+    for (width, height) in SIZES {
+        let image = raw_frame(width, height);
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(image.data.len() as u64));
+        for (name, algorithm) in [
+            ("bilinear", DebayerAlgorithm::Bilinear),
+            ("malvar", DebayerAlgorithm::Malvar),
+        ] {
+            group.bench_function(BenchmarkId::new(name, &label), |b| {
+                b.iter(|| {
+                    black_box(
+                        image
+                            .debayer(BayerMode::RGGB, algorithm)
+                            .expect("debayer failed"),
+                    )
+                })
+            });
+        }
+    }
+    group.finish();
+}
+
+fn bin(c: &mut Criterion) {
+    let mut group = c.benchmark_group("bin");
+    for (width, height) in SIZES {
+        let image = raw_frame(width, height);
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(image.data.len() as u64));
+        for factor in [2, 4] {
+            group.bench_function(
+                BenchmarkId::new(format!("sum_{factor}x{factor}"), &label),
+                |b| b.iter(|| black_box(image.bin(factor, BinningMode::Sum).expect("bin failed"))),
+            );
+        }
+        group.bench_function(BenchmarkId::new("average_2x2", &label), |b| {
+            b.iter(|| black_box(image.bin(2, BinningMode::Average).expect("bin failed")))
+        });
+    }
+    group.finish();
+}
+
+fn analysis(c: &mut Criterion) {
+    let mut group = c.benchmark_group("analysis");
+    for (width, height) in SIZES {
+        let image = raw_frame(width, height);
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(image.data.len() as u64));
+        group.bench_function(BenchmarkId::new("stats", &label), |b| {
+            b.iter(|| black_box(image.stats().expect("stats failed")))
+        });
+        let options = StarOptions::default();
+        group.bench_function(BenchmarkId::new("detect_stars", &label), |b| {
+            b.iter(|| black_box(image.detect_stars(&options).expect("detect_stars failed")))
+        });
+    }
+    group.finish();
+}
+
+fn calibration(c: &mut Criterion) {
+    let mut group = c.benchmark_group("calibration");
+    for (width, height) in SIZES {
+        let mut image = raw_frame(width, height);
+        let master = |value: f32| MasterFrame {
+            width,
+            height,
+            channels: 1,
+            frames: 1,
+            data: vec![value; (width * height) as usize],
+        };
+        let calibration = Calibration::new(
+            Some(&master(100.0)),
+            Some(&master(20.0)),
+            Some(&master(1000.0)),
+        )
+        .expect("Calibration::new failed");
+        group.throughput(Throughput::Bytes(image.data.len() as u64));
+        group.bench_function(
+            BenchmarkId::new("apply_calibration", format!("{width}x{height}")),
+            |b| {
+                b.iter(|| {
+                    image
+                        .apply_calibration(&calibration)
+                        .expect("apply_calibration failed")
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn fits(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fits");
+    let mut header = FitsHeader::new();
+    header
+        .set("EXPTIME", 300.0, "exposure time in seconds")
+        .set("GAIN", 30, "");
+    for (width, height) in SIZES {
+        let image = raw_frame(width, height);
+        let label = format!("{width}x{height}");
+        group.throughput(Throughput::Bytes(image.data.len() as u64));
+        group.bench_function(BenchmarkId::new("write", &label), |b| {
+            b.iter(|| {
+                image
+                    .write_fits(io::sink(), &header)
+                    .expect("write_fits failed")
+            })
+        });
+        group.bench_function(BenchmarkId::new("write_rice", &label), |b| {
+            b.iter(|| {
+                image
+                    .write_fits_rice(io::sink(), &header, 16)
+                    .expect("write_fits_rice failed")
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, debayer, bin, analysis, calibration, fits);
+criterion_main!(benches);
@@ -0,0 +1,391 @@
+use std::borrow::Cow;
+
+use eyre::{eyre, Result};
+
+use crate::parallel::{for_each_item_band, map_row_bands};
+use crate::samples::u16_samples;
+use crate::QHYError::UnsupportedImageError;
+use crate::{ImageData, ImageView};
+
+/// FWHM = 2 sqrt(2 ln 2) sigma for a gaussian profile
+const FWHM_PER_SIGMA: f64 = 2.354_820_045;
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// The number of samples per value of an image, see `ImageData::histogram`. 8 bit images have 256 bins, 16 bit
+/// images 65536, so percentiles and the median are exact.
+pub struct Histogram {
+    bins: Vec<u64>,
+    count: u64,
+}
+
+impl Histogram {
+    /// Returns the number of samples per value
+    pub fn bins(&self) -> &[u64] {
+        &self.bins
+    }
+
+    /// Returns the number of samples
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    /// Returns the smallest value, `None` for an empty image
+    pub fn min(&self) -> Option<u16> {
+        self.bins
+            .iter()
+            .position(|&count| count > 0)
+            .map(|value| value as u16)
+    }
+
+    /// Returns the largest value, `None` for an empty image
+    pub fn max(&self) -> Option<u16> {
+        self.bins
+            .iter()
+            .rposition(|&count| count > 0)
+            .map(|value| value as u16)
+    }
+
+    /// Returns the value below which `quantile` (0.0 to 1.0) of the samples are, 0 for an empty image
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![1, 2, 3, 4, 100], width: 5, height: 1, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let histogram = image.histogram().expect("histogram failed");
+    /// assert_eq!(histogram.percentile(0.5), 3);
+    /// assert_eq!(histogram.percentile(1.0), 100);
+    /// ```
+    pub fn percentile(&self, quantile: f64) -> u16 {
+        let rank = (quantile.clamp(0.0, 1.0) * self.count as f64)
+            .ceil()
+            .max(1.0) as u64;
+        let mut seen = 0;
+        for (value, &count) in self.bins.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return value as u16;
+            }
+        }
+        0
+    }
+
+    /// Returns the median value
+    pub fn median(&self) -> u16 {
+        self.percentile(0.5)
+    }
+
+    /// Returns min, max, mean, standard deviation and median
+    pub fn stats(&self) -> ImageStats {
+        let (sum, sum_of_squares) = self.bins.iter().enumerate().fold(
+            (0.0, 0.0),
+            |(sum, sum_of_squares), (value, &count)| {
+                let value = value as f64;
+                let count = count as f64;
+                (sum + value * count, sum_of_squares + value * value * count)
+            },
+        );
+        let count = self.count.max(1) as f64;
+        let mean = sum / count;
+        ImageStats {
+            count: self.count,
+            min: self.min().unwrap_or(0),
+            max: self.max().unwrap_or(0),
+            mean,
+            stddev: (sum_of_squares / count - mean * mean).max(0.0).sqrt(),
+            median: self.median(),
+        }
+    }
+
+    /// a robust estimate of the background noise from the 15.87% and 84.13% percentiles, which are one
+    /// sigma below and above the mean of a normal distribution, stars do not move them much
+    fn noise(&self) -> f64 {
+        (self.percentile(0.8413) as f64 - self.percentile(0.1587) as f64) / 2.0
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+/// Statistics over all samples of an image, see `ImageData::stats`
+pub struct ImageStats {
+    /// the number of samples, pixels times channels
+    pub count: u64,
+    /// the smallest value
+    pub min: u16,
+    /// the largest value
+    pub max: u16,
+    /// the mean value
+    pub mean: f64,
+    /// the standard deviation
+    pub stddev: f64,
+    /// the median value
+    pub median: u16,
+}
+
+#[derive(Debug, Clone)]
+/// Options for `ImageData::detect_stars`
+pub struct StarOptions {
+    /// how many noise sigmas above the background a peak has to be to count as a star
+    pub sigma: f64,
+    /// the radius in pixels of the circle a star is measured in, it should hold the whole star. Peaks closer
+    /// than this to a brighter star or to the edge of the image are dropped.
+    pub radius: u32,
+    /// at most this many stars are measured, the brightest ones
+    pub max_stars: usize,
+}
+
+impl Default for StarOptions {
+    fn default() -> Self {
+        Self {
+            sigma: 5.0,
+            radius: 8,
+            max_stars: 200,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+/// A star found by `ImageData::detect_stars`, positions are in pixels from the top left of the image or view
+pub struct Star {
+    /// the x coordinate of the centroid
+    pub x: f64,
+    /// the y coordinate of the centroid
+    pub y: f64,
+    /// the brightest pixel of the star, compare with the maximum value to find saturated stars
+    pub peak: u16,
+    /// the sum of all pixels of the star above the background
+    pub flux: f64,
+    /// the half flux radius, the flux weighted mean distance of the pixels from the centroid
+    pub hfr: f64,
+    /// the full width at half maximum, estimated from the second moment of the star assuming a gaussian
+    /// profile
+    pub fwhm: f64,
+}
+
+impl ImageData {
+    /// Returns the histogram over all samples of the image, computed in parallel over bands of rows. Use
+    /// `view` to restrict it to an area.
+    pub fn histogram(&self) -> Result<Histogram> {
+        self.full_view()?.histogram()
+    }
+
+    /// Returns min, max, mean, standard deviation and median of all samples of the image with a single pass
+    /// over the pixels
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![2, 4, 4, 4, 5, 5, 7, 9], width: 4, height: 2, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let stats = image.stats().expect("stats failed");
+    /// assert_eq!((stats.min, stats.max, stats.median), (2, 9, 4));
+    /// assert_eq!((stats.mean, stats.stddev), (5.0, 2.0));
+    /// ```
+    pub fn stats(&self) -> Result<ImageStats> {
+        Ok(self.histogram()?.stats())
+    }
+
+    /// Finds stars in a mono image and measures their centroid, HFR and FWHM, for autofocus and guiding. The
+    /// background and noise are estimated from the histogram, peaks more than `sigma` times the noise above
+    /// the background are stars. Use `view` to restrict the search to an area, e.g. around the guide star.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::{ImageData, StarOptions};
+    /// let (width, height) = (64_usize, 64_usize);
+    /// let data = (0..width * height)
+    ///     .map(|index| {
+    ///         let (dx, dy) = ((index % width) as f64 - 20.0, (index / width) as f64 - 30.0);
+    ///         // a gaussian star on a noisy background
+    ///         100 + (index * 7 % 5) as u8 + (120.0 * (-(dx * dx + dy * dy) / 4.0).exp()) as u8
+    ///     })
+    ///     .collect();
+    /// let image = ImageData { data, width: width as u32, height: height as u32, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let stars = image.detect_stars(&StarOptions::default()).expect("detect_stars failed");
+    /// assert_eq!(stars.len(), 1);
+    /// assert!((stars[0].x - 20.0).abs() < 0.1 && (stars[0].y - 30.0).abs() < 0.1);
+    /// ```
+    pub fn detect_stars(&self, options: &StarOptions) -> Result<Vec<Star>> {
+        self.full_view()?.detect_stars(options)
+    }
+}
+
+impl ImageView<'_> {
+    /// Returns the histogram over all samples of the view, see `ImageData::histogram`
+    pub fn histogram(&self) -> Result<Histogram> {
+        let bins = match self.bytes_per_sample() {
+            1 => 1 << 8,
+            2 => 1 << 16,
+            _ => return Err(self.unsupported()),
+        };
+        // one histogram per band, u32 counts keep them small enough to stay in the cache
+        let bands = map_row_bands(self.height() as usize, |rows| {
+            let mut counts = vec![0_u32; bins];
+            for y in rows {
+                match self.bytes_per_sample() {
+                    1 => count_samples(self.row(y as u32).iter().copied(), &mut counts),
+                    _ => {
+                        count_samples(u16_samples(self.row(y as u32)).iter().copied(), &mut counts)
+                    }
+                }
+            }
+            counts
+        });
+        let mut histogram = Histogram {
+            bins: vec![0; bins],
+            count: 0,
+        };
+        for counts in bands {
+            for (bin, count) in histogram.bins.iter_mut().zip(counts) {
+                *bin += count as u64;
+            }
+        }
+        histogram.count = histogram.bins.iter().sum();
+        Ok(histogram)
+    }
+
+    /// Returns the statistics over all samples of the view, see `ImageData::stats`
+    pub fn stats(&self) -> Result<ImageStats> {
+        Ok(self.histogram()?.stats())
+    }
+
+    /// Finds stars in the view, see `ImageData::detect_stars`
+    pub fn detect_stars(&self, options: &StarOptions) -> Result<Vec<Star>> {
+        if self.channels() != 1 {
+            return Err(self.unsupported());
+        }
+        let histogram = self.histogram()?;
+        let background = histogram.median() as f64;
+        let threshold = background + options.sigma * histogram.noise().max(1.0);
+        let radius = options.radius.max(1);
+        let (width, height) = (self.width(), self.height());
+        if width <= 2 * radius || height <= 2 * radius {
+            return Ok(Vec::new());
+        }
+        // local maxima above the threshold, away from the edges so the whole star can be measured
+        let first = radius as usize;
+        let inner = (height - 2 * radius) as usize;
+        let mut peaks: Vec<(u16, u32, u32)> = map_row_bands(inner, |rows| {
+            let mut peaks = Vec::new();
+            for y in rows.start + first..rows.end + first {
+                let y = y as u32;
+                let (above, row, below) =
+                    (self.samples(y - 1), self.samples(y), self.samples(y + 1));
+                for x in radius as usize..(width - radius) as usize {
+                    let value = row[x];
+                    // ties go to the first pixel, so a flat top is found once
+                    if value as f64 > threshold
+                        && value > row[x - 1]
+                        && value >= row[x + 1]
+                        && above[x - 1..=x + 1].iter().all(|&other| value > other)
+                        && below[x - 1..=x + 1].iter().all(|&other| value >= other)
+                    {
+                        peaks.push((value, x as u32, y));
+                    }
+                }
+            }
+            peaks
+        })
+        .into_iter()
+        .flatten()
+        .collect();
+        // the brightest peak of a star wins, everything within the radius of it belongs to it
+        peaks.sort_unstable_by(|a, b| b.0.cmp(&a.0));
+        let min_distance = (radius * radius) as i64;
+        let mut accepted: Vec<(u16, u32, u32)> = Vec::new();
+        for peak in peaks {
+            if accepted.len() >= options.max_stars {
+                break;
+            }
+            let close = accepted.iter().any(|other| {
+                let (dx, dy) = (
+                    peak.1 as i64 - other.1 as i64,
+                    peak.2 as i64 - other.2 as i64,
+                );
+                dx * dx + dy * dy <= min_distance
+            });
+            if !close {
+                accepted.push(peak);
+            }
+        }
+        let mut stars: Vec<Option<Star>> = accepted
+            .iter()
+            .map(|&(peak, x, y)| {
+                Some(Star {
+                    x: x as f64,
+                    y: y as f64,
+                    peak,
+                    flux: 0.0,
+                    hfr: 0.0,
+                    fwhm: 0.0,
+                })
+            })
+            .collect();
+        for_each_item_band(&mut stars, |_, band| {
+            for star in band.iter_mut() {
+                *star = star.and_then(|star| self.measure(star, background, radius));
+            }
+        });
+        Ok(stars.into_iter().flatten().collect())
+    }
+
+    /// measures the star around its peak, `None` if there is no flux above the background
+    fn measure(&self, star: Star, background: f64, radius: u32) -> Option<Star> {
+        let (peak_x, peak_y) = (star.x as u32, star.y as u32);
+        let rows = peak_y - radius..=peak_y + radius;
+        let columns = (peak_x - radius) as usize..=(peak_x + radius) as usize;
+        let radius_squared = (radius * radius) as f64;
+        let pixels = || {
+            rows.clone().flat_map(|y| {
+                let row = self.samples(y);
+                let columns = columns.clone();
+                columns.filter_map(move |x| {
+                    let (dx, dy) = (x as f64 - star.x, y as f64 - star.y);
+                    let weight = row[x] as f64 - background;
+                    (dx * dx + dy * dy <= radius_squared && weight > 0.0)
+                        .then_some((x as f64, y as f64, weight))
+                })
+            })
+        };
+        let (flux, sum_x, sum_y) = pixels()
+            .fold((0.0, 0.0, 0.0), |(flux, sum_x, sum_y), (x, y, w)| {
+                (flux + w, sum_x + x * w, sum_y + y * w)
+            });
+        if flux <= 0.0 {
+            return None;
+        }
+        let (x, y) = (sum_x / flux, sum_y / flux);
+        let (sum_distance, sum_squared) =
+            pixels().fold((0.0, 0.0), |(sum_distance, sum_squared), (px, py, w)| {
+                let squared = (px - x).powi(2) + (py - y).powi(2);
+                (sum_distance + squared.sqrt() * w, sum_squared + squared * w)
+            });
+        Some(Star {
+            x,
+            y,
+            peak: star.peak,
+            flux,
+            hfr: sum_distance / flux,
+            // the second moment over both axes is 2 sigma^2
+            fwhm: FWHM_PER_SIGMA * (sum_squared / flux / 2.0).sqrt(),
+        })
+    }
+
+    /// row `y` as samples, 8 bit rows are widened
+    fn samples(&self, y: u32) -> Cow<'_, [u16]> {
+        match self.bytes_per_sample() {
+            1 => Cow::Owned(self.row(y).iter().map(|&sample| sample as u16).collect()),
+            _ => u16_samples(self.row(y)),
+        }
+    }
+
+    fn unsupported(&self) -> eyre::Report {
+        let error = UnsupportedImageError {
+            bits_per_pixel: self.bits_per_pixel(),
+            channels: self.channels(),
+        };
+        tracing::error!(error = ?error);
+        eyre!(error)
+    }
+}
+
+#[inline(always)]
+fn count_samples<S: Into<usize>>(samples: impl Iterator<Item = S>, counts: &mut [u32]) {
+    for sample in samples {
+        counts[sample.into()] += 1;
+    }
+}
@@ -0,0 +1,100 @@
+use std::future::Future;
+use std::time::Duration;
+
+use eyre::{eyre, Result};
+
+use crate::{Camera, Control, ImageData};
+
+/// a single frame exposure is only considered finished once the SDK reports less than this, the readout
+/// call waits for the rest
+const REMAINING_THRESHOLD: Duration = Duration::from_millis(1);
+
+impl Camera {
+    /// Takes a single frame exposure without blocking the calling task. The exposure is set and started on
+    /// tokio's blocking pool, the task then sleeps until the SDK reports the exposure as nearly complete and
+    /// finally reads the frame out on the blocking pool again. A single runtime with a few threads can
+    /// drive many cameras this way. Requires the `async` feature and a tokio runtime with the timer enabled.
+    ///
+    /// If the future is dropped before the frame was read out the exposure is aborted.
+    /// # Example
+    /// ```no_run
+    /// use std::time::Duration;
+    /// use qhyccd_rs::{Sdk,StreamMode};
+    /// # async fn run() -> eyre::Result<()> {
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// let image = camera.expose_async(Duration::from_secs(120)).await?;
+    /// println!("{}x{}", image.width, image.height);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn expose_async(
+        &self,
+        exposure: Duration,
+    ) -> impl Future<Output = Result<ImageData>> + Send + 'static {
+        let camera = self.clone();
+        async move {
+            let exposure_us = exposure.as_micros() as f64;
+            blocking(&camera, move |camera| {
+                camera.set_parameter(Control::Exposure, exposure_us)?;
+                camera.start_single_frame_exposure()
+            })
+            .await?;
+            let mut guard = AbortOnDrop {
+                camera: camera.clone(),
+                armed: true,
+            };
+            loop {
+                let remaining = Duration::from_micros(
+                    blocking(&camera, |camera| camera.get_remaining_exposure_us()).await? as u64,
+                );
+                if remaining < REMAINING_THRESHOLD {
+                    break;
+                }
+                tokio::time::sleep(remaining).await;
+            }
+            let image = blocking(&camera, |camera| {
+                let buffer_size = camera.get_image_size()?;
+                camera.get_single_frame(buffer_size)
+            })
+            .await;
+            guard.armed = false;
+            image
+        }
+    }
+}
+
+/// aborts the running exposure if `expose_async` is dropped while waiting
+struct AbortOnDrop {
+    camera: Camera,
+    armed: bool,
+}
+
+impl Drop for AbortOnDrop {
+    fn drop(&mut self) {
+        if self.armed {
+            if let Err(error) = self.camera.abort_exposure_and_readout() {
+                tracing::error!(error = ?error);
+            }
+        }
+    }
+}
+
+/// runs `f` with a clone of `camera` on tokio's blocking pool
+async fn blocking<T, F>(camera: &Camera, f: F) -> Result<T>
+where
+    T: Send + 'static,
+    F: FnOnce(&Camera) -> Result<T> + Send + 'static,
+{
+    let camera = camera.clone();
+    match tokio::task::spawn_blocking(move || f(&camera)).await {
+        Ok(result) => result,
+        Err(error) => {
+            tracing::error!(error = ?error);
+            Err(eyre!(error))
+        }
+    }
+}
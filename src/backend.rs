@@ -0,0 +1,619 @@
+use std::ffi::c_char;
+use std::fmt::Debug;
+use std::sync::{Arc, OnceLock};
+
+use eyre::{eyre, Result};
+use libqhyccd_sys::QhyccdHandle;
+
+use crate::QHYError::BackendAlreadySetError;
+
+/// The functions of the QHYCCD SDK the crate calls, with the names and signatures of `libqhyccd-sys`. The
+/// default backend is the SDK itself, `set_backend` replaces it for the whole process, e.g. with the
+/// simulated cameras of `SimCamera` to load test a pipeline without hardware.
+///
+/// # Safety
+/// The methods get the same raw pointers as the SDK functions and have to treat them the same way: output
+/// pointers are valid for a single write and frame buffers hold at least `GetQHYCCDMemLength` bytes.
+#[allow(
+    non_snake_case,
+    clippy::too_many_arguments,
+    clippy::missing_safety_doc,
+    missing_docs
+)]
+pub trait Backend: Debug + Send + Sync {
+    unsafe fn InitQHYCCDResource(&self) -> u32;
+    unsafe fn ScanQHYCCD(&self) -> u32;
+    unsafe fn GetQHYCCDSDKVersion(
+        &self,
+        year: *mut u32,
+        month: *mut u32,
+        day: *mut u32,
+        subday: *mut u32,
+    ) -> u32;
+    unsafe fn GetQHYCCDId(&self, index: u32, id: *mut c_char) -> u32;
+    unsafe fn OpenQHYCCD(&self, id: *const c_char) -> QhyccdHandle;
+    unsafe fn GetQHYCCDFWVersion(&self, h: QhyccdHandle, buf: *mut u8) -> u32;
+    unsafe fn IsQHYCCDControlAvailable(&self, h: QhyccdHandle, controlId: u32) -> u32;
+    unsafe fn SetQHYCCDReadMode(&self, h: QhyccdHandle, mode: u32) -> u32;
+    unsafe fn SetQHYCCDStreamMode(&self, h: QhyccdHandle, mode: u8) -> u32;
+    unsafe fn InitQHYCCD(&self, h: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDChipInfo(
+        &self,
+        handle: QhyccdHandle,
+        chipw: *mut f64,
+        chiph: *mut f64,
+        imagew: *mut u32,
+        imageh: *mut u32,
+        pixelw: *mut f64,
+        pixelh: *mut f64,
+        bpp: *mut u32,
+    ) -> u32;
+    unsafe fn SetQHYCCDBitsMode(&self, handle: QhyccdHandle, bits: u32) -> u32;
+    unsafe fn SetQHYCCDDebayerOnOff(&self, handle: QhyccdHandle, onoff: bool) -> u32;
+    unsafe fn SetQHYCCDBinMode(&self, handle: QhyccdHandle, wbin: u32, hbin: u32) -> u32;
+    unsafe fn SetQHYCCDResolution(
+        &self,
+        handle: QhyccdHandle,
+        x: u32,
+        y: u32,
+        xsize: u32,
+        ysize: u32,
+    ) -> u32;
+    unsafe fn GetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32) -> f64;
+    unsafe fn SetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32, value: f64) -> u32;
+    unsafe fn BeginQHYCCDLive(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDMemLength(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDLiveFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32;
+    unsafe fn StopQHYCCDLive(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn CloseQHYCCD(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn ReleaseQHYCCDResource(&self) -> u32;
+    unsafe fn GetQHYCCDOverScanArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32;
+    unsafe fn GetQHYCCDEffectiveArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32;
+    unsafe fn ExpQHYCCDSingleFrame(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDSingleFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32;
+    unsafe fn GetQHYCCDNumberOfReadModes(&self, handle: QhyccdHandle, num_modes: *mut u32) -> u32;
+    unsafe fn GetQHYCCDReadModeResolution(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        width: *mut u32,
+        height: *mut u32,
+    ) -> u32;
+    unsafe fn GetQHYCCDReadModeName(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        name: *mut c_char,
+    ) -> u32;
+    unsafe fn GetQHYCCDReadMode(&self, handle: QhyccdHandle, mode: *mut u32) -> u32;
+    unsafe fn GetQHYCCDModel(&self, handle: QhyccdHandle, model: *mut c_char) -> u32;
+    unsafe fn GetQHYCCDType(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDExposureRemaining(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn CancelQHYCCDExposing(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn CancelQHYCCDExposingAndReadout(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn IsQHYCCDCFWPlugged(&self, handle: QhyccdHandle) -> u32;
+    unsafe fn GetQHYCCDCFWStatus(&self, handle: QhyccdHandle, status: *mut c_char) -> u32;
+    unsafe fn GetQHYCCDParamMinMaxStep(
+        &self,
+        handle: QhyccdHandle,
+        controlId: u32,
+        min: *mut f64,
+        max: *mut f64,
+        step: *mut f64,
+    ) -> u32;
+}
+
+#[derive(Debug, Default, Clone, Copy)]
+/// The backend calling the QHYCCD SDK linked through `libqhyccd-sys`
+pub struct RealBackend;
+
+#[allow(non_snake_case, clippy::too_many_arguments)]
+impl Backend for RealBackend {
+    unsafe fn InitQHYCCDResource(&self) -> u32 {
+        libqhyccd_sys::InitQHYCCDResource()
+    }
+
+    unsafe fn ScanQHYCCD(&self) -> u32 {
+        libqhyccd_sys::ScanQHYCCD()
+    }
+
+    unsafe fn GetQHYCCDSDKVersion(
+        &self,
+        year: *mut u32,
+        month: *mut u32,
+        day: *mut u32,
+        subday: *mut u32,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDSDKVersion(year, month, day, subday)
+    }
+
+    unsafe fn GetQHYCCDId(&self, index: u32, id: *mut c_char) -> u32 {
+        libqhyccd_sys::GetQHYCCDId(index, id)
+    }
+
+    unsafe fn OpenQHYCCD(&self, id: *const c_char) -> QhyccdHandle {
+        libqhyccd_sys::OpenQHYCCD(id)
+    }
+
+    unsafe fn GetQHYCCDFWVersion(&self, h: QhyccdHandle, buf: *mut u8) -> u32 {
+        libqhyccd_sys::GetQHYCCDFWVersion(h, buf)
+    }
+
+    unsafe fn IsQHYCCDControlAvailable(&self, h: QhyccdHandle, controlId: u32) -> u32 {
+        libqhyccd_sys::IsQHYCCDControlAvailable(h, controlId)
+    }
+
+    unsafe fn SetQHYCCDReadMode(&self, h: QhyccdHandle, mode: u32) -> u32 {
+        libqhyccd_sys::SetQHYCCDReadMode(h, mode)
+    }
+
+    unsafe fn SetQHYCCDStreamMode(&self, h: QhyccdHandle, mode: u8) -> u32 {
+        libqhyccd_sys::SetQHYCCDStreamMode(h, mode)
+    }
+
+    unsafe fn InitQHYCCD(&self, h: QhyccdHandle) -> u32 {
+        libqhyccd_sys::InitQHYCCD(h)
+    }
+
+    unsafe fn GetQHYCCDChipInfo(
+        &self,
+        handle: QhyccdHandle,
+        chipw: *mut f64,
+        chiph: *mut f64,
+        imagew: *mut u32,
+        imageh: *mut u32,
+        pixelw: *mut f64,
+        pixelh: *mut f64,
+        bpp: *mut u32,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDChipInfo(handle, chipw, chiph, imagew, imageh, pixelw, pixelh, bpp)
+    }
+
+    unsafe fn SetQHYCCDBitsMode(&self, handle: QhyccdHandle, bits: u32) -> u32 {
+        libqhyccd_sys::SetQHYCCDBitsMode(handle, bits)
+    }
+
+    unsafe fn SetQHYCCDDebayerOnOff(&self, handle: QhyccdHandle, onoff: bool) -> u32 {
+        libqhyccd_sys::SetQHYCCDDebayerOnOff(handle, onoff)
+    }
+
+    unsafe fn SetQHYCCDBinMode(&self, handle: QhyccdHandle, wbin: u32, hbin: u32) -> u32 {
+        libqhyccd_sys::SetQHYCCDBinMode(handle, wbin, hbin)
+    }
+
+    unsafe fn SetQHYCCDResolution(
+        &self,
+        handle: QhyccdHandle,
+        x: u32,
+        y: u32,
+        xsize: u32,
+        ysize: u32,
+    ) -> u32 {
+        libqhyccd_sys::SetQHYCCDResolution(handle, x, y, xsize, ysize)
+    }
+
+    unsafe fn GetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32) -> f64 {
+        libqhyccd_sys::GetQHYCCDParam(handle, controlId)
+    }
+
+    unsafe fn SetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32, value: f64) -> u32 {
+        libqhyccd_sys::SetQHYCCDParam(handle, controlId, value)
+    }
+
+    unsafe fn BeginQHYCCDLive(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::BeginQHYCCDLive(handle)
+    }
+
+    unsafe fn GetQHYCCDMemLength(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::GetQHYCCDMemLength(handle)
+    }
+
+    unsafe fn GetQHYCCDLiveFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDLiveFrame(handle, w, h, bpp, channels, imgdata)
+    }
+
+    unsafe fn StopQHYCCDLive(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::StopQHYCCDLive(handle)
+    }
+
+    unsafe fn CloseQHYCCD(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::CloseQHYCCD(handle)
+    }
+
+    unsafe fn ReleaseQHYCCDResource(&self) -> u32 {
+        libqhyccd_sys::ReleaseQHYCCDResource()
+    }
+
+    unsafe fn GetQHYCCDOverScanArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDOverScanArea(handle, startx, starty, sizex, sizey)
+    }
+
+    unsafe fn GetQHYCCDEffectiveArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDEffectiveArea(handle, startx, starty, sizex, sizey)
+    }
+
+    unsafe fn ExpQHYCCDSingleFrame(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::ExpQHYCCDSingleFrame(handle)
+    }
+
+    unsafe fn GetQHYCCDSingleFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDSingleFrame(handle, w, h, bpp, channels, imgdata)
+    }
+
+    unsafe fn GetQHYCCDNumberOfReadModes(&self, handle: QhyccdHandle, num_modes: *mut u32) -> u32 {
+        libqhyccd_sys::GetQHYCCDNumberOfReadModes(handle, num_modes)
+    }
+
+    unsafe fn GetQHYCCDReadModeResolution(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        width: *mut u32,
+        height: *mut u32,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDReadModeResolution(handle, mode, width, height)
+    }
+
+    unsafe fn GetQHYCCDReadModeName(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        name: *mut c_char,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDReadModeName(handle, mode, name)
+    }
+
+    unsafe fn GetQHYCCDReadMode(&self, handle: QhyccdHandle, mode: *mut u32) -> u32 {
+        libqhyccd_sys::GetQHYCCDReadMode(handle, mode)
+    }
+
+    unsafe fn GetQHYCCDModel(&self, handle: QhyccdHandle, model: *mut c_char) -> u32 {
+        libqhyccd_sys::GetQHYCCDModel(handle, model)
+    }
+
+    unsafe fn GetQHYCCDType(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::GetQHYCCDType(handle)
+    }
+
+    unsafe fn GetQHYCCDExposureRemaining(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::GetQHYCCDExposureRemaining(handle)
+    }
+
+    unsafe fn CancelQHYCCDExposing(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::CancelQHYCCDExposing(handle)
+    }
+
+    unsafe fn CancelQHYCCDExposingAndReadout(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::CancelQHYCCDExposingAndReadout(handle)
+    }
+
+    unsafe fn IsQHYCCDCFWPlugged(&self, handle: QhyccdHandle) -> u32 {
+        libqhyccd_sys::IsQHYCCDCFWPlugged(handle)
+    }
+
+    unsafe fn GetQHYCCDCFWStatus(&self, handle: QhyccdHandle, status: *mut c_char) -> u32 {
+        libqhyccd_sys::GetQHYCCDCFWStatus(handle, status)
+    }
+
+    unsafe fn GetQHYCCDParamMinMaxStep(
+        &self,
+        handle: QhyccdHandle,
+        controlId: u32,
+        min: *mut f64,
+        max: *mut f64,
+        step: *mut f64,
+    ) -> u32 {
+        libqhyccd_sys::GetQHYCCDParamMinMaxStep(handle, controlId, min, max, step)
+    }
+}
+
+fn cell() -> &'static OnceLock<Arc<dyn Backend>> {
+    static BACKEND: OnceLock<Arc<dyn Backend>> = OnceLock::new();
+    &BACKEND
+}
+
+/// Makes `backend` the SDK used by every `Sdk`, `Camera` and `FilterWheel` of the process. This has to happen
+/// before the first SDK call, which otherwise settles on `RealBackend`, and can only be done once. See
+/// `SimCamera` for simulated cameras.
+/// # Example
+/// ```no_run
+/// use std::sync::Arc;
+/// use qhyccd_rs::{set_backend, RealBackend, Sdk};
+/// set_backend(Arc::new(RealBackend)).expect("set_backend failed");
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// ```
+pub fn set_backend(backend: Arc<dyn Backend>) -> Result<()> {
+    cell().set(backend).map_err(|_| {
+        let error = BackendAlreadySetError;
+        tracing::error!(error = ?error);
+        eyre!(error)
+    })
+}
+
+#[cfg(not(test))]
+fn backend() -> &'static dyn Backend {
+    cell().get_or_init(|| Arc::new(RealBackend)).as_ref()
+}
+
+/// free functions with the signatures of `libqhyccd-sys` that call the selected backend, imported by the
+/// crate in place of the SDK bindings
+#[cfg(not(test))]
+#[allow(non_snake_case, clippy::too_many_arguments)]
+pub(crate) mod ffi {
+    use super::*;
+
+    pub use libqhyccd_sys::{QHYCCD_ERROR, QHYCCD_ERROR_F64, QHYCCD_SUCCESS};
+
+    pub unsafe fn InitQHYCCDResource() -> u32 {
+        backend().InitQHYCCDResource()
+    }
+
+    pub unsafe fn ScanQHYCCD() -> u32 {
+        backend().ScanQHYCCD()
+    }
+
+    pub unsafe fn GetQHYCCDSDKVersion(
+        year: *mut u32,
+        month: *mut u32,
+        day: *mut u32,
+        subday: *mut u32,
+    ) -> u32 {
+        backend().GetQHYCCDSDKVersion(year, month, day, subday)
+    }
+
+    pub unsafe fn GetQHYCCDId(index: u32, id: *mut c_char) -> u32 {
+        backend().GetQHYCCDId(index, id)
+    }
+
+    pub unsafe fn OpenQHYCCD(id: *const c_char) -> QhyccdHandle {
+        backend().OpenQHYCCD(id)
+    }
+
+    pub unsafe fn GetQHYCCDFWVersion(h: QhyccdHandle, buf: *mut u8) -> u32 {
+        backend().GetQHYCCDFWVersion(h, buf)
+    }
+
+    pub unsafe fn IsQHYCCDControlAvailable(h: QhyccdHandle, controlId: u32) -> u32 {
+        backend().IsQHYCCDControlAvailable(h, controlId)
+    }
+
+    pub unsafe fn SetQHYCCDReadMode(h: QhyccdHandle, mode: u32) -> u32 {
+        backend().SetQHYCCDReadMode(h, mode)
+    }
+
+    pub unsafe fn SetQHYCCDStreamMode(h: QhyccdHandle, mode: u8) -> u32 {
+        backend().SetQHYCCDStreamMode(h, mode)
+    }
+
+    pub unsafe fn InitQHYCCD(h: QhyccdHandle) -> u32 {
+        backend().InitQHYCCD(h)
+    }
+
+    pub unsafe fn GetQHYCCDChipInfo(
+        handle: QhyccdHandle,
+        chipw: *mut f64,
+        chiph: *mut f64,
+        imagew: *mut u32,
+        imageh: *mut u32,
+        pixelw: *mut f64,
+        pixelh: *mut f64,
+        bpp: *mut u32,
+    ) -> u32 {
+        backend().GetQHYCCDChipInfo(handle, chipw, chiph, imagew, imageh, pixelw, pixelh, bpp)
+    }
+
+    pub unsafe fn SetQHYCCDBitsMode(handle: QhyccdHandle, bits: u32) -> u32 {
+        backend().SetQHYCCDBitsMode(handle, bits)
+    }
+
+    pub unsafe fn SetQHYCCDDebayerOnOff(handle: QhyccdHandle, onoff: bool) -> u32 {
+        backend().SetQHYCCDDebayerOnOff(handle, onoff)
+    }
+
+    pub unsafe fn SetQHYCCDBinMode(handle: QhyccdHandle, wbin: u32, hbin: u32) -> u32 {
+        backend().SetQHYCCDBinMode(handle, wbin, hbin)
+    }
+
+    pub unsafe fn SetQHYCCDResolution(
+        handle: QhyccdHandle,
+        x: u32,
+        y: u32,
+        xsize: u32,
+        ysize: u32,
+    ) -> u32 {
+        backend().SetQHYCCDResolution(handle, x, y, xsize, ysize)
+    }
+
+    pub unsafe fn GetQHYCCDParam(handle: QhyccdHandle, controlId: u32) -> f64 {
+        backend().GetQHYCCDParam(handle, controlId)
+    }
+
+    pub unsafe fn SetQHYCCDParam(handle: QhyccdHandle, controlId: u32, value: f64) -> u32 {
+        backend().SetQHYCCDParam(handle, controlId, value)
+    }
+
+    pub unsafe fn BeginQHYCCDLive(handle: QhyccdHandle) -> u32 {
+        backend().BeginQHYCCDLive(handle)
+    }
+
+    pub unsafe fn GetQHYCCDMemLength(handle: QhyccdHandle) -> u32 {
+        backend().GetQHYCCDMemLength(handle)
+    }
+
+    pub unsafe fn GetQHYCCDLiveFrame(
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        backend().GetQHYCCDLiveFrame(handle, w, h, bpp, channels, imgdata)
+    }
+
+    pub unsafe fn StopQHYCCDLive(handle: QhyccdHandle) -> u32 {
+        backend().StopQHYCCDLive(handle)
+    }
+
+    pub unsafe fn CloseQHYCCD(handle: QhyccdHandle) -> u32 {
+        backend().CloseQHYCCD(handle)
+    }
+
+    pub unsafe fn ReleaseQHYCCDResource() -> u32 {
+        backend().ReleaseQHYCCDResource()
+    }
+
+    pub unsafe fn GetQHYCCDOverScanArea(
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        backend().GetQHYCCDOverScanArea(handle, startx, starty, sizex, sizey)
+    }
+
+    pub unsafe fn GetQHYCCDEffectiveArea(
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        backend().GetQHYCCDEffectiveArea(handle, startx, starty, sizex, sizey)
+    }
+
+    pub unsafe fn ExpQHYCCDSingleFrame(handle: QhyccdHandle) -> u32 {
+        backend().ExpQHYCCDSingleFrame(handle)
+    }
+
+    pub unsafe fn GetQHYCCDSingleFrame(
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        backend().GetQHYCCDSingleFrame(handle, w, h, bpp, channels, imgdata)
+    }
+
+    pub unsafe fn GetQHYCCDNumberOfReadModes(handle: QhyccdHandle, num_modes: *mut u32) -> u32 {
+        backend().GetQHYCCDNumberOfReadModes(handle, num_modes)
+    }
+
+    pub unsafe fn GetQHYCCDReadModeResolution(
+        handle: QhyccdHandle,
+        mode: u32,
+        width: *mut u32,
+        height: *mut u32,
+    ) -> u32 {
+        backend().GetQHYCCDReadModeResolution(handle, mode, width, height)
+    }
+
+    pub unsafe fn GetQHYCCDReadModeName(handle: QhyccdHandle, mode: u32, name: *mut c_char) -> u32 {
+        backend().GetQHYCCDReadModeName(handle, mode, name)
+    }
+
+    pub unsafe fn GetQHYCCDReadMode(handle: QhyccdHandle, mode: *mut u32) -> u32 {
+        backend().GetQHYCCDReadMode(handle, mode)
+    }
+
+    pub unsafe fn GetQHYCCDModel(handle: QhyccdHandle, model: *mut c_char) -> u32 {
+        backend().GetQHYCCDModel(handle, model)
+    }
+
+    pub unsafe fn GetQHYCCDType(handle: QhyccdHandle) -> u32 {
+        backend().GetQHYCCDType(handle)
+    }
+
+    pub unsafe fn GetQHYCCDExposureRemaining(handle: QhyccdHandle) -> u32 {
+        backend().GetQHYCCDExposureRemaining(handle)
+    }
+
+    pub unsafe fn CancelQHYCCDExposing(handle: QhyccdHandle) -> u32 {
+        backend().CancelQHYCCDExposing(handle)
+    }
+
+    pub unsafe fn CancelQHYCCDExposingAndReadout(handle: QhyccdHandle) -> u32 {
+        backend().CancelQHYCCDExposingAndReadout(handle)
+    }
+
+    pub unsafe fn IsQHYCCDCFWPlugged(handle: QhyccdHandle) -> u32 {
+        backend().IsQHYCCDCFWPlugged(handle)
+    }
+
+    pub unsafe fn GetQHYCCDCFWStatus(handle: QhyccdHandle, status: *mut c_char) -> u32 {
+        backend().GetQHYCCDCFWStatus(handle, status)
+    }
+
+    pub unsafe fn GetQHYCCDParamMinMaxStep(
+        handle: QhyccdHandle,
+        controlId: u32,
+        min: *mut f64,
+        max: *mut f64,
+        step: *mut f64,
+    ) -> u32 {
+        backend().GetQHYCCDParamMinMaxStep(handle, controlId, min, max, step)
+    }
+}
@@ -0,0 +1,380 @@
+#![allow(non_snake_case)]
+//! Serves the last camera found over TCP, one client at a time. Listens on the address given as the first
+//! argument, `127.0.0.1:4711` by default so only clients on the same machine can connect.
+//!
+//! The commands are not authenticated, any client that can connect has full control of the camera. Only
+//! bind a public address such as `0.0.0.0:4711` on a trusted network.
+//!
+//! All numbers are little endian. The client sends commands, a `u8` opcode followed by its arguments, and
+//! gets a reply for each of them in order:
+//!
+//! | opcode | command        | arguments                                                       | reply payload     |
+//! |--------|----------------|-----------------------------------------------------------------|-------------------|
+//! | `0x01` | set parameter  | `u32` control, `f64` value                                      | -                 |
+//! | `0x02` | get parameter  | `u32` control                                                   | `f64` value       |
+//! | `0x03` | reconfigure    | `u32` bit mode, `u32` bin, `u32` x, y, width, height of the ROI | `u64` image size  |
+//! | `0x04` | start stream   | `u32` software bin, `u8` encoding, `i32` compression level      | -                 |
+//! | `0x05` | stop stream    | -                                                               | -                 |
+//!
+//! The control is the `Control` discriminant. Arguments of `reconfigure` that are 0 keep what is set, a ROI
+//! with a width or height of 0 keeps the ROI. A software bin of 0 or 1 sends the frames unbinned, larger
+//! factors average the pixels before sending. The encoding is 0 for the raw pixels and 1 for a zstd frame,
+//! which needs the server to be built with the `zstd` feature.
+//!
+//! The server sends two kinds of messages, the replies and, between start and stop stream, the frames:
+//!
+//! - reply: `u8` 0x81, `u8` opcode, `u8` status, `u32` length, payload. A status of 0 is success, otherwise
+//!   the payload is the error message in UTF-8.
+//! - frame: `u8` 0x82, `u64` sequence, `u32` width, `u32` height, `u8` bits per pixel, `u8` channels,
+//!   `u8` encoding, `u32` length, payload. The sequence has gaps where frames were dropped because the
+//!   client did not keep up.
+//!
+//! A command the server does not know closes the connection, the arguments can not be skipped.
+use std::borrow::Cow;
+use std::io::{self, BufReader, IoSlice, Read, Write};
+use std::net::{TcpListener, TcpStream};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+use eyre::{eyre, Result};
+use qhyccd_rs::{
+    BinningMode, CCDChipArea, Camera, CaptureConfig, Control, ImageData, LiveStreamOptions,
+    OverflowPolicy, Sdk, StreamMode,
+};
+use tracing::{error, info, trace};
+use tracing_subscriber::FmtSubscriber;
+
+const SET_PARAMETER: u8 = 0x01;
+const GET_PARAMETER: u8 = 0x02;
+const RECONFIGURE: u8 = 0x03;
+const START_STREAM: u8 = 0x04;
+const STOP_STREAM: u8 = 0x05;
+
+const REPLY: u8 = 0x81;
+const FRAME: u8 = 0x82;
+
+const ENCODING_RAW: u8 = 0;
+const ENCODING_ZSTD: u8 = 1;
+
+/// how long the streaming thread waits for a frame before it looks at the stop flag again
+const FRAME_TIMEOUT: Duration = Duration::from_millis(100);
+
+/// the socket is shared by the replies and the streaming thread, it writes whole messages only
+type Writer = Arc<Mutex<TcpStream>>;
+
+#[derive(Debug, Clone, Copy)]
+/// how the streaming thread sends the frames
+struct FrameFormat {
+    bin: u32,
+    encoding: u8,
+    #[cfg_attr(not(feature = "zstd"), allow(dead_code))]
+    level: i32,
+}
+
+/// the thread sending the frames of a `LiveStream` to the client, stopped when dropped
+struct Streamer {
+    running: Arc<AtomicBool>,
+    thread: Option<JoinHandle<Result<()>>>,
+}
+
+impl Streamer {
+    fn start(camera: &Camera, writer: Writer, format: FrameFormat) -> Result<Self> {
+        if format.encoding == ENCODING_ZSTD && !cfg!(feature = "zstd") {
+            return Err(eyre!("the server is built without the zstd feature"));
+        }
+        if format.encoding != ENCODING_RAW && format.encoding != ENCODING_ZSTD {
+            return Err(eyre!("unknown encoding {}", format.encoding));
+        }
+        let stream = camera.begin_live_stream(LiveStreamOptions {
+            policy: OverflowPolicy::DropOldest,
+            ..Default::default()
+        })?;
+        let running = Arc::new(AtomicBool::new(true));
+        let keep_running = running.clone();
+        let thread = thread::Builder::new()
+            .name(format!("qhyccd-server-{}", camera.id()))
+            .spawn(move || {
+                let mut sent = 0u64;
+                let result = (|| {
+                    while keep_running.load(Ordering::Acquire) {
+                        if let Some(frame) = stream.next_frame_timeout(FRAME_TIMEOUT)? {
+                            send_frame(&writer, &frame, sent, format)?;
+                            sent += 1;
+                        }
+                    }
+                    Ok(())
+                })();
+                trace!(
+                    sent,
+                    delivered = stream.delivered_frames(),
+                    dropped = stream.dropped_frames()
+                );
+                stream.stop()?;
+                result
+            })?;
+        Ok(Self {
+            running,
+            thread: Some(thread),
+        })
+    }
+
+    fn stop(mut self) -> Result<()> {
+        self.shutdown()
+    }
+
+    fn shutdown(&mut self) -> Result<()> {
+        self.running.store(false, Ordering::Release);
+        match self.thread.take() {
+            Some(thread) => thread
+                .join()
+                .unwrap_or_else(|_| Err(eyre!("the streaming thread panicked"))),
+            None => Ok(()),
+        }
+    }
+}
+
+impl Drop for Streamer {
+    fn drop(&mut self) {
+        if let Err(error) = self.shutdown() {
+            error!(error = ?error);
+        }
+    }
+}
+
+/// sends `frame` binned and encoded as asked, the unbinned raw pixels straight from the pooled buffer
+fn send_frame(writer: &Writer, frame: &ImageData, sent: u64, format: FrameFormat) -> Result<()> {
+    let binned;
+    let image = if format.bin > 1 {
+        binned = frame.bin(format.bin, BinningMode::Average)?;
+        &binned
+    } else {
+        frame
+    };
+    let payload = match format.encoding {
+        #[cfg(feature = "zstd")]
+        ENCODING_ZSTD => {
+            let mut buffer = Vec::new();
+            image.write_zstd(&mut buffer, format.level)?;
+            Cow::Owned(buffer)
+        }
+        // checked by `Streamer::start`, anything else is raw
+        _ => Cow::Borrowed(image.as_u8_slice()),
+    };
+    let sequence = frame
+        .metadata
+        .map(|metadata| metadata.sequence)
+        .unwrap_or(sent);
+    let mut header = Vec::with_capacity(24);
+    header.push(FRAME);
+    header.extend_from_slice(&sequence.to_le_bytes());
+    header.extend_from_slice(&image.width.to_le_bytes());
+    header.extend_from_slice(&image.height.to_le_bytes());
+    header.push(image.bits_per_pixel as u8);
+    header.push(image.channels as u8);
+    header.push(format.encoding);
+    header.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    let mut stream = writer
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    write_all_vectored(&mut stream, &[&header, &payload])?;
+    Ok(())
+}
+
+fn send_reply(writer: &Writer, opcode: u8, result: Result<Vec<u8>>) -> Result<()> {
+    let (status, payload) = match result {
+        Ok(payload) => (0, payload),
+        Err(error) => {
+            error!(opcode, error = ?error);
+            (1, error.to_string().into_bytes())
+        }
+    };
+    let mut header = [REPLY, opcode, status, 0, 0, 0, 0];
+    header[3..].copy_from_slice(&(payload.len() as u32).to_le_bytes());
+    let mut stream = writer
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    write_all_vectored(&mut stream, &[&header, &payload])?;
+    Ok(())
+}
+
+/// writes the header and the payload with as few calls as the socket takes, without copying them into one
+/// buffer first
+fn write_all_vectored(stream: &mut TcpStream, parts: &[&[u8]]) -> io::Result<()> {
+    // the first part not fully written and how much of it is, `IoSlice::advance_slices` needs Rust 1.81
+    let (mut part, mut offset) = (0, 0);
+    let mut written = 0;
+    loop {
+        while part < parts.len() && written >= parts[part].len() - offset {
+            written -= parts[part].len() - offset;
+            part += 1;
+            offset = 0;
+        }
+        if part == parts.len() {
+            return Ok(());
+        }
+        offset += written;
+        let slices: Vec<IoSlice> = std::iter::once(&parts[part][offset..])
+            .chain(parts[part + 1..].iter().copied())
+            .map(IoSlice::new)
+            .collect();
+        written = match stream.write_vectored(&slices) {
+            Ok(0) => return Err(io::ErrorKind::WriteZero.into()),
+            Ok(written) => written,
+            Err(error) if error.kind() == io::ErrorKind::Interrupted => 0,
+            Err(error) => return Err(error),
+        };
+    }
+}
+
+fn read_array<const N: usize>(reader: &mut impl Read) -> io::Result<[u8; N]> {
+    let mut bytes = [0; N];
+    reader.read_exact(&mut bytes)?;
+    Ok(bytes)
+}
+
+fn read_u32(reader: &mut impl Read) -> io::Result<u32> {
+    read_array(reader).map(u32::from_le_bytes)
+}
+
+fn control(id: u32) -> Result<Control> {
+    Control::ALL
+        .iter()
+        .find(|control| **control as u32 == id)
+        .copied()
+        .ok_or_else(|| eyre!("unknown control {}", id))
+}
+
+/// runs the commands of one client until it disconnects
+fn serve(camera: &Camera, stream: TcpStream) -> Result<()> {
+    stream.set_nodelay(true)?;
+    let writer: Writer = Arc::new(Mutex::new(stream.try_clone()?));
+    let mut reader = BufReader::new(stream);
+    let mut streamer: Option<Streamer> = None;
+    let result = loop {
+        let opcode = match read_array::<1>(&mut reader) {
+            Ok([opcode]) => opcode,
+            Err(error) if error.kind() == io::ErrorKind::UnexpectedEof => break Ok(()),
+            Err(error) => break Err(error.into()),
+        };
+        let result = match opcode {
+            SET_PARAMETER => {
+                let id = read_u32(&mut reader)?;
+                let value = f64::from_le_bytes(read_array(&mut reader)?);
+                control(id)
+                    .and_then(|control| camera.set_parameter(control, value))
+                    .map(|_| Vec::new())
+            }
+            GET_PARAMETER => {
+                let id = read_u32(&mut reader)?;
+                control(id)
+                    .and_then(|control| camera.get_parameter(control))
+                    .map(|value| value.to_le_bytes().to_vec())
+            }
+            RECONFIGURE => {
+                let [bit_mode, bin, start_x, start_y, width, height] =
+                    [(); 6].map(|_| read_u32(&mut reader));
+                let roi = CCDChipArea {
+                    start_x: start_x?,
+                    start_y: start_y?,
+                    width: width?,
+                    height: height?,
+                };
+                let config = CaptureConfig {
+                    bit_mode: Some(bit_mode?).filter(|&mode| mode != 0),
+                    bin: Some(bin?).filter(|&bin| bin != 0),
+                    roi: Some(roi).filter(|roi| roi.width != 0 && roi.height != 0),
+                    ..Default::default()
+                };
+                camera
+                    .reconfigure(&config, None)
+                    .map(|done| (done.image_size as u64).to_le_bytes().to_vec())
+            }
+            START_STREAM => {
+                let format = FrameFormat {
+                    bin: read_u32(&mut reader)?,
+                    encoding: read_array::<1>(&mut reader)?[0],
+                    level: i32::from_le_bytes(read_array(&mut reader)?),
+                };
+                match streamer {
+                    Some(_) => Err(eyre!("the stream is running already")),
+                    None => Streamer::start(camera, writer.clone(), format).map(|started| {
+                        streamer = Some(started);
+                        Vec::new()
+                    }),
+                }
+            }
+            STOP_STREAM => streamer
+                .take()
+                .map_or(Ok(()), Streamer::stop)
+                .map(|_| Vec::new()),
+            _ => break Err(eyre!("unknown command {:#04x}", opcode)),
+        };
+        if let Err(error) = send_reply(&writer, opcode, result) {
+            break Err(error);
+        }
+    };
+    if let Some(streamer) = streamer {
+        streamer.stop()?;
+    }
+    result
+}
+
+fn main() {
+    let subscriber = FmtSubscriber::builder()
+        .with_max_level(tracing::Level::INFO)
+        .finish();
+
+    tracing::subscriber::set_global_default(subscriber).expect("setting default subscriber failed");
+
+    let address = std::env::args()
+        .nth(1)
+        .unwrap_or_else(|| "127.0.0.1:4711".to_owned());
+
+    let sdk = Sdk::new().expect("SDK::new failed");
+    let camera = sdk.cameras().last().expect("no camera found").clone();
+    info!(camera = ?camera);
+
+    camera.open().expect("open_camera failed");
+    if camera
+        .is_control_available(Control::CamLiveVideoMode)
+        .is_none()
+    {
+        panic!("Control::CamLiveVideoMode is not supported");
+    }
+    let effective_area = camera
+        .get_effective_area()
+        .expect("get_camera_effective_area failed");
+    camera
+        .reconfigure(
+            &CaptureConfig {
+                stream_mode: Some(StreamMode::LiveMode),
+                readout_mode: Some(0),
+                bit_mode: Some(16),
+                bin: Some(1),
+                roi: Some(effective_area),
+                ..Default::default()
+            },
+            None,
+        )
+        .expect("reconfigure failed");
+
+    let listener = TcpListener::bind(&address).expect("binding the address failed");
+    info!(address, "listening");
+    for client in listener.incoming() {
+        let client = match client {
+            Ok(client) => client,
+            Err(error) => {
+                error!(error = ?error);
+                continue;
+            }
+        };
+        let peer = client.peer_addr().ok();
+        info!(peer = ?peer, "client connected");
+        if let Err(error) = serve(&camera, client) {
+            error!(peer = ?peer, error = ?error);
+        }
+        info!(peer = ?peer, "client disconnected");
+    }
+}
@@ -1,7 +1,5 @@
 #![allow(non_snake_case)]
-use std::{thread, time::Duration};
-
-use qhyccd_rs::{Control, Sdk, StreamMode};
+use qhyccd_rs::{Control, LiveStreamOptions, Sdk, StreamMode};
 use tracing::trace;
 use tracing_subscriber::FmtSubscriber;
 
@@ -81,22 +79,17 @@ fn main() {
         .set_parameter(Control::DDR, 1.0)
         .expect("set_camera_parameter failed");
     trace!(control_ddr = 1.0);
-    camera.begin_live().expect("begin_camera_live failed");
-    let size = camera
-        .get_image_size()
-        .expect("get_camera_image_size failed");
-    trace!(image_size = ?size);
+    let stream = camera
+        .begin_live_stream(LiveStreamOptions::default())
+        .expect("begin_live_stream failed");
 
     for _ in 0..1000 {
-        let result = camera.get_live_frame(size);
-        if result.is_err() {
-            trace!("get_camera_live_frame returned error");
-            thread::sleep(Duration::from_millis(100));
-            continue;
-        }
-        let image = result.unwrap();
+        let image = stream.next_frame().expect("next_frame failed");
         trace!(image = ?image);
-        break;
     }
-    camera.end_live().expect("end_camera_live failed");
+    trace!(
+        delivered = stream.delivered_frames(),
+        dropped = stream.dropped_frames()
+    );
+    stream.stop().expect("stopping live stream failed");
 }
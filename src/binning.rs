@@ -0,0 +1,159 @@
+use eyre::{eyre, Result};
+
+use crate::parallel::for_each_row_band;
+use crate::samples::{u16_image_data, u16_samples};
+use crate::QHYError::{InvalidBinningError, UnsupportedImageError};
+use crate::{ImageData, ImageView};
+
+/// the largest supported binning factor, 8x8 16 bit sums still fit into the u32 accumulators
+const MAX_FACTOR: u32 = 8;
+
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+/// How `ImageData::bin` combines the pixels of a bin
+pub enum BinningMode {
+    /// adds the pixels up, saturating at the maximum value of the sample type. This is what the camera does
+    /// in hardware and keeps the most signal of faint objects.
+    Sum,
+    /// rounds the mean of the pixels, keeps the brightness of the image
+    Average,
+}
+
+trait BinSample: Copy + Default + Send + Sync + Into<u32> {
+    fn from_u32(value: u32) -> Self;
+}
+
+impl BinSample for u8 {
+    #[inline(always)]
+    fn from_u32(value: u32) -> Self {
+        value.min(u8::MAX as u32) as u8
+    }
+}
+
+impl BinSample for u16 {
+    #[inline(always)]
+    fn from_u32(value: u32) -> Self {
+        value.min(u16::MAX as u32) as u16
+    }
+}
+
+impl ImageData {
+    /// Bins the image in software by `factor` in both directions, e.g. 2 for 2x2 binning. Pixels on the right
+    /// and bottom edge that do not fill a whole bin are dropped, just like with hardware binning. Unlike
+    /// `set_bin_mode` this does not touch the camera, so a live stream can switch between full and binned
+    /// frames without being restarted, and factors without `Control::CamBin3x3mode` and friends work too.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::{BinningMode, ImageData};
+    /// let image = ImageData { data: vec![1, 2, 3, 4], width: 2, height: 2, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let binned = image.bin(2, BinningMode::Sum).expect("bin failed");
+    /// assert_eq!(binned.data, vec![10]);
+    /// ```
+    pub fn bin(&self, factor: u32, mode: BinningMode) -> Result<ImageData> {
+        self.full_view()?.bin(factor, mode)
+    }
+}
+
+impl ImageView<'_> {
+    /// Bins the pixels of the view, see `ImageData::bin`
+    pub fn bin(&self, factor: u32, mode: BinningMode) -> Result<ImageData> {
+        if !(1..=MAX_FACTOR).contains(&factor) || self.width() < factor || self.height() < factor {
+            let error = InvalidBinningError { factor };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        if self.channels() == 0 || !(1..=16).contains(&self.bits_per_pixel()) {
+            let error = UnsupportedImageError {
+                bits_per_pixel: self.bits_per_pixel(),
+                channels: self.channels(),
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let factor = factor as usize;
+        let channels = self.channels() as usize;
+        let width = self.width() as usize / factor;
+        let height = self.height() as usize / factor;
+        let samples = width * height * channels;
+        let data = match self.bytes_per_sample() {
+            1 => {
+                let rows: Vec<&[u8]> = self.rows().collect();
+                let mut data = vec![0_u8; samples];
+                bin_rows(&rows, factor, channels, mode, width * channels, &mut data);
+                data
+            }
+            _ => {
+                let rows: Vec<_> = self.rows().map(u16_samples).collect();
+                let rows: Vec<&[u16]> = rows.iter().map(|row| row.as_ref()).collect();
+                u16_image_data(samples, |out| {
+                    bin_rows(&rows, factor, channels, mode, width * channels, out)
+                })
+            }
+        };
+        Ok(ImageData {
+            data,
+            width: width as u32,
+            height: height as u32,
+            bits_per_pixel: self.bits_per_pixel(),
+            channels: self.channels(),
+            metadata: self.metadata(),
+        })
+    }
+}
+
+fn bin_rows<S: BinSample>(
+    rows: &[&[S]],
+    factor: usize,
+    channels: usize,
+    mode: BinningMode,
+    row_len: usize,
+    out: &mut [S],
+) {
+    let pixels = (factor * factor) as u32;
+    for_each_row_band(out, row_len, |first_row, band| {
+        let mut sums = vec![0_u32; row_len];
+        for (offset, out_row) in band.chunks_exact_mut(row_len).enumerate() {
+            let y = (first_row + offset) * factor;
+            sums.fill(0);
+            for row in &rows[y..y + factor] {
+                add_row(row, factor, channels, &mut sums);
+            }
+            match mode {
+                BinningMode::Sum => {
+                    for (out, &sum) in out_row.iter_mut().zip(&sums) {
+                        *out = S::from_u32(sum);
+                    }
+                }
+                BinningMode::Average => {
+                    for (out, &sum) in out_row.iter_mut().zip(&sums) {
+                        *out = S::from_u32((sum + pixels / 2) / pixels);
+                    }
+                }
+            }
+        }
+    });
+}
+
+/// adds the horizontal bins of one input row to `sums`, the common mono cases get a loop with a constant bin
+/// width that the compiler can vectorize
+fn add_row<S: BinSample>(row: &[S], factor: usize, channels: usize, sums: &mut [u32]) {
+    match (channels, factor) {
+        (1, 2) => add_mono_row::<S, 2>(row, sums),
+        (1, 3) => add_mono_row::<S, 3>(row, sums),
+        (1, 4) => add_mono_row::<S, 4>(row, sums),
+        _ => {
+            for (index, sum) in sums.iter_mut().enumerate() {
+                let first = (index / channels) * factor * channels + index % channels;
+                *sum += (0..factor)
+                    .map(|k| row[first + k * channels].into())
+                    .sum::<u32>();
+            }
+        }
+    }
+}
+
+#[inline(always)]
+fn add_mono_row<S: BinSample, const FACTOR: usize>(row: &[S], sums: &mut [u32]) {
+    for (sum, bin) in sums.iter_mut().zip(row.chunks_exact(FACTOR)) {
+        *sum += bin.iter().map(|&sample| sample.into()).sum::<u32>();
+    }
+}
@@ -0,0 +1,444 @@
+use eyre::{eyre, Result};
+
+use crate::parallel::for_each_row_band;
+use crate::samples::u16_samples;
+use crate::QHYError::{FrameMismatchError, StackEmptyError, UnsupportedImageError};
+use crate::{FrameInfo, ImageData};
+
+/// frames every pixel takes before `StackMethod::SigmaClip` starts rejecting, the mean and spread of fewer
+/// samples are too rough to tell outliers
+const SIGMA_CLIP_WARMUP: u32 = 5;
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+/// How a `Stacker` combines the frames into a master frame
+pub enum StackMethod {
+    /// the mean of all frames, keeps a running sum per sample
+    Mean,
+    /// the mean of the samples within `kappa` standard deviations of the running mean of that pixel, which
+    /// drops cosmic rays, satellites and hot pixels that only show in some frames. The mean and variance are
+    /// updated incrementally with Welford's algorithm, a sample is rejected if it is further off than `kappa`
+    /// standard deviations, but at least `kappa` ADU.
+    SigmaClip {
+        /// how many standard deviations a sample may be off the mean, 3.0 is common
+        kappa: f64,
+    },
+    /// the median of all frames. This keeps every frame in memory until `finish`, two bytes per sample and
+    /// frame.
+    Median,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+/// A master bias, dark or flat built by a `Stacker`. The samples are kept as `f32`, so averaging many frames
+/// does not round away the extra precision.
+pub struct MasterFrame {
+    /// the width of the frame in pixels
+    pub width: u32,
+    /// the height of the frame in pixels
+    pub height: u32,
+    /// the number of channels
+    pub channels: u32,
+    /// the number of frames that were stacked
+    pub frames: usize,
+    /// the samples, `width * height * channels` of them
+    pub data: Vec<f32>,
+}
+
+impl MasterFrame {
+    /// Returns the mean over all samples
+    pub fn mean(&self) -> f64 {
+        match self.data.len() {
+            0 => 0.0,
+            len => self.data.iter().map(|&sample| sample as f64).sum::<f64>() / len as f64,
+        }
+    }
+
+    /// Rounds the samples to a 16 bit image, e.g. to save the master as FITS
+    pub fn to_image(&self) -> ImageData {
+        let data = self
+            .data
+            .iter()
+            .flat_map(|&sample| (sample.round().clamp(0.0, u16::MAX as f32) as u16).to_le_bytes())
+            .collect();
+        ImageData {
+            data,
+            width: self.width,
+            height: self.height,
+            bits_per_pixel: 16,
+            channels: self.channels,
+            metadata: None,
+        }
+    }
+
+    fn check(&self, width: u32, height: u32, channels: u32) -> Result<()> {
+        check_geometry(
+            (self.width, self.height, self.channels),
+            (width, height, channels),
+        )
+    }
+}
+
+#[derive(Debug)]
+enum Accumulator {
+    Mean {
+        sums: Vec<u64>,
+    },
+    SigmaClip {
+        kappa: f32,
+        /// per sample: accepted frames, running mean and sum of squared differences from the mean
+        pixels: Vec<(u32, f32, f32)>,
+    },
+    Median {
+        frames: Vec<Vec<u16>>,
+    },
+}
+
+#[derive(Debug)]
+/// Stacks frames into a master bias, dark or flat while they arrive, e.g. from the sink of a `Sequencer`, so
+/// the single frames never have to be saved. All frames must have the same size and number of channels as
+/// the first one.
+/// # Example
+/// ```no_run
+/// use std::sync::Mutex;
+/// use std::time::Duration;
+/// use qhyccd_rs::{Sdk,Sequencer,SequencerOptions,SequenceStep,Stacker,StackMethod,FitsHeader};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// /* open, init and set up the camera in Single Frame Mode with the cover on */
+/// let sequencer = Sequencer::new(camera, None, SequencerOptions::default());
+/// let plan = [SequenceStep { count: 100, exposure: Duration::from_secs(300), gain: Some(30.0), filter: None }];
+/// let stacker = Mutex::new(Stacker::new(StackMethod::SigmaClip { kappa: 3.0 }));
+/// sequencer
+///     .run(&plan, |frame| stacker.lock().unwrap().add(&frame.image))
+///     .expect("sequence failed");
+/// let dark = stacker.into_inner().unwrap().finish().expect("finish failed");
+/// dark.to_image().save_fits("master_dark.fits", &FitsHeader::new()).expect("save_fits failed");
+/// ```
+pub struct Stacker {
+    method: StackMethod,
+    info: Option<FrameInfo>,
+    frames: usize,
+    accumulator: Option<Accumulator>,
+}
+
+impl Stacker {
+    /// Creates an empty stack, the memory is allocated with the first frame
+    pub fn new(method: StackMethod) -> Self {
+        Self {
+            method,
+            info: None,
+            frames: 0,
+            accumulator: None,
+        }
+    }
+
+    /// Returns the number of frames added so far
+    pub fn frames(&self) -> usize {
+        self.frames
+    }
+
+    /// Adds a frame to the stack, 8 and 16 bit frames are supported
+    pub fn add(&mut self, frame: &ImageData) -> Result<()> {
+        if frame.bytes_per_sample() > 2 || frame.bytes_per_sample() == 0 {
+            let error = UnsupportedImageError {
+                bits_per_pixel: frame.bits_per_pixel,
+                channels: frame.channels,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let info = frame.info();
+        if let Some(expected) = self.info {
+            check_geometry(
+                (expected.width, expected.height, expected.channels),
+                (info.width, info.height, info.channels),
+            )?;
+        }
+        let samples = widen(frame);
+        let len = samples.len();
+        let row_len = (info.width as usize * info.channels as usize).max(1);
+        let accumulator = self.accumulator.get_or_insert_with(|| match self.method {
+            StackMethod::Mean => Accumulator::Mean { sums: vec![0; len] },
+            StackMethod::SigmaClip { kappa } => Accumulator::SigmaClip {
+                kappa: kappa as f32,
+                pixels: vec![(0, 0.0, 0.0); len],
+            },
+            StackMethod::Median => Accumulator::Median { frames: Vec::new() },
+        });
+        match accumulator {
+            Accumulator::Mean { sums } => for_each_row_band(sums, row_len, |first_row, band| {
+                let samples = &samples[first_row * row_len..];
+                for (sum, &sample) in band.iter_mut().zip(samples) {
+                    *sum += sample as u64;
+                }
+            }),
+            Accumulator::SigmaClip { kappa, pixels } => {
+                let kappa = *kappa;
+                for_each_row_band(pixels, row_len, |first_row, band| {
+                    let samples = &samples[first_row * row_len..];
+                    for (pixel, &sample) in band.iter_mut().zip(samples) {
+                        add_clipped(pixel, sample as f32, kappa);
+                    }
+                })
+            }
+            Accumulator::Median { frames } => frames.push(samples.into_owned()),
+        }
+        self.info = Some(info);
+        self.frames += 1;
+        Ok(())
+    }
+
+    /// Returns the master frame of all frames added so far, the stack can take more frames afterwards
+    pub fn finish(&self) -> Result<MasterFrame> {
+        let (Some(info), Some(accumulator)) = (self.info, &self.accumulator) else {
+            tracing::error!(error = ?StackEmptyError);
+            return Err(eyre!(StackEmptyError));
+        };
+        let row_len = (info.width as usize * info.channels as usize).max(1);
+        let len = row_len * info.height as usize;
+        let mut data = vec![0.0_f32; len];
+        match accumulator {
+            Accumulator::Mean { sums } => {
+                let frames = self.frames as f64;
+                for_each_row_band(&mut data, row_len, |first_row, band| {
+                    for (out, &sum) in band.iter_mut().zip(&sums[first_row * row_len..]) {
+                        *out = (sum as f64 / frames) as f32;
+                    }
+                })
+            }
+            Accumulator::SigmaClip { pixels, .. } => {
+                for_each_row_band(&mut data, row_len, |first_row, band| {
+                    for (out, &(_, mean, _)) in band.iter_mut().zip(&pixels[first_row * row_len..])
+                    {
+                        *out = mean;
+                    }
+                })
+            }
+            Accumulator::Median { frames } => {
+                for_each_row_band(&mut data, row_len, |first_row, band| {
+                    let first = first_row * row_len;
+                    let mut values = Vec::with_capacity(frames.len());
+                    for (index, out) in band.iter_mut().enumerate() {
+                        values.clear();
+                        values.extend(frames.iter().map(|frame| frame[first + index]));
+                        *out = median(&mut values);
+                    }
+                })
+            }
+        }
+        Ok(MasterFrame {
+            width: info.width,
+            height: info.height,
+            channels: info.channels,
+            frames: self.frames,
+            data,
+        })
+    }
+}
+
+/// one Welford step for a pixel of a sigma clipped stack
+#[inline(always)]
+fn add_clipped(pixel: &mut (u32, f32, f32), sample: f32, kappa: f32) {
+    let (count, mean, m2) = pixel;
+    if *count >= SIGMA_CLIP_WARMUP {
+        // the floor keeps a pixel that was flat so far from rejecting every other value
+        let stddev = (*m2 / *count as f32).sqrt().max(1.0);
+        if (sample - *mean).abs() > kappa * stddev {
+            return;
+        }
+    }
+    *count += 1;
+    let delta = sample - *mean;
+    *mean += delta / *count as f32;
+    *m2 += delta * (sample - *mean);
+}
+
+fn median(values: &mut [u16]) -> f32 {
+    let len = values.len();
+    let (below, &mut upper, _) = values.select_nth_unstable(len / 2);
+    match len % 2 {
+        1 => upper as f32,
+        _ => (upper as f32 + *below.iter().max().expect("two or more values") as f32) / 2.0,
+    }
+}
+
+/// the samples of an 8 or 16 bit frame as u16
+fn widen(frame: &ImageData) -> std::borrow::Cow<'_, [u16]> {
+    match frame.bytes_per_sample() {
+        1 => frame
+            .as_u8_slice()
+            .iter()
+            .map(|&sample| sample as u16)
+            .collect(),
+        _ => u16_samples(frame.as_u8_slice()),
+    }
+}
+
+fn check_geometry(expected: (u32, u32, u32), actual: (u32, u32, u32)) -> Result<()> {
+    if expected == actual {
+        return Ok(());
+    }
+    let error = FrameMismatchError {
+        width: actual.0,
+        height: actual.1,
+        channels: actual.2,
+        expected_width: expected.0,
+        expected_height: expected.1,
+        expected_channels: expected.2,
+    };
+    tracing::error!(error = ?error);
+    Err(eyre!(error))
+}
+
+#[derive(Debug, Clone, PartialEq)]
+/// Master frames prepared for `ImageData::apply_calibration`. Bias and dark are combined into one offset per
+/// sample and the flat into one gain per sample, so calibrating a frame is a subtraction and a multiplication
+/// per sample.
+pub struct Calibration {
+    width: u32,
+    height: u32,
+    channels: u32,
+    offset: Vec<f32>,
+    gain: Option<Vec<f32>>,
+}
+
+impl Calibration {
+    /// Prepares the master frames, all of them must have the same size. The dark must not contain the bias
+    /// if a bias is given as well, i.e. it has to be stacked from bias subtracted frames. Otherwise leave out
+    /// the bias, the dark then removes both. The flat is normalized to its mean after subtracting the bias.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::{Calibration, ImageData, MasterFrame};
+    /// let master = |data: Vec<f32>| MasterFrame { width: 2, height: 1, channels: 1, frames: 1, data };
+    /// let calibration = Calibration::new(None, Some(&master(vec![10.0, 20.0])), Some(&master(vec![1.0, 0.5])))
+    ///     .expect("Calibration::new failed");
+    /// let mut frame = ImageData { data: vec![60, 45], width: 2, height: 1, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// frame.apply_calibration(&calibration).expect("apply_calibration failed");
+    /// assert_eq!(frame.data, vec![38, 38]);
+    /// ```
+    pub fn new(
+        bias: Option<&MasterFrame>,
+        dark: Option<&MasterFrame>,
+        flat: Option<&MasterFrame>,
+    ) -> Result<Self> {
+        let masters = [bias, dark, flat];
+        let Some(first) = masters.iter().flatten().next() else {
+            tracing::error!(error = ?StackEmptyError);
+            return Err(eyre!(StackEmptyError));
+        };
+        for master in masters.iter().flatten() {
+            master.check(first.width, first.height, first.channels)?;
+        }
+        let len = first.data.len();
+        let mut offset = vec![0.0_f32; len];
+        for master in [bias, dark].into_iter().flatten() {
+            for (offset, &sample) in offset.iter_mut().zip(&master.data) {
+                *offset += sample;
+            }
+        }
+        let gain = flat.map(|flat| {
+            let flat: Vec<f32> = match bias {
+                Some(bias) => flat
+                    .data
+                    .iter()
+                    .zip(&bias.data)
+                    .map(|(&flat, &bias)| flat - bias)
+                    .collect(),
+                None => flat.data.clone(),
+            };
+            let mean = flat.iter().map(|&sample| sample as f64).sum::<f64>() / len.max(1) as f64;
+            // dead pixels of the flat are left alone instead of blowing up
+            flat.iter()
+                .map(|&sample| match sample > 0.0 {
+                    true => (mean / sample as f64) as f32,
+                    false => 1.0,
+                })
+                .collect()
+        });
+        Ok(Self {
+            width: first.width,
+            height: first.height,
+            channels: first.channels,
+            offset,
+            gain,
+        })
+    }
+}
+
+trait CalibrationSample: Copy + Send + Into<f32> {
+    const MAX: f32;
+    fn from_f32(value: f32) -> Self;
+}
+
+impl CalibrationSample for u8 {
+    const MAX: f32 = u8::MAX as f32;
+    #[inline(always)]
+    fn from_f32(value: f32) -> Self {
+        value as u8
+    }
+}
+
+impl CalibrationSample for u16 {
+    const MAX: f32 = u16::MAX as f32;
+    #[inline(always)]
+    fn from_f32(value: f32) -> Self {
+        value as u16
+    }
+}
+
+impl ImageData {
+    /// Subtracts bias and dark and divides by the flat in place, e.g. right on the buffer of a
+    /// `PooledImageData`. Results are rounded and clamped to the range of the sample type. The work is spread
+    /// over all cores in bands of rows, the inner loop has no branches so the compiler vectorizes it.
+    pub fn apply_calibration(&mut self, calibration: &Calibration) -> Result<()> {
+        check_geometry(
+            (calibration.width, calibration.height, calibration.channels),
+            (self.width, self.height, self.channels),
+        )?;
+        let row_len = (self.width as usize * self.channels as usize).max(1);
+        match self.bytes_per_sample() {
+            1 => calibrate(self.as_u8_slice_mut(), row_len, calibration),
+            2 => match self.as_u16_slice_mut() {
+                Some(samples) => calibrate(samples, row_len, calibration),
+                None => {
+                    // not aligned, calibrate a copy
+                    let mut samples = u16_samples(self.as_u8_slice()).into_owned();
+                    calibrate(&mut samples, row_len, calibration);
+                    for (bytes, sample) in self.as_u8_slice_mut().chunks_exact_mut(2).zip(samples) {
+                        bytes.copy_from_slice(&sample.to_le_bytes());
+                    }
+                }
+            },
+            _ => {
+                let error = UnsupportedImageError {
+                    bits_per_pixel: self.bits_per_pixel,
+                    channels: self.channels,
+                };
+                tracing::error!(error = ?error);
+                return Err(eyre!(error));
+            }
+        }
+        Ok(())
+    }
+}
+
+fn calibrate<S: CalibrationSample>(samples: &mut [S], row_len: usize, calibration: &Calibration) {
+    for_each_row_band(samples, row_len, |first_row, band| {
+        let first = first_row * row_len;
+        let offset = &calibration.offset[first..first + band.len()];
+        match &calibration.gain {
+            Some(gain) => {
+                let gain = &gain[first..first + band.len()];
+                for ((sample, &offset), &gain) in band.iter_mut().zip(offset).zip(gain) {
+                    let value = ((*sample).into() - offset) * gain;
+                    *sample = S::from_f32((value + 0.5).clamp(0.0, S::MAX));
+                }
+            }
+            None => {
+                for (sample, &offset) in band.iter_mut().zip(offset) {
+                    let value = (*sample).into() - offset;
+                    *sample = S::from_f32((value + 0.5).clamp(0.0, S::MAX));
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,145 @@
+use std::collections::HashMap;
+use std::sync::Arc;
+
+use eyre::{eyre, Result};
+
+use crate::QHYError::CameraNotOpenError;
+use crate::{CCDChipArea, CCDChipInfo, Camera, Control, ReadoutMode};
+
+#[derive(Debug, PartialEq, Clone, Copy)]
+/// What the SDK reported for a single control in `CameraCapabilities`
+pub struct ControlCapability {
+    /// the value returned by `is_control_available`, e.g. the `BayerID` for `Control::CamColor`
+    pub value: u32,
+    /// min, max and step as returned by `get_parameter_min_max_step`, `None` if the control has no range
+    pub min_max_step: Option<(f64, f64, f64)>,
+}
+
+#[derive(Debug, PartialEq, Clone)]
+/// A readout mode together with the resolution the camera has in this mode
+pub struct ReadoutModeCapability {
+    /// id and name of the mode
+    pub mode: ReadoutMode,
+    /// width and height in pixels as returned by `get_readout_mode_resolution`
+    pub resolution: (u32, u32),
+}
+
+#[derive(Debug, PartialEq, Clone)]
+/// A snapshot of everything about a camera that does not change while it is open, see `Camera::capabilities`.
+/// Queries the SDK could not answer are left out, the corresponding `Camera` methods then still ask the SDK.
+pub struct CameraCapabilities {
+    /// all supported controls, controls missing here are not available
+    pub controls: HashMap<Control, ControlCapability>,
+    /// as returned by `get_ccd_info` for the readout mode active when the snapshot was taken, dropped by
+    /// `set_bit_mode` and `set_bin_mode`
+    pub ccd_info: Option<CCDChipInfo>,
+    /// as returned by `get_effective_area`
+    pub effective_area: Option<CCDChipArea>,
+    /// as returned by `get_overscan_area`
+    pub overscan_area: Option<CCDChipArea>,
+    /// all readout modes with their names and resolutions
+    pub readout_modes: Vec<ReadoutModeCapability>,
+}
+
+impl CameraCapabilities {
+    /// Returns `Some(value)` if the control is supported, the same as `Camera::is_control_available`
+    pub fn is_control_available(&self, control: Control) -> Option<u32> {
+        self.controls
+            .get(&control)
+            .map(|capability| capability.value)
+    }
+
+    /// Returns min, max and step of a control if it is supported and has a range
+    pub fn min_max_step(&self, control: Control) -> Option<(f64, f64, f64)> {
+        self.controls.get(&control)?.min_max_step
+    }
+
+    fn query(camera: &Camera) -> Result<Self> {
+        if !camera.is_open()? {
+            tracing::error!(error = ?CameraNotOpenError);
+            return Err(eyre!(CameraNotOpenError));
+        }
+        let controls = Control::ALL
+            .iter()
+            .filter_map(|&control| {
+                let value = camera.is_control_available(control)?;
+                let min_max_step = camera.get_parameter_min_max_step(control).ok();
+                Some((
+                    control,
+                    ControlCapability {
+                        value,
+                        min_max_step,
+                    },
+                ))
+            })
+            .collect();
+        let readout_modes = match camera.get_number_of_readout_modes() {
+            Ok(count) => (0..count)
+                .filter_map(|id| {
+                    let name = camera.get_readout_mode_name(id).ok()?;
+                    let resolution = camera.get_readout_mode_resolution(id).ok()?;
+                    Some(ReadoutModeCapability {
+                        mode: ReadoutMode { id, name },
+                        resolution,
+                    })
+                })
+                .collect(),
+            Err(_) => Vec::new(),
+        };
+        Ok(Self {
+            controls,
+            ccd_info: camera.get_ccd_info().ok(),
+            effective_area: camera.get_effective_area().ok(),
+            overscan_area: camera.get_overscan_area().ok(),
+            readout_modes,
+        })
+    }
+}
+
+impl Camera {
+    /// Returns the capabilities of the camera. They are queried from the SDK on the first call and cached
+    /// until the camera is closed or the readout mode changes, call this after `init`. While the snapshot is
+    /// cached `is_control_available`, `get_parameter_min_max_step`, `get_ccd_info`, `get_effective_area`,
+    /// `get_overscan_area` and the readout mode queries answer from it without asking the SDK. The chip info
+    /// depends on the bit mode and binning, so `set_bit_mode` and `set_bin_mode` drop it from the snapshot.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Control};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.init().expect("init failed");
+    /// let capabilities = camera.capabilities().expect("capabilities failed");
+    /// if let Some((min, max, step)) = capabilities.min_max_step(Control::Gain) {
+    ///     println!("gain from {} to {} in steps of {}", min, max, step);
+    /// }
+    /// ```
+    pub fn capabilities(&self) -> Result<Arc<CameraCapabilities>> {
+        if let Some(capabilities) = self.cached_capabilities() {
+            return Ok(capabilities);
+        }
+        self.refresh_capabilities()
+    }
+
+    /// Queries the capabilities from the SDK again and replaces the cached snapshot
+    pub fn refresh_capabilities(&self) -> Result<Arc<CameraCapabilities>> {
+        // holding the open/close lock keeps a concurrent close from being overwritten with a stale snapshot
+        let _lock = self.handle.lock_open_close();
+        self.handle.set_capabilities(None);
+        let capabilities = Arc::new(CameraCapabilities::query(self)?);
+        self.handle.set_capabilities(Some(capabilities.clone()));
+        Ok(capabilities)
+    }
+
+    pub(crate) fn cached_capabilities(&self) -> Option<Arc<CameraCapabilities>> {
+        self.handle.capabilities()
+    }
+
+    pub(crate) fn cached_readout_mode(&self, id: u32) -> Option<ReadoutModeCapability> {
+        self.cached_capabilities()?
+            .readout_modes
+            .iter()
+            .find(|mode| mode.mode.id == id)
+            .cloned()
+    }
+}
@@ -0,0 +1,390 @@
+use std::fs::File;
+use std::io::Write;
+use std::path::Path;
+
+use eyre::{eyre, Result, WrapErr};
+
+use crate::fits::{block_len, push_card, push_cards, push_end, BLOCK_LEN};
+use crate::parallel::for_each_item_band;
+use crate::samples::u16_samples;
+use crate::QHYError::{BufferTooSmallError, UnsupportedImageError, WriteFitsError};
+use crate::{FitsHeader, FitsValue, ImageData};
+
+/// the number of pixels per Rice block, the value fpack uses
+const RICE_BLOCK_SIZE: usize = 32;
+/// keywords of the compressed image extension, they are skipped if they are in a `FitsHeader`
+const COMPRESSED_KEYS: [&str; 22] = [
+    "XTENSION", "EXTEND", "PCOUNT", "GCOUNT", "TFIELDS", "TTYPE1", "TFORM1", "ZIMAGE", "ZCMPTYPE",
+    "ZBITPIX", "ZNAXIS", "ZNAXIS1", "ZNAXIS2", "ZNAXIS3", "ZTILE1", "ZTILE2", "ZTILE3", "ZNAME1",
+    "ZVAL1", "ZNAME2", "ZVAL2", "ZQUANTIZ",
+];
+
+/// A sample type that can be Rice coded, the constants are the ones of the FITS tiled image convention
+trait RiceSample: Copy + Send + Sync {
+    /// the number of bits of the block header holding the split position
+    const FS_BITS: u32;
+    /// split positions from here on are written as raw differences
+    const FS_MAX: u32;
+    /// the number of bits of a sample
+    const BITS: u32;
+    /// the value FITS stores for the sample
+    fn stored(self) -> u32;
+    /// the difference to the previous sample mapped to an unsigned number, small differences of both signs
+    /// become small numbers
+    fn difference(self, previous: Self) -> u32;
+}
+
+impl RiceSample for u8 {
+    const FS_BITS: u32 = 3;
+    const FS_MAX: u32 = 6;
+    const BITS: u32 = 8;
+
+    fn stored(self) -> u32 {
+        self.into()
+    }
+
+    #[inline(always)]
+    fn difference(self, previous: Self) -> u32 {
+        let difference = self.wrapping_sub(previous) as i8;
+        ((difference << 1) ^ (difference >> 7)) as u8 as u32
+    }
+}
+
+impl RiceSample for u16 {
+    const FS_BITS: u32 = 4;
+    const FS_MAX: u32 = 14;
+    const BITS: u32 = 16;
+
+    /// FITS stores unsigned 16 bit samples as i16 with `BZERO = 32768`, see `ImageData::write_fits`
+    fn stored(self) -> u32 {
+        (self ^ 0x8000).into()
+    }
+
+    /// flipping the sign bit of both samples does not change their difference modulo 2^16, so it can be
+    /// computed on the unsigned samples
+    #[inline(always)]
+    fn difference(self, previous: Self) -> u32 {
+        let difference = self.wrapping_sub(previous) as i16;
+        ((difference << 1) ^ (difference >> 15)) as u16 as u32
+    }
+}
+
+/// writes bits most significant first
+struct BitWriter<'a> {
+    out: &'a mut Vec<u8>,
+    pending: u64,
+    len: u32,
+}
+
+impl<'a> BitWriter<'a> {
+    fn new(out: &'a mut Vec<u8>) -> Self {
+        Self {
+            out,
+            pending: 0,
+            len: 0,
+        }
+    }
+
+    /// writes the lowest `bits` bits of `value`, at most 32
+    #[inline(always)]
+    fn write(&mut self, value: u32, bits: u32) {
+        self.pending = (self.pending << bits) | (value as u64 & ((1 << bits) - 1));
+        self.len += bits;
+        while self.len >= 8 {
+            self.len -= 8;
+            self.out.push((self.pending >> self.len) as u8);
+        }
+        self.pending &= (1 << self.len) - 1;
+    }
+
+    /// writes `zeros` zero bits followed by a one
+    #[inline(always)]
+    fn write_unary(&mut self, mut zeros: u32) {
+        while zeros >= 32 {
+            self.write(0, 32);
+            zeros -= 32;
+        }
+        self.write(1, zeros + 1);
+    }
+
+    /// pads the last byte with zeros
+    fn finish(self) {
+        if self.len > 0 {
+            self.out.push((self.pending << (8 - self.len)) as u8);
+        }
+    }
+}
+
+/// Rice codes `samples` as `RICE_1` does: the first sample as it is stored, then blocks of differences
+/// between neighbors, each with the number of low bits that are written verbatim
+fn rice_encode<S: RiceSample>(samples: &[S], out: &mut Vec<u8>) {
+    let Some(&first) = samples.first() else {
+        return;
+    };
+    let mut bits = BitWriter::new(out);
+    bits.write(first.stored(), S::BITS);
+    let mut previous = first;
+    let mut differences = [0_u32; RICE_BLOCK_SIZE];
+    for block in samples.chunks(RICE_BLOCK_SIZE) {
+        let differences = &mut differences[..block.len()];
+        let mut sum = 0_u64;
+        for (difference, &sample) in differences.iter_mut().zip(block) {
+            *difference = sample.difference(previous);
+            sum += *difference as u64;
+            previous = sample;
+        }
+        // the split that makes the verbatim low bits about as long as the unary high bits
+        let len = block.len() as u64;
+        let mut mean = (sum.saturating_sub(len / 2 + 1) / len) >> 1;
+        let mut fs = 0;
+        while mean > 0 {
+            fs += 1;
+            mean >>= 1;
+        }
+        if fs >= S::FS_MAX {
+            bits.write(S::FS_MAX + 1, S::FS_BITS);
+            for &difference in differences.iter() {
+                bits.write(difference, S::BITS);
+            }
+        } else if sum == 0 {
+            bits.write(0, S::FS_BITS);
+        } else {
+            bits.write(fs + 1, S::FS_BITS);
+            for &difference in differences.iter() {
+                bits.write_unary(difference >> fs);
+                if fs > 0 {
+                    bits.write(difference, fs);
+                }
+            }
+        }
+    }
+    bits.finish();
+}
+
+/// compresses all tiles of a frame on all cores, tiles are `tile_rows` rows of one color plane
+fn rice_tiles<S: RiceSample>(
+    samples: &[S],
+    width: usize,
+    height: usize,
+    channels: usize,
+    tile_rows: usize,
+) -> Vec<Vec<u8>> {
+    let tiles_per_plane = height.div_ceil(tile_rows);
+    let mut tiles = vec![Vec::new(); tiles_per_plane * channels];
+    for_each_item_band(&mut tiles, |first_tile, band| {
+        let mut plane_samples = Vec::new();
+        for (offset, tile) in band.iter_mut().enumerate() {
+            let index = first_tile + offset;
+            let (plane, first_row) = (
+                index / tiles_per_plane,
+                (index % tiles_per_plane) * tile_rows,
+            );
+            let rows = tile_rows.min(height - first_row);
+            let start = first_row * width * channels;
+            let end = start + rows * width * channels;
+            let tile_samples = if channels == 1 {
+                &samples[start..end]
+            } else {
+                plane_samples.clear();
+                plane_samples.extend(samples[start + plane..end].iter().step_by(channels));
+                &plane_samples[..]
+            };
+            rice_encode(tile_samples, tile);
+        }
+    });
+    tiles
+}
+
+impl ImageData {
+    /// Writes the image as a tile compressed FITS file with lossless `RICE_1` compression, the format
+    /// written by fpack and read by cfitsio, astropy and all common astro software. Tiles of `tile_rows`
+    /// rows are compressed in parallel on all cores. Sky background compresses to a fraction of the size
+    /// of `write_fits`, at the cost of the CPU time, so call it from a worker like the sink of a `Sequencer`
+    /// rather than from a capture loop.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Sequencer,SequencerOptions,SequenceStep};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// /* set up the camera for single frames */
+    /// let header = camera.fits_header().expect("fits_header failed");
+    /// let sequencer = Sequencer::new(camera, None, SequencerOptions::default());
+    /// let plan = [SequenceStep { count: 200, exposure: std::time::Duration::from_secs(60), gain: None, filter: None }];
+    /// sequencer
+    ///     .run(&plan, |frame| {
+    ///         let path = format!("light_{:03}.fits.fz", frame.index);
+    ///         frame.image.save_fits_rice(path, &header, 16)
+    ///     })
+    ///     .expect("sequence failed");
+    /// ```
+    pub fn write_fits_rice<W: Write>(
+        &self,
+        mut writer: W,
+        header: &FitsHeader,
+        tile_rows: u32,
+    ) -> Result<()> {
+        if self.channels == 0 || !(1..=16).contains(&self.bits_per_pixel) || self.width == 0 {
+            let error = UnsupportedImageError {
+                bits_per_pixel: self.bits_per_pixel,
+                channels: self.channels,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let needed = self.info().data_len();
+        if self.data.len() < needed {
+            let error = BufferTooSmallError {
+                needed,
+                available: self.data.len(),
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let (width, height) = (self.width as usize, self.height as usize);
+        let channels = self.channels as usize;
+        let tile_rows = (tile_rows.max(1) as usize).min(height.max(1));
+        let tiles = match self.bytes_per_sample() {
+            1 => rice_tiles(self.as_u8_slice(), width, height, channels, tile_rows),
+            _ => rice_tiles(
+                &u16_samples(self.as_u8_slice()),
+                width,
+                height,
+                channels,
+                tile_rows,
+            ),
+        };
+        let mut table = Vec::with_capacity(tiles.len() * 8);
+        let mut heap_len = 0;
+        for tile in &tiles {
+            table.extend_from_slice(&(tile.len() as u32).to_be_bytes());
+            table.extend_from_slice(&(heap_len as u32).to_be_bytes());
+            heap_len += tile.len();
+        }
+        let longest = tiles.iter().map(Vec::len).max().unwrap_or(0);
+        let headers = self.rice_headers(header, tiles.len(), heap_len, longest, tile_rows);
+        let mut write = || -> std::io::Result<()> {
+            writer.write_all(&headers)?;
+            writer.write_all(&table)?;
+            for tile in &tiles {
+                writer.write_all(tile)?;
+            }
+            let len = table.len() + heap_len;
+            writer.write_all(&vec![0_u8; block_len(len) - len])?;
+            writer.flush()
+        };
+        write().wrap_err(WriteFitsError)
+    }
+
+    /// Writes the image to a new Rice compressed FITS file at `path`, see `write_fits_rice`
+    pub fn save_fits_rice<P: AsRef<Path>>(
+        &self,
+        path: P,
+        header: &FitsHeader,
+        tile_rows: u32,
+    ) -> Result<()> {
+        let file = File::create(path).wrap_err(WriteFitsError)?;
+        self.write_fits_rice(std::io::BufWriter::new(file), header, tile_rows)
+    }
+
+    /// the empty primary header and the header of the binary table holding the compressed tiles
+    fn rice_headers(
+        &self,
+        header: &FitsHeader,
+        tiles: usize,
+        heap_len: usize,
+        longest: usize,
+        tile_rows: usize,
+    ) -> Vec<u8> {
+        let mut out = Vec::with_capacity(2 * BLOCK_LEN);
+        push_card(&mut out, "SIMPLE", &true.into(), "");
+        push_card(&mut out, "BITPIX", &8.into(), "");
+        push_card(&mut out, "NAXIS", &0.into(), "");
+        push_card(&mut out, "EXTEND", &true.into(), "");
+        push_end(&mut out);
+        let bitpix: i32 = if self.bytes_per_sample() == 1 { 8 } else { 16 };
+        let axes: i32 = if self.channels > 1 { 3 } else { 2 };
+        let cards: [(&str, FitsValue, &str); 20] = [
+            ("XTENSION", "BINTABLE".into(), "binary table extension"),
+            ("BITPIX", 8.into(), ""),
+            ("NAXIS", 2.into(), ""),
+            ("NAXIS1", 8.into(), "bytes per tile descriptor"),
+            ("NAXIS2", (tiles as i64).into(), "number of tiles"),
+            (
+                "PCOUNT",
+                (heap_len as i64).into(),
+                "size of the compressed tiles",
+            ),
+            ("GCOUNT", 1.into(), ""),
+            ("TFIELDS", 1.into(), ""),
+            ("TTYPE1", "COMPRESSED_DATA".into(), ""),
+            ("TFORM1", format!("1PB({})", longest).into(), ""),
+            ("ZIMAGE", true.into(), "tile compressed image"),
+            ("ZCMPTYPE", "RICE_1".into(), ""),
+            ("ZBITPIX", bitpix.into(), ""),
+            ("ZNAXIS", axes.into(), ""),
+            ("ZNAXIS1", self.width.into(), ""),
+            ("ZNAXIS2", self.height.into(), ""),
+            ("ZTILE1", self.width.into(), ""),
+            ("ZTILE2", (tile_rows as i64).into(), ""),
+            ("ZNAME1", "BLOCKSIZE".into(), ""),
+            ("ZVAL1", (RICE_BLOCK_SIZE as i64).into(), ""),
+        ];
+        for (key, value, comment) in &cards {
+            push_card(&mut out, key, value, comment);
+        }
+        push_card(&mut out, "ZNAME2", &"BYTEPIX".into(), "");
+        push_card(&mut out, "ZVAL2", &(bitpix / 8).into(), "");
+        if self.channels > 1 {
+            push_card(&mut out, "ZNAXIS3", &self.channels.into(), "");
+            push_card(&mut out, "ZTILE3", &1.into(), "");
+        }
+        if bitpix == 16 {
+            push_card(&mut out, "BZERO", &FitsValue::Integer(32768), "");
+            push_card(&mut out, "BSCALE", &FitsValue::Integer(1), "");
+        }
+        push_cards(&mut out, header, &COMPRESSED_KEYS);
+        push_end(&mut out);
+        out
+    }
+}
+
+#[cfg(feature = "zstd")]
+/// the size of the parts of a frame compressed in parallel by `write_zstd`
+const ZSTD_CHUNK_LEN: usize = 1 << 20;
+
+#[cfg(feature = "zstd")]
+impl ImageData {
+    /// Writes the raw bytes of `data` compressed with zstd at `level` (1 to 22, 3 is the zstd default). The
+    /// frame is cut into 1 MiB chunks that are compressed in parallel on all cores and written as
+    /// consecutive zstd frames, so any zstd decoder restores the original bytes. The geometry of the frame is
+    /// not stored. Needs the `zstd` feature.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![0; 1024], width: 32, height: 16, bits_per_pixel: 16, channels: 1, metadata: None };
+    /// let mut out = Vec::new();
+    /// image.write_zstd(&mut out, 3).expect("write_zstd failed");
+    /// assert_eq!(zstd::decode_all(&out[..]).unwrap(), image.data);
+    /// ```
+    pub fn write_zstd<W: Write>(&self, mut writer: W, level: i32) -> Result<()> {
+        let data = self.as_u8_slice();
+        let mut chunks: Vec<std::io::Result<Vec<u8>>> = (0..data.len().div_ceil(ZSTD_CHUNK_LEN))
+            .map(|_| Ok(Vec::new()))
+            .collect();
+        for_each_item_band(&mut chunks, |first_chunk, band| {
+            for (offset, chunk) in band.iter_mut().enumerate() {
+                let start = (first_chunk + offset) * ZSTD_CHUNK_LEN;
+                let end = (start + ZSTD_CHUNK_LEN).min(data.len());
+                *chunk = zstd::bulk::compress(&data[start..end], level);
+            }
+        });
+        let write = || -> std::io::Result<()> {
+            for chunk in chunks {
+                writer.write_all(&chunk?)?;
+            }
+            writer.flush()
+        };
+        write().wrap_err(crate::QHYError::CompressError)
+    }
+}
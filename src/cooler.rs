@@ -0,0 +1,349 @@
+use std::fmt::Debug;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use eyre::{eyre, Result};
+
+use crate::worker::Executor;
+use crate::QHYError::IsControlAvailableError;
+use crate::{Camera, CameraWorker, Control, Priority, TelemetryReader};
+
+#[derive(Debug, Clone)]
+/// Options for `Camera::start_cooler`
+pub struct CoolerOptions {
+    /// how fast the setpoint moves towards the target in degrees Celsius per minute, 0 sets the target at once
+    pub rate: f64,
+    /// how often the setpoint is moved, the step per tick is `rate` times this
+    pub interval: Duration,
+    /// how far the temperature may be off the target in degrees Celsius and still count as stable
+    pub tolerance: f64,
+    /// how long the temperature has to stay within `tolerance` before the cooler counts as settled
+    pub settle_time: Duration,
+}
+
+impl Default for CoolerOptions {
+    fn default() -> Self {
+        Self {
+            rate: 3.0,
+            interval: Duration::from_secs(5),
+            tolerance: 0.5,
+            settle_time: Duration::from_secs(60),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+/// What a `CoolerController` is doing
+pub enum CoolerState {
+    /// the telemetry has no temperature yet, the ramp starts from the first one
+    Waiting,
+    /// the setpoint is moving towards the target
+    Ramping,
+    /// the setpoint reached the target, the temperature is not stable within the tolerance yet
+    Settling,
+    /// the temperature stayed within the tolerance of the target for `settle_time`
+    Settled,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+/// A snapshot of a `CoolerController`, see `CoolerController::status`
+pub struct CoolerStatus {
+    /// what the controller is doing
+    pub state: CoolerState,
+    /// the temperature the ramp ends at
+    pub target: f64,
+    /// the setpoint last sent to the camera, `None` before the first one
+    pub setpoint: Option<f64>,
+    /// the latest sensor temperature from the telemetry
+    pub temperature: Option<f64>,
+    /// the latest cooler power from the telemetry, from 0 to 255
+    pub pwm: Option<f64>,
+    /// how far the ramp got from the temperature it started at to the target, from 0.0 to 1.0
+    pub progress: f64,
+    /// how long the temperature has been within the tolerance of the target
+    pub stable_for: Duration,
+    /// the error of the last setpoint that could not be set, cleared by the next one that could
+    pub error: Option<String>,
+}
+
+#[derive(Debug)]
+struct Shared {
+    running: AtomicBool,
+    status: Mutex<CoolerStatus>,
+    /// notified whenever the state changes
+    changed: Condvar,
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, CoolerStatus> {
+        self.status
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+}
+
+/// Ramps the cooler of a camera to a target temperature on a background thread, e.g. to -10°C at 3°C per
+/// minute instead of setting `Control::Cooler` at once, which makes the cooler power spike. The temperature is
+/// taken from a `TelemetryReader`, so the controller only calls the SDK to move the setpoint and never competes
+/// with the capture thread for the camera. `status` and `wait_settled` tell when imaging can start. Started
+/// with `CameraWorker::start_cooler` the setpoint is queued on the worker with `Priority::Control`, otherwise
+/// the thread calls the camera directly.
+///
+/// Stopping or dropping the controller joins the thread, the cooler keeps the last setpoint.
+pub struct CoolerController {
+    camera: Camera,
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl CoolerController {
+    pub(crate) fn start(
+        executor: Executor,
+        telemetry: TelemetryReader,
+        target: f64,
+        options: CoolerOptions,
+    ) -> Result<Self> {
+        executor.run(Priority::Control, |camera| {
+            if camera.is_control_available(Control::Cooler).is_none() {
+                let error = IsControlAvailableError {
+                    control: Control::Cooler,
+                };
+                tracing::error!(error = ?error);
+                return Err(eyre!(error));
+            }
+            Ok(())
+        })?;
+        let shared = Arc::new(Shared {
+            running: AtomicBool::new(true),
+            status: Mutex::new(CoolerStatus {
+                state: CoolerState::Waiting,
+                target,
+                setpoint: None,
+                temperature: None,
+                pwm: None,
+                progress: 0.0,
+                stable_for: Duration::ZERO,
+                error: None,
+            }),
+            changed: Condvar::new(),
+        });
+        let camera = executor.camera().clone();
+        let thread = {
+            let shared = shared.clone();
+            thread::Builder::new()
+                .name(format!("qhyccd-cooler-{}", camera.id()))
+                .spawn(move || ramp(executor, telemetry, shared, options))
+        };
+        match thread {
+            Ok(thread) => Ok(Self {
+                camera,
+                shared,
+                thread: Some(thread),
+            }),
+            Err(error) => {
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// Returns what the controller is doing
+    pub fn status(&self) -> CoolerStatus {
+        self.shared.lock().clone()
+    }
+
+    /// Returns `true` once the temperature stayed within the tolerance of the target for the settle time
+    pub fn is_settled(&self) -> bool {
+        self.shared.lock().state == CoolerState::Settled
+    }
+
+    /// Changes the target, the ramp continues from the current setpoint. Returns right away.
+    pub fn set_target(&self, target: f64) {
+        self.shared.lock().target = target;
+        if let Some(thread) = &self.thread {
+            thread.thread().unpark();
+        }
+    }
+
+    /// Waits at most `timeout` for the cooler to settle, returns `true` if it did
+    pub fn wait_settled(&self, timeout: Duration) -> bool {
+        let deadline = Instant::now() + timeout;
+        let mut status = self.shared.lock();
+        while status.state != CoolerState::Settled {
+            let now = Instant::now();
+            if now >= deadline || self.thread.is_none() {
+                return false;
+            }
+            status = self
+                .shared
+                .changed
+                .wait_timeout(status, deadline - now)
+                .unwrap_or_else(|poisoned| poisoned.into_inner())
+                .0;
+        }
+        true
+    }
+
+    /// Returns the camera this controller cools
+    pub fn camera(&self) -> &Camera {
+        &self.camera
+    }
+
+    /// Stops the ramp, the cooler keeps the last setpoint
+    pub fn stop(mut self) {
+        self.shutdown()
+    }
+
+    fn shutdown(&mut self) {
+        let Some(thread) = self.thread.take() else {
+            return;
+        };
+        self.shared.running.store(false, Ordering::Release);
+        thread.thread().unpark();
+        if thread.join().is_err() {
+            tracing::error!("cooler thread panicked");
+        }
+    }
+}
+
+impl Debug for CoolerController {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("CoolerController")
+            .field("camera", &self.camera)
+            .field("status", &self.status())
+            .finish()
+    }
+}
+
+impl Drop for CoolerController {
+    fn drop(&mut self) {
+        self.shutdown()
+    }
+}
+
+/// moves `setpoint` towards `target` by at most `step`
+fn next_setpoint(setpoint: f64, target: f64, step: f64) -> f64 {
+    if step <= 0.0 || (target - setpoint).abs() <= step {
+        target
+    } else {
+        setpoint + step.copysign(target - setpoint)
+    }
+}
+
+fn ramp(
+    executor: Executor,
+    telemetry: TelemetryReader,
+    shared: Arc<Shared>,
+    options: CoolerOptions,
+) {
+    let step = options.rate * options.interval.as_secs_f64() / 60.0;
+    // the temperature the ramp to `ramp_target` started at, for the progress
+    let mut start: Option<f64> = None;
+    let mut ramp_target = f64::NAN;
+    let mut stable_since: Option<Instant> = None;
+    while shared.running.load(Ordering::Acquire) {
+        let latest = telemetry.latest();
+        let target = shared.lock().target;
+        if target != ramp_target {
+            ramp_target = target;
+            start = None;
+        }
+        if let Some(temperature) = latest.temperature {
+            let previous = shared.lock().setpoint;
+            let setpoint = next_setpoint(previous.unwrap_or(temperature), target, step);
+            let error = if previous == Some(setpoint) {
+                None
+            } else {
+                executor
+                    .run(Priority::Control, move |camera| {
+                        camera.set_parameter(Control::Cooler, setpoint)
+                    })
+                    .err()
+                    .map(|report| format!("{:#}", report))
+            };
+            if (temperature - target).abs() <= options.tolerance && setpoint == target {
+                stable_since.get_or_insert_with(Instant::now);
+            } else {
+                stable_since = None;
+            }
+            let stable_for = stable_since.map_or(Duration::ZERO, |since| since.elapsed());
+            let from = *start.get_or_insert(previous.unwrap_or(temperature));
+            let mut status = shared.lock();
+            status.temperature = Some(temperature);
+            status.pwm = latest.cooler_pwm;
+            status.stable_for = stable_for;
+            status.progress = match from - target {
+                distance if distance.abs() > f64::EPSILON => {
+                    ((from - setpoint) / distance).clamp(0.0, 1.0)
+                }
+                _ => 1.0,
+            };
+            match error {
+                // the camera may not have taken it, so it is sent again on the next tick
+                Some(error) => status.error = Some(error),
+                None => {
+                    status.setpoint = Some(setpoint);
+                    status.error = None;
+                }
+            }
+            status.state = match () {
+                _ if setpoint != target => CoolerState::Ramping,
+                _ if stable_for >= options.settle_time => CoolerState::Settled,
+                _ => CoolerState::Settling,
+            };
+            drop(status);
+            shared.changed.notify_all();
+        }
+        // woken early by `set_target` and `stop`
+        thread::park_timeout(options.interval);
+    }
+    shared.changed.notify_all();
+}
+
+impl Camera {
+    /// Starts a `CoolerController` ramping the cooler from the current temperature to `target` in degrees
+    /// Celsius. The temperature is read from `telemetry`, which should sample at least as often as
+    /// `CoolerOptions::interval`.
+    /// # Example
+    /// ```no_run
+    /// use std::time::Duration;
+    /// use qhyccd_rs::{Sdk,CoolerOptions,TelemetryOptions};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let telemetry = camera
+    ///     .start_telemetry(TelemetryOptions { interval: Duration::from_secs(1), ..Default::default() })
+    ///     .expect("start_telemetry failed");
+    /// let cooler = camera
+    ///     .start_cooler(-10.0, telemetry.reader(), CoolerOptions::default())
+    ///     .expect("start_cooler failed");
+    /// while !cooler.wait_settled(Duration::from_secs(10)) {
+    ///     let status = cooler.status();
+    ///     println!("{:.0}% {:?}°C", status.progress * 100.0, status.temperature);
+    /// }
+    /// /* start imaging */
+    /// ```
+    pub fn start_cooler(
+        &self,
+        target: f64,
+        telemetry: TelemetryReader,
+        options: CoolerOptions,
+    ) -> Result<CoolerController> {
+        CoolerController::start(Executor::Direct(self.clone()), telemetry, target, options)
+    }
+}
+
+impl CameraWorker {
+    /// Like `Camera::start_cooler`, but the setpoint is queued on this worker with `Priority::Control`. Start
+    /// `telemetry` with `CameraWorker::start_telemetry` so the temperature readings go through it as well.
+    pub fn start_cooler(
+        &self,
+        target: f64,
+        telemetry: TelemetryReader,
+        options: CoolerOptions,
+    ) -> Result<CoolerController> {
+        CoolerController::start(self.executor(), telemetry, target, options)
+    }
+}
@@ -0,0 +1,19 @@
+use std::fs::File;
+#[cfg(any(target_os = "linux", target_os = "android", target_os = "freebsd"))]
+use std::os::unix::io::AsRawFd;
+
+/// grows `file` to `len` bytes with its blocks allocated, so a full disk fails here instead of partway through
+/// the write, or with `SIGBUS` on a write to a mapping of the file
+#[cfg(any(target_os = "linux", target_os = "android", target_os = "freebsd"))]
+pub(crate) fn allocate(file: &File, len: usize) -> std::io::Result<()> {
+    match unsafe { libc::posix_fallocate(file.as_raw_fd(), 0, len as libc::off_t) } {
+        0 => Ok(()),
+        errno => Err(std::io::Error::from_raw_os_error(errno)),
+    }
+}
+
+/// grows `file` to `len` bytes, this platform has no `posix_fallocate` so the file stays sparse
+#[cfg(not(any(target_os = "linux", target_os = "android", target_os = "freebsd")))]
+pub(crate) fn allocate(file: &File, len: usize) -> std::io::Result<()> {
+    file.set_len(len as u64)
+}
@@ -0,0 +1,123 @@
+use std::thread;
+use std::time::{Duration, Instant};
+
+use eyre::{eyre, Result};
+
+use crate::FilterWheel;
+use crate::QHYError::FilterWheelMoveTimeoutError;
+
+/// how often `MoveHandle::wait` asks the wheel whether it arrived
+const MOVE_POLL_INTERVAL: Duration = Duration::from_millis(20);
+
+#[derive(Debug, Default, Clone, Copy)]
+/// what is known about the wheel of a camera, reset on `open` and `close`
+pub(crate) struct CfwState {
+    /// the slot the wheel was last seen at, `None` while moving or if it is unknown
+    pub(crate) position: Option<u32>,
+    /// the slot the wheel was last sent to, `None` once it arrived there
+    pub(crate) target: Option<u32>,
+}
+
+/// A filter wheel move started by `FilterWheel::move_to`. The wheel moves on its own, the handle only
+/// tells when it arrived, so the time in between can be spent reading out the camera.
+#[derive(Debug)]
+pub struct MoveHandle {
+    filter_wheel: FilterWheel,
+    target: u32,
+    started: Instant,
+}
+
+impl MoveHandle {
+    /// Returns the position the wheel is moving to
+    pub fn target(&self) -> u32 {
+        self.target
+    }
+
+    /// Returns the time since the move was started
+    pub fn elapsed(&self) -> Duration {
+        self.started.elapsed()
+    }
+
+    /// Returns `true` once the wheel arrived at the target. Asks the wheel with `GetQHYCCDCFWStatus`,
+    /// falling back to `get_fw_position` if the status can not be read, until it arrived and then answers
+    /// from the cached position.
+    pub fn is_done(&self) -> Result<bool> {
+        let cfw = *self.filter_wheel.camera.handle.cfw();
+        if cfw.target.is_none() && cfw.position == Some(self.target) {
+            return Ok(true);
+        }
+        let position = match self.filter_wheel.get_fw_status() {
+            Ok(position) => position,
+            Err(_) => Some(self.filter_wheel.get_fw_position()?),
+        };
+        // right after the move is sent a wheel may still report the slot it is leaving
+        if position != Some(self.target) {
+            return Ok(false);
+        }
+        let mut cfw = self.filter_wheel.camera.handle.cfw();
+        cfw.position = position;
+        if cfw.target == position {
+            cfw.target = None;
+        }
+        tracing::debug!(
+            position = self.target,
+            elapsed = ?self.started.elapsed(),
+            "filter wheel arrived"
+        );
+        Ok(true)
+    }
+
+    /// Waits at most `timeout` for the wheel to arrive at the target
+    pub fn wait(self, timeout: Duration) -> Result<()> {
+        let deadline = Instant::now() + timeout;
+        while !self.is_done()? {
+            let now = Instant::now();
+            if now >= deadline {
+                let error = FilterWheelMoveTimeoutError {
+                    position: self.target,
+                };
+                tracing::error!(error = ?error);
+                return Err(eyre!(error));
+            }
+            thread::sleep(MOVE_POLL_INTERVAL.min(deadline - now));
+        }
+        Ok(())
+    }
+}
+
+impl FilterWheel {
+    /// Starts moving the wheel to `position` and returns without waiting for it to get there. If the wheel
+    /// is known to be at `position` already nothing is sent and the handle is done right away.
+    /// # Example
+    /// ```no_run
+    /// use std::time::Duration;
+    /// use qhyccd_rs::{Sdk,FilterWheel};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let fw = sdk.filter_wheels().last().expect("no filter wheel found");
+    /// fw.open().expect("open failed");
+    /// let moving = fw.move_to(2).expect("move_to failed");
+    /// /* read out the last frame with the previous filter */
+    /// moving.wait(Duration::from_secs(30)).expect("filter wheel did not arrive");
+    /// assert_eq!(fw.position(), Some(2));
+    /// ```
+    pub fn move_to(&self, position: u32) -> Result<MoveHandle> {
+        let cfw = *self.camera.handle.cfw();
+        if cfw.target.is_none() && cfw.position == Some(position) {
+            tracing::debug!(position, "filter wheel is at the position already");
+        } else {
+            self.set_fw_position(position)?;
+        }
+        Ok(MoveHandle {
+            filter_wheel: self.clone(),
+            target: position,
+            started: Instant::now(),
+        })
+    }
+
+    /// Returns the position the wheel was last seen at by a `MoveHandle`, without asking the wheel. `None`
+    /// while it is moving and after `open` until the first move arrived.
+    pub fn position(&self) -> Option<u32> {
+        let cfw = *self.camera.handle.cfw();
+        cfw.target.is_none().then_some(cfw.position).flatten()
+    }
+}
@@ -0,0 +1,408 @@
+use std::fs::File;
+use std::io::Write;
+use std::path::Path;
+
+use eyre::{eyre, Result, WrapErr};
+
+use crate::files::allocate;
+use crate::samples::u16_samples;
+use crate::QHYError::{BufferTooSmallError, UnsupportedImageError, WriteFitsError};
+use crate::{Camera, Control, ImageData};
+
+/// FITS files are written in blocks of 2880 bytes
+pub(crate) const BLOCK_LEN: usize = 2880;
+/// every header card is 80 characters
+const CARD_LEN: usize = 80;
+/// the characters of a string value between the quotes, what is left of a card after `KEYWORD = '` and `'`
+const STRING_LEN: usize = CARD_LEN - 12;
+/// the number of samples converted and written at once, small enough to stay in the L2 cache
+const CHUNK_SAMPLES: usize = 32 * 1024;
+/// keywords the writer sets itself from the image, they are skipped if they are in a `FitsHeader`
+const RESERVED_KEYS: [&str; 9] = [
+    "SIMPLE", "BITPIX", "NAXIS", "NAXIS1", "NAXIS2", "NAXIS3", "BZERO", "BSCALE", "END",
+];
+
+#[derive(Debug, Clone, PartialEq)]
+/// The value of a header card
+pub enum FitsValue {
+    /// written as `T` or `F`
+    Logical(bool),
+    /// a whole number
+    Integer(i64),
+    /// NaN and infinity can not be written, such cards are left out
+    Float(f64),
+    /// quotes are escaped and characters other than printable ASCII are written as `?`, the value is cut off
+    /// after 68 characters so the closing quote still fits on the card
+    String(String),
+}
+
+impl From<bool> for FitsValue {
+    fn from(value: bool) -> Self {
+        FitsValue::Logical(value)
+    }
+}
+
+impl From<i64> for FitsValue {
+    fn from(value: i64) -> Self {
+        FitsValue::Integer(value)
+    }
+}
+
+impl From<i32> for FitsValue {
+    fn from(value: i32) -> Self {
+        FitsValue::Integer(value.into())
+    }
+}
+
+impl From<u32> for FitsValue {
+    fn from(value: u32) -> Self {
+        FitsValue::Integer(value.into())
+    }
+}
+
+impl From<f64> for FitsValue {
+    fn from(value: f64) -> Self {
+        FitsValue::Float(value)
+    }
+}
+
+impl From<&str> for FitsValue {
+    fn from(value: &str) -> Self {
+        FitsValue::String(value.to_owned())
+    }
+}
+
+impl From<String> for FitsValue {
+    fn from(value: String) -> Self {
+        FitsValue::String(value)
+    }
+}
+
+impl FitsValue {
+    /// `None` for values FITS can not represent
+    fn format(&self) -> Option<String> {
+        match self {
+            FitsValue::Logical(value) => Some(format!("{:>20}", if *value { "T" } else { "F" })),
+            FitsValue::Integer(value) => Some(format!("{:>20}", value)),
+            FitsValue::Float(value) if !value.is_finite() => None,
+            // `{:?}` always has a decimal point or an exponent, FITS wants the exponent in upper case
+            FitsValue::Float(value) => {
+                Some(format!("{:>20}", format!("{:?}", value).to_uppercase()))
+            }
+            FitsValue::String(value) => {
+                let mut quoted = String::with_capacity(STRING_LEN);
+                for c in value.chars().map(ascii) {
+                    // a quote is escaped by doubling it, the pair must not be split
+                    let len = if c == '\'' { 2 } else { 1 };
+                    if quoted.len() + len > STRING_LEN {
+                        break;
+                    }
+                    quoted.push(c);
+                    if c == '\'' {
+                        quoted.push(c);
+                    }
+                }
+                Some(format!("'{:<8}'", quoted))
+            }
+        }
+    }
+}
+
+/// header cards may only contain printable ASCII
+fn ascii(c: char) -> char {
+    match c {
+        ' '..='~' => c,
+        _ => '?',
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Default)]
+/// The keywords of a FITS header in the order they are written, see `Camera::fits_header`
+pub struct FitsHeader {
+    cards: Vec<(String, FitsValue, String)>,
+}
+
+impl FitsHeader {
+    /// Creates an empty header
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sets `key` to `value`, replacing an earlier value of the same key. Keys are converted to upper case
+    /// and cut off after 8 characters as required by FITS.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::FitsHeader;
+    /// let mut header = FitsHeader::new();
+    /// header.set("object", "M31", "").set("EXPTIME", 300.0, "[s] exposure time");
+    /// ```
+    pub fn set(&mut self, key: &str, value: impl Into<FitsValue>, comment: &str) -> &mut Self {
+        let key: String = key.to_uppercase().chars().take(8).collect();
+        let value = value.into();
+        match self.cards.iter_mut().find(|card| card.0 == key) {
+            Some(card) => {
+                card.1 = value;
+                card.2 = comment.to_owned();
+            }
+            None => self.cards.push((key, value, comment.to_owned())),
+        }
+        self
+    }
+
+    /// Returns the value of `key`
+    pub fn get(&self, key: &str) -> Option<&FitsValue> {
+        let key = key.to_uppercase();
+        self.cards
+            .iter()
+            .find(|card| card.0 == key)
+            .map(|card| &card.1)
+    }
+}
+
+pub(crate) fn push_card(out: &mut Vec<u8>, key: &str, value: &FitsValue, comment: &str) {
+    let Some(value) = value.format() else {
+        tracing::debug!(
+            key,
+            ?value,
+            "value can not be written to FITS, card left out"
+        );
+        return;
+    };
+    let mut card = format!("{:<8}= {}", key, value);
+    if !comment.is_empty() {
+        card.push_str(" / ");
+        card.extend(comment.chars().map(ascii));
+    }
+    // only ASCII is left, so cutting bytes does not split a character
+    let mut card = card.into_bytes();
+    card.resize(CARD_LEN, b' ');
+    out.extend_from_slice(&card);
+}
+
+/// appends the cards of `header` except for the keywords the writer sets itself and `reserved`
+pub(crate) fn push_cards(out: &mut Vec<u8>, header: &FitsHeader, reserved: &[&str]) {
+    for (key, value, comment) in &header.cards {
+        if !RESERVED_KEYS.contains(&key.as_str()) && !reserved.contains(&key.as_str()) {
+            push_card(out, key, value, comment);
+        }
+    }
+}
+
+/// ends a header and pads it to a whole block
+pub(crate) fn push_end(out: &mut Vec<u8>) {
+    out.extend_from_slice(format!("{:<80}", "END").as_bytes());
+    out.resize(block_len(out.len()), b' ');
+}
+
+/// pads `len` up to the next multiple of `BLOCK_LEN`
+pub(crate) fn block_len(len: usize) -> usize {
+    len.div_ceil(BLOCK_LEN) * BLOCK_LEN
+}
+
+/// A sample type that can be written to FITS
+trait FitsSample: Copy + Default {
+    /// converts a native sample into its FITS representation in memory
+    fn to_fits(self) -> Self;
+    fn as_bytes(samples: &[Self]) -> &[u8];
+}
+
+impl FitsSample for u8 {
+    #[inline(always)]
+    fn to_fits(self) -> Self {
+        self
+    }
+
+    fn as_bytes(samples: &[Self]) -> &[u8] {
+        samples
+    }
+}
+
+impl FitsSample for u16 {
+    /// FITS has no unsigned 16 bit integers, the samples are stored as big endian i16 with `BZERO = 32768`.
+    /// Subtracting 32768 is the same as flipping the sign bit.
+    #[inline(always)]
+    fn to_fits(self) -> Self {
+        (self ^ 0x8000).to_be()
+    }
+
+    fn as_bytes(samples: &[Self]) -> &[u8] {
+        // Safety: u8 has no alignment requirements and every u16 is two initialized bytes
+        unsafe {
+            std::slice::from_raw_parts(
+                samples.as_ptr() as *const u8,
+                std::mem::size_of_val(samples),
+            )
+        }
+    }
+}
+
+/// Writes the samples plane by plane, FITS stores each color in its own plane while the camera interleaves
+/// them. The samples are converted into a small reused chunk, so the whole frame is never copied.
+fn write_samples<S: FitsSample, W: Write>(
+    writer: &mut W,
+    samples: &[S],
+    channels: usize,
+) -> std::io::Result<()> {
+    let mut chunk = vec![S::default(); CHUNK_SAMPLES.min(samples.len())];
+    if channels == 1 {
+        // a plain loop over contiguous samples, the compiler turns it into vector byte swaps
+        for src in samples.chunks(CHUNK_SAMPLES) {
+            let out = &mut chunk[..src.len()];
+            for (out, &sample) in out.iter_mut().zip(src) {
+                *out = sample.to_fits();
+            }
+            writer.write_all(S::as_bytes(out))?;
+        }
+        return Ok(());
+    }
+    for plane in 0..channels {
+        let mut src = samples[plane..].iter().step_by(channels);
+        loop {
+            let mut len = 0;
+            for (out, &sample) in chunk.iter_mut().zip(&mut src) {
+                *out = sample.to_fits();
+                len += 1;
+            }
+            if len == 0 {
+                break;
+            }
+            writer.write_all(S::as_bytes(&chunk[..len]))?;
+        }
+    }
+    Ok(())
+}
+
+impl ImageData {
+    fn fits_header_bytes(&self, header: &FitsHeader) -> Vec<u8> {
+        let mut out = Vec::with_capacity(BLOCK_LEN);
+        let bitpix: i64 = if self.bytes_per_sample() == 1 { 8 } else { 16 };
+        push_card(&mut out, "SIMPLE", &true.into(), "");
+        push_card(&mut out, "BITPIX", &bitpix.into(), "");
+        let axes = if self.channels > 1 { 3 } else { 2 };
+        push_card(&mut out, "NAXIS", &FitsValue::Integer(axes), "");
+        push_card(&mut out, "NAXIS1", &self.width.into(), "");
+        push_card(&mut out, "NAXIS2", &self.height.into(), "");
+        if self.channels > 1 {
+            push_card(&mut out, "NAXIS3", &self.channels.into(), "");
+        }
+        if bitpix == 16 {
+            push_card(&mut out, "BZERO", &FitsValue::Integer(32768), "");
+            push_card(&mut out, "BSCALE", &FitsValue::Integer(1), "");
+        }
+        push_cards(&mut out, header, &[]);
+        push_end(&mut out);
+        out
+    }
+
+    /// Returns the size of the FITS file `write_fits` writes for this image
+    pub fn fits_len(&self, header: &FitsHeader) -> usize {
+        self.fits_header_bytes(header).len() + block_len(self.info().data_len())
+    }
+
+    /// Writes the image as a FITS file with the keywords in `header`. 16 bit samples are converted to big
+    /// endian in small chunks straight from `data`, so writing needs no second copy of the frame. Color
+    /// images are written as a cube with one plane per channel.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::Sdk;
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// /* set up the camera for a single frame */
+    /// let image = camera.get_single_frame(camera.get_image_size().unwrap()).expect("get_single_frame failed");
+    /// let header = camera.fits_header().expect("fits_header failed");
+    /// let mut out = Vec::new();
+    /// image.write_fits(&mut out, &header).expect("write_fits failed");
+    /// ```
+    pub fn write_fits<W: Write>(&self, mut writer: W, header: &FitsHeader) -> Result<()> {
+        if self.channels == 0 || !(1..=16).contains(&self.bits_per_pixel) {
+            let error = UnsupportedImageError {
+                bits_per_pixel: self.bits_per_pixel,
+                channels: self.channels,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let needed = self.info().data_len();
+        if self.data.len() < needed {
+            let error = BufferTooSmallError {
+                needed,
+                available: self.data.len(),
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let channels = self.channels as usize;
+        let mut write = || -> std::io::Result<()> {
+            writer.write_all(&self.fits_header_bytes(header))?;
+            match (self.bytes_per_sample(), channels) {
+                (1, 1) => writer.write_all(self.as_u8_slice())?,
+                (1, _) => write_samples(&mut writer, self.as_u8_slice(), channels)?,
+                _ => write_samples(&mut writer, &u16_samples(self.as_u8_slice()), channels)?,
+            }
+            let padding = block_len(needed) - needed;
+            writer.write_all(&[0_u8; BLOCK_LEN][..padding])?;
+            writer.flush()
+        };
+        write().wrap_err(WriteFitsError)
+    }
+
+    /// Writes the image to a new FITS file at `path`, see `write_fits`. The blocks of the file are allocated
+    /// at its final size up front where the platform supports it, so the file system can place it in one piece
+    /// and a full disk fails before anything is written.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{FitsHeader, Sdk};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// /* set up the camera for a single frame */
+    /// let image = camera.get_single_frame(camera.get_image_size().unwrap()).expect("get_single_frame failed");
+    /// let mut header = camera.fits_header().expect("fits_header failed");
+    /// header.set("OBJECT", "M31", "");
+    /// image.save_fits("m31.fits", &header).expect("save_fits failed");
+    /// ```
+    pub fn save_fits<P: AsRef<Path>>(&self, path: P, header: &FitsHeader) -> Result<()> {
+        let file = File::create(path).wrap_err(WriteFitsError)?;
+        allocate(&file, self.fits_len(header)).wrap_err(WriteFitsError)?;
+        self.write_fits(file, header)
+    }
+}
+
+impl Camera {
+    /// Returns a FITS header describing the current settings of the camera: the id, pixel size, exposure
+    /// time, gain, offset and sensor temperature. Settings the camera does not support are left out. Call it
+    /// right after an exposure so the header matches the frame.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::Sdk;
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let header = camera.fits_header().expect("fits_header failed");
+    /// println!("{:?}", header.get("EXPTIME"));
+    /// ```
+    pub fn fits_header(&self) -> Result<FitsHeader> {
+        let info = self.get_ccd_info()?;
+        let mut header = FitsHeader::new();
+        header
+            .set("INSTRUME", self.id(), "camera id")
+            .set("XPIXSZ", info.pixel_width, "[um] pixel width")
+            .set("YPIXSZ", info.pixel_height, "[um] pixel height");
+        let parameters = [
+            (Control::Exposure, "EXPTIME", "[s] exposure time", 1e-6),
+            (Control::Gain, "GAIN", "camera gain", 1.0),
+            (Control::Offset, "OFFSET", "camera offset", 1.0),
+            (Control::CurTemp, "CCD-TEMP", "[C] sensor temperature", 1.0),
+        ];
+        for (control, key, comment, scale) in parameters {
+            if self.is_control_available(control).is_none() {
+                continue;
+            }
+            if let Ok(value) = self.get_parameter(control) {
+                header.set(key, value * scale, comment);
+            }
+        }
+        Ok(header)
+    }
+}
@@ -0,0 +1,175 @@
+use std::sync::Barrier;
+use std::thread;
+use std::time::{Duration, Instant, SystemTime};
+
+use eyre::Result;
+
+use crate::{Camera, FramePool, PooledImageData};
+
+/// the number of buffers each camera of a `CameraGroup` keeps, one frame can be processed while the next is read
+const GROUP_POOL_CAPACITY: usize = 2;
+
+#[derive(Debug)]
+/// A frame taken by one camera of a `CameraGroup`
+pub struct GroupFrame {
+    /// the id of the camera that took the frame
+    pub camera: String,
+    /// when the exposure was started, taken right before `start_single_frame_exposure`
+    pub started: SystemTime,
+    /// how much later this exposure started than the earliest one of the same `capture`, this is the skew
+    /// between the cameras
+    pub offset: Duration,
+    /// how long `start_single_frame_exposure` took to return
+    pub start_latency: Duration,
+    /// the image, its buffer goes back to the group when dropped
+    pub image: PooledImageData,
+}
+
+/// what the thread of one camera reports back to `capture`
+struct Exposure {
+    image: Result<PooledImageData>,
+    started: SystemTime,
+    instant: Instant,
+    start_latency: Duration,
+}
+
+#[derive(Debug)]
+struct Member {
+    camera: Camera,
+    pool: FramePool,
+}
+
+#[derive(Debug)]
+/// A set of cameras taking single frames at the same time, e.g. several cameras on one mount or a stereo rig.
+/// Every `capture` runs one thread per camera. The threads first do everything that talks to the SDK but
+/// does not start the exposure, then wait on a barrier and start their exposures together once all of them
+/// are ready, so the skew between the cameras is the time to wake a thread and not the time of a USB
+/// round trip per camera. The frames are read out in parallel as well.
+///
+/// The cameras have to be in Single Frame Mode, initialized and set up before. Each camera should only be
+/// in the group once, the SDK calls of one camera do not run in parallel.
+pub struct CameraGroup {
+    members: Vec<Member>,
+}
+
+impl CameraGroup {
+    /// Opens the cameras, if they are not open yet, and sizes a frame pool for each of them
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,CameraGroup,Control,StreamMode};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// for camera in sdk.cameras() {
+    ///     camera.open().expect("open failed");
+    ///     camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+    ///     camera.init().expect("init failed");
+    ///     camera.set_parameter(Control::Exposure, 10000.0).expect("set_parameter failed");
+    /// }
+    /// let group = CameraGroup::new(sdk.cameras()).expect("CameraGroup::new failed");
+    /// for frame in group.capture() {
+    ///     let frame = frame.expect("capture failed");
+    ///     println!("{} started {:?} after the first camera", frame.camera, frame.offset);
+    /// }
+    /// ```
+    pub fn new<'a>(cameras: impl IntoIterator<Item = &'a Camera>) -> Result<Self> {
+        let members = cameras
+            .into_iter()
+            .map(|camera| {
+                camera.open()?;
+                Ok(Member {
+                    camera: camera.clone(),
+                    pool: FramePool::for_camera(camera, GROUP_POOL_CAPACITY)?,
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
+        Ok(Self { members })
+    }
+
+    /// Returns the cameras of the group in the order `capture` returns their frames
+    pub fn cameras(&self) -> impl Iterator<Item = &Camera> {
+        self.members.iter().map(|member| &member.camera)
+    }
+
+    /// Returns the number of cameras in the group
+    pub fn len(&self) -> usize {
+        self.members.len()
+    }
+
+    /// Returns true if the group has no cameras
+    pub fn is_empty(&self) -> bool {
+        self.members.is_empty()
+    }
+
+    /// Starts an exposure on every camera at the same time and waits until all of them are read out. Returns
+    /// one result per camera in the order of `cameras`, a failing camera does not stop the others.
+    pub fn capture(&self) -> Vec<Result<GroupFrame>> {
+        let span = tracing::debug_span!("group_capture", cameras = self.members.len());
+        let _span = span.enter();
+        let barrier = Barrier::new(self.members.len());
+        let exposures: Vec<Exposure> = thread::scope(|scope| {
+            let workers: Vec<_> = self
+                .members
+                .iter()
+                .map(|member| {
+                    let barrier = &barrier;
+                    scope.spawn(move || member.expose(barrier))
+                })
+                .collect();
+            workers
+                .into_iter()
+                .map(|worker| {
+                    worker
+                        .join()
+                        .unwrap_or_else(|panic| std::panic::resume_unwind(panic))
+                })
+                .collect()
+        });
+        let first = exposures
+            .iter()
+            .filter(|exposure| exposure.image.is_ok())
+            .map(|exposure| exposure.instant)
+            .min();
+        exposures
+            .into_iter()
+            .zip(&self.members)
+            .map(|(exposure, member)| {
+                Ok(GroupFrame {
+                    camera: member.camera.id().to_owned(),
+                    started: exposure.started,
+                    offset: first.map_or(Duration::ZERO, |first| exposure.instant - first),
+                    start_latency: exposure.start_latency,
+                    image: exposure.image?,
+                })
+            })
+            .collect()
+    }
+}
+
+impl Member {
+    /// runs on the thread of this camera
+    fn expose(&self, barrier: &Barrier) -> Exposure {
+        // the image size only changes with the settings, asking for it here keeps it out of the skew
+        let buffer = self.camera.get_image_size().map(|size| {
+            self.pool.resize(size);
+            self.pool.acquire()
+        });
+        // every thread has to reach the barrier, also the ones that already failed, or the others wait forever
+        barrier.wait();
+        let started = SystemTime::now();
+        let instant = Instant::now();
+        let started_exposure = buffer.and_then(|buffer| {
+            self.camera.start_single_frame_exposure()?;
+            Ok(buffer)
+        });
+        let start_latency = instant.elapsed();
+        let image = started_exposure.and_then(|mut buffer| {
+            let info = self.camera.get_single_frame_into(&mut buffer)?;
+            Ok(buffer.into_image(info))
+        });
+        Exposure {
+            image,
+            started,
+            instant,
+            start_latency,
+        }
+    }
+}
@@ -1,9 +1,13 @@
 //!
 #![warn(missing_debug_implementations, rust_2018_idioms, missing_docs)]
 
+use std::collections::HashMap;
 use std::ffi::{c_char, CStr};
 use std::fmt::Debug;
-use std::sync::{Arc, RwLock};
+use std::ops::Deref;
+use std::sync::atomic::{AtomicPtr, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, OnceLock, RwLock};
+use std::time::{Duration, Instant, SystemTime};
 
 use eyre::{eyre, Result, WrapErr};
 use tracing::error;
@@ -15,32 +19,91 @@ extern crate educe;
 #[cfg(test)]
 pub mod mocks;
 
+mod analysis;
+#[cfg(feature = "async")]
+mod async_camera;
+mod backend;
+mod binning;
+mod calibration;
+mod capabilities;
+mod compress;
+mod cooler;
+mod debayer;
+mod files;
+mod filter_wheel;
+mod fits;
+mod group;
+mod live_stack;
+mod live_stream;
+mod metrics;
+mod parallel;
+mod parameters;
+mod pool;
+mod reconfigure;
+#[cfg(unix)]
+mod recorder;
+mod registry;
+mod samples;
+mod sequencer;
+#[cfg(feature = "simulation")]
+mod simulation;
+mod telemetry;
+mod view;
+mod worker;
+pub use analysis::{Histogram, ImageStats, Star, StarOptions};
+pub use backend::{set_backend, Backend, RealBackend};
+pub use binning::BinningMode;
+pub use calibration::{Calibration, MasterFrame, StackMethod, Stacker};
+pub use capabilities::{CameraCapabilities, ControlCapability, ReadoutModeCapability};
+pub use cooler::{CoolerController, CoolerOptions, CoolerState, CoolerStatus};
+pub use debayer::DebayerAlgorithm;
+use filter_wheel::CfwState;
+pub use filter_wheel::MoveHandle;
+pub use fits::{FitsHeader, FitsValue};
+pub use group::{CameraGroup, GroupFrame};
+pub use live_stack::{LiveStackOptions, LiveStacker};
+pub use live_stream::{LiveStream, LiveStreamOptions, OverflowPolicy};
+use metrics::Metrics;
+pub use metrics::{CameraMetrics, FrameStats, LatencyHistogram, PoolOccupancy, LATENCY_BUCKETS};
+pub use pool::{FramePool, PooledBuffer, PooledImageData};
+use reconfigure::CaptureModes;
+pub use reconfigure::{CaptureConfig, Reconfiguration};
+#[cfg(unix)]
+pub use recorder::{SerOptions, SerRecorder};
+pub use registry::{DeviceEvent, DeviceRegistry};
+pub use sequencer::{SequenceFrame, SequenceStep, SequenceSummary, Sequencer, SequencerOptions};
+#[cfg(feature = "simulation")]
+pub use simulation::{SimCamera, SimulationConfig};
+pub use telemetry::{Telemetry, TelemetryOptions, TelemetryPoller, TelemetryReader};
+pub use view::ImageView;
+pub use worker::{CameraWorker, Pending, Priority};
+
 #[cfg(not(test))]
-use libqhyccd_sys::{
+use crate::backend::ffi::{
     BeginQHYCCDLive, CancelQHYCCDExposing, CancelQHYCCDExposingAndReadout, CloseQHYCCD,
-    ExpQHYCCDSingleFrame, GetQHYCCDChipInfo, GetQHYCCDEffectiveArea, GetQHYCCDExposureRemaining,
-    GetQHYCCDFWVersion, GetQHYCCDId, GetQHYCCDLiveFrame, GetQHYCCDMemLength, GetQHYCCDModel,
-    GetQHYCCDNumberOfReadModes, GetQHYCCDOverScanArea, GetQHYCCDParam, GetQHYCCDParamMinMaxStep,
-    GetQHYCCDReadMode, GetQHYCCDReadModeName, GetQHYCCDReadModeResolution, GetQHYCCDSDKVersion,
-    GetQHYCCDSingleFrame, GetQHYCCDType, InitQHYCCD, InitQHYCCDResource, IsQHYCCDCFWPlugged,
-    IsQHYCCDControlAvailable, OpenQHYCCD, ReleaseQHYCCDResource, ScanQHYCCD, SetQHYCCDBinMode,
-    SetQHYCCDBitsMode, SetQHYCCDDebayerOnOff, SetQHYCCDParam, SetQHYCCDReadMode,
-    SetQHYCCDResolution, SetQHYCCDStreamMode, StopQHYCCDLive, QHYCCD_ERROR, QHYCCD_ERROR_F64,
-    QHYCCD_SUCCESS,
+    ExpQHYCCDSingleFrame, GetQHYCCDCFWStatus, GetQHYCCDChipInfo, GetQHYCCDEffectiveArea,
+    GetQHYCCDExposureRemaining, GetQHYCCDFWVersion, GetQHYCCDId, GetQHYCCDLiveFrame,
+    GetQHYCCDMemLength, GetQHYCCDModel, GetQHYCCDNumberOfReadModes, GetQHYCCDOverScanArea,
+    GetQHYCCDParam, GetQHYCCDParamMinMaxStep, GetQHYCCDReadMode, GetQHYCCDReadModeName,
+    GetQHYCCDReadModeResolution, GetQHYCCDSDKVersion, GetQHYCCDSingleFrame, GetQHYCCDType,
+    InitQHYCCD, InitQHYCCDResource, IsQHYCCDCFWPlugged, IsQHYCCDControlAvailable, OpenQHYCCD,
+    ReleaseQHYCCDResource, ScanQHYCCD, SetQHYCCDBinMode, SetQHYCCDBitsMode, SetQHYCCDDebayerOnOff,
+    SetQHYCCDParam, SetQHYCCDReadMode, SetQHYCCDResolution, SetQHYCCDStreamMode, StopQHYCCDLive,
+    QHYCCD_ERROR, QHYCCD_ERROR_F64, QHYCCD_SUCCESS,
 };
 
 #[cfg(test)]
 use crate::mocks::mock_libqhyccd_sys::{
     BeginQHYCCDLive, CancelQHYCCDExposing, CancelQHYCCDExposingAndReadout, CloseQHYCCD,
-    ExpQHYCCDSingleFrame, GetQHYCCDChipInfo, GetQHYCCDEffectiveArea, GetQHYCCDExposureRemaining,
-    GetQHYCCDFWVersion, GetQHYCCDId, GetQHYCCDLiveFrame, GetQHYCCDMemLength, GetQHYCCDModel,
-    GetQHYCCDNumberOfReadModes, GetQHYCCDOverScanArea, GetQHYCCDParam, GetQHYCCDParamMinMaxStep,
-    GetQHYCCDReadMode, GetQHYCCDReadModeName, GetQHYCCDReadModeResolution, GetQHYCCDSDKVersion,
-    GetQHYCCDSingleFrame, GetQHYCCDType, InitQHYCCD, InitQHYCCDResource, IsQHYCCDCFWPlugged,
-    IsQHYCCDControlAvailable, OpenQHYCCD, ReleaseQHYCCDResource, ScanQHYCCD, SetQHYCCDBinMode,
-    SetQHYCCDBitsMode, SetQHYCCDDebayerOnOff, SetQHYCCDParam, SetQHYCCDReadMode,
-    SetQHYCCDResolution, SetQHYCCDStreamMode, StopQHYCCDLive, QHYCCD_ERROR, QHYCCD_ERROR_F64,
-    QHYCCD_SUCCESS,
+    ExpQHYCCDSingleFrame, GetQHYCCDCFWStatus, GetQHYCCDChipInfo, GetQHYCCDEffectiveArea,
+    GetQHYCCDExposureRemaining, GetQHYCCDFWVersion, GetQHYCCDId, GetQHYCCDLiveFrame,
+    GetQHYCCDMemLength, GetQHYCCDModel, GetQHYCCDNumberOfReadModes, GetQHYCCDOverScanArea,
+    GetQHYCCDParam, GetQHYCCDParamMinMaxStep, GetQHYCCDReadMode, GetQHYCCDReadModeName,
+    GetQHYCCDReadModeResolution, GetQHYCCDSDKVersion, GetQHYCCDSingleFrame, GetQHYCCDType,
+    InitQHYCCD, InitQHYCCDResource, IsQHYCCDCFWPlugged, IsQHYCCDControlAvailable, OpenQHYCCD,
+    ReleaseQHYCCDResource, ScanQHYCCD, SetQHYCCDBinMode, SetQHYCCDBitsMode, SetQHYCCDDebayerOnOff,
+    SetQHYCCDParam, SetQHYCCDReadMode, SetQHYCCDResolution, SetQHYCCDStreamMode, StopQHYCCDLive,
+    QHYCCD_ERROR, QHYCCD_ERROR_F64, QHYCCD_SUCCESS,
 };
 
 use thiserror::Error;
@@ -142,15 +205,98 @@ pub enum QHYError {
     GetCfwPositionError,
     #[error("Error setting filter wheel position")]
     SetCfwPositionError,
+    #[error("Error getting filter wheel status, error code {:?}", error_code)]
+    GetCfwStatusError { error_code: u32 },
     #[error("Error opening the filter wheel")]
     OpenFilterWheelError,
     #[error("Error closing the filter wheel error code {:?}", error_code)]
     CloseFilterWheelError { error_code: u32 },
     #[error("Error getting the number of filters")]
     GetNumberOfFiltersError,
+    #[error("Error live stream is stopped")]
+    LiveStreamStoppedError,
+    #[error(
+        "Error image buffer too small, needed {} bytes but got {}",
+        needed,
+        available
+    )]
+    BufferTooSmallError { needed: usize, available: usize },
+    #[error(
+        "Error unsupported image with {} bits per pixel and {} channels",
+        bits_per_pixel,
+        channels
+    )]
+    UnsupportedImageError { bits_per_pixel: u32, channels: u32 },
+    #[error(
+        "Error area at {},{} with size {}x{} is outside of the image",
+        start_x,
+        start_y,
+        width,
+        height
+    )]
+    InvalidAreaError {
+        start_x: u32,
+        start_y: u32,
+        width: u32,
+        height: u32,
+    },
+    #[error("Error invalid binning factor {}", factor)]
+    InvalidBinningError { factor: u32 },
+    #[error("Error writing FITS file")]
+    WriteFitsError,
+    #[error("Error the sequence changes filters but the sequencer has no filter wheel")]
+    SequencerNoFilterWheelError,
+    #[error("Error filter wheel did not reach position {}", position)]
+    FilterWheelMoveTimeoutError { position: u32 },
+    #[error("Error compressing image")]
+    CompressError,
+    #[error("Error setting SDK backend, a backend is already in use")]
+    BackendAlreadySetError,
+    #[error(
+        "Error value {} for {:?} is outside of {} to {} in steps of {}",
+        value,
+        control,
+        min,
+        max,
+        step
+    )]
+    InvalidParameterError {
+        control: Control,
+        value: f64,
+        min: f64,
+        max: f64,
+        step: f64,
+    },
+    #[error(
+        "Error frame of {}x{} with {} channels does not match {}x{} with {} channels",
+        width,
+        height,
+        channels,
+        expected_width,
+        expected_height,
+        expected_channels
+    )]
+    FrameMismatchError {
+        width: u32,
+        height: u32,
+        channels: u32,
+        expected_width: u32,
+        expected_height: u32,
+        expected_channels: u32,
+    },
+    #[error("Error no frames to stack")]
+    StackEmptyError,
+    #[error("Error writing SER file")]
+    WriteSerError,
+    #[error("Error recorder is full after {} frames", capacity)]
+    RecorderFullError { capacity: usize },
+    #[error("Error camera worker is stopped")]
+    WorkerStoppedError,
+    #[error("Error camera {} is not connected", id)]
+    DeviceNotFoundError { id: String },
 }
 
-#[derive(Debug, PartialEq, Clone, Copy)]
+#[derive(Debug, PartialEq, Eq, Hash, Clone, Copy)]
 /// Controls used in `is_control_available` and `set_parameter` nad `get_parameter`
 /// documentation is taken from the QHYCCD SDK
 /// here <https://www.qhyccd.cn/file/repository/publish/SDK/code/QHYCCD%20SDK_API_EN_V2.3.pdf>
@@ -387,7 +533,103 @@ pub enum Control {
     GaindB = 1029,
 }
 
-#[derive(Debug, PartialEq)]
+impl Control {
+    /// All controls the SDK knows about, without the `MaxIdError` and `MaxId` markers
+    pub const ALL: [Control; 90] = [
+        Control::Brightness,
+        Control::Contrast,
+        Control::Wbr,
+        Control::Wbb,
+        Control::Wbg,
+        Control::Gamma,
+        Control::Gain,
+        Control::Offset,
+        Control::Exposure,
+        Control::Speed,
+        Control::TransferBit,
+        Control::Channels,
+        Control::UsbTraffic,
+        Control::RowDeNoise,
+        Control::CurTemp,
+        Control::CurPWM,
+        Control::ManualPWM,
+        Control::CfwPort,
+        Control::Cooler,
+        Control::St4Port,
+        Control::CamColor,
+        Control::CamBin1x1mode,
+        Control::CamBin2x2mode,
+        Control::CamBin3x3mode,
+        Control::CamBin4x4mode,
+        Control::CamMechanicalShutter,
+        Control::CamTrigerInterface,
+        Control::CamTecoverprotectInterface,
+        Control::CamSignalClampInterface,
+        Control::CamFinetoneInterface,
+        Control::CamShutterMotorHeatingInterface,
+        Control::CamCalibrateFpnInterface,
+        Control::CamChipTemperatureSensorInterface,
+        Control::CamUsbReadoutSlowestInterface,
+        Control::Cam8bits,
+        Control::Cam16bits,
+        Control::CamGps,
+        Control::CamIgnoreOverscanInterface,
+        Control::Qhyccd3aAutoexposure,
+        Control::Qhyccd3aAutofocus,
+        Control::Ampv,
+        Control::Vcam,
+        Control::CamViewMode,
+        Control::CfwSlotsNum,
+        Control::IsExposingDone,
+        Control::ScreenStretchB,
+        Control::ScreenStretchW,
+        Control::DDR,
+        Control::CamLightPerformanceMode,
+        Control::CamQhy5IIGuideMode,
+        Control::DDRBufferCapacity,
+        Control::DDRBufferReadThreshold,
+        Control::DefaultGain,
+        Control::DefaultOffset,
+        Control::OutputDataActualBits,
+        Control::OutputDataAlignment,
+        Control::CamSingleFrameMode,
+        Control::CamLiveVideoMode,
+        Control::CamIsColor,
+        Control::HasHardwareFrameCounter,
+        Control::CamHumidity,
+        Control::CamPressure,
+        Control::VacuumPump,
+        Control::SensorChamberCyclePump,
+        Control::Cam32bits,
+        Control::CamSensorUlvoStatus,
+        Control::CamSensorPhaseReTrain,
+        Control::CamInitConfigFromFlash,
+        Control::CamTriggerMode,
+        Control::CamTriggerOut,
+        Control::CamBurstMode,
+        Control::CamSpeakerLedAlarm,
+        Control::CamWatchDogFpga,
+        Control::CamBin6x6mode,
+        Control::CamBin8x8mode,
+        Control::CamGlobalSensorGpsLED,
+        Control::ImgProc,
+        Control::RemoveRbi,
+        Control::GlobalReset,
+        Control::FrameDetect,
+        Control::CamGainDbConversion,
+        Control::CamCurveSystemGain,
+        Control::CamCurveFullWell,
+        Control::CamCurveReadoutNoise,
+        Control::Autowhitebalance,
+        Control::Autoexposure,
+        Control::AutoexpMessureValue,
+        Control::AutoexpMessureMethod,
+        Control::ImageStabilization,
+        Control::GaindB,
+    ];
+}
+
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
 /// Stream mode used in `set_stream_mode`
 pub enum StreamMode {
     /// Long exposure mode
@@ -428,6 +670,164 @@ pub struct ImageData {
     pub bits_per_pixel: u32,
     /// the number of channels 1 or 4 most of the time
     pub channels: u32,
+    /// when and in which order the frame was captured, set on the frames of a `LiveStream` and kept by
+    /// `bin`, `debayer` and `to_image`
+    pub metadata: Option<FrameMetadata>,
+}
+
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+/// When and in which order a frame was captured, see `ImageData::metadata`
+pub struct FrameMetadata {
+    /// the number of the frame in its stream counting from 0, the frames the stream dropped leave gaps
+    pub sequence: u64,
+    /// the number of frames the stream dropped until this frame was queued
+    pub dropped: u64,
+    /// when the frame was read from the SDK, on the monotonic clock for measuring latencies
+    pub captured: Instant,
+    /// the system time of `captured`, e.g. to match the frame with mount or guider logs
+    pub timestamp: SystemTime,
+    /// the estimated end of the exposure, the time the SDK was asked for the frame and had it ready
+    pub exposure_end: SystemTime,
+    /// the exposure time last set with `set_parameter`, `None` if it was not set through this camera
+    pub exposure: Option<Duration>,
+}
+
+impl FrameMetadata {
+    /// Returns the estimated start of the exposure, `exposure` before `exposure_end`
+    pub fn exposure_start(&self) -> Option<SystemTime> {
+        self.exposure
+            .and_then(|exposure| self.exposure_end.checked_sub(exposure))
+    }
+
+    /// Returns the time since the frame was read from the SDK
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,LiveStreamOptions};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// /* open, init and set up the camera in Live Mode */
+    /// let stream = camera.begin_live_stream(LiveStreamOptions::default()).expect("begin_live_stream failed");
+    /// let image = stream.next_frame().expect("next_frame failed");
+    /// let metadata = image.metadata.expect("live frames have metadata");
+    /// println!("frame {} is {:?} old", metadata.sequence, metadata.latency());
+    /// ```
+    pub fn latency(&self) -> Duration {
+        self.captured.elapsed()
+    }
+}
+
+#[derive(Debug, PartialEq, Clone, Copy)]
+/// the geometry of a frame written into a caller provided buffer by `get_live_frame_into`
+/// and `get_single_frame_into`
+pub struct FrameInfo {
+    /// the width of the image in pixels
+    pub width: u32,
+    /// the height of the image in pixels
+    pub height: u32,
+    /// the number of bits per pixel
+    pub bits_per_pixel: u32,
+    /// the number of channels 1 or 4 most of the time
+    pub channels: u32,
+}
+
+impl FrameInfo {
+    /// the number of bytes of image data in the buffer for this frame
+    pub fn data_len(&self) -> usize {
+        self.width as usize
+            * self.height as usize
+            * self.channels as usize
+            * (self.bits_per_pixel as usize).div_ceil(8)
+    }
+}
+
+impl ImageData {
+    /// Returns the geometry of the image
+    pub fn info(&self) -> FrameInfo {
+        FrameInfo {
+            width: self.width,
+            height: self.height,
+            bits_per_pixel: self.bits_per_pixel,
+            channels: self.channels,
+        }
+    }
+
+    /// Returns the number of bytes of a single sample, 1 for 8 bit and 2 for 16 bit images
+    pub fn bytes_per_sample(&self) -> usize {
+        (self.bits_per_pixel as usize).div_ceil(8)
+    }
+
+    /// Returns the distance in bytes between the start of two rows, the SDK does not pad rows
+    pub fn row_stride(&self) -> usize {
+        self.width as usize * self.channels as usize * self.bytes_per_sample()
+    }
+
+    /// Returns the image data without the unused tail of the buffer. Buffers sized with `get_image_size` are
+    /// usually larger than the frame that was written into them.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![1, 2, 3, 4, 0, 0], width: 2, height: 2, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// assert_eq!(image.as_u8_slice(), &[1, 2, 3, 4]);
+    /// ```
+    pub fn as_u8_slice(&self) -> &[u8] {
+        let len = self.info().data_len().min(self.data.len());
+        &self.data[..len]
+    }
+
+    /// Mutable version of `as_u8_slice`
+    pub fn as_u8_slice_mut(&mut self) -> &mut [u8] {
+        let len = self.info().data_len().min(self.data.len());
+        &mut self.data[..len]
+    }
+
+    /// Returns the samples of a 16 bit image without copying them. The SDK delivers them in little endian,
+    /// which is the native order on all platforms the SDK is available for.
+    ///
+    /// Returns `None` for images with 8 bits per pixel or if the buffer is not aligned to 2 bytes. With the
+    /// default global allocator buffers allocated by this crate always are aligned, since `malloc` aligns
+    /// every allocation to at least 8 bytes.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![1, 0, 0, 1], width: 2, height: 1, bits_per_pixel: 16, channels: 1, metadata: None };
+    /// assert_eq!(image.as_u16_slice(), Some(&[1_u16, 256][..]));
+    /// ```
+    pub fn as_u16_slice(&self) -> Option<&[u16]> {
+        if self.bytes_per_sample() != 2 {
+            return None;
+        }
+        // Safety: every bit pattern is a valid u16, align_to only hands out the correctly aligned middle part
+        let (head, samples, _) = unsafe { self.as_u8_slice().align_to::<u16>() };
+        head.is_empty().then_some(samples)
+    }
+
+    /// Mutable version of `as_u16_slice`
+    pub fn as_u16_slice_mut(&mut self) -> Option<&mut [u16]> {
+        if self.bytes_per_sample() != 2 {
+            return None;
+        }
+        // Safety: see `as_u16_slice`
+        let (head, samples, _) = unsafe { self.as_u8_slice_mut().align_to_mut::<u16>() };
+        head.is_empty().then_some(samples)
+    }
+
+    /// Returns an iterator over the rows of the image as bytes, each row holds `width * channels` samples
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::ImageData;
+    /// let image = ImageData { data: vec![1, 2, 3, 4, 5, 6], width: 3, height: 2, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let rows: Vec<&[u8]> = image.rows().collect();
+    /// assert_eq!(rows, vec![&[1, 2, 3][..], &[4, 5, 6][..]]);
+    /// ```
+    pub fn rows(&self) -> std::slice::ChunksExact<'_, u8> {
+        self.as_u8_slice().chunks_exact(self.row_stride().max(1))
+    }
+
+    /// Returns an iterator over the rows of a 16 bit image, `None` under the same conditions as `as_u16_slice`
+    pub fn rows_u16(&self) -> Option<std::slice::ChunksExact<'_, u16>> {
+        let samples_per_row = (self.width as usize * self.channels as usize).max(1);
+        Some(self.as_u16_slice()?.chunks_exact(samples_per_row))
+    }
 }
 
 #[derive(Debug, PartialEq, Clone, Copy)]
@@ -443,7 +843,7 @@ pub struct CCDChipArea {
     pub height: u32,
 }
 
-#[derive(Debug, PartialEq)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
 #[allow(missing_docs)]
 /// this struct is returned from `is_control_available` when used with `Control::CamColor`
 pub enum BayerMode {
@@ -467,7 +867,7 @@ impl TryFrom<u32> for BayerMode {
     }
 }
 
-#[derive(Debug, PartialEq)]
+#[derive(Debug, PartialEq, Clone)]
 /// used to store readout mode numbers and their descriptions coming from `get_readout_mode_name`
 pub struct ReadoutMode {
     /// the number of the mode staring with 0
@@ -507,7 +907,31 @@ pub struct SDKVersion {
 /// ```
 pub struct Sdk {
     cameras: Vec<Camera>,
-    filter_wheels: Vec<FilterWheel>,
+    /// set during discovery or on the first call of `filter_wheels` if `SdkOptions::probe_filter_wheels` is off
+    filter_wheels: OnceLock<Vec<FilterWheel>>,
+    keep_open: bool,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// Options for `Sdk::new_with`, the default discovers devices the same way as `Sdk::new`
+pub struct SdkOptions {
+    /// probe the cameras concurrently with one thread per camera instead of one after the other
+    pub parallel: bool,
+    /// open every camera during discovery to check for a filter wheel. When off, cameras are only opened for
+    /// this on the first call of `Sdk::filter_wheels`, and cameras that fail to open are still listed.
+    pub probe_filter_wheels: bool,
+    /// leave the cameras open after discovery instead of closing them again, `Camera::open` is then a no-op
+    pub keep_open: bool,
+}
+
+impl Default for SdkOptions {
+    fn default() -> Self {
+        Self {
+            parallel: false,
+            probe_filter_wheels: true,
+            keep_open: false,
+        }
+    }
 }
 
 #[allow(unused_unsafe)]
@@ -520,78 +944,69 @@ impl Sdk {
     /// assert!(sdk.is_ok());
     /// ```
     pub fn new() -> Result<Self> {
+        Self::new_with(SdkOptions::default())
+    }
+
+    /// Creates a new instance of the SDK and discovers the connected devices as configured by `options`.
+    /// On arrays with several cameras probing them in parallel and deferring the filter wheel check cuts the
+    /// startup time considerably.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk, SdkOptions};
+    /// let sdk = Sdk::new_with(SdkOptions {
+    ///     parallel: true,
+    ///     probe_filter_wheels: false,
+    ///     keep_open: true,
+    /// })
+    /// .expect("SDK::new_with failed");
+    /// for camera in sdk.cameras() {
+    ///     assert!(camera.is_open().unwrap());
+    /// }
+    /// ```
+    pub fn new_with(options: SdkOptions) -> Result<Self> {
         match unsafe { InitQHYCCDResource() } {
             QHYCCD_SUCCESS => {
-                let num_cameras = match unsafe { ScanQHYCCD() } {
-                    QHYCCD_ERROR => {
-                        let error = ScanQHYCCDError;
-                        tracing::error!(error = ?error);
-                        Err(eyre!(error))
-                    }
-                    num => Ok(num),
-                }?;
-
-                let mut cameras = Vec::with_capacity(num_cameras as usize);
-                let mut filter_wheels = Vec::with_capacity(num_cameras as usize);
-                for index in 0..num_cameras {
-                    let id = {
-                        let mut c_id: [c_char; 32] = [0; 32];
-                        unsafe {
-                            match GetQHYCCDId(index, c_id.as_mut_ptr()) {
-                                QHYCCD_SUCCESS => {
-                                    let id = match CStr::from_ptr(c_id.as_ptr()).to_str() {
-                                        Ok(id) => id,
-                                        Err(error) => {
-                                            tracing::error!(error = ?error);
-                                            return Err(eyre!(error));
-                                        }
-                                    };
-                                    Ok(id.to_owned())
-                                }
-                                error_code => {
-                                    let error = GetCameraIdError { error_code };
-                                    tracing::error!(error = ?error);
-                                    Err(eyre!(error))
-                                }
-                            }
-                        }
-                    }?;
-                    let camera = Camera::new(id.clone());
-                    let mut has_filter_wheel = false;
-                    match camera.open() {
-                        Ok(_) => match camera.is_cfw_plugged_in() {
-                            Ok(true) => {
-                                tracing::trace!("Camera {} reporting a filter wheel", id);
-                                has_filter_wheel = true;
-                            }
-                            Ok(false) => {
-                                tracing::trace!("Camera {} has no filter wheel", id)
-                            }
-                            Err(error) => {
-                                tracing::error!(error = ?error);
-                            }
-                        },
-                        Err(error) => {
-                            tracing::error!(error = ?error);
-                            continue;
-                        }
-                    }
-                    match camera.close() {
-                        Ok(_) => (),
-                        Err(error) => {
-                            tracing::error!(error = ?error);
-                            continue;
-                        }
-                    }
+                let ids = Self::scan()?;
+
+                let probed: Vec<Option<(Camera, bool)>> = if options.parallel && ids.len() > 1 {
+                    std::thread::scope(|scope| {
+                        let probes: Vec<_> = ids
+                            .iter()
+                            .map(|id| scope.spawn(|| Self::probe_camera(id, &options)))
+                            .collect();
+                        probes
+                            .into_iter()
+                            .map(|probe| {
+                                probe.join().unwrap_or_else(|_| {
+                                    tracing::error!("camera probe thread panicked");
+                                    None
+                                })
+                            })
+                            .collect()
+                    })
+                } else {
+                    ids.iter()
+                        .map(|id| Self::probe_camera(id, &options))
+                        .collect()
+                };
+
+                let mut cameras = Vec::with_capacity(probed.len());
+                let mut filter_wheels = Vec::with_capacity(probed.len());
+                for (camera, has_filter_wheel) in probed.into_iter().flatten() {
                     if has_filter_wheel {
-                        filter_wheels.push(FilterWheel::new(Camera::new(id)))
-                    };
+                        filter_wheels.push(Self::filter_wheel_for(&camera, options.keep_open));
+                    }
                     cameras.push(camera);
                 }
+                let sdk_filter_wheels = OnceLock::new();
+                if options.probe_filter_wheels {
+                    let _ = sdk_filter_wheels.set(filter_wheels);
+                }
 
                 Ok(Sdk {
                     cameras,
-                    filter_wheels,
+                    filter_wheels: sdk_filter_wheels,
+                    keep_open: options.keep_open,
                 })
             }
             error_code => {
@@ -601,6 +1016,110 @@ impl Sdk {
             }
         }
     }
+
+    /// asks the SDK for the connected cameras, also after the first scan to find cameras that were plugged in
+    /// or reset
+    fn scan() -> Result<Vec<String>> {
+        let num_cameras = match unsafe { ScanQHYCCD() } {
+            QHYCCD_ERROR => {
+                let error = ScanQHYCCDError;
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+            num => Ok(num),
+        }?;
+        (0..num_cameras).map(Self::camera_id).collect()
+    }
+
+    fn camera_id(index: u32) -> Result<String> {
+        let mut c_id: [c_char; 32] = [0; 32];
+        unsafe {
+            match GetQHYCCDId(index, c_id.as_mut_ptr()) {
+                QHYCCD_SUCCESS => match CStr::from_ptr(c_id.as_ptr()).to_str() {
+                    Ok(id) => Ok(id.to_owned()),
+                    Err(error) => {
+                        tracing::error!(error = ?error);
+                        Err(eyre!(error))
+                    }
+                },
+                error_code => {
+                    let error = GetCameraIdError { error_code };
+                    tracing::error!(error = ?error);
+                    Err(eyre!(error))
+                }
+            }
+        }
+    }
+
+    /// opens the camera if needed for the options, returns `None` if the camera has to be skipped
+    fn probe_camera(id: &str, options: &SdkOptions) -> Option<(Camera, bool)> {
+        let camera = Camera::new(id.to_owned());
+        if !options.probe_filter_wheels && !options.keep_open {
+            return Some((camera, false));
+        }
+        if let Err(error) = camera.open() {
+            tracing::error!(error = ?error);
+            return None;
+        }
+        let has_filter_wheel = options.probe_filter_wheels && Self::reports_filter_wheel(&camera);
+        if !options.keep_open {
+            if let Err(error) = camera.close() {
+                tracing::error!(error = ?error);
+                return None;
+            }
+        }
+        Some((camera, has_filter_wheel))
+    }
+
+    fn reports_filter_wheel(camera: &Camera) -> bool {
+        match camera.is_cfw_plugged_in() {
+            Ok(true) => {
+                tracing::trace!("Camera {} reporting a filter wheel", camera.id());
+                true
+            }
+            Ok(false) => {
+                tracing::trace!("Camera {} has no filter wheel", camera.id());
+                false
+            }
+            Err(error) => {
+                tracing::error!(error = ?error);
+                false
+            }
+        }
+    }
+
+    /// an open camera is shared with its filter wheel, otherwise the filter wheel gets its own handle
+    fn filter_wheel_for(camera: &Camera, keep_open: bool) -> FilterWheel {
+        match keep_open {
+            true => FilterWheel::new(camera.clone()),
+            false => FilterWheel::new(Camera::new(camera.id().to_owned())),
+        }
+    }
+
+    /// checks all cameras for a filter wheel, opening and closing them again if they are not open
+    fn detect_filter_wheels(&self) -> Vec<FilterWheel> {
+        self.cameras
+            .iter()
+            .filter(|camera| {
+                let was_open = camera.is_open().unwrap_or(false);
+                if !was_open {
+                    if let Err(error) = camera.open() {
+                        tracing::error!(error = ?error);
+                        return false;
+                    }
+                }
+                let has_filter_wheel = Self::reports_filter_wheel(camera);
+                if !was_open {
+                    if let Err(error) = camera.close() {
+                        tracing::error!(error = ?error);
+                    }
+                }
+                has_filter_wheel
+            })
+            .map(|camera| Self::filter_wheel_for(camera, self.keep_open))
+            .collect()
+    }
+
     /// Returns an iterator over all cameras found by the SDK
     /// # Example
     /// ```no_run
@@ -614,7 +1133,8 @@ impl Sdk {
         self.cameras.iter()
     }
 
-    /// Returns an iterator over all filter wheels found by the SDK
+    /// Returns an iterator over all filter wheels found by the SDK. If the SDK was created with
+    /// `SdkOptions::probe_filter_wheels` off, the first call checks every camera for a filter wheel.
     /// # Example
     /// ```no_run
     /// use qhyccd_rs::Sdk;
@@ -623,7 +1143,9 @@ impl Sdk {
     /// println!("{} filter wheels connected.", sdk.filter_wheels().count());
     /// ```
     pub fn filter_wheels(&self) -> impl Iterator<Item = &FilterWheel> {
-        self.filter_wheels.iter()
+        self.filter_wheels
+            .get_or_init(|| self.detect_filter_wheels())
+            .iter()
     }
 
     /// Returns the version of the SDK
@@ -668,14 +1190,142 @@ impl Drop for Sdk {
     }
 }
 
-#[derive(Debug, PartialEq, Copy, Clone)]
+/// The SDK handle of a camera, null while the camera is closed. SDK calls do not take a lock: they count
+/// themselves in `in_flight` and load the pointer. `close` swaps the pointer to null first and then waits
+/// until `in_flight` drops to zero before handing the handle back to the SDK, so no call can still be using it.
+#[derive(Debug, Default)]
 struct QHYCCDHandle {
-    pub ptr: *const std::ffi::c_void,
+    ptr: AtomicPtr<std::ffi::c_void>,
+    in_flight: AtomicUsize,
+    /// serializes `open` and `close`, the SDK calls never take it
+    open_close: Mutex<()>,
+    /// filled by `Camera::capabilities`, cleared on `open`, `close` and `set_readout_mode`
+    capabilities: RwLock<Option<Arc<CameraCapabilities>>>,
+    /// the counters behind `Camera::metrics`
+    metrics: Metrics,
+    /// the values last set with `set_parameter` or `apply`, cleared on `open`, `close`, `init` and
+    /// `set_readout_mode`. `set_bit_mode` drops `TransferBit`, which the SDK changes along with it.
+    applied: Mutex<HashMap<Control, f64>>,
+    /// the modes last set, for `Camera::reconfigure`, reset on `open` and `close`
+    modes: Mutex<CaptureModes>,
+    /// the filter wheel position and move, for `FilterWheel::move_to`, reset on `open` and `close`
+    cfw: Mutex<CfwState>,
+    /// what `GetQHYCCDMemLength` last returned, so polling for live frames does not ask every time. 0 until
+    /// it is asked, cleared whenever a mode changes and after a failed `GetQHYCCDLiveFrame`.
+    mem_length: AtomicUsize,
 }
 
-//Safety: QHYCCDHandle is only used in Camera and Camera is Send and Sync
-unsafe impl Send for QHYCCDHandle {}
-unsafe impl Sync for QHYCCDHandle {}
+impl QHYCCDHandle {
+    /// Returns a guard holding the handle, the camera can not be closed while the guard lives.
+    /// Both operations are SeqCst so that either this sees the null written by `close` or `close` sees
+    /// the increment.
+    fn acquire(&self) -> Result<HandleGuard<'_>> {
+        self.in_flight.fetch_add(1, Ordering::SeqCst);
+        let ptr = self.ptr.load(Ordering::SeqCst);
+        if ptr.is_null() {
+            self.in_flight.fetch_sub(1, Ordering::SeqCst);
+            tracing::error!(error = ?CameraNotOpenError);
+            return Err(eyre!(CameraNotOpenError));
+        }
+        Ok(HandleGuard { owner: self, ptr })
+    }
+
+    fn is_open(&self) -> bool {
+        !self.ptr.load(Ordering::SeqCst).is_null()
+    }
+
+    fn lock_open_close(&self) -> std::sync::MutexGuard<'_, ()> {
+        self.open_close
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn capabilities(&self) -> Option<Arc<CameraCapabilities>> {
+        self.capabilities
+            .read()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .clone()
+    }
+
+    fn set_capabilities(&self, capabilities: Option<Arc<CameraCapabilities>>) {
+        *self
+            .capabilities
+            .write()
+            .unwrap_or_else(|poisoned| poisoned.into_inner()) = capabilities;
+    }
+
+    /// drops the chip info from the snapshot, its bits per pixel and image size change with the bit mode and
+    /// binning, so `get_ccd_info` asks the SDK again
+    fn forget_ccd_info(&self) {
+        let mut capabilities = self
+            .capabilities
+            .write()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        if let Some(snapshot) = capabilities
+            .as_mut()
+            .filter(|snapshot| snapshot.ccd_info.is_some())
+        {
+            Arc::make_mut(snapshot).ccd_info = None;
+        }
+    }
+
+    fn applied(&self) -> std::sync::MutexGuard<'_, HashMap<Control, f64>> {
+        // a map of plain values, still consistent after a panic
+        self.applied
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn modes(&self) -> std::sync::MutexGuard<'_, CaptureModes> {
+        self.modes
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn cfw(&self) -> std::sync::MutexGuard<'_, CfwState> {
+        self.cfw
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn forget_mem_length(&self) {
+        self.mem_length.store(0, Ordering::Relaxed);
+    }
+
+    /// waits for all calls that acquired the handle before it was cleared
+    fn wait_idle(&self) {
+        let mut spins = 0_u32;
+        while self.in_flight.load(Ordering::SeqCst) != 0 {
+            if spins < 100 {
+                std::thread::yield_now();
+                spins += 1;
+            } else {
+                // e.g. a single frame readout still running
+                std::thread::sleep(std::time::Duration::from_millis(1));
+            }
+        }
+    }
+}
+
+/// Keeps the camera from being closed while an SDK call uses the handle, dereferences to the raw handle
+struct HandleGuard<'a> {
+    owner: &'a QHYCCDHandle,
+    ptr: *mut std::ffi::c_void,
+}
+
+impl Deref for HandleGuard<'_> {
+    type Target = *mut std::ffi::c_void;
+
+    fn deref(&self) -> &Self::Target {
+        &self.ptr
+    }
+}
+
+impl Drop for HandleGuard<'_> {
+    fn drop(&mut self) {
+        self.owner.in_flight.fetch_sub(1, Ordering::SeqCst);
+    }
+}
 
 #[derive(Educe)]
 #[educe(Debug, Clone, PartialEq)]
@@ -684,22 +1334,7 @@ unsafe impl Sync for QHYCCDHandle {}
 pub struct Camera {
     id: String,
     #[educe(PartialEq(ignore))]
-    handle: Arc<RwLock<Option<QHYCCDHandle>>>,
-}
-
-macro_rules! read_lock {
-    ($var:expr, $wrap:expr) => {
-        $var.read().map_err(|err| {
-            tracing::error!(error=?err);
-            eyre!("Could not acquire read lock on camera handle")
-        }).and_then(|lock|{match *lock {
-            Some(handle) => Ok(handle.ptr),
-            None => {
-                tracing::error!(error = ?CameraNotOpenError);
-                Err(eyre!(CameraNotOpenError))
-            }
-        }}).wrap_err($wrap)
-    }
+    handle: Arc<QHYCCDHandle>,
 }
 
 #[allow(unused_unsafe)]
@@ -715,7 +1350,7 @@ impl Camera {
     pub fn new(id: String) -> Self {
         Self {
             id: id.clone(),
-            handle: Arc::new(RwLock::new(None)),
+            handle: Arc::new(QHYCCDHandle::default()),
         }
     }
 
@@ -741,9 +1376,15 @@ impl Camera {
     /// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
     /// ```
     pub fn set_stream_mode(&self, mode: StreamMode) -> Result<()> {
-        let handle = read_lock!(self.handle, SetStreamModeError { error_code: 0 })?;
-        match unsafe { SetQHYCCDStreamMode(handle, mode as u8) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetStreamModeError { error_code: 0 })?;
+        match unsafe { SetQHYCCDStreamMode(*handle, mode as u8) } {
+            QHYCCD_SUCCESS => {
+                self.handle.modes().stream_mode = Some(mode);
+                Ok(())
+            }
             error_code => {
                 let error = SetStreamModeError { error_code };
                 tracing::error!(error = ?error);
@@ -763,9 +1404,19 @@ impl Camera {
     /// camera.set_readout_mode(0).expect("set_readout_mode failed");
     /// ```
     pub fn set_readout_mode(&self, mode: u32) -> Result<()> {
-        let handle = read_lock!(self.handle, SetReadoutModeError { error_code: 0 })?;
-        match unsafe { SetQHYCCDReadMode(handle, mode) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetReadoutModeError { error_code: 0 })?;
+        match unsafe { SetQHYCCDReadMode(*handle, mode) } {
+            QHYCCD_SUCCESS => {
+                // resolution and chip info depend on the readout mode
+                self.handle.set_capabilities(None);
+                self.handle.applied().clear();
+                self.handle.modes().readout_mode = Some(mode);
+                self.handle.forget_mem_length();
+                Ok(())
+            }
             error_code => {
                 let error = SetReadoutModeError { error_code };
                 tracing::error!(error = ?error);
@@ -785,9 +1436,12 @@ impl Camera {
     /// println!("Camera model: {}", model);
     /// ```
     pub fn get_model(&self) -> Result<String> {
-        let handle = read_lock!(self.handle, GetCameraModelError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetCameraModelError { error_code: 0 })?;
         let mut model: [c_char; 80] = [0; 80];
-        match unsafe { GetQHYCCDModel(handle, model.as_mut_ptr()) } {
+        match unsafe { GetQHYCCDModel(*handle, model.as_mut_ptr()) } {
             QHYCCD_SUCCESS => {
                 let model = match unsafe { CStr::from_ptr(model.as_ptr()) }.to_str() {
                     Ok(model) => model,
@@ -817,10 +1471,20 @@ impl Camera {
     /// camera.init().expect("init failed");
     /// ```
     pub fn init(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, InitCameraError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(InitCameraError { error_code: 0 })?;
 
-        match unsafe { InitQHYCCD(handle) } {
-            QHYCCD_SUCCESS => Ok(()),
+        match unsafe { InitQHYCCD(*handle) } {
+            QHYCCD_SUCCESS => {
+                // init puts the controls back to the defaults of the camera
+                self.handle.applied().clear();
+                let mut modes = self.handle.modes();
+                (modes.bit_mode, modes.bin, modes.roi, modes.live) = (None, None, None, false);
+                self.handle.forget_mem_length();
+                Ok(())
+            }
             error_code => {
                 let error = InitCameraError { error_code };
                 tracing::error!(error = ?error);
@@ -840,9 +1504,12 @@ impl Camera {
     /// println!("Firmware version: {}", firmware_version);
     /// ```
     pub fn get_firmware_version(&self) -> Result<String> {
-        let handle = read_lock!(self.handle, GetFirmwareVersionError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetFirmwareVersionError { error_code: 0 })?;
         let mut version = [0u8; 32];
-        match unsafe { GetQHYCCDFWVersion(handle, version.as_mut_ptr()) } {
+        match unsafe { GetQHYCCDFWVersion(*handle, version.as_mut_ptr()) } {
             QHYCCD_SUCCESS => {
                 if version[0] >> 4 <= 9 {
                     Ok(format!(
@@ -879,10 +1546,18 @@ impl Camera {
     /// println!("Number of readout modes: {}", num_readout_modes);
     /// ```
     pub fn get_number_of_readout_modes(&self) -> Result<u32> {
-        let handle = read_lock!(self.handle, GetNumberOfReadoutModesError)?;
+        if let Some(capabilities) = self.cached_capabilities() {
+            if !capabilities.readout_modes.is_empty() {
+                return Ok(capabilities.readout_modes.len() as u32);
+            }
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetNumberOfReadoutModesError)?;
 
         let mut num: u32 = 0;
-        match unsafe { GetQHYCCDNumberOfReadModes(handle, &mut num as *mut u32) } {
+        match unsafe { GetQHYCCDNumberOfReadModes(*handle, &mut num as *mut u32) } {
             QHYCCD_ERROR => {
                 let error = GetNumberOfReadoutModesError;
                 tracing::error!(error = ?error);
@@ -906,9 +1581,12 @@ impl Camera {
     /// }
     /// ```
     pub fn get_readout_mode_name(&self, index: u32) -> Result<String> {
-        let handle = read_lock!(self.handle, GetReadoutModeNameError)?;
+        if let Some(mode) = self.cached_readout_mode(index) {
+            return Ok(mode.mode.name);
+        }
+        let handle = self.handle.acquire().wrap_err(GetReadoutModeNameError)?;
         let mut name: [c_char; 80] = [0; 80];
-        match unsafe { GetQHYCCDReadModeName(handle, index, name.as_mut_ptr()) } {
+        match unsafe { GetQHYCCDReadModeName(*handle, index, name.as_mut_ptr()) } {
             QHYCCD_ERROR => {
                 let error = GetReadoutModeNameError;
                 tracing::error!(error = ?error);
@@ -941,13 +1619,19 @@ impl Camera {
     /// }
     /// ```
     pub fn get_readout_mode_resolution(&self, index: u32) -> Result<(u32, u32)> {
-        let handle = read_lock!(self.handle, GetReadoutModeResolutionError)?;
+        if let Some(mode) = self.cached_readout_mode(index) {
+            return Ok(mode.resolution);
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetReadoutModeResolutionError)?;
 
         let mut width: u32 = 0;
         let mut height: u32 = 0;
         match unsafe {
             GetQHYCCDReadModeResolution(
-                handle,
+                *handle,
                 index,
                 &mut width as *mut u32,
                 &mut height as *mut u32,
@@ -974,9 +1658,9 @@ impl Camera {
     /// println!("Readout mode: {}", readout_mode);
     /// ```
     pub fn get_readout_mode(&self) -> Result<u32> {
-        let handle = read_lock!(self.handle, GetReadoutModeError)?;
+        let handle = self.handle.acquire().wrap_err(GetReadoutModeError)?;
         let mut mode: u32 = 0;
-        match unsafe { GetQHYCCDReadMode(handle, &mut mode as *mut u32) } {
+        match unsafe { GetQHYCCDReadMode(*handle, &mut mode as *mut u32) } {
             QHYCCD_SUCCESS => Ok(mode),
             _ => {
                 let error = GetReadoutModeError;
@@ -998,8 +1682,8 @@ impl Camera {
     /// println!("Type: {}", tipe);
     /// ```
     pub fn get_type(&self) -> Result<u32> {
-        let handle = read_lock!(self.handle, GetCameraTypeError)?;
-        match unsafe { GetQHYCCDType(handle) } {
+        let handle = self.handle.acquire().wrap_err(GetCameraTypeError)?;
+        match unsafe { GetQHYCCDType(*handle) } {
             QHYCCD_ERROR => {
                 let error = GetCameraTypeError;
                 tracing::error!(error = ?error);
@@ -1021,9 +1705,17 @@ impl Camera {
     /// camera.set_bin_mode(2, 2).expect("set_bin_mode failed");
     /// ```
     pub fn set_bin_mode(&self, bin_x: u32, bin_y: u32) -> Result<()> {
-        let handle = read_lock!(self.handle, SetBinModeError { error_code: 0 })?;
-        match unsafe { SetQHYCCDBinMode(handle, bin_x, bin_y) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetBinModeError { error_code: 0 })?;
+        match unsafe { SetQHYCCDBinMode(*handle, bin_x, bin_y) } {
+            QHYCCD_SUCCESS => {
+                self.handle.modes().bin = Some((bin_x, bin_y));
+                self.handle.forget_ccd_info();
+                self.handle.forget_mem_length();
+                Ok(())
+            }
             error_code => {
                 let error = SetBinModeError { error_code };
                 tracing::error!(error = ?error);
@@ -1043,8 +1735,11 @@ impl Camera {
     /// camera.set_debayer(false).expect("set_debayer failed");
     ///```
     pub fn set_debayer(&self, on: bool) -> Result<()> {
-        let handle = read_lock!(self.handle, SetDebayerError { error_code: 0 })?;
-        match unsafe { SetQHYCCDDebayerOnOff(handle, on) } {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetDebayerError { error_code: 0 })?;
+        match unsafe { SetQHYCCDDebayerOnOff(*handle, on) } {
             QHYCCD_SUCCESS => Ok(()),
             error_code => {
                 let error = SetDebayerError { error_code };
@@ -1072,11 +1767,18 @@ impl Camera {
     /// camera.set_roi(roi).expect("set_roi failed");
     /// ```
     pub fn set_roi(&self, roi: CCDChipArea) -> Result<()> {
-        let handle = read_lock!(self.handle, SetRoiError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetRoiError { error_code: 0 })?;
         match unsafe {
-            SetQHYCCDResolution(handle, roi.start_x, roi.start_y, roi.width, roi.height)
+            SetQHYCCDResolution(*handle, roi.start_x, roi.start_y, roi.width, roi.height)
         } {
-            QHYCCD_SUCCESS => Ok(()),
+            QHYCCD_SUCCESS => {
+                self.handle.modes().roi = Some(roi);
+                self.handle.forget_mem_length();
+                Ok(())
+            }
             error_code => {
                 let error = SetRoiError { error_code };
                 tracing::error!(error = ?error);
@@ -1097,9 +1799,16 @@ impl Camera {
     /// camera.begin_live().expect("begin_live failed");
     /// ```
     pub fn begin_live(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, BeginLiveError { error_code: 0 })?;
-        match unsafe { BeginQHYCCDLive(handle) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(BeginLiveError { error_code: 0 })?;
+        match unsafe { BeginQHYCCDLive(*handle) } {
+            QHYCCD_SUCCESS => {
+                self.handle.modes().live = true;
+                self.handle.metrics.exposure_started();
+                Ok(())
+            }
             error_code => {
                 let error = BeginLiveError { error_code };
                 tracing::error!(error = ?error);
@@ -1122,9 +1831,16 @@ impl Camera {
     /// camera.end_live().expect("end_live failed");
     /// ```
     pub fn end_live(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, EndLiveError { error_code: 0 })?;
-        match unsafe { StopQHYCCDLive(handle) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(EndLiveError { error_code: 0 })?;
+        match unsafe { StopQHYCCDLive(*handle) } {
+            QHYCCD_SUCCESS => {
+                self.handle.modes().live = false;
+                self.handle.metrics.exposure_ended();
+                Ok(())
+            }
             error_code => {
                 let error = EndLiveError { error_code };
                 tracing::error!(error = ?error);
@@ -1133,6 +1849,24 @@ impl Camera {
         }
     }
 
+    /// Starts Live Video Mode on the camera and a background thread that captures frames as fast as the camera
+    /// delivers them. See `LiveStream` for details.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Camera,StreamMode,LiveStreamOptions};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// let stream = camera.begin_live_stream(LiveStreamOptions::default()).expect("begin_live_stream failed");
+    /// let image = stream.next_frame().expect("next_frame failed");
+    /// stream.stop().expect("stop failed");
+    /// ```
+    pub fn begin_live_stream(&self, options: LiveStreamOptions) -> Result<LiveStream> {
+        LiveStream::start(worker::Executor::Direct(self.clone()), options)
+    }
+
     /// Returns the number of bytes needed to retrieve the image stored in the camera
     /// # Example
     /// ```no_run
@@ -1150,8 +1884,8 @@ impl Camera {
     /// let image = camera.get_single_frame(buffer_size).expect("get_camera_single_frame failed");
     /// ```
     pub fn get_image_size(&self) -> Result<usize> {
-        let handle = read_lock!(self.handle, GetImageSizeError)?;
-        match unsafe { GetQHYCCDMemLength(handle) } {
+        let handle = self.handle.acquire().wrap_err(GetImageSizeError)?;
+        match unsafe { GetQHYCCDMemLength(*handle) } {
             QHYCCD_ERROR => {
                 let error = GetImageSizeError;
                 tracing::error!(error = ?error);
@@ -1188,13 +1922,137 @@ impl Camera {
     /// camera.end_live().expect("end_camera_live failed");
     /// ```
     pub fn get_live_frame(&self, buffer_size: usize) -> Result<ImageData> {
-        let handle = read_lock!(self.handle, GetLiveFrameError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetLiveFrameError { error_code: 0 })?;
+        let mut buffer = vec![0u8; buffer_size];
+        let info = self.read_live_frame(*handle, &mut buffer)?;
+        Ok(ImageData {
+            data: buffer,
+            width: info.width,
+            height: info.height,
+            bits_per_pixel: info.bits_per_pixel,
+            channels: info.channels,
+            metadata: None,
+        })
+    }
+
+    /// Writes the image stored in the camera into `buffer` if the camera is in Live Video Mode and returns
+    /// the geometry of the frame. This does not allocate, so the same buffer can be reused for every frame.
+    /// The buffer has to be at least `get_image_size` bytes long, the image data occupies the first
+    /// `FrameInfo::data_len` bytes.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Camera,StreamMode,Control};
+    ///
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// camera.begin_live().expect("begin_live failed");
+    /// let mut buffer = vec![0u8; camera.get_image_size().expect("get_image_size failed")];
+    /// for _ in 0..1000 {
+    ///     if let Ok(info) = camera.get_live_frame_into(&mut buffer) {
+    ///         let image = &buffer[..info.data_len()];
+    ///         /* Do something with the image */
+    ///     }
+    /// }
+    /// camera.end_live().expect("end_camera_live failed");
+    /// ```
+    pub fn get_live_frame_into(&self, buffer: &mut [u8]) -> Result<FrameInfo> {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetLiveFrameError { error_code: 0 })?;
+        Self::check_buffer_size(*handle, buffer.len())?;
+        self.read_live_frame(*handle, buffer)
+    }
+
+    /// Returns the image stored in the camera if the camera is in Live Video Mode. The image is written into a
+    /// buffer taken from `pool` and the buffer goes back to the pool when the returned image is dropped.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Camera,StreamMode,FramePool};
+    ///
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// camera.begin_live().expect("begin_live failed");
+    /// let pool = FramePool::for_camera(camera, 4).expect("FramePool::for_camera failed");
+    /// let image = camera.get_live_frame_pooled(&pool).expect("get_live_frame_pooled failed");
+    /// ```
+    pub fn get_live_frame_pooled(&self, pool: &FramePool) -> Result<PooledImageData> {
+        self.handle.metrics.pool(pool);
+        let mut buffer = pool.acquire();
+        let info = self.get_live_frame_into(&mut buffer)?;
+        Ok(buffer.into_image(info))
+    }
+
+    /// Like `get_live_frame_into`, but returns `Ok(None)` without logging if no new frame is ready yet. This is
+    /// used by `LiveStream` which polls the camera as fast as it delivers frames.
+    pub(crate) fn poll_live_frame_into(&self, buffer: &mut [u8]) -> Result<Option<FrameInfo>> {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetLiveFrameError { error_code: 0 })?;
+        let needed = match self.handle.mem_length.load(Ordering::Relaxed) {
+            0 => {
+                let needed = Self::mem_length(*handle)?;
+                self.handle.mem_length.store(needed, Ordering::Relaxed);
+                needed
+            }
+            needed => needed,
+        };
+        Self::check_buffer_len(needed, buffer.len())?;
+        match self.sdk_live_frame(*handle, buffer) {
+            Ok(info) => Ok(Some(info)),
+            Err(QHYCCD_ERROR) => Ok(None),
+            Err(error_code) => {
+                // the camera may have changed, check the buffer size again on the next poll
+                self.handle.forget_mem_length();
+                let error = GetLiveFrameError { error_code };
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// the caller has to make sure `buffer` is large enough for the SDK to write the frame
+    fn read_live_frame(
+        &self,
+        handle: *const std::ffi::c_void,
+        buffer: &mut [u8],
+    ) -> Result<FrameInfo> {
+        self.sdk_live_frame(handle, buffer).map_err(|error_code| {
+            let error = GetLiveFrameError { error_code };
+            tracing::error!(error = ?error);
+            eyre!(error)
+        })
+    }
+
+    /// records the call in the metrics, the SDK returns `QHYCCD_ERROR` while no new frame is ready
+    fn sdk_live_frame(
+        &self,
+        handle: *const std::ffi::c_void,
+        buffer: &mut [u8],
+    ) -> std::result::Result<FrameInfo, u32> {
+        let span = tracing::debug_span!(
+            "get_live_frame",
+            camera = %self.id,
+            latency_us = tracing::field::Empty,
+            bytes = tracing::field::Empty
+        );
+        let _span = span.enter();
         let mut width: u32 = 0;
         let mut height: u32 = 0;
         let mut bpp: u32 = 0;
         let mut channels: u32 = 0;
-        let mut buffer = vec![0u8; buffer_size];
-        match unsafe {
+        let started = Instant::now();
+        let res = unsafe {
             GetQHYCCDLiveFrame(
                 handle,
                 &mut width as *mut u32,
@@ -1203,18 +2061,29 @@ impl Camera {
                 &mut channels as *mut u32,
                 buffer.as_mut_ptr(),
             )
-        } {
-            QHYCCD_SUCCESS => Ok(ImageData {
-                data: buffer,
-                width,
-                height,
-                bits_per_pixel: bpp,
-                channels,
-            }),
+        };
+        let latency = started.elapsed();
+        span.record("latency_us", latency.as_micros() as u64);
+        let metrics = &self.handle.metrics;
+        match res {
+            QHYCCD_SUCCESS => {
+                let info = FrameInfo {
+                    width,
+                    height,
+                    bits_per_pixel: bpp,
+                    channels,
+                };
+                span.record("bytes", info.data_len() as u64);
+                metrics.frame(&metrics.live, latency, info.data_len());
+                Ok(info)
+            }
+            QHYCCD_ERROR => {
+                metrics.not_ready(&metrics.live);
+                Err(QHYCCD_ERROR)
+            }
             error_code => {
-                let error = GetLiveFrameError { error_code };
-                tracing::error!(error = ?error);
-                Err(eyre!(error))
+                metrics.error(&metrics.live);
+                Err(error_code)
             }
         }
     }
@@ -1236,13 +2105,94 @@ impl Camera {
     /// let image = camera.get_single_frame(buffer_size).expect("get_camera_single_frame failed");
     /// ```
     pub fn get_single_frame(&self, buffer_size: usize) -> Result<ImageData> {
-        let handle = read_lock!(self.handle, GetSingleFrameError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetSingleFrameError { error_code: 0 })?;
+        let mut buffer = vec![0u8; buffer_size];
+        let info = self.read_single_frame(*handle, &mut buffer)?;
+        Ok(ImageData {
+            data: buffer,
+            width: info.width,
+            height: info.height,
+            bits_per_pixel: info.bits_per_pixel,
+            channels: info.channels,
+            metadata: None,
+        })
+    }
+
+    /// Writes the image stored in the camera into `buffer` if the camera is in Single Frame Mode and returns
+    /// the geometry of the frame. This does not allocate, so the same buffer can be reused for every exposure.
+    /// The buffer has to be at least `get_image_size` bytes long, the image data occupies the first
+    /// `FrameInfo::data_len` bytes.
+    /// # Example
+    ///
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Camera,StreamMode,Control};
+    ///
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// camera.set_parameter(Control::Exposure, 10000.0).expect("set_param failed"); // this is in micro seconds
+    /// let mut buffer = vec![0u8; camera.get_image_size().expect("get_camera_image_size failed")];
+    /// camera.start_single_frame_exposure().expect("start_camera_single_frame_exposure failed");
+    /// let info = camera.get_single_frame_into(&mut buffer).expect("get_single_frame_into failed");
+    /// let image = &buffer[..info.data_len()];
+    /// ```
+    pub fn get_single_frame_into(&self, buffer: &mut [u8]) -> Result<FrameInfo> {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetSingleFrameError { error_code: 0 })?;
+        Self::check_buffer_size(*handle, buffer.len())?;
+        self.read_single_frame(*handle, buffer)
+    }
+
+    /// Returns the image stored in the camera if the camera is in Single Frame Mode. The image is written into a
+    /// buffer taken from `pool` and the buffer goes back to the pool when the returned image is dropped.
+    /// # Example
+    ///
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Camera,StreamMode,Control,FramePool};
+    ///
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+    /// camera.init().expect("init failed");
+    /// camera.set_parameter(Control::Exposure, 10000.0).expect("set_param failed"); // this is in micro seconds
+    /// let pool = FramePool::for_camera(camera, 2).expect("FramePool::for_camera failed");
+    /// camera.start_single_frame_exposure().expect("start_camera_single_frame_exposure failed");
+    /// let image = camera.get_single_frame_pooled(&pool).expect("get_single_frame_pooled failed");
+    /// ```
+    pub fn get_single_frame_pooled(&self, pool: &FramePool) -> Result<PooledImageData> {
+        self.handle.metrics.pool(pool);
+        let mut buffer = pool.acquire();
+        let info = self.get_single_frame_into(&mut buffer)?;
+        Ok(buffer.into_image(info))
+    }
+
+    /// the caller has to make sure `buffer` is large enough for the SDK to write the frame
+    fn read_single_frame(
+        &self,
+        handle: *const std::ffi::c_void,
+        buffer: &mut [u8],
+    ) -> Result<FrameInfo> {
+        let span = tracing::debug_span!(
+            "get_single_frame",
+            camera = %self.id,
+            latency_us = tracing::field::Empty,
+            bytes = tracing::field::Empty
+        );
+        let _span = span.enter();
         let mut width: u32 = 0;
         let mut height: u32 = 0;
         let mut bpp: u32 = 0;
         let mut channels: u32 = 0;
-        let mut buffer = vec![0u8; buffer_size];
-        match unsafe {
+        let started = Instant::now();
+        let res = unsafe {
             GetQHYCCDSingleFrame(
                 handle,
                 &mut width as *mut u32,
@@ -1251,15 +2201,25 @@ impl Camera {
                 &mut channels as *mut u32,
                 buffer.as_mut_ptr(),
             )
-        } {
-            QHYCCD_SUCCESS => Ok(ImageData {
-                data: buffer,
-                width,
-                height,
-                bits_per_pixel: bpp,
-                channels,
-            }),
+        };
+        let latency = started.elapsed();
+        span.record("latency_us", latency.as_micros() as u64);
+        let metrics = &self.handle.metrics;
+        metrics.exposure_ended();
+        match res {
+            QHYCCD_SUCCESS => {
+                let info = FrameInfo {
+                    width,
+                    height,
+                    bits_per_pixel: bpp,
+                    channels,
+                };
+                span.record("bytes", info.data_len() as u64);
+                metrics.frame(&metrics.single, latency, info.data_len());
+                Ok(info)
+            }
             error_code => {
+                metrics.error(&metrics.single);
                 let error = GetSingleFrameError { error_code };
                 tracing::error!(error = ?error);
                 Err(eyre!(error))
@@ -1267,6 +2227,31 @@ impl Camera {
         }
     }
 
+    /// the SDK writes up to `GetQHYCCDMemLength` bytes into the buffer, so make sure they fit
+    fn check_buffer_size(handle: *const std::ffi::c_void, available: usize) -> Result<()> {
+        Self::check_buffer_len(Self::mem_length(handle)?, available)
+    }
+
+    fn mem_length(handle: *const std::ffi::c_void) -> Result<usize> {
+        match unsafe { GetQHYCCDMemLength(handle) } {
+            QHYCCD_ERROR => {
+                let error = GetImageSizeError;
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+            needed => Ok(needed as usize),
+        }
+    }
+
+    fn check_buffer_len(needed: usize, available: usize) -> Result<()> {
+        if needed > available {
+            let error = BufferTooSmallError { needed, available };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        Ok(())
+    }
+
     /// Get the chip area including overscan area
     /// # Example
     /// ```no_run
@@ -1278,14 +2263,23 @@ impl Camera {
     /// println!("Chip area: {:?}", chip_area);
     /// ```
     pub fn get_overscan_area(&self) -> Result<CCDChipArea> {
-        let handle = read_lock!(self.handle, GetOverscanAreaError { error_code: 0 })?;
+        if let Some(overscan_area) = self
+            .cached_capabilities()
+            .and_then(|capabilities| capabilities.overscan_area)
+        {
+            return Ok(overscan_area);
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetOverscanAreaError { error_code: 0 })?;
         let mut start_x: u32 = 0;
         let mut start_y: u32 = 0;
         let mut width: u32 = 0;
         let mut height: u32 = 0;
         match unsafe {
             GetQHYCCDOverScanArea(
-                handle,
+                *handle,
                 &mut start_x as *mut u32,
                 &mut start_y as *mut u32,
                 &mut width as *mut u32,
@@ -1317,14 +2311,23 @@ impl Camera {
     /// println!("Chip area: {:?}", chip_area);
     /// ```
     pub fn get_effective_area(&self) -> Result<CCDChipArea> {
-        let handle = read_lock!(self.handle, GetEffectiveAreaError { error_code: 0 })?;
+        if let Some(effective_area) = self
+            .cached_capabilities()
+            .and_then(|capabilities| capabilities.effective_area)
+        {
+            return Ok(effective_area);
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetEffectiveAreaError { error_code: 0 })?;
         let mut start_x: u32 = 0;
         let mut start_y: u32 = 0;
         let mut width: u32 = 0;
         let mut height: u32 = 0;
         match unsafe {
             GetQHYCCDEffectiveArea(
-                handle,
+                *handle,
                 &mut start_x as *mut u32,
                 &mut start_y as *mut u32,
                 &mut width as *mut u32,
@@ -1361,9 +2364,15 @@ impl Camera {
     /// camera.start_single_frame_exposure().expect("start_single_frame_exposure failed");
     /// ```
     pub fn start_single_frame_exposure(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, StartSingleFrameExposureError { error_code: 0 })?;
-        match unsafe { ExpQHYCCDSingleFrame(handle) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(StartSingleFrameExposureError { error_code: 0 })?;
+        match unsafe { ExpQHYCCDSingleFrame(*handle) } {
+            QHYCCD_SUCCESS => {
+                self.handle.metrics.exposure_started();
+                Ok(())
+            }
             error_code => {
                 let error = StartSingleFrameExposureError { error_code };
                 tracing::error!(error = ?error);
@@ -1386,8 +2395,8 @@ impl Camera {
     /// println!("Remaining exposure: {}", remaining_exposure);
     /// ```
     pub fn get_remaining_exposure_us(&self) -> Result<u32> {
-        let handle = read_lock!(self.handle, GetExposureRemainingError)?;
-        match unsafe { GetQHYCCDExposureRemaining(handle) } {
+        let handle = self.handle.acquire().wrap_err(GetExposureRemainingError)?;
+        match unsafe { GetQHYCCDExposureRemaining(*handle) } {
             QHYCCD_ERROR => {
                 let error = GetExposureRemainingError;
                 tracing::error!(error = ?error);
@@ -1412,8 +2421,11 @@ impl Camera {
     /// /* retrieve image data */
     /// ```
     pub fn stop_exposure(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, StopExposureError { error_code: 0 })?;
-        match unsafe { CancelQHYCCDExposing(handle) } {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(StopExposureError { error_code: 0 })?;
+        match unsafe { CancelQHYCCDExposing(*handle) } {
             QHYCCD_SUCCESS => Ok(()),
             error_code => {
                 let error = StopExposureError { error_code };
@@ -1435,8 +2447,11 @@ impl Camera {
     /// camera.abort_exposure_and_readout().expect("abort_exposure failed");
     /// ```
     pub fn abort_exposure_and_readout(&self) -> Result<()> {
-        let handle = read_lock!(self.handle, AbortExposureAndReadoutError { error_code: 0 })?;
-        match unsafe { CancelQHYCCDExposingAndReadout(handle) } {
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(AbortExposureAndReadoutError { error_code: 0 })?;
+        match unsafe { CancelQHYCCDExposingAndReadout(*handle) } {
             QHYCCD_SUCCESS => Ok(()),
             error_code => {
                 let error = AbortExposureAndReadoutError { error_code };
@@ -1464,11 +2479,18 @@ impl Camera {
     /// let camera_is_color = camera.is_control_available(Control::CamColor).is_some(); //this returns a `BayerID` if it is a color camera
     /// ```
     pub fn is_control_available(&self, control: Control) -> Option<u32> {
-        let handle = match read_lock!(self.handle, IsControlAvailableError { control }) {
+        if let Some(capabilities) = self.cached_capabilities() {
+            return capabilities.is_control_available(control);
+        }
+        let handle = match self
+            .handle
+            .acquire()
+            .wrap_err(IsControlAvailableError { control })
+        {
             Ok(handle) => handle,
             Err(_) => return None,
         };
-        match unsafe { IsQHYCCDControlAvailable(handle, control as u32) } {
+        match unsafe { IsQHYCCDControlAvailable(*handle, control as u32) } {
             QHYCCD_ERROR => {
                 let error = IsControlAvailableError { control };
                 tracing::debug!(control = ?error);
@@ -1489,7 +2511,16 @@ impl Camera {
     /// println!("Chip info: {:?}", chip_info);
     /// ```
     pub fn get_ccd_info(&self) -> Result<CCDChipInfo> {
-        let handle = read_lock!(self.handle, GetCCDInfoError { error_code: 0 })?;
+        if let Some(ccd_info) = self
+            .cached_capabilities()
+            .and_then(|capabilities| capabilities.ccd_info)
+        {
+            return Ok(ccd_info);
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetCCDInfoError { error_code: 0 })?;
         let mut chipw: f64 = 0.0;
         let mut chiph: f64 = 0.0;
         let mut imagew: u32 = 0;
@@ -1499,7 +2530,7 @@ impl Camera {
         let mut bpp: u32 = 0;
         match unsafe {
             GetQHYCCDChipInfo(
-                handle,
+                *handle,
                 &mut chipw as *mut f64,
                 &mut chiph as *mut f64,
                 &mut imagew as *mut u32,
@@ -1537,9 +2568,19 @@ impl Camera {
     /// camera.set_bit_mode(8).expect("set_bit_mode failed");
     /// ```
     pub fn set_bit_mode(&self, mode: u32) -> Result<()> {
-        let handle = read_lock!(self.handle, SetBitModeError { error_code: 0 })?;
-        match unsafe { SetQHYCCDBitsMode(handle, mode) } {
-            QHYCCD_SUCCESS => Ok(()),
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetBitModeError { error_code: 0 })?;
+        match unsafe { SetQHYCCDBitsMode(*handle, mode) } {
+            QHYCCD_SUCCESS => {
+                self.handle.modes().bit_mode = Some(mode);
+                // the SDK changes the transfer bits along with the bit mode
+                self.handle.applied().remove(&Control::TransferBit);
+                self.handle.forget_ccd_info();
+                self.handle.forget_mem_length();
+                Ok(())
+            }
             error_code => {
                 let error = SetBitModeError { error_code };
                 tracing::error!(error = ?error);
@@ -1561,7 +2602,14 @@ impl Camera {
     /// };
     /// ```
     pub fn get_parameter(&self, control: Control) -> Result<f64> {
-        let handle = read_lock!(self.handle, GetParameterError { control })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetParameterError { control })?;
+        Self::read_parameter(*handle, control)
+    }
+
+    fn read_parameter(handle: *const std::ffi::c_void, control: Control) -> Result<f64> {
         let res = unsafe { GetQHYCCDParam(handle, control as u32) };
         if (res - QHYCCD_ERROR_F64).abs() < f64::EPSILON {
             let error = GetParameterError { control };
@@ -1582,13 +2630,22 @@ impl Camera {
     /// let (min_exposure, max_exposure, exposure_resolution) = camera.get_parameter_min_max_step(Control::Exposure).expect("getting min,max,step failed");
     /// ```
     pub fn get_parameter_min_max_step(&self, control: Control) -> Result<(f64, f64, f64)> {
-        let handle = read_lock!(self.handle, GetMinMaxStepError { control })?;
+        if let Some(min_max_step) = self
+            .cached_capabilities()
+            .and_then(|capabilities| capabilities.min_max_step(control))
+        {
+            return Ok(min_max_step);
+        }
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(GetMinMaxStepError { control })?;
         let mut min: f64 = 0.0;
         let mut max: f64 = 0.0;
         let mut step: f64 = 0.0;
         match unsafe {
             GetQHYCCDParamMinMaxStep(
-                handle,
+                *handle,
                 control as u32,
                 &mut min as *mut f64,
                 &mut max as *mut f64,
@@ -1614,10 +2671,28 @@ impl Camera {
     /// camera.set_parameter(Control::Exposure, 2000000.0).expect("set_parameter failed");
     /// ```
     pub fn set_parameter(&self, control: Control, value: f64) -> Result<()> {
-        let handle = read_lock!(self.handle, SetParameterError { error_code: 0 })?;
+        let handle = self
+            .handle
+            .acquire()
+            .wrap_err(SetParameterError { error_code: 0 })?;
+        self.write_parameter(*handle, control, value)
+    }
+
+    /// sets the control and remembers the value for the unchanged check of `apply`
+    fn write_parameter(
+        &self,
+        handle: *const std::ffi::c_void,
+        control: Control,
+        value: f64,
+    ) -> Result<()> {
         match unsafe { SetQHYCCDParam(handle, control as u32, value) } {
-            QHYCCD_SUCCESS => Ok(()),
+            QHYCCD_SUCCESS => {
+                self.handle.applied().insert(control, value);
+                Ok(())
+            }
             error_code => {
+                // the camera may or may not have taken the value, so the next `apply` sends it again
+                self.handle.applied().remove(&control);
                 let error = SetParameterError { error_code };
                 tracing::error!(error = ?error);
                 Err(eyre!(error))
@@ -1654,8 +2729,8 @@ impl Camera {
     /// println!("Is filter wheel plugged in: {}", is_cfw_plugged_in);
     /// ```
     pub fn is_cfw_plugged_in(&self) -> Result<bool> {
-        let handle = read_lock!(self.handle, IsCfwPluggedInError)?;
-        match unsafe { IsQHYCCDCFWPlugged(handle) } {
+        let handle = self.handle.acquire().wrap_err(IsCfwPluggedInError)?;
+        match unsafe { IsQHYCCDCFWPlugged(*handle) } {
             QHYCCD_SUCCESS => Ok(true),
             QHYCCD_ERROR => Ok(false),
             _ => {
@@ -1677,14 +2752,10 @@ impl Camera {
     /// camera.open().expect("open failed");
     /// ```
     pub fn open(&self) -> Result<()> {
-        if self.is_open()? {
+        let _lock = self.handle.lock_open_close();
+        if self.handle.is_open() {
             return Ok(());
         }
-        // read and see if the handle is already Some(_)
-        let mut lock = self.handle.write().map_err(|err| {
-            tracing::error!(error=?err);
-            eyre!("Could not acquire write lock on camera handle")
-        })?;
         unsafe {
             match std::ffi::CString::new(self.id.clone()) {
                 Ok(c_id) => {
@@ -1694,7 +2765,12 @@ impl Camera {
                         tracing::error!(error = ?error);
                         return Err(eyre!(error));
                     }
-                    *lock = Some(QHYCCDHandle { ptr: handle });
+                    self.handle.set_capabilities(None);
+                    self.handle.applied().clear();
+                    *self.handle.modes() = CaptureModes::default();
+                    *self.handle.cfw() = CfwState::default();
+                    self.handle.forget_mem_length();
+                    self.handle.ptr.store(handle as *mut _, Ordering::SeqCst);
                     Ok(())
                 }
                 Err(error) => {
@@ -1716,28 +2792,60 @@ impl Camera {
     /// camera.close().expect("close failed");
     /// ```
     pub fn close(&self) -> Result<()> {
-        if !self.is_open()? {
+        let _lock = self.handle.lock_open_close();
+        // new calls fail with CameraNotOpenError from here on, the ones already running finish first
+        let handle = self.handle.ptr.swap(std::ptr::null_mut(), Ordering::SeqCst);
+        if handle.is_null() {
             return Ok(());
         }
-        let mut lock = self.handle.write().map_err(|err| {
-            tracing::error!(error=?err);
-            eyre!("Could not acquire write lock on camera handle")
-        })?;
+        self.handle.wait_idle();
+        match unsafe { CloseQHYCCD(handle) } {
+            QHYCCD_SUCCESS => {
+                self.handle.set_capabilities(None);
+                self.handle.applied().clear();
+                *self.handle.modes() = CaptureModes::default();
+                *self.handle.cfw() = CfwState::default();
+                self.handle.forget_mem_length();
+                Ok(())
+            }
+            error_code => {
+                self.handle.ptr.store(handle, Ordering::SeqCst);
+                let error = CloseCameraError { error_code };
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
 
-        match *lock {
-            Some(handle) => match unsafe { CloseQHYCCD(handle.ptr) } {
-                QHYCCD_SUCCESS => {
-                    lock.take();
-                    Ok(())
-                }
-                error_code => {
-                    let error = CloseCameraError { error_code };
-                    tracing::error!(error = ?error);
-                    Err(eyre!(error))
-                }
-            },
-            None => Ok(()),
+    /// drops the handle of a camera that was unplugged or reset. Unlike `close` the camera is closed even if the
+    /// SDK fails to close the handle, it is of no use anymore. The cached capabilities are kept.
+    fn discard(&self) {
+        let _lock = self.handle.lock_open_close();
+        let handle = self.handle.ptr.swap(std::ptr::null_mut(), Ordering::SeqCst);
+        if handle.is_null() {
+            return;
+        }
+        self.handle.wait_idle();
+        match unsafe { CloseQHYCCD(handle) } {
+            QHYCCD_SUCCESS => (),
+            error_code => {
+                tracing::debug!(camera = %self.id, error_code, "closing a lost camera failed")
+            }
         }
+        self.handle.applied().clear();
+        *self.handle.modes() = CaptureModes::default();
+        *self.handle.cfw() = CfwState::default();
+        self.handle.forget_mem_length();
+    }
+
+    /// discards the handle and opens the camera again, the cached capabilities survive since it is the same
+    /// model
+    fn reopen(&self) -> Result<()> {
+        let capabilities = self.handle.capabilities();
+        self.discard();
+        self.open()?;
+        self.handle.set_capabilities(capabilities);
+        Ok(())
     }
 
     /// Returns `true` if the camera is open
@@ -1751,11 +2859,7 @@ impl Camera {
     /// println!("Is camera open: {:?}", is_open);
     /// ```
     pub fn is_open(&self) -> Result<bool> {
-        let lock = self.handle.read().map_err(|err| {
-            tracing::error!(error=?err);
-            eyre!("Could not acquire read lock on camera handle")
-        })?;
-        Ok((*lock).is_some())
+        Ok(self.handle.is_open())
     }
 }
 
@@ -1915,25 +3019,113 @@ impl FilterWheel {
     pub fn set_fw_position(&self, position: u32) -> Result<()> {
         match self.camera.is_control_available(Control::CfwPort) {
             //the parameter uses ASCII values to represent the position
-            Some(_) => self
-                .camera
-                .set_parameter(Control::CfwPort, (position + 48_u32) as f64) //adding ASCII offset
-                .map_err(|_| {
-                    let error = SetCfwPositionError;
-                    tracing::error!(error = ?error);
-                    eyre!(error)
-                }),
+            Some(_) => {
+                self.camera
+                    .set_parameter(Control::CfwPort, (position + 48_u32) as f64) //adding ASCII offset
+                    .map_err(|_| {
+                        let error = SetCfwPositionError;
+                        tracing::error!(error = ?error);
+                        eyre!(error)
+                    })?;
+                *self.camera.handle.cfw() = CfwState {
+                    position: None,
+                    target: Some(position),
+                };
+                Ok(())
+            }
             None => {
                 tracing::debug!("No filter wheel plugged in.");
                 Err(eyre!(SetCfwPositionError))
             }
         }
     }
+
+    /// Returns the position the filter wheel reports with `GetQHYCCDCFWStatus`, `None` while it is moving.
+    /// This is a single call to the camera, `get_fw_position` checks the control first.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,FilterWheel};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let fw = sdk.filter_wheels().last().expect("no filter wheel found");
+    /// fw.open().expect("open failed");
+    /// match fw.get_fw_status().expect("get_fw_status failed") {
+    ///     Some(position) => println!("at position {}", position),
+    ///     None => println!("moving"),
+    /// }
+    /// ```
+    pub fn get_fw_status(&self) -> Result<Option<u32>> {
+        let handle = self
+            .camera
+            .handle
+            .acquire()
+            .wrap_err(GetCfwStatusError { error_code: 0 })?;
+        let mut status: [c_char; 64] = [0; 64];
+        match unsafe { GetQHYCCDCFWStatus(*handle, status.as_mut_ptr()) } {
+            //the status is the ASCII digit of the position, anything else while the wheel moves
+            QHYCCD_SUCCESS => Ok(match status[0] as u8 {
+                digit @ b'0'..=b'9' => Some((digit - b'0') as u32),
+                _ => None,
+            }),
+            error_code => {
+                let error = GetCfwStatusError { error_code };
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
 }
 
+#[cfg(test)]
+mod test_analysis;
+#[cfg(all(test, feature = "async"))]
+mod test_async;
+#[cfg(test)]
+mod test_binning;
+#[cfg(test)]
+mod test_calibration;
 #[cfg(test)]
 mod test_camera;
 #[cfg(test)]
+mod test_capabilities;
+#[cfg(test)]
+mod test_compress;
+#[cfg(test)]
+mod test_cooler;
+#[cfg(test)]
+mod test_debayer;
+#[cfg(test)]
 mod test_filter_wheel;
 #[cfg(test)]
+mod test_fits;
+#[cfg(test)]
+mod test_group;
+#[cfg(test)]
+mod test_image_data;
+#[cfg(test)]
+mod test_live_stack;
+#[cfg(test)]
+mod test_live_stream;
+#[cfg(test)]
+mod test_metrics;
+#[cfg(test)]
+mod test_parameters;
+#[cfg(test)]
+mod test_pool;
+#[cfg(test)]
+mod test_reconfigure;
+#[cfg(all(test, unix))]
+mod test_recorder;
+#[cfg(test)]
+mod test_registry;
+#[cfg(test)]
 mod test_sdk;
+#[cfg(test)]
+mod test_sequencer;
+#[cfg(all(test, feature = "simulation"))]
+mod test_simulation;
+#[cfg(test)]
+mod test_telemetry;
+#[cfg(test)]
+mod test_view;
+#[cfg(test)]
+mod test_worker;
@@ -0,0 +1,257 @@
+use std::fmt::Debug;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use eyre::{eyre, Result};
+
+use crate::{FrameInfo, LiveStream, MasterFrame, StackMethod, Stacker};
+
+/// how long the stacking thread waits for a frame before checking whether it should stop
+const FRAME_TIMEOUT: Duration = Duration::from_millis(50);
+
+#[derive(Debug, Clone)]
+/// Options for `LiveStream::stack`
+pub struct LiveStackOptions {
+    /// reject samples further than this many standard deviations off the running mean of their pixel, e.g.
+    /// 3.0 to drop satellites, planes and meteors from the stack. `None` keeps every sample.
+    pub kappa: Option<f64>,
+    /// how often a new snapshot of the stack is published, `Duration::ZERO` publishes one for every frame
+    pub snapshot_interval: Duration,
+}
+
+impl Default for LiveStackOptions {
+    fn default() -> Self {
+        Self {
+            kappa: None,
+            snapshot_interval: Duration::from_secs(1),
+        }
+    }
+}
+
+#[derive(Debug)]
+struct Shared {
+    running: AtomicBool,
+    reset: AtomicBool,
+    frames: AtomicU64,
+    snapshot: Mutex<Option<Arc<MasterFrame>>>,
+    /// the error that stopped the stacking thread, if any
+    error: Mutex<Option<String>>,
+}
+
+impl Shared {
+    fn snapshot(&self) -> MutexGuard<'_, Option<Arc<MasterFrame>>> {
+        self.snapshot
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+}
+
+/// Stacks the frames of a `LiveStream` on a background thread while they arrive, for electronically assisted
+/// astronomy or meteor watching with many short exposures. Every frame is added to a `Stacker`, which sums
+/// the samples in a wider accumulator or keeps a running sigma clipped mean per pixel, and its buffer goes
+/// back to the pool right away. A `MasterFrame` snapshot of the stack is published every
+/// `LiveStackOptions::snapshot_interval` and can be taken with `latest` at any time.
+///
+/// The capture thread of the stream keeps running on its own, so with `OverflowPolicy::DropOldest` a slow
+/// stack drops frames instead of stalling the camera. The stack starts over when the frame size changes,
+/// e.g. after changing the binning, and on `reset`, e.g. after moving the mount.
+///
+/// Stopping or dropping the stacker joins the thread and stops the stream.
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use qhyccd_rs::{Sdk,StreamMode,Control,LiveStreamOptions,LiveStackOptions,OverflowPolicy};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+/// camera.init().expect("init failed");
+/// camera.set_parameter(Control::Exposure, 2_000_000.0).expect("set_param failed");
+/// let stream = camera
+///     .begin_live_stream(LiveStreamOptions { policy: OverflowPolicy::DropOldest, ..Default::default() })
+///     .expect("begin_live_stream failed");
+/// let stacker = stream
+///     .stack(LiveStackOptions { kappa: Some(3.0), ..Default::default() })
+///     .expect("stack failed");
+/// std::thread::sleep(Duration::from_secs(60));
+/// if let Some(stack) = stacker.latest() {
+///     println!("{} frames stacked", stack.frames);
+///     /* show stack.to_image() */
+/// }
+/// stacker.stop().expect("stop failed");
+/// ```
+pub struct LiveStacker {
+    /// only taken by `stop`
+    stream: Option<Arc<LiveStream>>,
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl LiveStacker {
+    pub(crate) fn start(stream: LiveStream, options: LiveStackOptions) -> Result<Self> {
+        let stream = Arc::new(stream);
+        let shared = Arc::new(Shared {
+            running: AtomicBool::new(true),
+            reset: AtomicBool::new(false),
+            frames: AtomicU64::new(0),
+            snapshot: Mutex::new(None),
+            error: Mutex::new(None),
+        });
+        let thread = {
+            let stream = stream.clone();
+            let shared = shared.clone();
+            thread::Builder::new()
+                .name(format!("qhyccd-stack-{}", stream.camera().id()))
+                .spawn(move || stack(stream, shared, options))
+        };
+        match thread {
+            Ok(thread) => Ok(Self {
+                stream: Some(stream),
+                shared,
+                thread: Some(thread),
+            }),
+            Err(error) => {
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// Returns the latest snapshot of the stack, `None` until the first one is published
+    pub fn latest(&self) -> Option<Arc<MasterFrame>> {
+        self.shared.snapshot().clone()
+    }
+
+    /// Returns the number of frames in the stack so far
+    pub fn frames(&self) -> u64 {
+        self.shared.frames.load(Ordering::Relaxed)
+    }
+
+    /// Starts the stack over with the next frame, the latest snapshot is kept until a new one is published
+    pub fn reset(&self) {
+        self.shared.reset.store(true, Ordering::Release);
+    }
+
+    /// Returns `false` once the stacking thread stopped, e.g. because the stream failed
+    pub fn is_running(&self) -> bool {
+        self.thread
+            .as_ref()
+            .is_some_and(|thread| !thread.is_finished())
+    }
+
+    /// Returns the error that stopped the stacking thread, if any
+    pub fn error(&self) -> Option<String> {
+        self.shared
+            .error
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .clone()
+    }
+
+    /// Returns the stream the frames are taken from, e.g. for `LiveStream::dropped_frames`
+    pub fn stream(&self) -> &LiveStream {
+        self.stream.as_ref().expect("stream is only taken by stop")
+    }
+
+    /// Stops stacking and the stream, the latest snapshot is returned by `latest` until then
+    pub fn stop(mut self) -> Result<()> {
+        self.join();
+        // the stacking thread let go of its reference when it exited
+        match self.stream.take().map(Arc::try_unwrap) {
+            Some(Ok(stream)) => stream.stop(),
+            _ => Ok(()),
+        }
+    }
+
+    fn join(&mut self) {
+        let Some(thread) = self.thread.take() else {
+            return;
+        };
+        self.shared.running.store(false, Ordering::Release);
+        if thread.join().is_err() {
+            tracing::error!("live stack thread panicked");
+        }
+    }
+}
+
+impl Debug for LiveStacker {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("LiveStacker")
+            .field("stream", &self.stream())
+            .field("frames", &self.frames())
+            .finish()
+    }
+}
+
+impl Drop for LiveStacker {
+    fn drop(&mut self) {
+        // the stream is stopped when the last reference to it goes
+        self.join()
+    }
+}
+
+fn stack(stream: Arc<LiveStream>, shared: Arc<Shared>, options: LiveStackOptions) {
+    let method = match options.kappa {
+        Some(kappa) => StackMethod::SigmaClip { kappa },
+        None => StackMethod::Mean,
+    };
+    let mut stacker = Stacker::new(method);
+    let mut info: Option<FrameInfo> = None;
+    let mut published = Instant::now();
+    while shared.running.load(Ordering::Acquire) {
+        let frame = match stream.next_frame_timeout(FRAME_TIMEOUT) {
+            Ok(Some(frame)) => frame,
+            Ok(None) => continue,
+            Err(report) => {
+                *shared
+                    .error
+                    .lock()
+                    .unwrap_or_else(|poisoned| poisoned.into_inner()) =
+                    Some(format!("{:#}", report));
+                break;
+            }
+        };
+        let frame_info = frame.info();
+        if shared.reset.swap(false, Ordering::AcqRel) || info.is_some_and(|info| info != frame_info)
+        {
+            tracing::debug!(frames = stacker.frames(), "live stack starts over");
+            stacker = Stacker::new(method);
+        }
+        info = Some(frame_info);
+        if let Err(error) = stacker.add(&frame) {
+            *shared
+                .error
+                .lock()
+                .unwrap_or_else(|poisoned| poisoned.into_inner()) = Some(format!("{:#}", error));
+            break;
+        }
+        drop(frame);
+        shared
+            .frames
+            .store(stacker.frames() as u64, Ordering::Relaxed);
+        if published.elapsed() >= options.snapshot_interval {
+            publish(&stacker, &shared);
+            published = Instant::now();
+        }
+    }
+    // whatever was stacked since the last snapshot
+    publish(&stacker, &shared);
+}
+
+fn publish(stacker: &Stacker, shared: &Shared) {
+    if stacker.frames() == 0 {
+        return;
+    }
+    if let Ok(master) = stacker.finish() {
+        *shared.snapshot() = Some(Arc::new(master));
+    }
+}
+
+impl LiveStream {
+    /// Starts a `LiveStacker` stacking the frames of this stream
+    pub fn stack(self, options: LiveStackOptions) -> Result<LiveStacker> {
+        LiveStacker::start(self, options)
+    }
+}
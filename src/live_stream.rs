@@ -0,0 +1,455 @@
+use std::collections::VecDeque;
+use std::fmt::Debug;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+#[cfg(feature = "async")]
+use std::task::{Context, Poll, Waker};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant, SystemTime};
+
+use eyre::{eyre, Result};
+
+use crate::worker::Executor;
+use crate::QHYError::{BufferTooSmallError, LiveStreamStoppedError};
+use crate::{
+    Camera, CameraWorker, Control, FrameMetadata, FramePool, PooledImageData, Priority, QHYError,
+};
+
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+/// What the capture thread of a `LiveStream` does when the consumer falls behind and the ring is full
+pub enum OverflowPolicy {
+    /// the oldest frame in the ring is dropped to make room, the capture thread never waits
+    DropOldest,
+    /// the capture thread waits until the consumer took a frame, the camera may drop frames instead
+    BlockProducer,
+}
+
+#[derive(Debug, Clone)]
+/// Options for `Camera::begin_live_stream`
+pub struct LiveStreamOptions {
+    /// number of frames the ring holds before the overflow policy kicks in
+    pub depth: usize,
+    /// what to do when the ring is full
+    pub policy: OverflowPolicy,
+    /// how long the capture thread waits before asking the camera again when no frame was ready
+    pub poll_interval: Duration,
+}
+
+impl Default for LiveStreamOptions {
+    fn default() -> Self {
+        Self {
+            depth: 4,
+            policy: OverflowPolicy::DropOldest,
+            poll_interval: Duration::from_millis(1),
+        }
+    }
+}
+
+#[derive(Debug)]
+struct Ring {
+    frames: VecDeque<PooledImageData>,
+    /// set once the capture thread has exited, no more frames will be pushed
+    closed: bool,
+    /// the error that stopped the capture thread, if any
+    error: Option<String>,
+    /// the task waiting in `Stream::poll_next`, woken on the next push or close
+    #[cfg(feature = "async")]
+    waker: Option<Waker>,
+}
+
+impl Ring {
+    #[cfg(feature = "async")]
+    fn wake(&mut self) {
+        if let Some(waker) = self.waker.take() {
+            waker.wake();
+        }
+    }
+
+    #[cfg(not(feature = "async"))]
+    fn wake(&mut self) {}
+}
+
+#[derive(Debug)]
+struct Shared {
+    depth: usize,
+    policy: OverflowPolicy,
+    running: AtomicBool,
+    delivered: AtomicU64,
+    dropped: AtomicU64,
+    ring: Mutex<Ring>,
+    not_empty: Condvar,
+    not_full: Condvar,
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, Ring> {
+        self.ring
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn push(&self, mut frame: PooledImageData) {
+        let mut ring = self.lock();
+        while ring.frames.len() >= self.depth {
+            match self.policy {
+                OverflowPolicy::DropOldest => {
+                    ring.frames.pop_front();
+                    self.dropped.fetch_add(1, Ordering::Relaxed);
+                }
+                OverflowPolicy::BlockProducer => {
+                    if !self.running.load(Ordering::Acquire) {
+                        return;
+                    }
+                    ring = self
+                        .not_full
+                        .wait_timeout(ring, Duration::from_millis(50))
+                        .unwrap_or_else(|poisoned| poisoned.into_inner())
+                        .0;
+                }
+            }
+        }
+        if let Some(metadata) = frame.metadata.as_mut() {
+            metadata.dropped = self.dropped.load(Ordering::Relaxed);
+        }
+        ring.frames.push_back(frame);
+        self.delivered.fetch_add(1, Ordering::Relaxed);
+        ring.wake();
+        drop(ring);
+        self.not_empty.notify_one();
+    }
+
+    fn close(&self, error: Option<String>) {
+        let mut ring = self.lock();
+        ring.closed = true;
+        ring.error = error;
+        ring.wake();
+        drop(ring);
+        self.not_empty.notify_all();
+    }
+
+    fn pop(&self, mut ring: MutexGuard<'_, Ring>) -> Option<PooledImageData> {
+        let frame = ring.frames.pop_front();
+        drop(ring);
+        if frame.is_some() {
+            self.not_full.notify_one();
+        }
+        frame
+    }
+
+    fn stopped_error(&self, ring: &Ring) -> eyre::Report {
+        match &ring.error {
+            Some(error) => eyre!(error.clone()).wrap_err(LiveStreamStoppedError),
+            None => eyre!(LiveStreamStoppedError),
+        }
+    }
+}
+
+/// A camera in Live Video Mode with a dedicated capture thread. The thread pulls frames from the SDK as fast as
+/// the camera delivers them into buffers from a `FramePool` and queues them in a bounded ring, so the SDK's
+/// internal buffer does not overflow while the consumer is busy. What happens when the ring is full is
+/// decided by the `OverflowPolicy`.
+///
+/// Frames are handed out as `PooledImageData`, their buffers go back to the pool when dropped. Stopping or
+/// dropping the stream joins the capture thread and ends live mode.
+///
+/// Started with `CameraWorker::begin_live_stream` every poll of the capture thread is queued on the worker
+/// with `Priority::Readout`, so it only waits for the command that is running. Otherwise the thread calls the
+/// camera directly.
+/// # Example
+/// ```no_run
+/// use qhyccd_rs::{Sdk,Camera,StreamMode,Control,LiveStreamOptions,OverflowPolicy};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+/// camera.init().expect("init failed");
+/// camera.set_parameter(Control::Exposure, 10000.0).expect("set_param failed");
+/// let options = LiveStreamOptions {
+///     depth: 8,
+///     policy: OverflowPolicy::DropOldest,
+///     ..Default::default()
+/// };
+/// let stream = camera.begin_live_stream(options).expect("begin_live_stream failed");
+/// for _ in 0..100 {
+///     let image = stream.next_frame().expect("next_frame failed");
+///     /* Do something with the image */
+/// }
+/// println!("dropped {} frames", stream.dropped_frames());
+/// stream.stop().expect("stop failed");
+/// ```
+pub struct LiveStream {
+    executor: Executor,
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl LiveStream {
+    /// Calls `begin_live` on the camera and starts the capture thread, use `Camera::begin_live_stream`
+    pub(crate) fn start(executor: Executor, options: LiveStreamOptions) -> Result<Self> {
+        let depth = options.depth.max(1);
+        // one buffer in the capture thread and one held by the consumer on top of the ring
+        let pool = executor.run(Priority::Control, move |camera| {
+            camera.begin_live()?;
+            match FramePool::for_camera(camera, depth + 2) {
+                Ok(pool) => Ok(pool),
+                Err(error) => {
+                    let _ = camera.end_live();
+                    Err(error)
+                }
+            }
+        })?;
+        let shared = Arc::new(Shared {
+            depth,
+            policy: options.policy,
+            running: AtomicBool::new(true),
+            delivered: AtomicU64::new(0),
+            dropped: AtomicU64::new(0),
+            ring: Mutex::new(Ring {
+                frames: VecDeque::with_capacity(depth),
+                closed: false,
+                error: None,
+                #[cfg(feature = "async")]
+                waker: None,
+            }),
+            not_empty: Condvar::new(),
+            not_full: Condvar::new(),
+        });
+        let thread = {
+            let executor = executor.clone();
+            let shared = shared.clone();
+            let poll_interval = options.poll_interval;
+            thread::Builder::new()
+                .name(format!("qhyccd-live-{}", executor.camera().id()))
+                .spawn(move || capture(executor, pool, shared, poll_interval))
+        };
+        match thread {
+            Ok(thread) => Ok(Self {
+                executor,
+                shared,
+                thread: Some(thread),
+            }),
+            Err(error) => {
+                tracing::error!(error = ?error);
+                let _ = executor.run(Priority::Control, Camera::end_live);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// Waits for the next frame. Returns an error once the stream is stopped and all queued frames have been
+    /// taken, or if the capture thread stopped because of an error.
+    pub fn next_frame(&self) -> Result<PooledImageData> {
+        let mut ring = self.shared.lock();
+        loop {
+            if !ring.frames.is_empty() {
+                return Ok(self.shared.pop(ring).expect("ring is not empty"));
+            }
+            if ring.closed {
+                return Err(self.shared.stopped_error(&ring));
+            }
+            ring = self
+                .shared
+                .not_empty
+                .wait(ring)
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+        }
+    }
+
+    /// Waits at most `timeout` for the next frame, returns `Ok(None)` if none arrived in time
+    pub fn next_frame_timeout(&self, timeout: Duration) -> Result<Option<PooledImageData>> {
+        let deadline = Instant::now() + timeout;
+        let mut ring = self.shared.lock();
+        loop {
+            if !ring.frames.is_empty() {
+                return Ok(self.shared.pop(ring));
+            }
+            if ring.closed {
+                return Err(self.shared.stopped_error(&ring));
+            }
+            let now = Instant::now();
+            if now >= deadline {
+                return Ok(None);
+            }
+            ring = self
+                .shared
+                .not_empty
+                .wait_timeout(ring, deadline - now)
+                .unwrap_or_else(|poisoned| poisoned.into_inner())
+                .0;
+        }
+    }
+
+    /// Returns the next frame if one is queued, never waits
+    pub fn try_next_frame(&self) -> Option<PooledImageData> {
+        let ring = self.shared.lock();
+        self.shared.pop(ring)
+    }
+
+    /// Returns the number of frames the capture thread queued so far
+    pub fn delivered_frames(&self) -> u64 {
+        self.shared.delivered.load(Ordering::Relaxed)
+    }
+
+    /// Returns the number of frames dropped because the ring was full with `OverflowPolicy::DropOldest`
+    pub fn dropped_frames(&self) -> u64 {
+        self.shared.dropped.load(Ordering::Relaxed)
+    }
+
+    /// Returns `true` while the capture thread is running
+    pub fn is_running(&self) -> bool {
+        !self.shared.lock().closed
+    }
+
+    /// Returns the camera this stream captures from
+    pub fn camera(&self) -> &Camera {
+        self.executor.camera()
+    }
+
+    /// Stops the capture thread and ends live mode on the camera. Frames already queued are discarded.
+    pub fn stop(mut self) -> Result<()> {
+        self.shutdown()
+    }
+
+    fn shutdown(&mut self) -> Result<()> {
+        let thread = match self.thread.take() {
+            Some(thread) => thread,
+            None => return Ok(()),
+        };
+        self.shared.running.store(false, Ordering::Release);
+        self.shared.not_full.notify_all();
+        if thread.join().is_err() {
+            tracing::error!("live stream capture thread panicked");
+        }
+        self.shared.lock().frames.clear();
+        self.executor.run(Priority::Control, Camera::end_live)
+    }
+}
+
+/// With the `async` feature the stream can be consumed from async code, each item is the next frame. The stream
+/// yields the error that stopped the capture thread once and ends after that. Dropping it still joins the capture
+/// thread, which may block the executor for up to one SDK call.
+/// # Example
+/// ```no_run
+/// # async fn run(camera: qhyccd_rs::Camera) -> eyre::Result<()> {
+/// use futures_core::Stream;
+/// use qhyccd_rs::LiveStreamOptions;
+/// let mut stream = camera.begin_live_stream(LiveStreamOptions::default())?;
+/// while let Some(image) = std::future::poll_fn(|cx| std::pin::Pin::new(&mut stream).poll_next(cx)).await {
+///     let image = image?;
+///     /* Do something with the image */
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[cfg(feature = "async")]
+impl futures_core::Stream for LiveStream {
+    type Item = Result<PooledImageData>;
+
+    fn poll_next(self: std::pin::Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        let mut ring = self.shared.lock();
+        if !ring.frames.is_empty() {
+            return Poll::Ready(self.shared.pop(ring).map(Ok));
+        }
+        if ring.closed {
+            if ring.error.is_none() {
+                return Poll::Ready(None);
+            }
+            let error = self.shared.stopped_error(&ring);
+            ring.error = None;
+            return Poll::Ready(Some(Err(error)));
+        }
+        // registered under the ring lock, so a push right after this cannot be missed
+        ring.waker = Some(cx.waker().clone());
+        Poll::Pending
+    }
+}
+
+impl Debug for LiveStream {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("LiveStream")
+            .field("camera", self.camera())
+            .field("depth", &self.shared.depth)
+            .field("policy", &self.shared.policy)
+            .field("delivered", &self.delivered_frames())
+            .field("dropped", &self.dropped_frames())
+            .finish()
+    }
+}
+
+impl Drop for LiveStream {
+    fn drop(&mut self) {
+        if let Err(error) = self.shutdown() {
+            tracing::error!(error = ?error);
+        }
+    }
+}
+
+fn capture(executor: Executor, pool: FramePool, shared: Arc<Shared>, poll_interval: Duration) {
+    let mut error = None;
+    let mut sequence = 0;
+    // kept while the camera has no frame ready, so the not ready polls do not touch the pool
+    let mut idle = None;
+    while shared.running.load(Ordering::Acquire) {
+        let camera = executor.camera();
+        let mut buffer = idle.take().unwrap_or_else(|| {
+            camera.handle.metrics.pool(&pool);
+            pool.acquire()
+        });
+        let (asked, asked_at) = (Instant::now(), SystemTime::now());
+        let polled = executor.run(Priority::Readout, move |camera| {
+            let polled = camera.poll_live_frame_into(&mut buffer);
+            Ok((buffer, polled))
+        });
+        // only fails once the worker stopped, the buffer went back to the pool with the command
+        let (buffer, polled) = match polled {
+            Ok(polled) => polled,
+            Err(report) => {
+                error = Some(format!("{:#}", report));
+                break;
+            }
+        };
+        match polled {
+            Ok(Some(info)) => {
+                let captured = Instant::now();
+                let mut image = buffer.into_image(info);
+                image.metadata = Some(FrameMetadata {
+                    sequence,
+                    dropped: 0,
+                    captured,
+                    timestamp: asked_at + (captured - asked),
+                    exposure_end: asked_at,
+                    exposure: camera
+                        .handle
+                        .applied()
+                        .get(&Control::Exposure)
+                        .map(|&us| Duration::from_secs_f64(us.max(0.0) / 1e6)),
+                });
+                sequence += 1;
+                shared.push(image)
+            }
+            Ok(None) => {
+                idle = Some(buffer);
+                thread::sleep(poll_interval)
+            }
+            Err(report) => {
+                // the frame size changed, e.g. by `Camera::reconfigure`
+                if let Some(&BufferTooSmallError { needed, .. }) = report.downcast_ref::<QHYError>()
+                {
+                    pool.resize(needed);
+                    continue;
+                }
+                error = Some(format!("{:#}", report));
+                break;
+            }
+        }
+    }
+    shared.close(error);
+}
+
+impl CameraWorker {
+    /// Like `Camera::begin_live_stream`, but `begin_live` and every poll of the capture thread are queued on this
+    /// worker, the polls with `Priority::Readout`
+    pub fn begin_live_stream(&self, options: LiveStreamOptions) -> Result<LiveStream> {
+        LiveStream::start(self.executor(), options)
+    }
+}
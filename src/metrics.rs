@@ -0,0 +1,321 @@
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use crate::{Camera, FramePool};
+
+/// the number of buckets of a `LatencyHistogram`, bucket `i` counts latencies below 2^i microseconds and the
+/// last one everything from 2^22 microseconds (4.2 seconds) on
+pub const LATENCY_BUCKETS: usize = 24;
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// The distribution of the latency of an SDK call in buckets growing by powers of two
+pub struct LatencyHistogram {
+    /// the number of calls
+    pub count: u64,
+    /// the sum of all latencies
+    pub total: Duration,
+    /// the longest latency
+    pub max: Duration,
+    /// the number of calls per bucket, see `LATENCY_BUCKETS`
+    pub buckets: [u64; LATENCY_BUCKETS],
+}
+
+impl LatencyHistogram {
+    /// Returns the average latency
+    pub fn mean(&self) -> Duration {
+        match self.count {
+            0 => Duration::ZERO,
+            // the count does not fit the u32 `Duration` divides by in a long running process
+            count => Duration::from_nanos((self.total.as_nanos() / count as u128) as u64),
+        }
+    }
+
+    /// Returns the upper bound of the bucket holding the `quantile` (0.0 to 1.0) of the calls, e.g. 0.99 for the
+    /// latency 99% of the calls stayed below. The result is exact up to a factor of two and never more than `max`.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::LatencyHistogram;
+    /// use std::time::Duration;
+    /// let mut buckets = [0; qhyccd_rs::LATENCY_BUCKETS];
+    /// buckets[10] = 99; // below 1024us
+    /// buckets[15] = 1; // below 32768us
+    /// let histogram = LatencyHistogram {
+    ///     count: 100,
+    ///     total: Duration::from_millis(120),
+    ///     max: Duration::from_millis(20),
+    ///     buckets,
+    /// };
+    /// assert_eq!(histogram.quantile(0.5), Duration::from_micros(1024));
+    /// assert_eq!(histogram.quantile(1.0), Duration::from_millis(20));
+    /// ```
+    pub fn quantile(&self, quantile: f64) -> Duration {
+        let rank = (quantile.clamp(0.0, 1.0) * self.count as f64)
+            .ceil()
+            .max(1.0) as u64;
+        let mut seen = 0;
+        for (bucket, &count) in self.buckets.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Duration::from_micros(1 << bucket).min(self.max);
+            }
+        }
+        self.max
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// Counters for one kind of frame transfer, see `CameraMetrics`
+pub struct FrameStats {
+    /// frames the SDK delivered
+    pub frames: u64,
+    /// polls in Live Video Mode where the SDK had no new frame yet, these are not errors
+    pub not_ready: u64,
+    /// calls that failed, e.g. `GetLiveFrameError` with an error code other than "no frame"
+    pub errors: u64,
+    /// the image bytes of the delivered frames
+    pub bytes: u64,
+    /// the time the SDK took to deliver each frame
+    pub latency: LatencyHistogram,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+/// How many buffers of a `FramePool` were free
+pub struct PoolOccupancy {
+    /// the number of buffers the pool keeps
+    pub capacity: usize,
+    /// the number of buffers that were not in use, 0 means the pool had to allocate
+    pub available: usize,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+/// A snapshot of the transfer metrics of a camera, see `Camera::metrics`
+pub struct CameraMetrics {
+    /// `GetQHYCCDLiveFrame` in Live Video Mode
+    pub live: FrameStats,
+    /// `GetQHYCCDSingleFrame` in Single Frame Mode
+    pub single: FrameStats,
+    /// when the last single frame exposure or live mode was started
+    pub exposure_started: Option<SystemTime>,
+    /// when the readout of the last single frame returned or live mode was stopped
+    pub exposure_ended: Option<SystemTime>,
+    /// when the last frame finished transferring
+    pub last_frame: Option<SystemTime>,
+    /// the time since the counters started, when the first frame was requested or `reset_metrics` was called
+    pub elapsed: Duration,
+    /// the pool the last pooled frame was read into, right before the frame was taken from it
+    pub pool: Option<PoolOccupancy>,
+}
+
+impl CameraMetrics {
+    /// Returns the average throughput of live and single frames since the counters started
+    pub fn bytes_per_second(&self) -> f64 {
+        match self.elapsed.as_secs_f64() {
+            seconds if seconds > 0.0 => (self.live.bytes + self.single.bytes) as f64 / seconds,
+            _ => 0.0,
+        }
+    }
+}
+
+/// microseconds since the unix epoch, 0 stands for none
+fn now_us() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map_or(1, |now| now.as_micros() as u64)
+}
+
+fn to_time(us: u64) -> Option<SystemTime> {
+    (us != 0).then(|| UNIX_EPOCH + Duration::from_micros(us))
+}
+
+#[derive(Debug, Default)]
+struct Histogram {
+    buckets: [AtomicU64; LATENCY_BUCKETS],
+    count: AtomicU64,
+    total_us: AtomicU64,
+    max_us: AtomicU64,
+}
+
+impl Histogram {
+    fn record(&self, latency: Duration) {
+        let us = latency.as_micros() as u64;
+        let bucket = ((u64::BITS - us.leading_zeros()) as usize).min(LATENCY_BUCKETS - 1);
+        self.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.total_us.fetch_add(us, Ordering::Relaxed);
+        self.max_us.fetch_max(us, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> LatencyHistogram {
+        LatencyHistogram {
+            count: self.count.load(Ordering::Relaxed),
+            total: Duration::from_micros(self.total_us.load(Ordering::Relaxed)),
+            max: Duration::from_micros(self.max_us.load(Ordering::Relaxed)),
+            buckets: std::array::from_fn(|bucket| self.buckets[bucket].load(Ordering::Relaxed)),
+        }
+    }
+
+    fn reset(&self) {
+        for bucket in &self.buckets {
+            bucket.store(0, Ordering::Relaxed);
+        }
+        self.count.store(0, Ordering::Relaxed);
+        self.total_us.store(0, Ordering::Relaxed);
+        self.max_us.store(0, Ordering::Relaxed);
+    }
+}
+
+#[derive(Debug, Default)]
+pub(crate) struct FrameCounters {
+    frames: AtomicU64,
+    not_ready: AtomicU64,
+    errors: AtomicU64,
+    bytes: AtomicU64,
+    latency: Histogram,
+}
+
+impl FrameCounters {
+    fn snapshot(&self) -> FrameStats {
+        FrameStats {
+            frames: self.frames.load(Ordering::Relaxed),
+            not_ready: self.not_ready.load(Ordering::Relaxed),
+            errors: self.errors.load(Ordering::Relaxed),
+            bytes: self.bytes.load(Ordering::Relaxed),
+            latency: self.latency.snapshot(),
+        }
+    }
+
+    fn reset(&self) {
+        self.frames.store(0, Ordering::Relaxed);
+        self.not_ready.store(0, Ordering::Relaxed);
+        self.errors.store(0, Ordering::Relaxed);
+        self.bytes.store(0, Ordering::Relaxed);
+        self.latency.reset();
+    }
+}
+
+/// The counters behind `CameraMetrics`, shared by all clones of a camera. Everything is a relaxed atomic, so
+/// recording costs a few uncontended increments per frame and never blocks the capture thread.
+#[derive(Debug, Default)]
+pub(crate) struct Metrics {
+    pub(crate) live: FrameCounters,
+    pub(crate) single: FrameCounters,
+    exposure_started_us: AtomicU64,
+    exposure_ended_us: AtomicU64,
+    last_frame_us: AtomicU64,
+    since_us: AtomicU64,
+    pool_capacity: AtomicUsize,
+    pool_available: AtomicUsize,
+    pool_recorded: AtomicBool,
+}
+
+impl Metrics {
+    /// starts the clock for `CameraMetrics::elapsed` on the first request
+    fn start(&self) {
+        if self.since_us.load(Ordering::Relaxed) == 0 {
+            let _ =
+                self.since_us
+                    .compare_exchange(0, now_us(), Ordering::Relaxed, Ordering::Relaxed);
+        }
+    }
+
+    pub(crate) fn exposure_started(&self) {
+        self.start();
+        self.exposure_started_us.store(now_us(), Ordering::Relaxed);
+    }
+
+    pub(crate) fn exposure_ended(&self) {
+        self.start();
+        self.exposure_ended_us.store(now_us(), Ordering::Relaxed);
+    }
+
+    pub(crate) fn frame(&self, counters: &FrameCounters, latency: Duration, bytes: usize) {
+        self.start();
+        counters.frames.fetch_add(1, Ordering::Relaxed);
+        counters.bytes.fetch_add(bytes as u64, Ordering::Relaxed);
+        counters.latency.record(latency);
+        self.last_frame_us.store(now_us(), Ordering::Relaxed);
+    }
+
+    pub(crate) fn not_ready(&self, counters: &FrameCounters) {
+        self.start();
+        counters.not_ready.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub(crate) fn error(&self, counters: &FrameCounters) {
+        self.start();
+        counters.errors.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub(crate) fn pool(&self, pool: &FramePool) {
+        self.pool_capacity.store(pool.capacity(), Ordering::Relaxed);
+        self.pool_available
+            .store(pool.available(), Ordering::Relaxed);
+        self.pool_recorded.store(true, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> CameraMetrics {
+        let since_us = self.since_us.load(Ordering::Relaxed);
+        CameraMetrics {
+            live: self.live.snapshot(),
+            single: self.single.snapshot(),
+            exposure_started: to_time(self.exposure_started_us.load(Ordering::Relaxed)),
+            exposure_ended: to_time(self.exposure_ended_us.load(Ordering::Relaxed)),
+            last_frame: to_time(self.last_frame_us.load(Ordering::Relaxed)),
+            elapsed: match since_us {
+                0 => Duration::ZERO,
+                since_us => Duration::from_micros(now_us().saturating_sub(since_us)),
+            },
+            pool: self
+                .pool_recorded
+                .load(Ordering::Relaxed)
+                .then(|| PoolOccupancy {
+                    capacity: self.pool_capacity.load(Ordering::Relaxed),
+                    available: self.pool_available.load(Ordering::Relaxed),
+                }),
+        }
+    }
+
+    fn reset(&self) {
+        self.live.reset();
+        self.single.reset();
+        self.exposure_started_us.store(0, Ordering::Relaxed);
+        self.exposure_ended_us.store(0, Ordering::Relaxed);
+        self.last_frame_us.store(0, Ordering::Relaxed);
+        self.since_us.store(now_us(), Ordering::Relaxed);
+        self.pool_recorded.store(false, Ordering::Relaxed);
+    }
+}
+
+impl Camera {
+    /// Returns a snapshot of the transfer metrics of the camera: frames delivered and failed, the latency of
+    /// the SDK frame calls, bytes per second and the occupancy of the frame pool. The counters are shared by
+    /// all clones of the camera and keep counting across `open` and `close`. Every frame transfer is also
+    /// recorded as a `get_live_frame` or `get_single_frame` tracing span at debug level with the latency and
+    /// size as fields.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,LiveStreamOptions};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// /* set up the camera for live mode */
+    /// let stream = camera.begin_live_stream(LiveStreamOptions::default()).expect("begin_live_stream failed");
+    /// std::thread::sleep(std::time::Duration::from_secs(10));
+    /// let metrics = camera.metrics();
+    /// println!(
+    ///     "{} frames, {} errors, p99 {:?}, {:.1} MB/s",
+    ///     metrics.live.frames,
+    ///     metrics.live.errors,
+    ///     metrics.live.latency.quantile(0.99),
+    ///     metrics.bytes_per_second() / 1e6
+    /// );
+    /// ```
+    pub fn metrics(&self) -> CameraMetrics {
+        self.handle.metrics.snapshot()
+    }
+
+    /// Sets all counters of `metrics` back to zero and restarts the clock
+    pub fn reset_metrics(&self) {
+        self.handle.metrics.reset()
+    }
+}
@@ -0,0 +1,87 @@
+use std::num::NonZeroUsize;
+use std::ops::Range;
+use std::thread;
+
+/// bands smaller than this are not worth a thread
+const MIN_ROWS_PER_BAND: usize = 16;
+
+/// Splits `out` into bands of whole rows of `row_len` elements and calls `f(first_row, band)` for each band on
+/// its own scoped thread, one band per available core. Small images are processed on the calling thread.
+pub(crate) fn for_each_row_band<T, F>(out: &mut [T], row_len: usize, f: F)
+where
+    T: Send,
+    F: Fn(usize, &mut [T]) + Sync,
+{
+    for_each_band(out, row_len, MIN_ROWS_PER_BAND, f)
+}
+
+/// Like `for_each_row_band` for items that are each worth a thread on their own, like compressed tiles
+pub(crate) fn for_each_item_band<T, F>(items: &mut [T], f: F)
+where
+    T: Send,
+    F: Fn(usize, &mut [T]) + Sync,
+{
+    for_each_band(items, 1, 1, f)
+}
+
+fn for_each_band<T, F>(out: &mut [T], row_len: usize, min_rows_per_band: usize, f: F)
+where
+    T: Send,
+    F: Fn(usize, &mut [T]) + Sync,
+{
+    if row_len == 0 || out.is_empty() {
+        return;
+    }
+    let rows = out.len() / row_len;
+    let threads = threads_for(rows, min_rows_per_band);
+    if threads == 1 {
+        f(0, out);
+        return;
+    }
+    let rows_per_band = rows.div_ceil(threads);
+    thread::scope(|scope| {
+        for (index, band) in out.chunks_mut(rows_per_band * row_len).enumerate() {
+            let f = &f;
+            scope.spawn(move || f(index * rows_per_band, band));
+        }
+    });
+}
+
+/// Splits `rows` rows into bands like `for_each_row_band` and returns `f(rows_of_band)` for each band in order,
+/// for reductions like histograms that read the image instead of writing an output
+pub(crate) fn map_row_bands<R, F>(rows: usize, f: F) -> Vec<R>
+where
+    R: Send,
+    F: Fn(Range<usize>) -> R + Sync,
+{
+    let threads = threads_for(rows, MIN_ROWS_PER_BAND);
+    if threads == 1 {
+        return vec![f(0..rows)];
+    }
+    let rows_per_band = rows.div_ceil(threads);
+    thread::scope(|scope| {
+        let bands: Vec<_> = (0..rows)
+            .step_by(rows_per_band)
+            .map(|first| {
+                let f = &f;
+                scope.spawn(move || f(first..(first + rows_per_band).min(rows)))
+            })
+            .collect();
+        bands
+            .into_iter()
+            .map(|band| {
+                band.join()
+                    .unwrap_or_else(|panic| std::panic::resume_unwind(panic))
+            })
+            .collect()
+    })
+}
+
+/// one thread per available core, but no band smaller than `min_rows_per_band`
+fn threads_for(rows: usize, min_rows_per_band: usize) -> usize {
+    thread::available_parallelism()
+        .map(NonZeroUsize::get)
+        .unwrap_or(1)
+        .min(rows / min_rows_per_band)
+        .max(1)
+}
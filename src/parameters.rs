@@ -0,0 +1,143 @@
+use eyre::{eyre, Result};
+
+use crate::QHYError::{CameraNotOpenError, InvalidParameterError, IsControlAvailableError};
+use crate::{Camera, CameraCapabilities, Control};
+
+/// how far a value may be off a multiple of the step, relative to the number of steps, before it is rejected
+const STEP_TOLERANCE: f64 = 1e-6;
+
+/// checks the value against the range of the control, controls without a range take any value
+fn check_range(capabilities: &CameraCapabilities, control: Control, value: f64) -> Result<()> {
+    if capabilities.is_control_available(control).is_none() {
+        let error = IsControlAvailableError { control };
+        tracing::error!(error = ?error);
+        return Err(eyre!(error));
+    }
+    let Some((min, max, step)) = capabilities.min_max_step(control) else {
+        return Ok(());
+    };
+    let steps = if step > 0.0 {
+        (value - min) / step
+    } else {
+        0.0
+    };
+    if value < min
+        || value > max
+        || (steps - steps.round()).abs() > STEP_TOLERANCE * steps.abs().max(1.0)
+    {
+        let error = InvalidParameterError {
+            control,
+            value,
+            min,
+            max,
+            step,
+        };
+        tracing::error!(error = ?error);
+        return Err(eyre!(error));
+    }
+    Ok(())
+}
+
+impl Camera {
+    /// Sets several controls at once. The camera handle is taken once for the whole batch, every value is
+    /// checked against `capabilities`, queried on the first call and cached, and only values that differ from
+    /// what was last set with `set_parameter` or `apply` are sent to the camera. The known values are forgotten on `open`, `close`,
+    /// `init` and `set_readout_mode`, so the first `apply` after those sends everything.
+    ///
+    /// Returns one result per control in the order of `settings`: `Ok(true)` if the value was sent,
+    /// `Ok(false)` if it was unchanged and `Err` if the control is not available, the value is outside of
+    /// min, max and step or the SDK failed. A failing control does not stop the others.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Control};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// camera.init().expect("init failed");
+    /// let settings = [
+    ///     (Control::TransferBit, 16.0),
+    ///     (Control::UsbTraffic, 0.0),
+    ///     (Control::Gain, 30.0),
+    ///     (Control::Offset, 40.0),
+    ///     (Control::Exposure, 300_000_000.0),
+    /// ];
+    /// for ((control, _), result) in settings.iter().zip(camera.apply(&settings)) {
+    ///     if let Err(error) = result {
+    ///         println!("{:?} not set: {}", control, error);
+    ///     }
+    /// }
+    /// // only the exposure is sent to the camera again
+    /// camera.apply(&[(Control::Gain, 30.0), (Control::Exposure, 60_000_000.0)]);
+    /// ```
+    pub fn apply(&self, settings: &[(Control, f64)]) -> Vec<Result<bool>> {
+        // before taking the handle, the query takes the open/close lock and a close waits for the handle
+        let capabilities = self.capabilities().ok();
+        let handle = match self.handle.acquire() {
+            Ok(handle) => handle,
+            Err(_) => {
+                return settings
+                    .iter()
+                    .map(|_| Err(eyre!(CameraNotOpenError)))
+                    .collect()
+            }
+        };
+        let results: Vec<Result<bool>> = settings
+            .iter()
+            .map(|&(control, value)| {
+                if let Some(capabilities) = &capabilities {
+                    check_range(capabilities, control, value)?;
+                }
+                if self.handle.applied().get(&control) == Some(&value) {
+                    return Ok(false);
+                }
+                self.write_parameter(*handle, control, value)?;
+                Ok(true)
+            })
+            .collect();
+        tracing::debug!(
+            camera = %self.id,
+            sent = results.iter().filter(|result| matches!(result, Ok(true))).count(),
+            unchanged = results.iter().filter(|result| matches!(result, Ok(false))).count(),
+            "apply"
+        );
+        results
+    }
+
+    /// Reads several controls at once, the camera handle is taken once for the whole batch. Returns one result
+    /// per control in the order of `controls`. Controls the cached `capabilities` do not list are reported as
+    /// not available without asking the SDK.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,Control};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let values = camera.read_many(&[Control::Gain, Control::Offset, Control::CurTemp]);
+    /// if let [Ok(gain), Ok(offset), Ok(temperature)] = values.as_slice() {
+    ///     println!("gain {} offset {} at {}°C", gain, offset, temperature);
+    /// }
+    /// ```
+    pub fn read_many(&self, controls: &[Control]) -> Vec<Result<f64>> {
+        let capabilities = self.cached_capabilities();
+        let handle = match self.handle.acquire() {
+            Ok(handle) => handle,
+            Err(_) => {
+                return controls
+                    .iter()
+                    .map(|_| Err(eyre!(CameraNotOpenError)))
+                    .collect()
+            }
+        };
+        controls
+            .iter()
+            .map(|&control| {
+                if let Some(capabilities) = &capabilities {
+                    if capabilities.is_control_available(control).is_none() {
+                        return Err(eyre!(IsControlAvailableError { control }));
+                    }
+                }
+                Self::read_parameter(*handle, control)
+            })
+            .collect()
+    }
+}
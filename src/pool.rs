@@ -0,0 +1,265 @@
+use std::fmt::Debug;
+use std::ops::{Deref, DerefMut};
+use std::sync::{Arc, Mutex, MutexGuard};
+
+use eyre::Result;
+
+use crate::{Camera, FrameInfo, ImageData};
+
+#[derive(Debug)]
+struct PoolState {
+    buffer_size: usize,
+    free: Vec<Vec<u8>>,
+}
+
+#[derive(Debug)]
+struct PoolInner {
+    capacity: usize,
+    state: Mutex<PoolState>,
+}
+
+impl PoolInner {
+    fn lock(&self) -> MutexGuard<'_, PoolState> {
+        // the state is only ever a list of free buffers, so it is still consistent after a panic
+        self.state
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn give_back(&self, buffer: Vec<u8>) {
+        let mut state = self.lock();
+        if buffer.len() == state.buffer_size && state.free.len() < self.capacity {
+            state.free.push(buffer);
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+/// A pool of pre-allocated image buffers. Buffers taken from the pool go back to it when they are dropped,
+/// so capturing does not allocate and free a multi-megabyte block for every frame. Clones of the pool share
+/// the same buffers.
+///
+/// The pool never blocks: if all buffers are in use `acquire` allocates a new one, but at most `capacity`
+/// buffers are kept when they come back, which caps the memory held by the pool.
+/// # Example
+/// ```no_run
+/// use qhyccd_rs::{Sdk, FramePool};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// /* set up the camera and start live mode */
+/// let pool = FramePool::for_camera(camera, 4).expect("FramePool::for_camera failed");
+/// let image = camera.get_live_frame_pooled(&pool).expect("get_live_frame_pooled failed");
+/// std::thread::spawn(move || {
+///     println!("{}x{}", image.width, image.height);
+///     // the buffer goes back to the pool here
+/// });
+/// ```
+pub struct FramePool {
+    inner: Arc<PoolInner>,
+}
+
+impl FramePool {
+    /// Creates a pool holding `capacity` buffers of `buffer_size` bytes each. All buffers are allocated upfront.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::FramePool;
+    /// let pool = FramePool::new(2, 1024);
+    /// assert_eq!(pool.available(), 2);
+    /// ```
+    pub fn new(capacity: usize, buffer_size: usize) -> Self {
+        let free = (0..capacity).map(|_| vec![0u8; buffer_size]).collect();
+        Self {
+            inner: Arc::new(PoolInner {
+                capacity,
+                state: Mutex::new(PoolState { buffer_size, free }),
+            }),
+        }
+    }
+
+    /// Creates a pool holding `capacity` buffers sized for the current settings of the camera as reported by
+    /// `get_image_size`
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk, FramePool};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let pool = FramePool::for_camera(camera, 4).expect("FramePool::for_camera failed");
+    /// ```
+    pub fn for_camera(camera: &Camera, capacity: usize) -> Result<Self> {
+        Ok(Self::new(capacity, camera.get_image_size()?))
+    }
+
+    /// Returns the number of buffers the pool keeps
+    pub fn capacity(&self) -> usize {
+        self.inner.capacity
+    }
+
+    /// Returns the size in bytes of the buffers handed out by the pool
+    pub fn buffer_size(&self) -> usize {
+        self.inner.lock().buffer_size
+    }
+
+    /// Returns the number of buffers that are currently not in use
+    pub fn available(&self) -> usize {
+        self.inner.lock().free.len()
+    }
+
+    /// Changes the size of the buffers in the pool, e.g. after changing the ROI or bin mode. The free buffers
+    /// are reallocated, buffers still in use are dropped instead of returned once they come back.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::FramePool;
+    /// let pool = FramePool::new(2, 1024);
+    /// pool.resize(2048);
+    /// assert_eq!(pool.acquire().len(), 2048);
+    /// ```
+    pub fn resize(&self, buffer_size: usize) {
+        let mut state = self.inner.lock();
+        if state.buffer_size == buffer_size {
+            return;
+        }
+        let count = state.free.len();
+        state.buffer_size = buffer_size;
+        state.free = (0..count).map(|_| vec![0u8; buffer_size]).collect();
+    }
+
+    /// Takes a buffer from the pool, a new one is allocated if all buffers are in use
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::FramePool;
+    /// let pool = FramePool::new(1, 1024);
+    /// let buffer = pool.acquire();
+    /// assert_eq!(pool.available(), 0);
+    /// drop(buffer);
+    /// assert_eq!(pool.available(), 1);
+    /// ```
+    pub fn acquire(&self) -> PooledBuffer {
+        let mut state = self.inner.lock();
+        let buffer = match state.free.pop() {
+            Some(buffer) => buffer,
+            None => vec![0u8; state.buffer_size],
+        };
+        drop(state);
+        PooledBuffer {
+            buffer,
+            pool: self.inner.clone(),
+        }
+    }
+
+    /// Takes a buffer from the pool, returns `None` if all buffers are in use
+    pub fn try_acquire(&self) -> Option<PooledBuffer> {
+        let buffer = self.inner.lock().free.pop()?;
+        Some(PooledBuffer {
+            buffer,
+            pool: self.inner.clone(),
+        })
+    }
+}
+
+/// A buffer borrowed from a `FramePool`, it goes back to the pool when dropped
+pub struct PooledBuffer {
+    buffer: Vec<u8>,
+    pool: Arc<PoolInner>,
+}
+
+impl PooledBuffer {
+    /// Turns the buffer into an image after a frame has been written into it with `get_live_frame_into`
+    /// or `get_single_frame_into`
+    pub fn into_image(mut self, info: FrameInfo) -> PooledImageData {
+        let data = std::mem::take(&mut self.buffer);
+        PooledImageData {
+            image: ImageData {
+                data,
+                width: info.width,
+                height: info.height,
+                bits_per_pixel: info.bits_per_pixel,
+                channels: info.channels,
+                metadata: None,
+            },
+            pool: self.pool.clone(),
+        }
+    }
+}
+
+impl Deref for PooledBuffer {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        &self.buffer
+    }
+}
+
+impl DerefMut for PooledBuffer {
+    fn deref_mut(&mut self) -> &mut [u8] {
+        &mut self.buffer
+    }
+}
+
+impl Debug for PooledBuffer {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("PooledBuffer")
+            .field("len", &self.buffer.len())
+            .finish()
+    }
+}
+
+impl Drop for PooledBuffer {
+    fn drop(&mut self) {
+        if !self.buffer.is_empty() {
+            self.pool.give_back(std::mem::take(&mut self.buffer));
+        }
+    }
+}
+
+/// An `ImageData` whose buffer belongs to a `FramePool`. It dereferences to `ImageData` and can be sent to
+/// other threads, the buffer goes back to the pool when it is dropped.
+pub struct PooledImageData {
+    image: ImageData,
+    pool: Arc<PoolInner>,
+}
+
+impl PooledImageData {
+    /// Detaches the image from the pool, the buffer will not be returned to the pool
+    pub fn into_image(mut self) -> ImageData {
+        ImageData {
+            data: std::mem::take(&mut self.image.data),
+            ..self.image
+        }
+    }
+}
+
+impl Deref for PooledImageData {
+    type Target = ImageData;
+
+    fn deref(&self) -> &ImageData {
+        &self.image
+    }
+}
+
+impl DerefMut for PooledImageData {
+    fn deref_mut(&mut self) -> &mut ImageData {
+        &mut self.image
+    }
+}
+
+impl Debug for PooledImageData {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("PooledImageData")
+            .field("len", &self.image.data.len())
+            .field("width", &self.image.width)
+            .field("height", &self.image.height)
+            .field("bits_per_pixel", &self.image.bits_per_pixel)
+            .field("channels", &self.image.channels)
+            .finish()
+    }
+}
+
+impl Drop for PooledImageData {
+    fn drop(&mut self) {
+        if !self.image.data.is_empty() {
+            self.pool.give_back(std::mem::take(&mut self.image.data));
+        }
+    }
+}
@@ -0,0 +1,191 @@
+use eyre::Result;
+
+use crate::{CCDChipArea, Camera, Control, FramePool, StreamMode};
+
+#[derive(Debug, Default, Clone, Copy)]
+/// what was last set on a camera through this crate, `None` where it is unknown
+pub(crate) struct CaptureModes {
+    pub(crate) stream_mode: Option<StreamMode>,
+    pub(crate) readout_mode: Option<u32>,
+    pub(crate) bit_mode: Option<u32>,
+    pub(crate) bin: Option<(u32, u32)>,
+    pub(crate) roi: Option<CCDChipArea>,
+    /// between `begin_live` and `end_live`
+    pub(crate) live: bool,
+}
+
+#[derive(Debug, Clone, Default, PartialEq)]
+/// The settings `Camera::reconfigure` moves the camera to, `None` keeps what is set
+pub struct CaptureConfig {
+    /// single frame or live mode, changing it needs `init`
+    pub stream_mode: Option<StreamMode>,
+    /// the readout mode, see `get_number_of_readout_modes`, changing it needs `init`
+    pub readout_mode: Option<u32>,
+    /// the transfer bits, 8 or 16, see `set_bit_mode`
+    pub bit_mode: Option<u32>,
+    /// the symmetric binning, see `set_bin_mode`
+    pub bin: Option<u32>,
+    /// the region of interest in binned pixels, see `set_roi`
+    pub roi: Option<CCDChipArea>,
+    /// controls set with `apply` at the end, e.g. the exposure and gain
+    pub parameters: Vec<(Control, f64)>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// What `Camera::reconfigure` did
+pub struct Reconfiguration {
+    /// `true` if the camera had to be initialized again
+    pub initialized: bool,
+    /// `true` if live mode was stopped for the change and started again
+    pub live_restarted: bool,
+    /// the number of modes and controls sent to the camera
+    pub changes: usize,
+    /// the buffer size needed for a frame with the new settings, see `get_image_size`
+    pub image_size: usize,
+}
+
+/// `true` if a value is wanted and it is not the one set
+fn differs<T: PartialEq>(wanted: Option<T>, set: Option<T>) -> bool {
+    wanted.is_some() && wanted != set
+}
+
+impl Camera {
+    /// Moves the camera to `config`, changing only the settings that differ from what was last set through
+    /// this crate, in the order the SDK needs them: readout mode, stream mode, `init`, bit mode, binning, ROI
+    /// and then the controls. `init` is only called if the readout or stream mode change. Since it resets the
+    /// camera, the modes and controls set before are restored afterwards unless `config` changes them.
+    ///
+    /// In live mode the stream is stopped for changes of the modes and started again afterwards, unless
+    /// `config` switches to single frame mode. It is started again as well if a change fails, and the first
+    /// error is returned. A `LiveStream` keeps running through this and resizes its
+    /// buffers to the new frame size. `pool`, if given, is resized to `Reconfiguration::image_size`.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,CaptureConfig,CCDChipArea,Control,FramePool,StreamMode};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let science = CaptureConfig {
+    ///     stream_mode: Some(StreamMode::SingleFrameMode),
+    ///     bit_mode: Some(16),
+    ///     bin: Some(1),
+    ///     roi: Some(CCDChipArea { start_x: 0, start_y: 0, width: 6248, height: 4176 }),
+    ///     parameters: vec![(Control::Exposure, 300_000_000.0)],
+    ///     ..Default::default()
+    /// };
+    /// let focus = CaptureConfig {
+    ///     bin: Some(2),
+    ///     roi: Some(CCDChipArea { start_x: 1312, start_y: 844, width: 500, height: 400 }),
+    ///     parameters: vec![(Control::Exposure, 2_000_000.0)],
+    ///     ..science.clone()
+    /// };
+    /// let pool = FramePool::new(2, 0);
+    /// camera.reconfigure(&science, Some(&pool)).expect("reconfigure failed");
+    /// /* take the frames, then focus again, this does not init the camera */
+    /// let done = camera.reconfigure(&focus, Some(&pool)).expect("reconfigure failed");
+    /// assert!(!done.initialized);
+    /// ```
+    pub fn reconfigure(
+        &self,
+        config: &CaptureConfig,
+        pool: Option<&FramePool>,
+    ) -> Result<Reconfiguration> {
+        let current = *self.handle.modes();
+        let bin = config.bin.map(|bin| (bin, bin));
+        let initialize = differs(config.stream_mode, current.stream_mode)
+            || differs(config.readout_mode, current.readout_mode);
+        // init puts bit mode, binning and ROI back to the defaults, so everything known is set again
+        let bit_mode = config.bit_mode.or(current.bit_mode);
+        let bin = bin.or(current.bin);
+        let roi = config.roi.or(current.roi);
+        let set_bit_mode = bit_mode.is_some() && (initialize || bit_mode != current.bit_mode);
+        let set_bin = bin.is_some() && (initialize || bin != current.bin);
+        let set_roi = roi.is_some() && (initialize || roi != current.roi);
+        let stream_mode = config.stream_mode.or(current.stream_mode);
+        let stop_live = current.live && (initialize || set_bit_mode || set_bin || set_roi);
+        tracing::debug!(
+            camera = %self.id,
+            initialize,
+            set_bit_mode,
+            set_bin,
+            set_roi,
+            stop_live,
+            "reconfigure"
+        );
+
+        if stop_live {
+            self.end_live()?;
+        }
+        let changed = (|| -> Result<usize> {
+            let mut changes = 0;
+            let mut parameters = Vec::with_capacity(config.parameters.len());
+            if initialize {
+                // the controls set before, init and the readout mode forget them, a new bit mode replaces
+                // the transfer bits
+                let applied = self.handle.applied().clone();
+                parameters.extend(applied.into_iter().filter(|(control, _)| {
+                    (!set_bit_mode || *control != Control::TransferBit)
+                        && !config
+                            .parameters
+                            .iter()
+                            .any(|(wanted, _)| wanted == control)
+                }));
+            }
+            if let Some(mode) = config
+                .readout_mode
+                .filter(|&mode| Some(mode) != current.readout_mode)
+            {
+                self.set_readout_mode(mode)?;
+                changes += 1;
+            }
+            if initialize {
+                if let Some(mode) = stream_mode {
+                    self.set_stream_mode(mode)?;
+                    changes += 1;
+                }
+                self.init()?;
+            }
+            if let Some(mode) = bit_mode.filter(|_| set_bit_mode) {
+                self.set_bit_mode(mode)?;
+                changes += 1;
+            }
+            if let Some((bin_x, bin_y)) = bin.filter(|_| set_bin) {
+                self.set_bin_mode(bin_x, bin_y)?;
+                changes += 1;
+            }
+            if let Some(roi) = roi.filter(|_| set_roi) {
+                self.set_roi(roi)?;
+                changes += 1;
+            }
+            parameters.extend_from_slice(&config.parameters);
+            if !parameters.is_empty() {
+                for result in self.apply(&parameters) {
+                    if result? {
+                        changes += 1;
+                    }
+                }
+            }
+            Ok(changes)
+        })();
+        // live mode is started again even if a change failed, in the stream mode that was actually set
+        let live_restarted =
+            stop_live && self.handle.modes().stream_mode != Some(StreamMode::SingleFrameMode);
+        let restarted = if live_restarted {
+            self.begin_live()
+        } else {
+            Ok(())
+        };
+        let changes = changed?;
+        restarted?;
+        let image_size = self.get_image_size()?;
+        if let Some(pool) = pool {
+            pool.resize(image_size);
+        }
+        Ok(Reconfiguration {
+            initialized: initialize,
+            live_restarted,
+            changes,
+            image_size,
+        })
+    }
+}
@@ -0,0 +1,359 @@
+use std::fs::{File, OpenOptions};
+use std::io::{Seek, SeekFrom, Write};
+use std::os::unix::io::AsRawFd;
+use std::path::Path;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use eyre::{eyre, Result, WrapErr};
+
+use crate::files::allocate;
+use crate::QHYError::{
+    BufferTooSmallError, FrameMismatchError, RecorderFullError, UnsupportedImageError,
+    WriteSerError,
+};
+use crate::{BayerMode, Camera, FrameInfo, ImageData};
+
+/// the size of the fixed SER header in front of the frames
+const SER_HEADER_LEN: usize = 178;
+/// the SER file id
+const SER_ID: &[u8; 14] = b"LUCAM-RECORDER";
+/// the offset of the frame count in the header
+const FRAME_COUNT_OFFSET: usize = 38;
+/// SER time stamps count 100ns ticks since 0001-01-01, this many to the unix epoch
+const UNIX_EPOCH_TICKS: u64 = 621_355_968_000_000_000;
+
+#[derive(Debug, Clone, Default)]
+/// Options for `SerRecorder::create`
+pub struct SerOptions {
+    /// the observer written to the header, at most 40 bytes are kept
+    pub observer: String,
+    /// the camera written to the header, at most 40 bytes are kept
+    pub instrument: String,
+    /// the telescope written to the header, at most 40 bytes are kept
+    pub telescope: String,
+    /// the bayer pattern of a color camera recording raw frames, `None` for mono frames
+    pub bayer: Option<BayerMode>,
+}
+
+/// a shared read-write mapping of a whole file
+#[derive(Debug)]
+struct Mapping {
+    ptr: *mut u8,
+    len: usize,
+}
+
+// the mapping is owned by one `SerRecorder`, which is only ever used from one thread at a time
+unsafe impl Send for Mapping {}
+
+impl Mapping {
+    fn new(file: &File, len: usize) -> std::io::Result<Self> {
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_SHARED,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(std::io::Error::last_os_error());
+        }
+        // frames are written front to back, so the kernel can write back and drop pages behind us early
+        unsafe { libc::madvise(ptr, len, libc::MADV_SEQUENTIAL) };
+        Ok(Self {
+            ptr: ptr as *mut u8,
+            len,
+        })
+    }
+
+    fn as_mut_slice(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.ptr, self.len) }
+    }
+
+    fn flush(&self) -> std::io::Result<()> {
+        match unsafe { libc::msync(self.ptr as *mut libc::c_void, self.len, libc::MS_SYNC) } {
+            0 => Ok(()),
+            _ => Err(std::io::Error::last_os_error()),
+        }
+    }
+}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        unsafe { libc::munmap(self.ptr as *mut libc::c_void, self.len) };
+    }
+}
+
+/// Records frames into a SER video file, the format planetary stacking tools read. The file is sized for
+/// `capacity` frames up front and mapped into memory, `record_live_frame` lets the SDK write each live frame
+/// straight into its slot in the file, so recording costs no copy and no `write` call per frame. The page
+/// cache writes the file back sequentially in the background.
+///
+/// A time stamp is kept for every frame and written to the trailer of the file by `finish`, which also cuts
+/// the file down to the frames recorded. Dropping the recorder finishes it as well.
+///
+/// Only available on unix.
+/// # Example
+/// ```no_run
+/// use qhyccd_rs::{Sdk,StreamMode,Control,FrameInfo,SerOptions,SerRecorder};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// camera.set_stream_mode(StreamMode::LiveMode).expect("set_stream_mode failed");
+/// camera.init().expect("init failed");
+/// camera.set_parameter(Control::TransferBit, 8.0).expect("set_param failed");
+/// camera.set_parameter(Control::Exposure, 5000.0).expect("set_param failed");
+/// camera.begin_live().expect("begin_live failed");
+/// let info = FrameInfo { width: 640, height: 480, bits_per_pixel: 8, channels: 1 };
+/// let mut recorder = SerRecorder::create("jupiter.ser", info, 20_000, SerOptions::default())
+///     .expect("create failed");
+/// while !recorder.is_full() {
+///     recorder.record_live_frame(camera).expect("record_live_frame failed");
+/// }
+/// camera.end_live().expect("end_live failed");
+/// let frames = recorder.finish().expect("finish failed");
+/// println!("recorded {} frames", frames);
+/// ```
+#[derive(Debug)]
+pub struct SerRecorder {
+    file: File,
+    map: Option<Mapping>,
+    info: FrameInfo,
+    frame_len: usize,
+    capacity: usize,
+    /// what the SDK needs to write a live frame, it may ask for more than the frame itself
+    buffer_len: Option<usize>,
+    timestamps: Vec<u64>,
+}
+
+impl SerRecorder {
+    /// Creates the file at `path` for at most `capacity` frames with the geometry `info`. 8 and 16 bit
+    /// frames with one channel or three (BGR) are supported.
+    pub fn create<P: AsRef<Path>>(
+        path: P,
+        info: FrameInfo,
+        capacity: usize,
+        options: SerOptions,
+    ) -> Result<Self> {
+        let color_id = match (info.channels, options.bayer) {
+            (1, None) => 0,
+            (1, Some(BayerMode::RGGB)) => 8,
+            (1, Some(BayerMode::GRBG)) => 9,
+            (1, Some(BayerMode::GBRG)) => 10,
+            (1, Some(BayerMode::BGGR)) => 11,
+            (3, _) => 101,
+            _ => 0,
+        };
+        if !matches!(info.channels, 1 | 3) || !matches!(info.bits_per_pixel.div_ceil(8), 1 | 2) {
+            let error = UnsupportedImageError {
+                bits_per_pixel: info.bits_per_pixel,
+                channels: info.channels,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let capacity = capacity.max(1);
+        let frame_len = info.data_len();
+        let len = SER_HEADER_LEN + capacity * frame_len;
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(true)
+            .open(path)
+            .wrap_err(WriteSerError)?;
+        allocate(&file, len).wrap_err(WriteSerError)?;
+        let mut map = Mapping::new(&file, len).wrap_err(WriteSerError)?;
+        write_header(
+            &mut map.as_mut_slice()[..SER_HEADER_LEN],
+            info,
+            color_id,
+            &options,
+        );
+        Ok(Self {
+            file,
+            map: Some(map),
+            info,
+            frame_len,
+            capacity,
+            buffer_len: None,
+            timestamps: Vec::with_capacity(capacity),
+        })
+    }
+
+    /// Returns the geometry of the frames
+    pub fn info(&self) -> FrameInfo {
+        self.info
+    }
+
+    /// Returns the number of frames recorded so far
+    pub fn frames(&self) -> usize {
+        self.timestamps.len()
+    }
+
+    /// Returns the number of frames the file has room for
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Returns `true` once the file has no room for another frame
+    pub fn is_full(&self) -> bool {
+        self.frames() >= self.capacity
+    }
+
+    /// Lets the SDK write the next live frame of `camera` directly into the file, the camera has to be in
+    /// live mode. Returns `Ok(false)` if no new frame was ready yet, call it again right away.
+    pub fn record_live_frame(&mut self, camera: &Camera) -> Result<bool> {
+        let start = self.next_slot()?;
+        let buffer_len = match self.buffer_len {
+            Some(buffer_len) => buffer_len,
+            None => {
+                let buffer_len = camera.get_image_size()?;
+                // room for the SDK buffer behind the last slot, so the file grows once and not per frame
+                self.reserve(SER_HEADER_LEN + (self.capacity - 1) * self.frame_len + buffer_len)?;
+                *self.buffer_len.insert(buffer_len)
+            }
+        };
+        let map = self.map.as_mut().expect("mapped until finished");
+        let slot = &mut map.as_mut_slice()[start..start + buffer_len];
+        match camera.poll_live_frame_into(slot)? {
+            Some(info) => {
+                self.check(info)?;
+                self.timestamps.push(now_ticks());
+                Ok(true)
+            }
+            None => Ok(false),
+        }
+    }
+
+    /// Copies a frame into the file, e.g. one taken from a `LiveStream`
+    pub fn write_frame(&mut self, image: &ImageData) -> Result<()> {
+        let start = self.next_slot()?;
+        self.check(image.info())?;
+        // the header may promise more pixels than the buffer holds
+        let pixels = image.as_u8_slice();
+        if pixels.len() != self.frame_len {
+            let error = BufferTooSmallError {
+                needed: self.frame_len,
+                available: pixels.len(),
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let map = self.map.as_mut().expect("mapped until finished");
+        map.as_mut_slice()[start..start + self.frame_len].copy_from_slice(pixels);
+        self.timestamps.push(now_ticks());
+        Ok(())
+    }
+
+    /// Writes the frame count and the time stamps, and cuts the file down to the frames recorded. Returns
+    /// the number of frames.
+    pub fn finish(mut self) -> Result<usize> {
+        self.finalize()?;
+        Ok(self.frames())
+    }
+
+    fn next_slot(&self) -> Result<usize> {
+        if self.is_full() || self.map.is_none() {
+            let error = RecorderFullError {
+                capacity: self.capacity,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        Ok(SER_HEADER_LEN + self.frames() * self.frame_len)
+    }
+
+    fn check(&self, info: FrameInfo) -> Result<()> {
+        if info == self.info {
+            return Ok(());
+        }
+        let error = FrameMismatchError {
+            width: info.width,
+            height: info.height,
+            channels: info.channels,
+            expected_width: self.info.width,
+            expected_height: self.info.height,
+            expected_channels: self.info.channels,
+        };
+        tracing::error!(error = ?error);
+        Err(eyre!(error))
+    }
+
+    /// grows the file and the mapping to at least `len` bytes, the SDK may write past the end of the last frame
+    fn reserve(&mut self, len: usize) -> Result<()> {
+        if self.map.as_ref().is_some_and(|map| map.len >= len) {
+            return Ok(());
+        }
+        self.map = None;
+        allocate(&self.file, len).wrap_err(WriteSerError)?;
+        self.map = Some(Mapping::new(&self.file, len).wrap_err(WriteSerError)?);
+        Ok(())
+    }
+
+    fn finalize(&mut self) -> Result<()> {
+        let Some(mut map) = self.map.take() else {
+            return Ok(());
+        };
+        let frames = self.frames();
+        let header = map.as_mut_slice();
+        header[FRAME_COUNT_OFFSET..FRAME_COUNT_OFFSET + 4]
+            .copy_from_slice(&(frames as i32).to_le_bytes());
+        if let Some(&first) = self.timestamps.first() {
+            header[162..170].copy_from_slice(&first.to_le_bytes());
+            header[170..178].copy_from_slice(&first.to_le_bytes());
+        }
+        let write = || -> std::io::Result<()> {
+            map.flush()?;
+            drop(map);
+            let end = (SER_HEADER_LEN + frames * self.frame_len) as u64;
+            self.file.set_len(end)?;
+            self.file.seek(SeekFrom::Start(end))?;
+            let trailer: Vec<u8> = self
+                .timestamps
+                .iter()
+                .flat_map(|ticks| ticks.to_le_bytes())
+                .collect();
+            self.file.write_all(&trailer)?;
+            self.file.flush()
+        };
+        write().wrap_err(WriteSerError)
+    }
+}
+
+impl Drop for SerRecorder {
+    fn drop(&mut self) {
+        if let Err(error) = self.finalize() {
+            tracing::error!(error = ?error);
+        }
+    }
+}
+
+fn write_header(header: &mut [u8], info: FrameInfo, color_id: i32, options: &SerOptions) {
+    header.fill(0);
+    header[..14].copy_from_slice(SER_ID);
+    header[18..22].copy_from_slice(&color_id.to_le_bytes());
+    // 0 means little endian samples to FireCapture, SharpCap and the stacking tools, even though the
+    // format description reads the other way round
+    header[22..26].copy_from_slice(&0_i32.to_le_bytes());
+    header[26..30].copy_from_slice(&(info.width as i32).to_le_bytes());
+    header[30..34].copy_from_slice(&(info.height as i32).to_le_bytes());
+    header[34..38].copy_from_slice(&(info.bits_per_pixel as i32).to_le_bytes());
+    for (offset, text) in [
+        (42, &options.observer),
+        (82, &options.instrument),
+        (122, &options.telescope),
+    ] {
+        let len = text.len().min(40);
+        header[offset..offset + len].copy_from_slice(&text.as_bytes()[..len]);
+    }
+}
+
+fn now_ticks() -> u64 {
+    let since_epoch = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or_default();
+    UNIX_EPOCH_TICKS + (since_epoch.as_nanos() / 100) as u64
+}
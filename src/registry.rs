@@ -0,0 +1,237 @@
+use std::fmt::Debug;
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Mutex, MutexGuard};
+use std::time::Instant;
+
+use eyre::{eyre, Result};
+
+use crate::QHYError::DeviceNotFoundError;
+use crate::{Camera, Sdk};
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+/// A change of the connected cameras found by `DeviceRegistry::rescan` or `DeviceRegistry::recover`
+pub enum DeviceEvent {
+    /// a camera that was not known before showed up, it is not opened
+    Added(String),
+    /// a known camera is missing from the scan, it is closed but kept in the registry
+    Lost(String),
+    /// a lost or reset camera is back, and open again if it was open when it got lost
+    Recovered(String),
+}
+
+#[derive(Debug)]
+struct Device {
+    /// shares its handle with every clone handed out, so those work again after a recovery
+    camera: Camera,
+    /// `true` if the last scan listed the camera
+    present: bool,
+    /// `true` if the camera was open when it got lost and has to be opened when it is back
+    reopen: bool,
+}
+
+/// Keeps track of the connected cameras while the `Sdk` stays initialized. `rescan` asks the SDK for the
+/// connected cameras again and compares the ids with the known ones: new cameras are added, missing ones are
+/// closed and kept, and cameras that come back are opened again if they were open. `recover` does the same
+/// for a single camera that reset under load, without releasing the SDK and interrupting the other cameras.
+///
+/// The registry hands out clones of its cameras, which share the handle and the cached `capabilities` with
+/// it, so a recovered camera needs neither a new `Camera` nor a new capability query. Subscribers get every
+/// `DeviceEvent` over a channel.
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use qhyccd_rs::{Sdk,DeviceEvent,DeviceRegistry};
+/// let registry = DeviceRegistry::new(Sdk::new().expect("SDK::new failed"));
+/// let events = registry.subscribe();
+/// for camera in registry.cameras() {
+///     camera.open().expect("open failed");
+/// }
+/// loop {
+///     std::thread::sleep(Duration::from_secs(5));
+///     registry.rescan().expect("rescan failed");
+///     while let Ok(event) = events.try_recv() {
+///         if let DeviceEvent::Recovered(id) = event {
+///             println!("{} is back", id);
+///             /* restart its capture */
+///         }
+///     }
+/// }
+/// ```
+pub struct DeviceRegistry {
+    sdk: Sdk,
+    /// also serializes the scans, the SDK must not scan twice at the same time
+    devices: Mutex<Vec<Device>>,
+    subscribers: Mutex<Vec<Sender<DeviceEvent>>>,
+}
+
+impl DeviceRegistry {
+    /// Creates a registry starting with the cameras `sdk` found, the `Sdk` is released with the registry
+    pub fn new(sdk: Sdk) -> Self {
+        let devices = sdk
+            .cameras()
+            .map(|camera| Device {
+                camera: camera.clone(),
+                present: true,
+                reopen: false,
+            })
+            .collect();
+        Self {
+            sdk,
+            devices: Mutex::new(devices),
+            subscribers: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Returns the `Sdk`, e.g. for `Sdk::filter_wheels` or `Sdk::version`
+    pub fn sdk(&self) -> &Sdk {
+        &self.sdk
+    }
+
+    /// Returns the cameras listed by the last scan
+    pub fn cameras(&self) -> Vec<Camera> {
+        self.devices()
+            .iter()
+            .filter(|device| device.present)
+            .map(|device| device.camera.clone())
+            .collect()
+    }
+
+    /// Returns the camera with `id`, also while it is lost
+    pub fn camera(&self, id: &str) -> Option<Camera> {
+        self.devices()
+            .iter()
+            .find(|device| device.camera.id() == id)
+            .map(|device| device.camera.clone())
+    }
+
+    /// Returns `true` if the last scan listed the camera with `id`
+    pub fn is_present(&self, id: &str) -> bool {
+        self.devices()
+            .iter()
+            .any(|device| device.present && device.camera.id() == id)
+    }
+
+    /// Returns a channel that receives every event from now on, it is dropped from the registry once the
+    /// receiver is gone
+    pub fn subscribe(&self) -> Receiver<DeviceEvent> {
+        let (sender, receiver) = mpsc::channel();
+        self.subscribers
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .push(sender);
+        receiver
+    }
+
+    /// Scans for cameras and updates the registry, returns the changes that were also sent to the subscribers.
+    /// Cameras that are still there are not touched.
+    pub fn rescan(&self) -> Result<Vec<DeviceEvent>> {
+        let mut devices = self.devices();
+        let ids = Sdk::scan()?;
+        let events = update(&mut devices, &ids);
+        drop(devices);
+        self.notify(&events);
+        Ok(events)
+    }
+
+    /// Scans for cameras and opens the camera with `id` again, e.g. after its calls failed because it reset.
+    /// The camera does not have to be lost, its handle is discarded either way. Fails with
+    /// `DeviceNotFoundError` if the scan did not list the camera, it is then lost and a later `rescan` opens
+    /// it when it is back.
+    pub fn recover(&self, id: &str) -> Result<()> {
+        let started = Instant::now();
+        let mut devices = self.devices();
+        let ids = Sdk::scan()?;
+        let mut events = update(&mut devices, &ids);
+        let recovered = events.contains(&DeviceEvent::Recovered(id.to_owned()));
+        let result = match devices
+            .iter_mut()
+            .find(|device| device.present && device.camera.id() == id)
+        {
+            Some(device) if recovered && device.camera.handle.is_open() => Ok(()),
+            Some(device) => device.camera.reopen().map(|_| {
+                if !recovered {
+                    events.push(DeviceEvent::Recovered(id.to_owned()));
+                }
+            }),
+            None => {
+                let error = DeviceNotFoundError { id: id.to_owned() };
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        };
+        drop(devices);
+        tracing::debug!(camera = id, elapsed = ?started.elapsed(), ok = result.is_ok(), "recover");
+        self.notify(&events);
+        result
+    }
+
+    fn devices(&self) -> MutexGuard<'_, Vec<Device>> {
+        self.devices
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn notify(&self, events: &[DeviceEvent]) {
+        if events.is_empty() {
+            return;
+        }
+        self.subscribers
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .retain(|subscriber| {
+                events
+                    .iter()
+                    .all(|event| subscriber.send(event.clone()).is_ok())
+            });
+    }
+}
+
+/// compares the scanned `ids` with the known devices and brings them up to date
+fn update(devices: &mut Vec<Device>, ids: &[String]) -> Vec<DeviceEvent> {
+    let mut events = Vec::new();
+    for device in devices.iter_mut() {
+        let listed = ids.iter().any(|id| id == device.camera.id());
+        match (device.present, listed) {
+            (true, false) => {
+                device.present = false;
+                device.reopen = device.camera.handle.is_open();
+                device.camera.discard();
+                tracing::debug!(camera = device.camera.id(), "camera lost");
+                events.push(DeviceEvent::Lost(device.camera.id().to_owned()));
+            }
+            (false, true) => {
+                if device.reopen {
+                    if let Err(error) = device.camera.reopen() {
+                        // stays lost, the next scan tries again
+                        tracing::error!(error = ?error);
+                        continue;
+                    }
+                }
+                device.present = true;
+                device.reopen = false;
+                tracing::debug!(camera = device.camera.id(), "camera recovered");
+                events.push(DeviceEvent::Recovered(device.camera.id().to_owned()));
+            }
+            _ => (),
+        }
+    }
+    for id in ids {
+        if devices.iter().all(|device| device.camera.id() != id) {
+            devices.push(Device {
+                camera: Camera::new(id.clone()),
+                present: true,
+                reopen: false,
+            });
+            events.push(DeviceEvent::Added(id.clone()));
+        }
+    }
+    events
+}
+
+impl Debug for DeviceRegistry {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("DeviceRegistry")
+            .field("devices", &*self.devices())
+            .finish_non_exhaustive()
+    }
+}
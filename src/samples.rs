@@ -0,0 +1,34 @@
+use std::borrow::Cow;
+
+/// Returns the little endian 16 bit samples in `bytes`, borrowed if the buffer is aligned and decoded into a
+/// copy otherwise
+pub(crate) fn u16_samples(bytes: &[u8]) -> Cow<'_, [u16]> {
+    // Safety: every bit pattern is a valid u16
+    match unsafe { bytes.align_to::<u16>() } {
+        ([], samples, []) => Cow::Borrowed(samples),
+        _ => Cow::Owned(
+            bytes
+                .chunks_exact(2)
+                .map(|bytes| u16::from_le_bytes([bytes[0], bytes[1]]))
+                .collect(),
+        ),
+    }
+}
+
+/// Allocates the byte buffer of a 16 bit image with `samples` samples and lets `fill` write the samples
+/// directly into it, only if the allocation is not aligned the samples are written to a copy first
+pub(crate) fn u16_image_data(samples: usize, fill: impl FnOnce(&mut [u16])) -> Vec<u8> {
+    let mut data = vec![0_u8; samples * 2];
+    // Safety: every bit pattern is a valid u16
+    match unsafe { data.align_to_mut::<u16>() } {
+        ([], out, []) => fill(out),
+        _ => {
+            let mut out = vec![0_u16; samples];
+            fill(&mut out);
+            for (bytes, sample) in data.chunks_exact_mut(2).zip(out) {
+                bytes.copy_from_slice(&sample.to_le_bytes());
+            }
+        }
+    }
+    data
+}
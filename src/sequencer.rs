@@ -0,0 +1,326 @@
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{self, Receiver, SyncSender};
+use std::sync::Mutex;
+use std::thread;
+use std::time::{Duration, Instant};
+
+use eyre::{eyre, Result};
+
+use crate::QHYError::SequencerNoFilterWheelError;
+use crate::{Camera, Control, FilterWheel, FramePool, MoveHandle, PooledImageData};
+
+#[derive(Debug, Clone, PartialEq)]
+/// One line of a `Sequencer` plan: `count` frames with the same settings
+pub struct SequenceStep {
+    /// the number of frames
+    pub count: u32,
+    /// the exposure time of each frame
+    pub exposure: Duration,
+    /// the gain, `None` keeps the current gain of the camera
+    pub gain: Option<f64>,
+    /// the filter wheel position, `None` keeps the current filter
+    pub filter: Option<u32>,
+}
+
+#[derive(Debug, Clone)]
+/// Options for `Sequencer::new`
+pub struct SequencerOptions {
+    /// the number of threads calling the sink
+    pub workers: usize,
+    /// the number of frames waiting for a worker before the next exposure waits for the queue
+    pub queue_depth: usize,
+    /// how long to wait for the filter wheel to reach a new position
+    pub filter_timeout: Duration,
+}
+
+impl Default for SequencerOptions {
+    fn default() -> Self {
+        Self {
+            workers: 2,
+            queue_depth: 2,
+            filter_timeout: Duration::from_secs(30),
+        }
+    }
+}
+
+#[derive(Debug)]
+/// A frame taken by a `Sequencer` together with the settings it was taken with
+pub struct SequenceFrame {
+    /// the number of the frame in the whole sequence, starting at 0
+    pub index: usize,
+    /// the index of the `SequenceStep` in the plan
+    pub step: usize,
+    /// the exposure time
+    pub exposure: Duration,
+    /// the gain set by the plan, `None` if the plan did not set it
+    pub gain: Option<f64>,
+    /// the filter wheel position set by the plan, `None` if the plan did not set it
+    pub filter: Option<u32>,
+    /// the image, its buffer goes back to the sequencer when dropped
+    pub image: PooledImageData,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+/// What a `Sequencer` run did
+pub struct SequenceSummary {
+    /// the number of frames handed to the sink
+    pub frames: usize,
+    /// the time from the start of the first exposure to the end of the last readout
+    pub elapsed: Duration,
+    /// the total time the camera was not exposing or reading out between the first and the last frame,
+    /// this is what the pipeline keeps small
+    pub idle: Duration,
+}
+
+/// the settings the camera currently has, so unchanged settings are not sent again for every frame
+#[derive(Debug, Default)]
+struct Applied {
+    exposure: Option<Duration>,
+    gain: Option<f64>,
+    /// the position the wheel was last told to move to
+    filter: Option<u32>,
+    /// the move to `filter` until the wheel reported that it arrived
+    moving: Option<MoveHandle>,
+}
+
+/// Runs an imaging plan in Single Frame Mode and pipelines it: while the sink processes or saves frame N on
+/// worker threads, frame N+1 is already exposing. When the next frame needs another filter, the wheel is
+/// told to move as soon as the exposure of the last frame with the current filter is over, so the move
+/// overlaps with reading that frame out and handing it off.
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use qhyccd_rs::{Sdk,StreamMode,Sequencer,SequencerOptions,SequenceStep,FitsHeader};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+/// camera.init().expect("init failed");
+/// let filter_wheel = sdk.filter_wheels().last();
+/// let sequencer = Sequencer::new(camera, filter_wheel, SequencerOptions::default());
+/// let plan: Vec<SequenceStep> = (0..3)
+///     .map(|filter| SequenceStep {
+///         count: 20,
+///         exposure: Duration::from_secs(300),
+///         gain: Some(30.0),
+///         filter: Some(filter),
+///     })
+///     .collect();
+/// let summary = sequencer
+///     .run(&plan, |frame| {
+///         let path = format!("light_{:03}_filter{:?}.fits", frame.index, frame.filter);
+///         frame.image.save_fits(path, &FitsHeader::new())
+///     })
+///     .expect("sequence failed");
+/// println!("{} frames, idle for {:?}", summary.frames, summary.idle);
+/// ```
+#[derive(Debug, Clone)]
+pub struct Sequencer {
+    camera: Camera,
+    filter_wheel: Option<FilterWheel>,
+    options: SequencerOptions,
+}
+
+impl Sequencer {
+    /// Creates a sequencer for an open camera in Single Frame Mode. `filter_wheel` is only needed if the
+    /// plan changes filters.
+    pub fn new(
+        camera: &Camera,
+        filter_wheel: Option<&FilterWheel>,
+        options: SequencerOptions,
+    ) -> Self {
+        Self {
+            camera: camera.clone(),
+            filter_wheel: filter_wheel.cloned(),
+            options,
+        }
+    }
+
+    /// Takes all frames of `plan` and calls `sink` for each of them on one of the worker threads. The frames
+    /// of one worker arrive in order, with several workers they may finish out of order. If the camera fails,
+    /// no new exposure is started but the frames already taken are still handed to `sink`. If `sink` fails,
+    /// the frames still queued are dropped as well. The first error is returned once all workers are done.
+    pub fn run<F>(&self, plan: &[SequenceStep], sink: F) -> Result<SequenceSummary>
+    where
+        F: Fn(SequenceFrame) -> Result<()> + Sync,
+    {
+        if self.filter_wheel.is_none() && plan.iter().any(|step| step.filter.is_some()) {
+            let error = SequencerNoFilterWheelError;
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let workers = self.options.workers.max(1);
+        let depth = self.options.queue_depth.max(1);
+        // one buffer per worker, the queued ones and the one being read out
+        let pool = FramePool::for_camera(&self.camera, workers + depth + 1)?;
+        let stop = AtomicBool::new(false);
+        let sink_error = Mutex::new(None);
+        let (sender, receiver) = mpsc::sync_channel(depth);
+        let receiver = Mutex::new(receiver);
+        let result = thread::scope(|scope| {
+            for _ in 0..workers {
+                scope.spawn(|| work(&receiver, &sink, &stop, &sink_error));
+            }
+            let result = self.acquire(plan, &pool, &sender, &stop);
+            // lets the workers finish the queued frames and exit
+            drop(sender);
+            result
+        });
+        match sink_error
+            .into_inner()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+        {
+            Some(error) => Err(error),
+            None => result,
+        }
+    }
+
+    fn acquire(
+        &self,
+        plan: &[SequenceStep],
+        pool: &FramePool,
+        sender: &SyncSender<SequenceFrame>,
+        stop: &AtomicBool,
+    ) -> Result<SequenceSummary> {
+        let frames = plan
+            .iter()
+            .enumerate()
+            .flat_map(|(index, step)| (0..step.count).map(move |_| (index, step)));
+        let mut frames = frames.peekable();
+        let mut applied = Applied::default();
+        let mut summary = SequenceSummary {
+            frames: 0,
+            elapsed: Duration::ZERO,
+            idle: Duration::ZERO,
+        };
+        let mut first_exposure = None;
+        let mut last_readout: Option<Instant> = None;
+        while let Some((step_index, step)) = frames.next() {
+            if stop.load(Ordering::Acquire) {
+                break;
+            }
+            self.apply(step, &mut applied)?;
+            let started = Instant::now();
+            first_exposure.get_or_insert(started);
+            if let Some(last_readout) = last_readout {
+                summary.idle += started - last_readout;
+            }
+            let next_filter = frames
+                .peek()
+                .and_then(|(_, next)| next.filter)
+                .filter(|&filter| applied.filter != Some(filter));
+            let span =
+                tracing::debug_span!("sequence_frame", index = summary.frames, step = step_index);
+            let image = span.in_scope(|| {
+                self.camera.start_single_frame_exposure()?;
+                // the light is collected, the wheel can move while the frame is read out
+                if let Some(filter) = next_filter {
+                    self.wait_for_exposure(started + step.exposure);
+                    self.start_filter_move(filter, &mut applied)?;
+                }
+                self.camera.get_single_frame_pooled(pool)
+            })?;
+            let read_out = Instant::now();
+            last_readout = Some(read_out);
+            summary.elapsed = read_out - first_exposure.unwrap_or(started);
+            let frame = SequenceFrame {
+                index: summary.frames,
+                step: step_index,
+                exposure: step.exposure,
+                gain: step.gain,
+                filter: step.filter,
+                image,
+            };
+            if sender.send(frame).is_err() {
+                break;
+            }
+            summary.frames += 1;
+        }
+        Ok(summary)
+    }
+
+    /// sends the settings of `step` that differ from the current ones and waits for the filter wheel
+    fn apply(&self, step: &SequenceStep, applied: &mut Applied) -> Result<()> {
+        if let Some(filter) = step.filter {
+            self.start_filter_move(filter, applied)?;
+            self.wait_for_filter(applied)?;
+        }
+        if applied.exposure != Some(step.exposure) {
+            self.camera
+                .set_parameter(Control::Exposure, step.exposure.as_micros() as f64)?;
+            applied.exposure = Some(step.exposure);
+        }
+        if let Some(gain) = step.gain {
+            if applied.gain != Some(gain) {
+                self.camera.set_parameter(Control::Gain, gain)?;
+                applied.gain = Some(gain);
+            }
+        }
+        Ok(())
+    }
+
+    fn start_filter_move(&self, filter: u32, applied: &mut Applied) -> Result<()> {
+        if applied.filter == Some(filter) {
+            return Ok(());
+        }
+        let filter_wheel = self
+            .filter_wheel
+            .as_ref()
+            .ok_or_else(|| eyre!(SequencerNoFilterWheelError))?;
+        applied.moving = Some(filter_wheel.move_to(filter)?);
+        applied.filter = Some(filter);
+        Ok(())
+    }
+
+    fn wait_for_filter(&self, applied: &mut Applied) -> Result<()> {
+        match applied.moving.take() {
+            Some(moving) => moving.wait(self.options.filter_timeout),
+            None => Ok(()),
+        }
+    }
+
+    /// waits until `end` and then for what the camera still reports as remaining, a camera that can not
+    /// report it is taken to be done at `end`
+    fn wait_for_exposure(&self, end: Instant) {
+        let now = Instant::now();
+        if end > now {
+            thread::sleep(end - now);
+        }
+        if let Ok(remaining) = self.camera.get_remaining_exposure_us() {
+            thread::sleep(Duration::from_micros(remaining as u64));
+        }
+    }
+}
+
+/// the loop of a worker thread, it ends when the sequencer drops the sending side of the queue
+fn work<F>(
+    receiver: &Mutex<Receiver<SequenceFrame>>,
+    sink: &F,
+    stop: &AtomicBool,
+    sink_error: &Mutex<Option<eyre::Report>>,
+) where
+    F: Fn(SequenceFrame) -> Result<()> + Sync,
+{
+    loop {
+        let frame = match receiver
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .recv()
+        {
+            Ok(frame) => frame,
+            Err(_) => return,
+        };
+        if stop.load(Ordering::Acquire) {
+            // keep draining so the sequencer never blocks on a full queue
+            continue;
+        }
+        if let Err(error) = sink(frame) {
+            tracing::error!(error = ?error);
+            stop.store(true, Ordering::Release);
+            let mut sink_error = sink_error
+                .lock()
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+            sink_error.get_or_insert(error);
+        }
+    }
+}
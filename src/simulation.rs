@@ -0,0 +1,908 @@
+use std::ffi::{c_char, CStr};
+use std::sync::{Arc, Mutex, MutexGuard, RwLock};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use libqhyccd_sys::{QhyccdHandle, QHYCCD_ERROR, QHYCCD_ERROR_F64, QHYCCD_SUCCESS};
+
+use crate::{Backend, Control};
+
+#[derive(Debug, Clone, PartialEq)]
+/// The cameras simulated by a `SimCamera`
+pub struct SimulationConfig {
+    /// the number of cameras `Sdk::new` finds
+    pub cameras: u32,
+    /// the width of the sensor in pixels
+    pub width: u32,
+    /// the height of the sensor in pixels
+    pub height: u32,
+    /// the bit depth the cameras start with, 8 or 16
+    pub bits_per_pixel: u32,
+    /// the number of channels of a frame, 1 for mono and raw color frames, 3 for RGB
+    pub channels: u32,
+    /// the pixels per second the sensor reads out at 16 bit, 8 bit reads out twice as fast and binning
+    /// divides the readout time by the factor. `f64::INFINITY` reads out instantly.
+    pub pixel_rate: f64,
+    /// the bytes per second of the USB bus, shared by all simulated cameras like cameras on one host
+    /// controller. `f64::INFINITY` transfers instantly.
+    pub usb_bandwidth: f64,
+    /// the number of stars in the synthetic star field
+    pub stars: u32,
+    /// the seed of the star positions and the noise, the same seed gives the same frames
+    pub seed: u64,
+    /// if every camera reports a filter wheel
+    pub filter_wheel: bool,
+    /// the time the filter wheel takes to move by one slot, it moves the shorter way around
+    pub filter_slot_time: Duration,
+}
+
+impl Default for SimulationConfig {
+    /// a 2 megapixel USB 3 camera at about 100 frames per second
+    fn default() -> Self {
+        Self {
+            cameras: 1,
+            width: 1920,
+            height: 1080,
+            bits_per_pixel: 16,
+            channels: 1,
+            pixel_rate: 200e6,
+            usb_bandwidth: 350e6,
+            stars: 200,
+            seed: 1,
+            filter_wheel: false,
+            filter_slot_time: Duration::from_millis(300),
+        }
+    }
+}
+
+/// the number of control ids a simulated camera keeps values for, the ids of `Control` are all below that
+const CONTROLS: usize = 128;
+
+/// the size of a pixel of the simulated sensor in micrometers
+const PIXEL_SIZE: f64 = 3.76;
+
+/// the exposure time the cameras start with in microseconds
+const DEFAULT_EXPOSURE_US: f64 = 1000.0;
+
+/// the sky background of the star field in 16 bit ADU and the range of the noise on top of it
+const BACKGROUND: u64 = 1000;
+const NOISE: u64 = 64;
+
+/// the standard deviation of the star profiles in sensor pixels
+const STAR_SIGMA: f64 = 1.5;
+
+/// A `Backend` simulating a set of identical cameras with a timing model: an exposure takes the exposure time,
+/// reading the frame out of the sensor takes `SimulationConfig::pixel_rate` and transferring it takes its
+/// share of `SimulationConfig::usb_bandwidth`. Live Video Mode delivers a frame every exposure or readout
+/// time, whichever is longer. Frames show a seeded star field on a noisy background that is rendered once
+/// per geometry, so the cost of a frame is the modeled time plus a memcpy.
+/// # Example
+/// ```
+/// use std::sync::Arc;
+/// use qhyccd_rs::{set_backend, Control, Sdk, SimCamera, SimulationConfig, StreamMode};
+/// let simulator = Arc::new(SimCamera::new(SimulationConfig {
+///     cameras: 8,
+///     width: 640,
+///     height: 480,
+///     ..Default::default()
+/// }));
+/// set_backend(simulator.clone()).expect("set_backend failed");
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// assert_eq!(sdk.cameras().count(), 8);
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// camera.set_stream_mode(StreamMode::SingleFrameMode).expect("set_stream_mode failed");
+/// camera.init().expect("init failed");
+/// camera.set_parameter(Control::Exposure, 5000.0).expect("set_parameter failed");
+/// camera.start_single_frame_exposure().expect("start_single_frame_exposure failed");
+/// let size = camera.get_image_size().expect("get_image_size failed");
+/// let image = camera.get_single_frame(size).expect("get_single_frame failed");
+/// assert_eq!((image.width, image.height), (640, 480));
+/// ```
+#[derive(Debug)]
+pub struct SimCamera {
+    config: Mutex<SimulationConfig>,
+    /// every camera has its own lock, so simulated cameras work in parallel like real ones
+    cameras: RwLock<Vec<Arc<Mutex<SimDevice>>>>,
+    /// when the USB bus is free again
+    bus: Mutex<Instant>,
+}
+
+impl SimCamera {
+    /// Creates the simulator, the cameras appear with the first `Sdk::new`
+    pub fn new(config: SimulationConfig) -> Self {
+        Self {
+            config: Mutex::new(config),
+            cameras: RwLock::new(Vec::new()),
+            bus: Mutex::new(Instant::now()),
+        }
+    }
+
+    /// Changes the simulated cameras, they are replaced by the next `Sdk::new`. Cameras found before keep
+    /// working until then.
+    pub fn configure(&self, config: SimulationConfig) {
+        *lock(&self.config) = config;
+    }
+
+    /// Returns the configuration the next `Sdk::new` uses
+    pub fn config(&self) -> SimulationConfig {
+        lock(&self.config).clone()
+    }
+
+    fn camera_at(&self, index: usize) -> Option<Arc<Mutex<SimDevice>>> {
+        self.cameras
+            .read()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .get(index)
+            .cloned()
+    }
+
+    /// runs `f` on the open camera behind `handle`, handles are the index of the camera plus one so they are
+    /// never null. Unknown and closed cameras give `error`.
+    fn with_camera<T>(
+        &self,
+        handle: QhyccdHandle,
+        error: T,
+        f: impl FnOnce(&mut SimDevice) -> T,
+    ) -> T {
+        match (handle as usize)
+            .checked_sub(1)
+            .and_then(|index| self.camera_at(index))
+        {
+            Some(camera) => {
+                let mut camera = lock(&camera);
+                match camera.open {
+                    true => f(&mut camera),
+                    false => error,
+                }
+            }
+            None => error,
+        }
+    }
+
+    /// waits until `bytes` went over the bus, transfers of all cameras queue up behind each other
+    fn transfer(&self, bandwidth: f64, bytes: usize) {
+        let duration = seconds(bytes as f64 / bandwidth);
+        if duration.is_zero() {
+            return;
+        }
+        let done = {
+            let mut free = lock(&self.bus);
+            let start = (*free).max(Instant::now());
+            *free = start + duration;
+            *free
+        };
+        sleep_until(done);
+    }
+}
+
+impl Default for SimCamera {
+    fn default() -> Self {
+        Self::new(SimulationConfig::default())
+    }
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    // the simulation state stays consistent after a panic, every change is a single assignment
+    mutex
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// `Duration::ZERO` for infinite rates, which give 0 seconds, and for nonsensical ones
+fn seconds(seconds: f64) -> Duration {
+    Duration::try_from_secs_f64(seconds).unwrap_or(Duration::ZERO)
+}
+
+fn sleep_until(deadline: Instant) {
+    let now = Instant::now();
+    if deadline > now {
+        thread::sleep(deadline - now);
+    }
+}
+
+/// splitmix64, good enough for noise and star positions and the same on every platform
+#[derive(Debug)]
+struct Rng(u64);
+
+impl Rng {
+    fn next(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(0x9e37_79b9_7f4a_7c15);
+        let mut z = self.0;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+        z ^ (z >> 31)
+    }
+
+    /// uniform in [0, 1)
+    fn unit(&mut self) -> f64 {
+        (self.next() >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+struct Star {
+    /// the center in sensor pixels
+    x: f64,
+    y: f64,
+    /// the total signal in 16 bit ADU
+    flux: f64,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct SimControl {
+    value: f64,
+    min: f64,
+    max: f64,
+    step: f64,
+}
+
+#[derive(Debug)]
+struct SimDevice {
+    id: String,
+    config: SimulationConfig,
+    open: bool,
+    controls: Vec<Option<SimControl>>,
+    bits: u32,
+    bin: u32,
+    /// start x, start y, width, height in binned pixels
+    roi: (u32, u32, u32, u32),
+    live: bool,
+    next_live_frame: Instant,
+    exposure_started: Option<Instant>,
+    /// when the filter wheel reaches the slot in `Control::CfwPort`
+    filter_arrives: Instant,
+    stars: Vec<Star>,
+    /// the pixels of the current geometry, copied into the caller's buffer like the SDK copies the USB
+    /// transfer, so filling a frame costs a memcpy and not the rendering
+    frame: Vec<u8>,
+    /// `true` if the geometry changed since `frame` was rendered
+    stale: bool,
+}
+
+impl SimDevice {
+    fn new(index: u32, config: &SimulationConfig) -> Self {
+        let mut rng = Rng(config.seed ^ ((index as u64) << 32));
+        let stars = (0..config.stars)
+            .map(|_| Star {
+                x: rng.unit() * config.width as f64,
+                y: rng.unit() * config.height as f64,
+                // mostly faint stars and a few bright ones, log uniform from 2e4 to 2e6 ADU
+                flux: 2e4 * 100f64.powf(rng.unit()),
+            })
+            .collect();
+        let mut camera = Self {
+            id: format!("SIM-{index:04}"),
+            config: config.clone(),
+            open: false,
+            controls: vec![None; CONTROLS],
+            bits: config.bits_per_pixel,
+            bin: 1,
+            roi: (0, 0, config.width, config.height),
+            live: false,
+            next_live_frame: Instant::now(),
+            exposure_started: None,
+            filter_arrives: Instant::now(),
+            stars,
+            frame: Vec::new(),
+            stale: true,
+        };
+        let mut control = |control: Control, value: f64, min: f64, max: f64, step: f64| {
+            camera.controls[control as usize] = Some(SimControl {
+                value,
+                min,
+                max,
+                step,
+            });
+        };
+        control(Control::Gain, 0.0, 0.0, 100.0, 1.0);
+        control(Control::Offset, 10.0, 0.0, 255.0, 1.0);
+        control(Control::Exposure, DEFAULT_EXPOSURE_US, 1.0, 3.6e9, 1.0);
+        control(Control::Speed, 0.0, 0.0, 2.0, 1.0);
+        control(Control::UsbTraffic, 0.0, 0.0, 255.0, 1.0);
+        control(
+            Control::TransferBit,
+            config.bits_per_pixel as f64,
+            8.0,
+            16.0,
+            8.0,
+        );
+        control(Control::CurTemp, 20.0, -50.0, 50.0, 0.1);
+        control(Control::Cooler, 0.0, -50.0, 50.0, 0.1);
+        for flag in [
+            Control::Cam8bits,
+            Control::Cam16bits,
+            Control::CamBin1x1mode,
+            Control::CamBin2x2mode,
+            Control::CamBin3x3mode,
+            Control::CamBin4x4mode,
+            Control::CamSingleFrameMode,
+            Control::CamLiveVideoMode,
+        ] {
+            control(flag, 0.0, 0.0, 0.0, 0.0);
+        }
+        if config.filter_wheel {
+            // the position is the ASCII code of the slot number, like the real wheels report it
+            control(Control::CfwPort, 48.0, 48.0, 54.0, 1.0);
+            control(Control::CfwSlotsNum, 7.0, 7.0, 7.0, 1.0);
+        }
+        camera
+    }
+
+    fn control(&self, id: u32) -> Option<&SimControl> {
+        self.controls.get(id as usize).and_then(Option::as_ref)
+    }
+
+    fn bytes_per_sample(&self) -> usize {
+        match self.bits {
+            8 => 1,
+            _ => 2,
+        }
+    }
+
+    fn frame_len(&self) -> usize {
+        let (_, _, width, height) = self.roi;
+        width as usize * height as usize * self.config.channels as usize * self.bytes_per_sample()
+    }
+
+    /// renders the star field for the current bit depth, binning and ROI. Binning sums the signal of the
+    /// binned pixels, so stars get brighter and smaller like with hardware binning.
+    fn render(&mut self) {
+        let (start_x, start_y, width, height) = self.roi;
+        let (width, height) = (width as usize, height as usize);
+        let bin = self.bin as f64;
+        let mut rng = Rng(self.config.seed.wrapping_mul(31) ^ self.frame_len() as u64);
+        let binned = (self.bin * self.bin) as u64;
+        let mut signal: Vec<f64> = (0..width * height)
+            .map(|_| {
+                let noise = (0..binned).map(|_| rng.next() % NOISE).sum::<u64>();
+                (BACKGROUND * binned + noise) as f64
+            })
+            .collect();
+        let sigma = (STAR_SIGMA / bin).max(0.5);
+        let radius = (4.0 * sigma).ceil() as isize;
+        let peak_scale = 1.0 / (2.0 * std::f64::consts::PI * sigma * sigma);
+        for star in &self.stars {
+            let center_x = star.x / bin - start_x as f64;
+            let center_y = star.y / bin - start_y as f64;
+            let (pixel_x, pixel_y) = (center_x.round() as isize, center_y.round() as isize);
+            for y in (pixel_y - radius).max(0)..(pixel_y + radius + 1).min(height as isize) {
+                for x in (pixel_x - radius).max(0)..(pixel_x + radius + 1).min(width as isize) {
+                    let distance = (x as f64 - center_x).powi(2) + (y as f64 - center_y).powi(2);
+                    signal[y as usize * width + x as usize] +=
+                        star.flux * peak_scale * (-distance / (2.0 * sigma * sigma)).exp();
+                }
+            }
+        }
+        let channels = self.config.channels as usize;
+        let mut frame = Vec::with_capacity(self.frame_len());
+        for value in signal {
+            let value = value.min(u16::MAX as f64) as u16;
+            for _ in 0..channels {
+                match self.bits {
+                    8 => frame.push((value >> 8) as u8),
+                    _ => frame.extend_from_slice(&value.to_ne_bytes()),
+                }
+            }
+        }
+        self.frame = frame;
+        self.stale = false;
+    }
+
+    /// the size of the largest frame, the SDK reports it for 16 bit and no binning
+    fn mem_length(&self) -> u32 {
+        self.config.width * self.config.height * self.config.channels * 2
+    }
+
+    fn exposure(&self) -> Duration {
+        let us = self
+            .control(Control::Exposure as u32)
+            .map_or(DEFAULT_EXPOSURE_US, |control| control.value);
+        Duration::from_micros(us as u64)
+    }
+
+    /// the time the sensor needs to read out the ROI with the current bit depth and binning
+    fn readout(&self) -> Duration {
+        let (_, _, width, height) = self.roi;
+        let sensor_pixels = (width * self.bin) as f64 * (height * self.bin) as f64;
+        let rate = self.config.pixel_rate * self.bin as f64 * (16 / self.bits.clamp(8, 16)) as f64;
+        seconds(sensor_pixels / rate)
+    }
+
+    /// exposure and readout overlap in Live Video Mode, so the slower one sets the frame rate
+    fn live_period(&self) -> Duration {
+        self.exposure().max(self.readout())
+    }
+
+    /// # Safety
+    /// the pointers have to be valid and `data` large enough for `frame_len` bytes
+    unsafe fn copy_frame(
+        &mut self,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        data: *mut u8,
+    ) {
+        if self.stale {
+            self.render();
+        }
+        let (_, _, width, height) = self.roi;
+        *w = width;
+        *h = height;
+        *bpp = self.bits;
+        *channels = self.config.channels;
+        std::ptr::copy_nonoverlapping(self.frame.as_ptr(), data, self.frame.len());
+    }
+}
+
+/// copies `text` into a C string buffer of at least 32 bytes
+unsafe fn write_c_str(text: &str, out: *mut c_char) {
+    let len = text.len().min(31);
+    std::ptr::copy_nonoverlapping(text.as_ptr() as *const c_char, out, len);
+    *out.add(len) = 0;
+}
+
+#[allow(non_snake_case, clippy::too_many_arguments)]
+impl Backend for SimCamera {
+    unsafe fn InitQHYCCDResource(&self) -> u32 {
+        QHYCCD_SUCCESS
+    }
+
+    unsafe fn ScanQHYCCD(&self) -> u32 {
+        let config = self.config();
+        let mut cameras = self
+            .cameras
+            .write()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        *cameras = (0..config.cameras)
+            .map(|index| Arc::new(Mutex::new(SimDevice::new(index, &config))))
+            .collect();
+        config.cameras
+    }
+
+    unsafe fn GetQHYCCDSDKVersion(
+        &self,
+        year: *mut u32,
+        month: *mut u32,
+        day: *mut u32,
+        subday: *mut u32,
+    ) -> u32 {
+        *year = 24;
+        *month = 1;
+        *day = 1;
+        *subday = 0;
+        QHYCCD_SUCCESS
+    }
+
+    unsafe fn GetQHYCCDId(&self, index: u32, id: *mut c_char) -> u32 {
+        match self.camera_at(index as usize) {
+            Some(camera) => {
+                write_c_str(&lock(&camera).id, id);
+                QHYCCD_SUCCESS
+            }
+            None => QHYCCD_ERROR,
+        }
+    }
+
+    unsafe fn OpenQHYCCD(&self, id: *const c_char) -> QhyccdHandle {
+        let id = match CStr::from_ptr(id).to_str() {
+            Ok(id) => id,
+            Err(_) => return std::ptr::null(),
+        };
+        let cameras = self
+            .cameras
+            .read()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        for (index, camera) in cameras.iter().enumerate() {
+            let mut camera = lock(camera);
+            if camera.id == id {
+                camera.open = true;
+                return (index + 1) as QhyccdHandle;
+            }
+        }
+        std::ptr::null()
+    }
+
+    unsafe fn GetQHYCCDFWVersion(&self, h: QhyccdHandle, buf: *mut u8) -> u32 {
+        self.with_camera(h, QHYCCD_ERROR, |_| {
+            // 2024, January 1st in the packed format of the SDK
+            *buf = (0x2 << 4) | 0x1;
+            *buf.add(1) = 1;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn IsQHYCCDControlAvailable(&self, h: QhyccdHandle, controlId: u32) -> u32 {
+        self.with_camera(h, QHYCCD_ERROR, |camera| match camera.control(controlId) {
+            Some(_) => QHYCCD_SUCCESS,
+            None => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn SetQHYCCDReadMode(&self, h: QhyccdHandle, mode: u32) -> u32 {
+        self.with_camera(h, QHYCCD_ERROR, |_| match mode {
+            0 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn SetQHYCCDStreamMode(&self, h: QhyccdHandle, mode: u8) -> u32 {
+        self.with_camera(h, QHYCCD_ERROR, |_| match mode {
+            0 | 1 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn InitQHYCCD(&self, h: QhyccdHandle) -> u32 {
+        self.with_camera(h, QHYCCD_ERROR, |_| QHYCCD_SUCCESS)
+    }
+
+    unsafe fn GetQHYCCDChipInfo(
+        &self,
+        handle: QhyccdHandle,
+        chipw: *mut f64,
+        chiph: *mut f64,
+        imagew: *mut u32,
+        imageh: *mut u32,
+        pixelw: *mut f64,
+        pixelh: *mut f64,
+        bpp: *mut u32,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            *chipw = camera.config.width as f64 * PIXEL_SIZE / 1000.0;
+            *chiph = camera.config.height as f64 * PIXEL_SIZE / 1000.0;
+            *imagew = camera.config.width;
+            *imageh = camera.config.height;
+            *pixelw = PIXEL_SIZE;
+            *pixelh = PIXEL_SIZE;
+            *bpp = camera.bits;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn SetQHYCCDBitsMode(&self, handle: QhyccdHandle, bits: u32) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| match bits {
+            8 | 16 => {
+                camera.bits = bits;
+                camera.stale = true;
+                QHYCCD_SUCCESS
+            }
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn SetQHYCCDDebayerOnOff(&self, handle: QhyccdHandle, _onoff: bool) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| QHYCCD_SUCCESS)
+    }
+
+    /// resets the ROI to the whole binned sensor
+    unsafe fn SetQHYCCDBinMode(&self, handle: QhyccdHandle, wbin: u32, hbin: u32) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| match (wbin, hbin) {
+            (bin @ 1..=4, hbin) if hbin == bin => {
+                camera.bin = bin;
+                camera.roi = (0, 0, camera.config.width / bin, camera.config.height / bin);
+                camera.stale = true;
+                QHYCCD_SUCCESS
+            }
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn SetQHYCCDResolution(
+        &self,
+        handle: QhyccdHandle,
+        x: u32,
+        y: u32,
+        xsize: u32,
+        ysize: u32,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            let width = camera.config.width / camera.bin;
+            let height = camera.config.height / camera.bin;
+            let fits = |start: u32, size: u32, max: u32| {
+                size > 0 && start.checked_add(size).is_some_and(|end| end <= max)
+            };
+            match fits(x, xsize, width) && fits(y, ysize, height) {
+                true => {
+                    camera.roi = (x, y, xsize, ysize);
+                    camera.stale = true;
+                    QHYCCD_SUCCESS
+                }
+                false => QHYCCD_ERROR,
+            }
+        })
+    }
+
+    unsafe fn GetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32) -> f64 {
+        self.with_camera(handle, QHYCCD_ERROR_F64, |camera| {
+            camera
+                .control(controlId)
+                .map_or(QHYCCD_ERROR_F64, |control| control.value)
+        })
+    }
+
+    unsafe fn SetQHYCCDParam(&self, handle: QhyccdHandle, controlId: u32, value: f64) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            let slots = camera
+                .control(Control::CfwSlotsNum as u32)
+                .map_or(1.0, |control| control.value);
+            let slot_time = camera.config.filter_slot_time;
+            match camera
+                .controls
+                .get_mut(controlId as usize)
+                .and_then(Option::as_mut)
+            {
+                Some(control) if (control.min..=control.max).contains(&value) => {
+                    if controlId == Control::CfwPort as u32 {
+                        let distance = (value - control.value).abs();
+                        camera.filter_arrives =
+                            Instant::now() + slot_time.mul_f64(distance.min(slots - distance));
+                    }
+                    control.value = value;
+                    QHYCCD_SUCCESS
+                }
+                _ => QHYCCD_ERROR,
+            }
+        })
+    }
+
+    unsafe fn BeginQHYCCDLive(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.live = true;
+            camera.next_live_frame = Instant::now() + camera.live_period();
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn GetQHYCCDMemLength(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| camera.mem_length())
+    }
+
+    /// returns `QHYCCD_ERROR` until the next frame is read out, then waits for the transfer
+    unsafe fn GetQHYCCDLiveFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            let now = Instant::now();
+            if !camera.live || now < camera.next_live_frame {
+                return QHYCCD_ERROR;
+            }
+            // a consumer that fell behind gets the latest frame, not a burst of old ones
+            let next = camera.next_live_frame + camera.live_period();
+            camera.next_live_frame = next.max(now);
+            self.transfer(camera.config.usb_bandwidth, camera.frame_len());
+            camera.copy_frame(w, h, bpp, channels, imgdata);
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn StopQHYCCDLive(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.live = false;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn CloseQHYCCD(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.open = false;
+            camera.live = false;
+            camera.exposure_started = None;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn ReleaseQHYCCDResource(&self) -> u32 {
+        QHYCCD_SUCCESS
+    }
+
+    unsafe fn GetQHYCCDOverScanArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| {
+            *startx = 0;
+            *starty = 0;
+            *sizex = 0;
+            *sizey = 0;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn GetQHYCCDEffectiveArea(
+        &self,
+        handle: QhyccdHandle,
+        startx: *mut u32,
+        starty: *mut u32,
+        sizex: *mut u32,
+        sizey: *mut u32,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            *startx = 0;
+            *starty = 0;
+            *sizex = camera.config.width;
+            *sizey = camera.config.height;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn ExpQHYCCDSingleFrame(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.exposure_started = Some(Instant::now());
+            QHYCCD_SUCCESS
+        })
+    }
+
+    /// blocks until the exposure started by `ExpQHYCCDSingleFrame` is read out, without holding the camera
+    /// so it can still be stopped, then waits for the transfer
+    unsafe fn GetQHYCCDSingleFrame(
+        &self,
+        handle: QhyccdHandle,
+        w: *mut u32,
+        h: *mut u32,
+        bpp: *mut u32,
+        channels: *mut u32,
+        imgdata: *mut u8,
+    ) -> u32 {
+        let read_out = self.with_camera(handle, None, |camera| {
+            camera
+                .exposure_started
+                .map(|started| started + camera.exposure() + camera.readout())
+        });
+        let Some(read_out) = read_out else {
+            return QHYCCD_ERROR;
+        };
+        sleep_until(read_out);
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            match camera.exposure_started.take() {
+                Some(_) => {
+                    self.transfer(camera.config.usb_bandwidth, camera.frame_len());
+                    camera.copy_frame(w, h, bpp, channels, imgdata);
+                    QHYCCD_SUCCESS
+                }
+                None => QHYCCD_ERROR,
+            }
+        })
+    }
+
+    unsafe fn GetQHYCCDNumberOfReadModes(&self, handle: QhyccdHandle, num_modes: *mut u32) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| {
+            *num_modes = 1;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn GetQHYCCDReadModeResolution(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        width: *mut u32,
+        height: *mut u32,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| match mode {
+            0 => {
+                *width = camera.config.width;
+                *height = camera.config.height;
+                QHYCCD_SUCCESS
+            }
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn GetQHYCCDReadModeName(
+        &self,
+        handle: QhyccdHandle,
+        mode: u32,
+        name: *mut c_char,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| match mode {
+            0 => {
+                write_c_str("STANDARD MODE", name);
+                QHYCCD_SUCCESS
+            }
+            _ => QHYCCD_ERROR,
+        })
+    }
+
+    unsafe fn GetQHYCCDReadMode(&self, handle: QhyccdHandle, mode: *mut u32) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| {
+            *mode = 0;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn GetQHYCCDModel(&self, handle: QhyccdHandle, model: *mut c_char) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| {
+            write_c_str("QHY-SIM", model);
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn GetQHYCCDType(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |_| 4000)
+    }
+
+    unsafe fn GetQHYCCDExposureRemaining(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            match camera.exposure_started {
+                Some(started) => {
+                    let done = started + camera.exposure();
+                    done.saturating_duration_since(Instant::now()).as_micros() as u32
+                }
+                None => 0,
+            }
+        })
+    }
+
+    unsafe fn CancelQHYCCDExposing(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.exposure_started = None;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn CancelQHYCCDExposingAndReadout(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            camera.exposure_started = None;
+            QHYCCD_SUCCESS
+        })
+    }
+
+    unsafe fn IsQHYCCDCFWPlugged(&self, handle: QhyccdHandle) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            match camera.config.filter_wheel {
+                true => QHYCCD_SUCCESS,
+                false => QHYCCD_ERROR,
+            }
+        })
+    }
+
+    /// the ASCII digit of the slot once the wheel arrived, `N` while it is moving
+    unsafe fn GetQHYCCDCFWStatus(&self, handle: QhyccdHandle, status: *mut c_char) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            match camera.control(Control::CfwPort as u32) {
+                Some(control) => {
+                    *status = match Instant::now() >= camera.filter_arrives {
+                        true => control.value as u8 as c_char,
+                        false => b'N' as c_char,
+                    };
+                    *status.add(1) = 0;
+                    QHYCCD_SUCCESS
+                }
+                None => QHYCCD_ERROR,
+            }
+        })
+    }
+
+    unsafe fn GetQHYCCDParamMinMaxStep(
+        &self,
+        handle: QhyccdHandle,
+        controlId: u32,
+        min: *mut f64,
+        max: *mut f64,
+        step: *mut f64,
+    ) -> u32 {
+        self.with_camera(handle, QHYCCD_ERROR, |camera| {
+            match camera.control(controlId) {
+                Some(control) => {
+                    *min = control.min;
+                    *max = control.max;
+                    *step = control.step;
+                    QHYCCD_SUCCESS
+                }
+                None => QHYCCD_ERROR,
+            }
+        })
+    }
+}
@@ -0,0 +1,340 @@
+use std::fmt::Debug;
+use std::sync::atomic::{fence, AtomicBool, AtomicU64, Ordering};
+use std::sync::Arc;
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use eyre::{eyre, Result};
+
+use crate::worker::Executor;
+use crate::QHYError::CameraNotOpenError;
+use crate::{Camera, CameraWorker, Control, Priority};
+
+/// stands for a value that is not available or could not be read, as f64 bits this is a NaN
+const NONE: u64 = u64::MAX;
+
+/// the controls sampled with one `read_many` per sample
+const CONTROLS: [Control; 4] = [
+    Control::CurTemp,
+    Control::CurPWM,
+    Control::Cooler,
+    Control::CfwPort,
+];
+
+/// the slots of a snapshot in `Slot`
+#[derive(Clone, Copy)]
+enum Field {
+    Temperature,
+    CoolerPwm,
+    CoolerTarget,
+    FilterPosition,
+    RemainingExposure,
+    SampledAt,
+    Samples,
+}
+
+const FIELDS: usize = Field::Samples as usize + 1;
+
+#[derive(Debug, Clone)]
+/// Options for `Camera::start_telemetry`
+pub struct TelemetryOptions {
+    /// the time between two samples
+    pub interval: Duration,
+    /// also sample the filter wheel position if the camera has a filter wheel port
+    pub filter_wheel: bool,
+}
+
+impl Default for TelemetryOptions {
+    fn default() -> Self {
+        Self {
+            interval: Duration::from_millis(500),
+            filter_wheel: true,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+/// The latest values sampled by a `TelemetryPoller`. Values the camera does not support or that could not be
+/// read in the last sample are `None`.
+pub struct Telemetry {
+    /// `Control::CurTemp`, the sensor temperature in degrees Celsius
+    pub temperature: Option<f64>,
+    /// `Control::CurPWM`, the power of the cooler from 0 to 255
+    pub cooler_pwm: Option<f64>,
+    /// `Control::Cooler`, the target temperature of the cooler in degrees Celsius
+    pub cooler_target: Option<f64>,
+    /// the filter wheel position as returned by `FilterWheel::get_fw_position`
+    pub filter_position: Option<u32>,
+    /// as returned by `Camera::get_remaining_exposure_us`
+    pub remaining_exposure_us: Option<u32>,
+    /// when the values were sampled, `None` before the first sample
+    pub sampled_at: Option<SystemTime>,
+    /// the number of samples taken so far
+    pub samples: u64,
+}
+
+/// A seqlock over the fields of a `Telemetry` snapshot. There is a single writer, the poller thread. Readers
+/// never block the writer and retry only if they raced with a write, which takes a few nanoseconds.
+#[derive(Debug)]
+struct Slot {
+    /// odd while a write is in progress
+    sequence: AtomicU64,
+    fields: [AtomicU64; FIELDS],
+}
+
+impl Slot {
+    fn new() -> Self {
+        let slot = Self {
+            sequence: AtomicU64::new(0),
+            fields: std::array::from_fn(|_| AtomicU64::new(NONE)),
+        };
+        slot.fields[Field::Samples as usize].store(0, Ordering::Relaxed);
+        slot
+    }
+
+    fn write(&self, fields: [u64; FIELDS]) {
+        let sequence = self.sequence.load(Ordering::Relaxed);
+        self.sequence.store(sequence + 1, Ordering::Relaxed);
+        fence(Ordering::Release);
+        for (slot, value) in self.fields.iter().zip(fields) {
+            slot.store(value, Ordering::Relaxed);
+        }
+        self.sequence.store(sequence + 2, Ordering::Release);
+    }
+
+    fn read(&self) -> [u64; FIELDS] {
+        loop {
+            let before = self.sequence.load(Ordering::Acquire);
+            if before % 2 == 1 {
+                std::hint::spin_loop();
+                continue;
+            }
+            let fields = std::array::from_fn(|index| self.fields[index].load(Ordering::Relaxed));
+            fence(Ordering::Acquire);
+            if self.sequence.load(Ordering::Relaxed) == before {
+                return fields;
+            }
+        }
+    }
+}
+
+fn to_f64(bits: u64) -> Option<f64> {
+    (bits != NONE).then(|| f64::from_bits(bits))
+}
+
+fn to_u32(bits: u64) -> Option<u32> {
+    (bits != NONE).then_some(bits as u32)
+}
+
+impl From<[u64; FIELDS]> for Telemetry {
+    fn from(fields: [u64; FIELDS]) -> Self {
+        Self {
+            temperature: to_f64(fields[Field::Temperature as usize]),
+            cooler_pwm: to_f64(fields[Field::CoolerPwm as usize]),
+            cooler_target: to_f64(fields[Field::CoolerTarget as usize]),
+            filter_position: to_u32(fields[Field::FilterPosition as usize]),
+            remaining_exposure_us: to_u32(fields[Field::RemainingExposure as usize]),
+            sampled_at: match fields[Field::SampledAt as usize] {
+                NONE => None,
+                us => Some(UNIX_EPOCH + Duration::from_micros(us)),
+            },
+            samples: fields[Field::Samples as usize],
+        }
+    }
+}
+
+#[derive(Debug)]
+struct Shared {
+    running: AtomicBool,
+    slot: Slot,
+}
+
+#[derive(Debug, Clone)]
+/// A cheap handle to the latest `Telemetry` of a `TelemetryPoller`, clone it for every thread that watches the
+/// camera. Reading never calls the SDK and never takes a lock. After the poller stopped it keeps returning the
+/// last sample.
+pub struct TelemetryReader {
+    shared: Arc<Shared>,
+}
+
+impl TelemetryReader {
+    /// Returns the latest sample
+    pub fn latest(&self) -> Telemetry {
+        Telemetry::from(self.shared.slot.read())
+    }
+}
+
+/// A thread sampling the temperature, the cooler, the remaining exposure time and the filter wheel position
+/// of a camera at a fixed rate, see `Camera::start_telemetry`. Observers read the latest sample through a
+/// `TelemetryReader` instead of calling the SDK themselves, so any number of them costs the camera one set of
+/// SDK calls per interval. Started with `CameraWorker::start_telemetry` the samples are queued on the worker
+/// with `Priority::Telemetry`, otherwise the thread calls the camera directly. Stopping or dropping the poller
+/// joins the thread, it also ends once the worker stopped.
+pub struct TelemetryPoller {
+    camera: Camera,
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl TelemetryPoller {
+    pub(crate) fn start(executor: Executor, options: TelemetryOptions) -> Result<Self> {
+        let filter_wheel = options.filter_wheel;
+        // availability does not change while the camera is open, so it is only checked once
+        let controls: Arc<[Control]> = executor.run(Priority::Telemetry, move |camera| {
+            if !camera.is_open()? {
+                tracing::error!(error = ?CameraNotOpenError);
+                return Err(eyre!(CameraNotOpenError));
+            }
+            Ok(CONTROLS
+                .into_iter()
+                .filter(|&control| control != Control::CfwPort || filter_wheel)
+                .filter(|&control| camera.is_control_available(control).is_some())
+                .collect())
+        })?;
+        let shared = Arc::new(Shared {
+            running: AtomicBool::new(true),
+            slot: Slot::new(),
+        });
+        let camera = executor.camera().clone();
+        let thread = {
+            let shared = shared.clone();
+            thread::Builder::new()
+                .name(format!("qhyccd-telemetry-{}", camera.id()))
+                .spawn(move || poll(executor, controls, shared, options.interval))
+        };
+        match thread {
+            Ok(thread) => Ok(Self {
+                camera,
+                shared,
+                thread: Some(thread),
+            }),
+            Err(error) => {
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// Returns the latest sample
+    pub fn latest(&self) -> Telemetry {
+        Telemetry::from(self.shared.slot.read())
+    }
+
+    /// Returns a handle other threads can read the latest sample from
+    pub fn reader(&self) -> TelemetryReader {
+        TelemetryReader {
+            shared: self.shared.clone(),
+        }
+    }
+
+    /// Returns the camera this poller samples
+    pub fn camera(&self) -> &Camera {
+        &self.camera
+    }
+
+    /// Stops the thread, readers keep the last sample
+    pub fn stop(mut self) {
+        self.shutdown()
+    }
+
+    fn shutdown(&mut self) {
+        let Some(thread) = self.thread.take() else {
+            return;
+        };
+        self.shared.running.store(false, Ordering::Release);
+        thread.thread().unpark();
+        if thread.join().is_err() {
+            tracing::error!("telemetry thread panicked");
+        }
+    }
+}
+
+impl Debug for TelemetryPoller {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("TelemetryPoller")
+            .field("camera", &self.camera)
+            .field("latest", &self.latest())
+            .finish()
+    }
+}
+
+impl Drop for TelemetryPoller {
+    fn drop(&mut self) {
+        self.shutdown()
+    }
+}
+
+fn poll(executor: Executor, controls: Arc<[Control]>, shared: Arc<Shared>, interval: Duration) {
+    let mut samples = 0;
+    while shared.running.load(Ordering::Acquire) {
+        let sample = {
+            let controls = controls.clone();
+            executor.run(Priority::Telemetry, move |camera| {
+                Ok((
+                    camera.read_many(&controls),
+                    camera.get_remaining_exposure_us(),
+                ))
+            })
+        };
+        // only fails once the worker stopped, readers keep the last sample
+        let Ok((values, remaining)) = sample else {
+            break;
+        };
+        let mut fields = [NONE; FIELDS];
+        for (control, value) in controls.iter().zip(values) {
+            let Ok(value) = value else {
+                continue;
+            };
+            match control {
+                Control::CurTemp => fields[Field::Temperature as usize] = value.to_bits(),
+                Control::CurPWM => fields[Field::CoolerPwm as usize] = value.to_bits(),
+                Control::Cooler => fields[Field::CoolerTarget as usize] = value.to_bits(),
+                //the parameter uses ASCII values to represent the position
+                _ => fields[Field::FilterPosition as usize] = (value - 48_f64) as u64,
+            }
+        }
+        if let Ok(remaining) = remaining {
+            fields[Field::RemainingExposure as usize] = remaining as u64;
+        }
+        samples += 1;
+        fields[Field::SampledAt as usize] = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map_or(0, |now| now.as_micros() as u64);
+        fields[Field::Samples as usize] = samples;
+        shared.slot.write(fields);
+        // woken early by `stop`
+        thread::park_timeout(interval);
+    }
+}
+
+impl Camera {
+    /// Starts a thread that samples `CurTemp`, `CurPWM`, `Cooler`, the remaining exposure time and the filter
+    /// wheel position every `interval`, the first sample is taken right away. The values are read with a
+    /// `TelemetryReader` from any thread without calling the SDK, so UIs and schedulers polling at a high
+    /// rate do not compete with the frame readout for the camera.
+    /// # Example
+    /// ```no_run
+    /// use qhyccd_rs::{Sdk,TelemetryOptions};
+    /// let sdk = Sdk::new().expect("SDK::new failed");
+    /// let camera = sdk.cameras().last().expect("no camera found");
+    /// camera.open().expect("open failed");
+    /// let poller = camera.start_telemetry(TelemetryOptions::default()).expect("start_telemetry failed");
+    /// let reader = poller.reader();
+    /// std::thread::spawn(move || loop {
+    ///     let telemetry = reader.latest();
+    ///     println!("{:?}°C at {:?} PWM", telemetry.temperature, telemetry.cooler_pwm);
+    ///     std::thread::sleep(std::time::Duration::from_millis(100));
+    /// });
+    /// ```
+    pub fn start_telemetry(&self, options: TelemetryOptions) -> Result<TelemetryPoller> {
+        TelemetryPoller::start(Executor::Direct(self.clone()), options)
+    }
+}
+
+impl CameraWorker {
+    /// Like `Camera::start_telemetry`, but the samples are queued on this worker with `Priority::Telemetry`
+    /// and wait behind the frame readout and the controls
+    pub fn start_telemetry(&self, options: TelemetryOptions) -> Result<TelemetryPoller> {
+        TelemetryPoller::start(self.executor(), options)
+    }
+}
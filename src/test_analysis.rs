@@ -0,0 +1,184 @@
+use super::*;
+
+fn image_u16(samples: &[u16], width: u32, height: u32) -> ImageData {
+    ImageData {
+        data: samples
+            .iter()
+            .flat_map(|sample| sample.to_le_bytes())
+            .collect(),
+        width,
+        height,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+/// gaussian stars with `(x, y, amplitude)` and the given sigma on a background of 1000 with a little
+/// deterministic noise
+fn star_field(width: u32, height: u32, stars: &[(f64, f64, f64)], sigma: f64) -> ImageData {
+    let samples: Vec<u16> = (0..width * height)
+        .map(|index| {
+            let (x, y) = ((index % width) as f64, (index / width) as f64);
+            let light: f64 = stars
+                .iter()
+                .map(|&(star_x, star_y, amplitude)| {
+                    let squared = (x - star_x).powi(2) + (y - star_y).powi(2);
+                    amplitude * (-squared / (2.0 * sigma * sigma)).exp()
+                })
+                .sum();
+            (1000 + index * 7919 % 11) as u16 + light as u16
+        })
+        .collect();
+    image_u16(&samples, width, height)
+}
+
+#[test]
+fn histogram_counts_16_bit_samples() {
+    //given
+    let image = image_u16(&[0, 1000, 1000, 65535], 2, 2);
+    //when
+    let histogram = image.histogram().unwrap();
+    //then
+    assert_eq!(histogram.bins().len(), 65536);
+    assert_eq!(histogram.count(), 4);
+    assert_eq!(histogram.bins()[1000], 2);
+    assert_eq!((histogram.min(), histogram.max()), (Some(0), Some(65535)));
+    assert_eq!(histogram.median(), 1000);
+}
+
+#[test]
+fn stats_of_a_large_image_match_a_direct_computation() {
+    //given
+    let samples: Vec<u16> = (0..512 * 300_u32)
+        .map(|index| (index % 4099) as u16)
+        .collect();
+    let image = image_u16(&samples, 512, 300);
+    //when
+    let stats = image.stats().unwrap();
+    //then
+    let count = samples.len() as f64;
+    let mean = samples.iter().map(|&sample| sample as f64).sum::<f64>() / count;
+    let variance = samples
+        .iter()
+        .map(|&sample| (sample as f64 - mean).powi(2))
+        .sum::<f64>()
+        / count;
+    let mut sorted = samples.clone();
+    sorted.sort_unstable();
+    assert_eq!(stats.count, samples.len() as u64);
+    assert_eq!((stats.min, stats.max), (0, 4098));
+    assert!((stats.mean - mean).abs() < 1e-6);
+    assert!((stats.stddev - variance.sqrt()).abs() < 1e-6);
+    assert_eq!(stats.median, sorted[sorted.len().div_ceil(2) - 1]);
+}
+
+#[test]
+fn stats_of_a_view() {
+    //given
+    #[rustfmt::skip]
+    let image = image_u16(&[
+        9, 9, 9,
+        9, 1, 3,
+        9, 5, 7,
+    ], 3, 3);
+    let view = image
+        .view(CCDChipArea {
+            start_x: 1,
+            start_y: 1,
+            width: 2,
+            height: 2,
+        })
+        .unwrap();
+    //when
+    let stats = view.stats().unwrap();
+    //then
+    assert_eq!((stats.min, stats.max, stats.median), (1, 7, 3));
+    assert_eq!(stats.mean, 4.0);
+}
+
+#[test]
+fn detect_stars_measures_centroid_and_fwhm() {
+    //given
+    let sigma = 1.5;
+    let image = star_field(
+        128,
+        96,
+        &[(30.25, 40.5, 20000.0), (90.0, 60.75, 8000.0)],
+        sigma,
+    );
+    //when
+    let stars = image.detect_stars(&StarOptions::default()).unwrap();
+    //then
+    assert_eq!(stars.len(), 2);
+    // brightest first
+    assert!((stars[0].x - 30.25).abs() < 0.05, "{:?}", stars[0]);
+    assert!((stars[0].y - 40.5).abs() < 0.05, "{:?}", stars[0]);
+    assert!((stars[1].x - 90.0).abs() < 0.05, "{:?}", stars[1]);
+    assert!((stars[1].y - 60.75).abs() < 0.05, "{:?}", stars[1]);
+    for star in &stars {
+        let fwhm = 2.3548 * sigma;
+        assert!((star.fwhm - fwhm).abs() < 0.1 * fwhm, "{:?}", star);
+        // the mean distance of a 2d gaussian is sigma sqrt(pi / 2)
+        let hfr = sigma * (std::f64::consts::PI / 2.0).sqrt();
+        assert!((star.hfr - hfr).abs() < 0.1 * hfr, "{:?}", star);
+    }
+    assert!(stars[0].flux > stars[1].flux);
+}
+
+#[test]
+fn detect_stars_in_a_view_and_limited() {
+    //given
+    let image = star_field(128, 96, &[(30.0, 40.0, 20000.0), (90.0, 60.0, 8000.0)], 1.5);
+    let view = image
+        .view(CCDChipArea {
+            start_x: 64,
+            start_y: 32,
+            width: 64,
+            height: 64,
+        })
+        .unwrap();
+    //when
+    let in_view = view.detect_stars(&StarOptions::default()).unwrap();
+    let brightest = image
+        .detect_stars(&StarOptions {
+            max_stars: 1,
+            ..Default::default()
+        })
+        .unwrap();
+    //then
+    assert_eq!(in_view.len(), 1);
+    assert!((in_view[0].x - 26.0).abs() < 0.05 && (in_view[0].y - 28.0).abs() < 0.05);
+    assert_eq!(brightest.len(), 1);
+    assert!((brightest[0].x - 30.0).abs() < 0.05);
+}
+
+#[test]
+fn detect_stars_on_an_empty_sky() {
+    //given
+    let image = star_field(64, 64, &[], 1.5);
+    //when
+    let stars = image.detect_stars(&StarOptions::default()).unwrap();
+    //then
+    assert!(stars.is_empty());
+}
+
+#[test]
+fn detect_stars_needs_mono_images() {
+    //given
+    let image = ImageData {
+        data: vec![0; 3 * 32 * 32],
+        width: 32,
+        height: 32,
+        bits_per_pixel: 8,
+        channels: 3,
+        metadata: None,
+    };
+    //when
+    let res = image.detect_stars(&StarOptions::default());
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(UnsupportedImageError { channels: 3, .. })
+    ));
+}
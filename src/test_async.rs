@@ -0,0 +1,182 @@
+use std::pin::Pin;
+use std::sync::atomic::{AtomicU8, Ordering};
+use std::time::Duration;
+
+use futures_core::Stream;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    BeginQHYCCDLive_context, CancelQHYCCDExposingAndReadout_context, ExpQHYCCDSingleFrame_context,
+    GetQHYCCDExposureRemaining_context, GetQHYCCDLiveFrame_context, GetQHYCCDMemLength_context,
+    GetQHYCCDSingleFrame_context, OpenQHYCCD_context, SetQHYCCDParam_context,
+    StopQHYCCDLive_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+#[tokio::test]
+async fn expose_async_success() {
+    //given
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param
+        .expect()
+        .withf(|handle, control, value| {
+            *handle == TEST_HANDLE && *control == Control::Exposure as u32 && *value == 5000.0
+        })
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp
+        .expect()
+        .withf(|handle| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    let polls = Arc::new(AtomicU8::new(0));
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining
+        .expect()
+        .withf(|handle| *handle == TEST_HANDLE)
+        .times(2)
+        .returning(move |_handle| match polls.fetch_add(1, Ordering::SeqCst) {
+            0 => 5000,
+            _ => 0,
+        });
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const(4_u32);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame
+        .expect()
+        .withf(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .returning(|_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            let test_image = b"\x01\x02\x03\x04";
+            buffer.copy_from(test_image.as_ptr(), 4);
+            QHYCCD_SUCCESS
+        });
+    let ctx_abort = CancelQHYCCDExposingAndReadout_context();
+    ctx_abort.expect().never();
+    let cam = new_camera();
+    //when
+    let res = cam.expose_async(Duration::from_millis(5)).await;
+    //then
+    assert!(res.is_ok());
+    assert_eq!(
+        res.unwrap(),
+        ImageData {
+            data: vec![0x01, 0x02, 0x03, 0x04],
+            width: 2,
+            height: 2,
+            bits_per_pixel: 8,
+            channels: 1,
+            metadata: None,
+        }
+    )
+}
+
+#[tokio::test]
+async fn expose_async_start_fail() {
+    //given
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(1).return_const(QHYCCD_ERROR);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().never();
+    let cam = new_camera();
+    //when
+    let res = cam.expose_async(Duration::from_millis(5)).await;
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::StartSingleFrameExposureError {
+            error_code: QHYCCD_ERROR
+        }
+        .to_string()
+    );
+}
+
+#[tokio::test]
+async fn expose_async_dropped_aborts_exposure() {
+    //given
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(60_000_000_u32);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().never();
+    let ctx_abort = CancelQHYCCDExposingAndReadout_context();
+    ctx_abort
+        .expect()
+        .withf(|handle| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let res = tokio::time::timeout(
+        Duration::from_millis(50),
+        cam.expose_async(Duration::from_secs(60)),
+    )
+    .await;
+    //then
+    assert!(res.is_err());
+}
+
+#[tokio::test]
+async fn live_stream_as_stream() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let counter = Arc::new(AtomicU8::new(0));
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            let count = counter.fetch_add(1, Ordering::SeqCst);
+            // the first frames are only ready after a few polls, so the stream has to wait for them
+            if count < 3 {
+                return QHYCCD_ERROR;
+            }
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            buffer.write_bytes(count, 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let mut stream = cam
+        .begin_live_stream(LiveStreamOptions {
+            depth: 2,
+            policy: OverflowPolicy::BlockProducer,
+            ..Default::default()
+        })
+        .unwrap();
+    //when
+    let mut frames = Vec::new();
+    for _ in 0..3 {
+        let frame = std::future::poll_fn(|cx| Pin::new(&mut stream).poll_next(cx)).await;
+        frames.push(frame.unwrap().unwrap().data[0]);
+    }
+    //then
+    assert_eq!(frames, vec![3, 4, 5]);
+    assert!(stream.stop().is_ok());
+}
@@ -0,0 +1,105 @@
+use super::*;
+
+fn image_u8(data: Vec<u8>, width: u32, height: u32, channels: u32) -> ImageData {
+    ImageData {
+        data,
+        width,
+        height,
+        bits_per_pixel: 8,
+        channels,
+        metadata: None,
+    }
+}
+
+#[test]
+fn bin_2x2_sum_and_average() {
+    //given
+    #[rustfmt::skip]
+    let image = image_u8(vec![
+        1, 2, 3, 4, 9,
+        5, 6, 7, 8, 9,
+        9, 9, 9, 9, 9,
+    ], 5, 3, 1);
+    //when
+    let sum = image.bin(2, BinningMode::Sum).unwrap();
+    let average = image.bin(2, BinningMode::Average).unwrap();
+    //then
+    assert_eq!((sum.width, sum.height), (2, 1));
+    assert_eq!(sum.data, vec![14, 22]);
+    assert_eq!(average.data, vec![4, 6]);
+}
+
+#[test]
+fn bin_sum_saturates() {
+    //given
+    let image = image_u8(vec![200; 9], 3, 3, 1);
+    //when
+    let res = image.bin(3, BinningMode::Sum).unwrap();
+    //then
+    assert_eq!(res.data, vec![255]);
+}
+
+#[test]
+fn bin_16bit_4x4() {
+    //given
+    let image = ImageData {
+        data: (0..64_u16).flat_map(|v| (v * 1000).to_le_bytes()).collect(),
+        width: 8,
+        height: 8,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let average = image.bin(4, BinningMode::Average).unwrap();
+    let sum = image.bin(4, BinningMode::Sum).unwrap();
+    //then
+    assert_eq!(
+        average.as_u16_slice().unwrap(),
+        &[13500, 17500, 45500, 49500]
+    );
+    assert_eq!(sum.as_u16_slice().unwrap(), &[65535, 65535, 65535, 65535]);
+}
+
+#[test]
+fn bin_keeps_channels_apart() {
+    //given
+    let image = image_u8(vec![1, 10, 2, 20, 3, 30, 4, 40], 2, 2, 2);
+    //when
+    let res = image.bin(2, BinningMode::Sum).unwrap();
+    //then
+    assert_eq!(res.channels, 2);
+    assert_eq!(res.data, vec![10, 100]);
+}
+
+#[test]
+fn bin_view() {
+    //given
+    let image = image_u8((0..16).collect(), 4, 4, 1);
+    let view = image
+        .view(CCDChipArea {
+            start_x: 1,
+            start_y: 1,
+            width: 2,
+            height: 2,
+        })
+        .unwrap();
+    //when
+    let res = view.bin(2, BinningMode::Sum).unwrap();
+    //then
+    assert_eq!(res.data, vec![5 + 6 + 9 + 10]);
+}
+
+#[test]
+fn bin_invalid_factor() {
+    //given
+    let image = image_u8(vec![0; 4], 2, 2, 1);
+    //when
+    let res = image.bin(3, BinningMode::Sum);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::InvalidBinningError { factor: 3 }.to_string()
+    );
+}
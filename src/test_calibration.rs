@@ -0,0 +1,214 @@
+use super::*;
+
+fn image_u16(samples: &[u16], width: u32, height: u32) -> ImageData {
+    ImageData {
+        data: samples
+            .iter()
+            .flat_map(|sample| sample.to_le_bytes())
+            .collect(),
+        width,
+        height,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+fn master(data: Vec<f32>, width: u32, height: u32) -> MasterFrame {
+    MasterFrame {
+        width,
+        height,
+        channels: 1,
+        frames: 1,
+        data,
+    }
+}
+
+fn stack(method: StackMethod, frames: &[&[u16]]) -> MasterFrame {
+    let mut stacker = Stacker::new(method);
+    for frame in frames {
+        stacker
+            .add(&image_u16(frame, frame.len() as u32, 1))
+            .unwrap();
+    }
+    stacker.finish().unwrap()
+}
+
+#[test]
+fn mean_stack() {
+    //given
+    let frames: [&[u16]; 4] = [&[100, 0], &[101, 10], &[102, 20], &[103, 65535]];
+    //when
+    let master = stack(StackMethod::Mean, &frames);
+    //then
+    assert_eq!(master.frames, 4);
+    assert_eq!((master.width, master.height, master.channels), (2, 1, 1));
+    assert_eq!(master.data, vec![101.5, 16391.25]);
+    assert_eq!(master.to_image().as_u16_slice().unwrap(), &[102, 16391]);
+}
+
+#[test]
+fn sigma_clip_stack_rejects_outliers() {
+    //given
+    let mut frames: Vec<[u16; 2]> = (0..20).map(|index| [1000 + index % 3, 500]).collect();
+    // a cosmic ray and a satellite trail after the warm up
+    frames[8][0] = 60000;
+    frames[13] = [30000, 40000];
+    let frames: Vec<&[u16]> = frames.iter().map(|frame| &frame[..]).collect();
+    //when
+    let clipped = stack(StackMethod::SigmaClip { kappa: 3.0 }, &frames);
+    let mean = stack(StackMethod::Mean, &frames);
+    //then
+    assert!((clipped.data[0] - 1001.0).abs() < 0.2, "{:?}", clipped.data);
+    assert_eq!(clipped.data[1], 500.0);
+    assert!(mean.data[0] > 3000.0);
+}
+
+#[test]
+fn median_stack() {
+    //given
+    let odd: [&[u16]; 3] = [&[5, 1], &[1, 9], &[3, 65535]];
+    let even: [&[u16]; 4] = [&[5, 1], &[1, 9], &[3, 65535], &[4, 2]];
+    //when
+    let odd = stack(StackMethod::Median, &odd);
+    let even = stack(StackMethod::Median, &even);
+    //then
+    assert_eq!(odd.data, vec![3.0, 9.0]);
+    assert_eq!(even.data, vec![3.5, 5.5]);
+}
+
+#[test]
+fn stack_methods_agree_on_a_large_frame() {
+    //given
+    let (width, height) = (300, 200);
+    let frames: Vec<ImageData> = (0..6_u32)
+        .map(|frame| {
+            let samples: Vec<u16> = (0..width * height)
+                .map(|index| (index % 4096 + frame) as u16)
+                .collect();
+            image_u16(&samples, width, height)
+        })
+        .collect();
+    //when
+    let masters: Vec<MasterFrame> = [
+        StackMethod::Mean,
+        StackMethod::SigmaClip { kappa: 3.0 },
+        StackMethod::Median,
+    ]
+    .into_iter()
+    .map(|method| {
+        let mut stacker = Stacker::new(method);
+        frames.iter().for_each(|frame| stacker.add(frame).unwrap());
+        stacker.finish().unwrap()
+    })
+    .collect();
+    //then
+    for master in &masters {
+        for (index, &sample) in master.data.iter().enumerate() {
+            assert!((sample - (index % 4096) as f32 - 2.5).abs() < 1e-3);
+        }
+    }
+}
+
+#[test]
+fn stack_rejects_mismatched_frames() {
+    //given
+    let mut stacker = Stacker::new(StackMethod::Mean);
+    stacker.add(&image_u16(&[1, 2, 3, 4], 2, 2)).unwrap();
+    //when
+    let res = stacker.add(&image_u16(&[1, 2, 3, 4], 4, 1));
+    let empty = Stacker::new(StackMethod::Median).finish();
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(FrameMismatchError {
+            width: 4,
+            height: 1,
+            expected_width: 2,
+            expected_height: 2,
+            ..
+        })
+    ));
+    assert_eq!(stacker.frames(), 1);
+    assert!(matches!(
+        empty.unwrap_err().downcast_ref::<QHYError>(),
+        Some(StackEmptyError)
+    ));
+}
+
+#[test]
+fn apply_calibration_subtracts_and_flattens() {
+    //given
+    let bias = master(vec![100.0; 4], 2, 2);
+    let dark = master(vec![10.0, 20.0, 0.0, 5000.0], 2, 2);
+    // a vignetted flat with a dead pixel
+    let flat = master(vec![1100.0, 900.0, 1000.0, 100.0], 2, 2);
+    let calibration = Calibration::new(Some(&bias), Some(&dark), Some(&flat)).unwrap();
+    let mut frame = image_u16(&[1110, 920, 1100, 1000], 2, 2);
+    //when
+    frame.apply_calibration(&calibration).unwrap();
+    //then
+    // flat minus bias is 1000, 800, 900, 0 with a mean of 675
+    assert_eq!(frame.as_u16_slice().unwrap(), &[675, 675, 750, 0]);
+}
+
+#[test]
+fn apply_calibration_on_pooled_and_8_bit_frames() {
+    //given
+    let (width, height) = (256, 64);
+    let dark = master(vec![50.0; (width * height) as usize], width, height);
+    let calibration = Calibration::new(None, Some(&dark), None).unwrap();
+    let pool = FramePool::new(1, (width * height * 2) as usize);
+    let mut buffer = pool.acquire();
+    for (bytes, index) in buffer.chunks_exact_mut(2).zip(0_u16..) {
+        bytes.copy_from_slice(&index.to_le_bytes());
+    }
+    let mut pooled = buffer.into_image(FrameInfo {
+        width,
+        height,
+        bits_per_pixel: 16,
+        channels: 1,
+    });
+    let mut bytes = ImageData {
+        data: (0..width * height).map(|index| index as u8).collect(),
+        width,
+        height,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    pooled.apply_calibration(&calibration).unwrap();
+    bytes.apply_calibration(&calibration).unwrap();
+    //then
+    let expected: Vec<u16> = (0..width * height)
+        .map(|index| index.saturating_sub(50) as u16)
+        .collect();
+    assert_eq!(pooled.as_u16_slice().unwrap(), &expected[..]);
+    assert!(bytes
+        .data
+        .iter()
+        .zip(0..width * height)
+        .all(|(&sample, index)| sample == (index as u8).saturating_sub(50)));
+}
+
+#[test]
+fn apply_calibration_rejects_mismatched_masters() {
+    //given
+    let dark = master(vec![0.0; 4], 2, 2);
+    let flat = master(vec![1.0; 4], 4, 1);
+    let calibration = Calibration::new(None, Some(&dark), None).unwrap();
+    let mut frame = image_u16(&[0; 4], 4, 1);
+    //when
+    let res = Calibration::new(None, Some(&dark), Some(&flat));
+    let applied = frame.apply_calibration(&calibration);
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(FrameMismatchError { .. })
+    ));
+    assert!(matches!(
+        applied.unwrap_err().downcast_ref::<QHYError>(),
+        Some(FrameMismatchError { .. })
+    ));
+}
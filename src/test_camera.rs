@@ -728,7 +728,8 @@ fn get_live_frame_success() {
             width: 2,
             height: 2,
             bits_per_pixel: 8,
-            channels: 1
+            channels: 1,
+            metadata: None,
         }
     )
 }
@@ -783,7 +784,8 @@ fn get_single_frame_success() {
             width: 2,
             height: 2,
             bits_per_pixel: 8,
-            channels: 1
+            channels: 1,
+            metadata: None,
         }
     )
 }
@@ -810,6 +812,247 @@ fn get_single_frame_fail() {
     );
 }
 
+#[test]
+fn get_live_frame_into_success() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDLiveFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .returning_st(|_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            let test_image = b"\x01\x02\x03\x04";
+            buffer.copy_from(test_image.as_ptr(), 4);
+            QHYCCD_SUCCESS
+        });
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let res = cam.get_live_frame_into(&mut buffer);
+    //then
+    assert!(res.is_ok());
+    let info = res.unwrap();
+    assert_eq!(
+        info,
+        FrameInfo {
+            width: 2,
+            height: 2,
+            bits_per_pixel: 8,
+            channels: 1
+        }
+    );
+    assert_eq!(info.data_len(), 4);
+    assert_eq!(buffer, [0x01, 0x02, 0x03, 0x04]);
+}
+
+#[test]
+fn get_live_frame_into_buffer_too_small() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(8_u32);
+    let ctx = GetQHYCCDLiveFrame_context();
+    ctx.expect().times(0);
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let res = cam.get_live_frame_into(&mut buffer);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::BufferTooSmallError {
+            needed: 8,
+            available: 4
+        }
+        .to_string()
+    );
+}
+
+#[test]
+fn get_live_frame_into_fail() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDLiveFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let res = cam.get_live_frame_into(&mut buffer);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::GetLiveFrameError {
+            error_code: QHYCCD_ERROR
+        }
+        .to_string()
+    );
+}
+
+#[test]
+fn poll_live_frame_into_asks_mem_length_once_per_mode() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(2).return_const_st(4_u32);
+    let ctx = GetQHYCCDLiveFrame_context();
+    ctx.expect().times(4).return_const_st(QHYCCD_ERROR);
+    let ctx_bin = SetQHYCCDBinMode_context();
+    ctx_bin.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let first = cam.poll_live_frame_into(&mut buffer);
+    let second = cam.poll_live_frame_into(&mut buffer);
+    cam.set_bin_mode(2, 2).unwrap();
+    let binned = cam.poll_live_frame_into(&mut buffer);
+    let again = cam.poll_live_frame_into(&mut buffer);
+    //then
+    assert_eq!(first.unwrap(), None);
+    assert_eq!(second.unwrap(), None);
+    assert_eq!(binned.unwrap(), None);
+    assert_eq!(again.unwrap(), None);
+}
+
+#[test]
+fn get_single_frame_into_success() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDSingleFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .returning_st(|_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 1;
+            *bpp = 16;
+            *channels = 1;
+            let test_image = b"\x01\x02\x03\x04";
+            buffer.copy_from(test_image.as_ptr(), 4);
+            QHYCCD_SUCCESS
+        });
+    let cam = new_camera();
+    let mut buffer = [0u8; 6];
+    //when
+    let res = cam.get_single_frame_into(&mut buffer);
+    //then
+    assert!(res.is_ok());
+    let info = res.unwrap();
+    assert_eq!(
+        info,
+        FrameInfo {
+            width: 2,
+            height: 1,
+            bits_per_pixel: 16,
+            channels: 1
+        }
+    );
+    assert_eq!(info.data_len(), 4);
+    assert_eq!(buffer[..info.data_len()], [0x01, 0x02, 0x03, 0x04]);
+}
+
+#[test]
+fn get_single_frame_into_size_fail() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let res = cam.get_single_frame_into(&mut buffer);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::GetImageSizeError.to_string()
+    );
+}
+
+#[test]
+fn get_single_frame_into_fail() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDSingleFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    let mut buffer = [0u8; 4];
+    //when
+    let res = cam.get_single_frame_into(&mut buffer);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::GetSingleFrameError {
+            error_code: QHYCCD_ERROR
+        }
+        .to_string()
+    );
+}
+
+#[test]
+fn get_live_frame_pooled_success() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDLiveFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .returning_st(|_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            let test_image = b"\x01\x02\x03\x04";
+            buffer.copy_from(test_image.as_ptr(), 4);
+            QHYCCD_SUCCESS
+        });
+    let cam = new_camera();
+    let pool = FramePool::new(1, 4);
+    //when
+    let res = cam.get_live_frame_pooled(&pool);
+    //then
+    assert!(res.is_ok());
+    let image = res.unwrap();
+    assert_eq!(image.data, vec![0x01, 0x02, 0x03, 0x04]);
+    assert_eq!(image.width, 2);
+    assert_eq!(pool.available(), 0);
+    drop(image);
+    assert_eq!(pool.available(), 1);
+}
+
+#[test]
+fn get_single_frame_pooled_fail_returns_buffer() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(4_u32);
+    let ctx = GetQHYCCDSingleFrame_context();
+    ctx.expect()
+        .withf_st(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    let pool = FramePool::new(1, 4);
+    //when
+    let res = cam.get_single_frame_pooled(&pool);
+    //then
+    assert!(res.is_err());
+    assert_eq!(pool.available(), 1);
+}
+
 #[test]
 fn get_overscan_area_success() {
     //given
@@ -1530,6 +1773,71 @@ fn close_fail() {
     );
 }
 
+#[test]
+fn close_fail_keeps_camera_open() {
+    //given
+    let ctx = CloseQHYCCD_context();
+    ctx.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let ctx_type = GetQHYCCDType_context();
+    ctx_type
+        .expect()
+        .withf_st(|handle| *handle == TEST_HANDLE)
+        .times(1)
+        .return_const_st(4010_u32);
+    let cam = new_camera();
+    //when
+    let res = cam.close();
+    //then
+    assert!(res.is_err());
+    assert!(cam.is_open().unwrap());
+    assert_eq!(cam.get_type().unwrap(), 4010);
+}
+
+#[test]
+fn close_waits_for_running_calls() {
+    //given
+    let finished = Arc::new(std::sync::atomic::AtomicBool::new(false));
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    let in_call = Arc::new(std::sync::Barrier::new(2));
+    {
+        let finished = finished.clone();
+        let in_call = in_call.clone();
+        ctx_frame.expect().times(1).returning(
+            move |_handle, width, height, bpp, channels, _buffer| unsafe {
+                in_call.wait();
+                std::thread::sleep(std::time::Duration::from_millis(50));
+                *width = 2;
+                *height = 2;
+                *bpp = 8;
+                *channels = 1;
+                finished.store(true, std::sync::atomic::Ordering::SeqCst);
+                QHYCCD_SUCCESS
+            },
+        );
+    }
+    let ctx_close = CloseQHYCCD_context();
+    {
+        let finished = finished.clone();
+        ctx_close
+            .expect()
+            .times(1)
+            .withf(move |_handle| finished.load(std::sync::atomic::Ordering::SeqCst))
+            .return_const(QHYCCD_SUCCESS);
+    }
+    let cam = new_camera();
+    let reader = {
+        let cam = cam.clone();
+        std::thread::spawn(move || cam.get_single_frame(4))
+    };
+    in_call.wait();
+    //when
+    let res = cam.close();
+    //then
+    assert!(res.is_ok());
+    assert!(reader.join().unwrap().is_ok());
+    assert!(!cam.is_open().unwrap());
+}
+
 #[test]
 fn bayer_mode_try_from() {
     assert_eq!(BayerMode::try_from(1).unwrap(), BayerMode::GBRG);
@@ -0,0 +1,231 @@
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    CloseQHYCCD_context, GetQHYCCDChipInfo_context, GetQHYCCDEffectiveArea_context,
+    GetQHYCCDNumberOfReadModes_context, GetQHYCCDOverScanArea_context,
+    GetQHYCCDParamMinMaxStep_context, GetQHYCCDReadModeName_context,
+    GetQHYCCDReadModeResolution_context, IsQHYCCDControlAvailable_context, OpenQHYCCD_context,
+    SetQHYCCDBinMode_context, SetQHYCCDBitsMode_context, SetQHYCCDReadMode_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+#[test]
+fn capabilities_are_queried_once() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .withf_st(|handle, _control| *handle == TEST_HANDLE)
+        .times(Control::ALL.len())
+        .returning_st(|_handle, control| match control {
+            c if c == Control::Gain as u32 => QHYCCD_SUCCESS,
+            c if c == Control::CamColor as u32 => BayerMode::RGGB as u32,
+            _ => QHYCCD_ERROR,
+        });
+    let ctx_min_max = GetQHYCCDParamMinMaxStep_context();
+    ctx_min_max
+        .expect()
+        .times(2)
+        .returning_st(|_handle, control, min, max, step| unsafe {
+            if control != Control::Gain as u32 {
+                return QHYCCD_ERROR;
+            }
+            *min = 0.0;
+            *max = 100.0;
+            *step = 1.0;
+            QHYCCD_SUCCESS
+        });
+    let ctx_modes = GetQHYCCDNumberOfReadModes_context();
+    ctx_modes
+        .expect()
+        .times(1)
+        .returning_st(|_handle, number| unsafe {
+            *number = 1;
+            QHYCCD_SUCCESS
+        });
+    let ctx_name = GetQHYCCDReadModeName_context();
+    ctx_name
+        .expect()
+        .times(1)
+        .returning_st(|_handle, _index, mode| unsafe {
+            let read_mode = "STANDARD MODE\0";
+            mode.copy_from(read_mode.as_ptr() as *const c_char, read_mode.len());
+            QHYCCD_SUCCESS
+        });
+    let ctx_resolution = GetQHYCCDReadModeResolution_context();
+    ctx_resolution
+        .expect()
+        .times(1)
+        .returning_st(|_handle, _index, width, height| unsafe {
+            *width = 1024;
+            *height = 768;
+            QHYCCD_SUCCESS
+        });
+    let ctx_info = GetQHYCCDChipInfo_context();
+    ctx_info.expect().times(1).returning_st(
+        |_handle, chipw, chiph, imagew, imageh, pixelw, pixelh, bpp| unsafe {
+            *chipw = 3124.1;
+            *chiph = 500.5;
+            *imagew = 1024;
+            *imageh = 768;
+            *pixelw = 2.4;
+            *pixelh = 2.4;
+            *bpp = 16;
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_effective = GetQHYCCDEffectiveArea_context();
+    ctx_effective.expect().times(1).returning_st(
+        |_handle, start_x, start_y, width, height| unsafe {
+            *start_x = 10;
+            *start_y = 20;
+            *width = 1000;
+            *height = 700;
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_overscan = GetQHYCCDOverScanArea_context();
+    ctx_overscan.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    //when
+    let capabilities = cam.capabilities().unwrap();
+    let again = cam.capabilities().unwrap();
+    //then
+    assert!(Arc::ptr_eq(&capabilities, &again));
+    assert_eq!(capabilities.controls.len(), 2);
+    assert_eq!(
+        capabilities.is_control_available(Control::CamColor),
+        Some(BayerMode::RGGB as u32)
+    );
+    assert_eq!(capabilities.min_max_step(Control::CamColor), None);
+    assert_eq!(
+        capabilities.readout_modes,
+        vec![ReadoutModeCapability {
+            mode: ReadoutMode {
+                id: 0,
+                name: "STANDARD MODE".to_owned()
+            },
+            resolution: (1024, 768)
+        }]
+    );
+    assert_eq!(capabilities.overscan_area, None);
+    // answered from the snapshot, the mocks above would fail on a second call
+    assert_eq!(
+        cam.is_control_available(Control::Gain),
+        Some(QHYCCD_SUCCESS)
+    );
+    assert_eq!(cam.is_control_available(Control::Cooler), None);
+    assert_eq!(
+        cam.get_parameter_min_max_step(Control::Gain).unwrap(),
+        (0.0, 100.0, 1.0)
+    );
+    assert_eq!(cam.get_ccd_info().unwrap().image_width, 1024);
+    assert_eq!(
+        cam.get_effective_area().unwrap(),
+        CCDChipArea {
+            start_x: 10,
+            start_y: 20,
+            width: 1000,
+            height: 700
+        }
+    );
+    assert_eq!(cam.get_number_of_readout_modes().unwrap(), 1);
+    assert_eq!(cam.get_readout_mode_name(0).unwrap(), "STANDARD MODE");
+    assert_eq!(cam.get_readout_mode_resolution(0).unwrap(), (1024, 768));
+}
+
+#[test]
+fn capabilities_are_cleared_by_set_readout_mode_and_close() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .times(Control::ALL.len() * 2)
+        .return_const_st(QHYCCD_ERROR);
+    let ctx_modes = GetQHYCCDNumberOfReadModes_context();
+    ctx_modes.expect().times(2).return_const_st(QHYCCD_ERROR);
+    let ctx_info = GetQHYCCDChipInfo_context();
+    ctx_info.expect().times(2).return_const_st(QHYCCD_ERROR);
+    let ctx_effective = GetQHYCCDEffectiveArea_context();
+    ctx_effective
+        .expect()
+        .times(2)
+        .return_const_st(QHYCCD_ERROR);
+    let ctx_overscan = GetQHYCCDOverScanArea_context();
+    ctx_overscan.expect().times(2).return_const_st(QHYCCD_ERROR);
+    let ctx_read_mode = SetQHYCCDReadMode_context();
+    ctx_read_mode
+        .expect()
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_close = CloseQHYCCD_context();
+    ctx_close.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let first = cam.capabilities().unwrap();
+    //when
+    cam.set_readout_mode(1).unwrap();
+    let second = cam.capabilities().unwrap();
+    cam.close().unwrap();
+    //then
+    assert!(!Arc::ptr_eq(&first, &second));
+    assert!(second.controls.is_empty());
+    assert!(cam.cached_capabilities().is_none());
+    assert!(cam.capabilities().is_err());
+}
+
+#[test]
+fn ccd_info_is_asked_again_after_bit_and_bin_mode() {
+    //given
+    let ctx_info = GetQHYCCDChipInfo_context();
+    let mut calls = 0;
+    ctx_info.expect().times(2).returning_st(
+        move |_handle, _chipw, _chiph, imagew, imageh, _pixelw, _pixelh, bpp| unsafe {
+            calls += 1;
+            *imagew = 1024 / calls;
+            *imageh = 768 / calls;
+            *bpp = 8;
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_bits = SetQHYCCDBitsMode_context();
+    ctx_bits.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bin = SetQHYCCDBinMode_context();
+    ctx_bin.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let snapshot = CameraCapabilities {
+        controls: HashMap::new(),
+        ccd_info: Some(CCDChipInfo {
+            chip_width: 7.0,
+            chip_height: 5.0,
+            image_width: 1024,
+            image_height: 768,
+            pixel_width: 3.76,
+            pixel_height: 3.76,
+            bits_per_pixel: 16,
+        }),
+        effective_area: None,
+        overscan_area: None,
+        readout_modes: Vec::new(),
+    };
+    cam.handle.set_capabilities(Some(Arc::new(snapshot)));
+    let cached = cam.get_ccd_info().unwrap();
+    //when
+    cam.set_bit_mode(8).unwrap();
+    let after_bit_mode = cam.get_ccd_info().unwrap();
+    cam.set_bin_mode(2, 2).unwrap();
+    let after_bin_mode = cam.get_ccd_info().unwrap();
+    //then
+    assert_eq!(cached.bits_per_pixel, 16);
+    assert_eq!(after_bit_mode.bits_per_pixel, 8);
+    assert_eq!(after_bin_mode.image_width, 512);
+    // the rest of the snapshot is kept
+    assert!(cam.cached_capabilities().is_some());
+}
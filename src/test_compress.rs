@@ -0,0 +1,199 @@
+use super::*;
+
+/// reads bits most significant first
+struct BitReader<'a> {
+    data: &'a [u8],
+    position: usize,
+}
+
+impl BitReader<'_> {
+    fn read(&mut self, bits: u32) -> u32 {
+        let mut value = 0;
+        for _ in 0..bits {
+            let bit = (self.data[self.position / 8] >> (7 - self.position % 8)) & 1;
+            value = (value << 1) | bit as u32;
+            self.position += 1;
+        }
+        value
+    }
+}
+
+/// the `RICE_1` decoder of cfitsio, returns the stored values
+fn rice_decode(data: &[u8], count: usize, fs_bits: u32, fs_max: u32, bits: u32) -> Vec<u32> {
+    let mask = (1_u64 << bits) - 1;
+    let mut reader = BitReader { data, position: 0 };
+    let mut last = reader.read(bits) as u64;
+    let mut out = Vec::with_capacity(count);
+    while out.len() < count {
+        let block = 32.min(count - out.len());
+        let fs = reader.read(fs_bits) as i32 - 1;
+        for _ in 0..block {
+            let difference = if fs < 0 {
+                0
+            } else if fs as u32 == fs_max {
+                reader.read(bits)
+            } else {
+                let mut top = 0;
+                while reader.read(1) == 0 {
+                    top += 1;
+                }
+                (top << fs) | reader.read(fs as u32)
+            } as u64;
+            let value = if difference & 1 == 0 {
+                difference >> 1
+            } else {
+                !(difference >> 1)
+            };
+            last = last.wrapping_add(value) & mask;
+            out.push(last as u32);
+        }
+    }
+    out
+}
+
+/// splits a tile compressed FITS file into its extension cards and the compressed tiles
+fn parse(fits: &[u8]) -> (Vec<String>, Vec<&[u8]>) {
+    assert_eq!(fits.len() % 2880, 0);
+    let cards: Vec<String> = fits[2880..]
+        .chunks(80)
+        .map(|card| String::from_utf8_lossy(card).trim_end().to_owned())
+        .take_while(|card| card != "END")
+        .collect();
+    let value = |key: &str| -> usize {
+        let card = cards.iter().find(|card| card.starts_with(key)).unwrap();
+        card[10..30].trim().parse().unwrap()
+    };
+    let table = 2880 + (cards.len() * 80 + 80).div_ceil(2880) * 2880;
+    let tiles = value("NAXIS2 ");
+    let heap = table + tiles * 8;
+    assert_eq!(
+        fits.len(),
+        (heap + value("PCOUNT") - 2880).div_ceil(2880) * 2880 + 2880
+    );
+    let tiles = (0..tiles)
+        .map(|tile| {
+            let descriptor = &fits[table + tile * 8..table + tile * 8 + 8];
+            let len = u32::from_be_bytes(descriptor[..4].try_into().unwrap()) as usize;
+            let offset = u32::from_be_bytes(descriptor[4..].try_into().unwrap()) as usize;
+            &fits[heap + offset..heap + offset + len]
+        })
+        .collect();
+    (cards, tiles)
+}
+
+#[test]
+fn write_fits_rice_16bit_round_trip() {
+    //given
+    let width = 100;
+    let height = 40;
+    let samples: Vec<u16> = (0..width * height)
+        .map(|i| match i % 700 {
+            // a flat block, a slope, noise and full scale jumps
+            0..=99 => 1000,
+            100..=399 => 1000 + (i % 300) as u16 * 3,
+            400..=599 => (i as u16).wrapping_mul(40503) % 64,
+            _ => (i as u16 % 2) * 65535,
+        })
+        .collect();
+    let image = ImageData {
+        data: samples.iter().flat_map(|v| v.to_le_bytes()).collect(),
+        width: width as u32,
+        height: height as u32,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    };
+    let mut header = FitsHeader::new();
+    header.set("OBJECT", "M31", "").set("ZBITPIX", 8, "ignored");
+    //when
+    let mut out = Vec::new();
+    image.write_fits_rice(&mut out, &header, 16).unwrap();
+    //then
+    let (cards, tiles) = parse(&out);
+    assert!(cards.contains(&"ZCMPTYPE= 'RICE_1  '".to_owned()));
+    assert!(cards.contains(&"ZBITPIX =                   16".to_owned()));
+    assert!(cards.contains(&"ZTILE2  =                   16".to_owned()));
+    assert!(cards.contains(&"BZERO   =                32768".to_owned()));
+    assert!(cards.contains(&"OBJECT  = 'M31     '".to_owned()));
+    assert_eq!(tiles.len(), 3);
+    let decoded: Vec<u16> = tiles
+        .iter()
+        .zip([16, 16, 8])
+        .flat_map(|(tile, rows)| rice_decode(tile, rows * width, 4, 14, 16))
+        .map(|stored| stored as u16 ^ 0x8000)
+        .collect();
+    assert_eq!(decoded, samples);
+}
+
+#[test]
+fn write_fits_rice_color_planes() {
+    //given
+    let image = ImageData {
+        data: (0..2 * 3 * 3).map(|i| (i * 37 % 256) as u8).collect(),
+        width: 2,
+        height: 3,
+        bits_per_pixel: 8,
+        channels: 3,
+        metadata: None,
+    };
+    //when
+    let mut out = Vec::new();
+    image
+        .write_fits_rice(&mut out, &FitsHeader::new(), 2)
+        .unwrap();
+    //then
+    let (cards, tiles) = parse(&out);
+    assert!(cards.contains(&"ZNAXIS3 =                    3".to_owned()));
+    assert_eq!(tiles.len(), 6);
+    let mut decoded = vec![0_u8; image.data.len()];
+    for (index, tile) in tiles.iter().enumerate() {
+        let (plane, first_row) = (index / 2, (index % 2) * 2);
+        let rows = 2.min(3 - first_row);
+        for (i, value) in rice_decode(tile, rows * 2, 3, 6, 8).into_iter().enumerate() {
+            decoded[(first_row * 2 + i) * 3 + plane] = value as u8;
+        }
+    }
+    assert_eq!(decoded, image.data);
+}
+
+#[test]
+fn write_fits_rice_compresses_background() {
+    //given
+    let image = ImageData {
+        data: (0..512 * 512_u32)
+            .flat_map(|i| (1000 + (i.wrapping_mul(2654435761) >> 28) as u16).to_le_bytes())
+            .collect(),
+        width: 512,
+        height: 512,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let mut out = Vec::new();
+    image
+        .write_fits_rice(&mut out, &FitsHeader::new(), 16)
+        .unwrap();
+    //then
+    assert!(out.len() * 2 < image.fits_len(&FitsHeader::new()));
+}
+
+#[cfg(feature = "zstd")]
+#[test]
+fn write_zstd_round_trip() {
+    //given
+    let image = ImageData {
+        data: (0..3_000_000_u32).map(|i| (i % 251) as u8).collect(),
+        width: 2000,
+        height: 1500,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let mut out = Vec::new();
+    image.write_zstd(&mut out, 3).unwrap();
+    //then
+    assert!(out.len() < image.data.len() / 10);
+    assert_eq!(zstd::decode_all(&out[..]).unwrap(), image.data);
+}
@@ -0,0 +1,109 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDExposureRemaining_context, GetQHYCCDParam_context, IsQHYCCDControlAvailable_context,
+    OpenQHYCCD_context, SetQHYCCDParam_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn fast_telemetry() -> TelemetryOptions {
+    TelemetryOptions {
+        interval: Duration::from_millis(1),
+        filter_wheel: false,
+    }
+}
+
+#[test]
+fn cooler_ramps_in_steps_and_settles() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .returning_st(|_handle, control| match control {
+            c if c == Control::CurTemp as u32 => QHYCCD_SUCCESS,
+            c if c == Control::Cooler as u32 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        });
+    // the sensor follows the setpoint at once
+    let temperature = Arc::new(AtomicU64::new(20.0_f64.to_bits()));
+    let sensor = temperature.clone();
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get
+        .expect()
+        .returning(move |_handle, _control| f64::from_bits(sensor.load(Ordering::SeqCst)));
+    let setpoints = Arc::new(Mutex::new(Vec::new()));
+    let sent = setpoints.clone();
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf(|_handle, control, _value| *control == Control::Cooler as u32)
+        .returning(move |_handle, _control, value| {
+            sent.lock().unwrap().push(value);
+            temperature.store(value.to_bits(), Ordering::SeqCst);
+            QHYCCD_SUCCESS
+        });
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(0_u32);
+    let cam = new_camera();
+    let telemetry = cam.start_telemetry(fast_telemetry()).unwrap();
+    //when
+    let cooler = cam
+        .start_cooler(
+            -10.0,
+            telemetry.reader(),
+            CoolerOptions {
+                // 1°C per tick
+                rate: 12000.0,
+                interval: Duration::from_millis(5),
+                tolerance: 0.5,
+                settle_time: Duration::from_millis(20),
+            },
+        )
+        .unwrap();
+    let settled = cooler.wait_settled(Duration::from_secs(10));
+    //then
+    assert!(settled);
+    let status = cooler.status();
+    cooler.stop();
+    assert_eq!(status.state, CoolerState::Settled);
+    assert_eq!(status.setpoint, Some(-10.0));
+    assert_eq!(status.progress, 1.0);
+    let setpoints = setpoints.lock().unwrap();
+    assert_eq!(setpoints.last(), Some(&-10.0));
+    assert!(setpoints.len() >= 30);
+    assert!(setpoints
+        .windows(2)
+        .all(|pair| pair[1] < pair[0] && pair[0] - pair[1] <= 1.0 + 1e-9));
+}
+
+#[test]
+fn cooler_needs_cooler_control() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(0_u32);
+    let cam = new_camera();
+    let telemetry = cam.start_telemetry(fast_telemetry()).unwrap();
+    //when
+    let res = cam.start_cooler(-10.0, telemetry.reader(), CoolerOptions::default());
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(IsControlAvailableError {
+            control: Control::Cooler
+        })
+    ));
+}
@@ -0,0 +1,180 @@
+use super::*;
+
+const MODES: [BayerMode; 4] = [
+    BayerMode::RGGB,
+    BayerMode::BGGR,
+    BayerMode::GRBG,
+    BayerMode::GBRG,
+];
+const ALGORITHMS: [DebayerAlgorithm; 2] = [DebayerAlgorithm::Bilinear, DebayerAlgorithm::Malvar];
+
+/// a raw frame of a uniformly colored scene as the sensor would see it through the bayer matrix
+fn mosaic(mode: BayerMode, width: usize, height: usize, rgb: [u16; 3]) -> Vec<u16> {
+    let (red_x, red_y) = match mode {
+        BayerMode::RGGB => (0, 0),
+        BayerMode::GRBG => (1, 0),
+        BayerMode::GBRG => (0, 1),
+        BayerMode::BGGR => (1, 1),
+    };
+    let mut raw = Vec::with_capacity(width * height);
+    for y in 0..height {
+        for x in 0..width {
+            raw.push(match (x & 1 == red_x, y & 1 == red_y) {
+                (true, true) => rgb[0],
+                (false, false) => rgb[2],
+                _ => rgb[1],
+            });
+        }
+    }
+    raw
+}
+
+fn image_u8(raw: &[u16], width: usize, height: usize) -> ImageData {
+    ImageData {
+        data: raw.iter().map(|&v| v as u8).collect(),
+        width: width as u32,
+        height: height as u32,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+fn image_u16(raw: &[u16], width: usize, height: usize) -> ImageData {
+    ImageData {
+        data: raw.iter().flat_map(|v| v.to_le_bytes()).collect(),
+        width: width as u32,
+        height: height as u32,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+#[test]
+fn debayer_uniform_color_8bit() {
+    for mode in MODES {
+        for algorithm in ALGORITHMS {
+            //given
+            let raw = mosaic(mode, 5, 4, [200, 100, 50]);
+            let image = image_u8(&raw, 5, 4);
+            //when
+            let res = image.debayer(mode, algorithm).unwrap();
+            //then
+            assert_eq!(res.channels, 3);
+            assert_eq!(res.width, 5);
+            assert_eq!(res.height, 4);
+            assert_eq!(res.bits_per_pixel, 8);
+            assert_eq!(res.data.len(), 5 * 4 * 3);
+            for rgb in res.data.chunks_exact(3) {
+                assert_eq!(rgb, &[200, 100, 50], "{:?} {:?}", mode, algorithm);
+            }
+        }
+    }
+}
+
+#[test]
+fn debayer_uniform_color_16bit() {
+    for mode in MODES {
+        for algorithm in ALGORITHMS {
+            //given
+            let raw = mosaic(mode, 6, 3, [60000, 30000, 1000]);
+            let image = image_u16(&raw, 6, 3);
+            //when
+            let res = image.debayer(mode, algorithm).unwrap();
+            //then
+            assert_eq!(res.bits_per_pixel, 16);
+            for rgb in res.as_u16_slice().unwrap().chunks_exact(3) {
+                assert_eq!(rgb, &[60000, 30000, 1000], "{:?} {:?}", mode, algorithm);
+            }
+        }
+    }
+}
+
+#[test]
+fn debayer_large_image_in_parallel_bands() {
+    //given
+    let (width, height) = (64, 257);
+    let raw = mosaic(BayerMode::GRBG, width, height, [10, 20, 30]);
+    let image = image_u8(&raw, width, height);
+    //when
+    let res = image
+        .debayer(BayerMode::GRBG, DebayerAlgorithm::Malvar)
+        .unwrap();
+    //then
+    assert!(res.data.chunks_exact(3).all(|rgb| rgb == [10, 20, 30]));
+}
+
+#[test]
+fn debayer_bilinear_interpolates_neighbors() {
+    //given
+    #[rustfmt::skip]
+    let raw = [
+        10, 20, 30, 40,
+        50, 60, 70, 80,
+        90, 100, 110, 120,
+        130, 140, 150, 160,
+    ];
+    let image = image_u8(&raw, 4, 4);
+    //when
+    let res = image
+        .debayer(BayerMode::RGGB, DebayerAlgorithm::Bilinear)
+        .unwrap();
+    //then
+    // (1,1) is blue in RGGB: red from the diagonals, green from the cross
+    let pixel = &res.data[(4 + 1) * 3..(4 + 1) * 3 + 3];
+    assert_eq!(pixel, &[60, 60, 60]);
+    // (2,1) is green in a blue row: red from above and below, blue from left and right
+    let pixel = &res.data[(4 + 2) * 3..(4 + 2) * 3 + 3];
+    assert_eq!(pixel, &[70, 70, 70]);
+}
+
+#[test]
+fn debayer_rejects_color_image() {
+    //given
+    let image = ImageData {
+        data: vec![0; 4 * 4 * 3],
+        width: 4,
+        height: 4,
+        bits_per_pixel: 8,
+        channels: 3,
+        metadata: None,
+    };
+    //when
+    let res = image.debayer(BayerMode::RGGB, DebayerAlgorithm::Bilinear);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::UnsupportedImageError {
+            bits_per_pixel: 8,
+            channels: 3
+        }
+        .to_string()
+    );
+}
+
+#[test]
+fn debayer_short_buffer() {
+    //given
+    let image = ImageData {
+        data: vec![0; 10],
+        width: 4,
+        height: 4,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let res = image.debayer(BayerMode::RGGB, DebayerAlgorithm::Bilinear);
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::BufferTooSmallError {
+            needed: 16,
+            available: 10
+        }
+        .to_string()
+    );
+}
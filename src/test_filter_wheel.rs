@@ -1,7 +1,12 @@
+use std::cell::Cell;
+use std::rc::Rc;
+use std::time::Duration;
+
 use super::*;
 use crate::mocks::mock_libqhyccd_sys::{
-    CloseQHYCCD_context, GetQHYCCDParam_context, IsQHYCCDCFWPlugged_context,
-    IsQHYCCDControlAvailable_context, OpenQHYCCD_context, SetQHYCCDParam_context, QHYCCD_SUCCESS,
+    CloseQHYCCD_context, GetQHYCCDCFWStatus_context, GetQHYCCDParam_context,
+    IsQHYCCDCFWPlugged_context, IsQHYCCDControlAvailable_context, OpenQHYCCD_context,
+    SetQHYCCDParam_context, QHYCCD_SUCCESS,
 };
 
 const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
@@ -304,3 +309,110 @@ fn set_fw_position_fail_set_parameter() {
     //then
     assert!(res.is_err());
 }
+
+#[test]
+fn get_fw_status_success() {
+    //given
+    let status = Rc::new(Cell::new(b'4'));
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    let reported = status.clone();
+    ctx_status
+        .expect()
+        .withf_st(|handle, _status| *handle == TEST_HANDLE)
+        .times(2)
+        .returning_st(move |_handle, status| unsafe {
+            *status = reported.get() as c_char;
+            QHYCCD_SUCCESS
+        });
+    let fw = new_filter_wheel();
+    //when
+    let arrived = fw.get_fw_status();
+    status.set(b'N');
+    let moving = fw.get_fw_status();
+    //then
+    assert_eq!(arrived.unwrap(), Some(4));
+    assert_eq!(moving.unwrap(), None);
+}
+
+#[test]
+fn get_fw_status_fail() {
+    //given
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    ctx_status.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let fw = new_filter_wheel();
+    //when
+    let res = fw.get_fw_status();
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(GetCfwStatusError {
+            error_code: QHYCCD_ERROR
+        })
+    ));
+}
+
+#[test]
+fn move_to_waits_for_the_status_and_caches_the_position() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_SUCCESS);
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf_st(|_handle, control, value| *control == Control::CfwPort as u32 && *value == 51.0)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    // the wheel still reports the old slot, then moves and arrives on the fourth call
+    let polls = Rc::new(Cell::new(0));
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    let counted = polls.clone();
+    ctx_status
+        .expect()
+        .returning_st(move |_handle, status| unsafe {
+            counted.set(counted.get() + 1);
+            *status = match counted.get() {
+                1 => b'0',
+                2 | 3 => b'N',
+                _ => b'3',
+            } as c_char;
+            QHYCCD_SUCCESS
+        });
+    let fw = new_filter_wheel();
+    //when
+    let moving = fw.move_to(3).unwrap();
+    let position_while_moving = fw.position();
+    let done_right_away = moving.is_done().unwrap();
+    let res = moving.wait(Duration::from_secs(1));
+    let again = fw.move_to(3).unwrap();
+    //then
+    assert!(res.is_ok());
+    assert_eq!(position_while_moving, None);
+    assert!(!done_right_away);
+    assert_eq!(fw.position(), Some(3));
+    // nothing is sent or asked for a move to where the wheel is
+    assert!(again.is_done().unwrap());
+    assert_eq!(polls.get(), 4);
+}
+
+#[test]
+fn move_to_times_out() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_SUCCESS);
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    ctx_status.expect().returning_st(|_handle, status| unsafe {
+        *status = b'N' as c_char;
+        QHYCCD_SUCCESS
+    });
+    let fw = new_filter_wheel();
+    //when
+    let res = fw.move_to(1).unwrap().wait(Duration::from_millis(50));
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(FilterWheelMoveTimeoutError { position: 1 })
+    ));
+    assert_eq!(fw.position(), None);
+}
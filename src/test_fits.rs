@@ -0,0 +1,212 @@
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDChipInfo_context, GetQHYCCDParam_context, IsQHYCCDControlAvailable_context,
+    OpenQHYCCD_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn cards(fits: &[u8]) -> Vec<String> {
+    fits.chunks(80)
+        .map(|card| String::from_utf8_lossy(card).trim_end().to_owned())
+        .take_while(|card| card != "END")
+        .collect()
+}
+
+#[test]
+fn write_fits_16bit() {
+    //given
+    let image = ImageData {
+        data: [0_u16, 1, 32768, 65535]
+            .iter()
+            .flat_map(|v| v.to_le_bytes())
+            .collect(),
+        width: 2,
+        height: 2,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    };
+    let mut header = FitsHeader::new();
+    header
+        .set("object", "M31", "")
+        .set("EXPTIME", 1.5, "[s] exposure time")
+        .set("BITPIX", 8, "ignored");
+    //when
+    let mut out = Vec::new();
+    image.write_fits(&mut out, &header).unwrap();
+    //then
+    assert_eq!(out.len(), 2 * 2880);
+    assert_eq!(out.len(), image.fits_len(&header));
+    assert_eq!(
+        cards(&out),
+        vec![
+            "SIMPLE  =                    T",
+            "BITPIX  =                   16",
+            "NAXIS   =                    2",
+            "NAXIS1  =                    2",
+            "NAXIS2  =                    2",
+            "BZERO   =                32768",
+            "BSCALE  =                    1",
+            "OBJECT  = 'M31     '",
+            "EXPTIME =                  1.5 / [s] exposure time",
+        ]
+    );
+    assert_eq!(
+        &out[2880..2888],
+        &[0x80, 0x00, 0x80, 0x01, 0x00, 0x00, 0x7f, 0xff]
+    );
+    assert!(out[2888..].iter().all(|&b| b == 0));
+}
+
+#[test]
+fn write_fits_color_planes() {
+    //given
+    let image = ImageData {
+        data: vec![1, 2, 3, 4, 5, 6],
+        width: 2,
+        height: 1,
+        bits_per_pixel: 8,
+        channels: 3,
+        metadata: None,
+    };
+    //when
+    let mut out = Vec::new();
+    image.write_fits(&mut out, &FitsHeader::new()).unwrap();
+    //then
+    assert_eq!(
+        cards(&out)[2..6],
+        [
+            "NAXIS   =                    3",
+            "NAXIS1  =                    2",
+            "NAXIS2  =                    1",
+            "NAXIS3  =                    3"
+        ]
+    );
+    assert_eq!(&out[2880..2886], &[1, 4, 2, 5, 3, 6]);
+}
+
+#[test]
+fn write_fits_unsupported_image() {
+    //given
+    let image = ImageData {
+        data: vec![0; 4],
+        width: 2,
+        height: 2,
+        bits_per_pixel: 32,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let res = image.write_fits(Vec::new(), &FitsHeader::new());
+    //then
+    assert!(res.is_err());
+}
+
+#[test]
+fn save_fits_preallocates_file() {
+    //given
+    let image = ImageData {
+        data: vec![7; 4000],
+        width: 100,
+        height: 40,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    let path = std::env::temp_dir().join(format!("qhyccd-rs-{}.fits", std::process::id()));
+    //when
+    let res = image.save_fits(&path, &FitsHeader::new());
+    //then
+    let written = std::fs::read(&path).unwrap();
+    std::fs::remove_file(&path).unwrap();
+    assert!(res.is_ok());
+    assert_eq!(written.len(), 3 * 2880);
+    assert!(written[2880..6880].iter().all(|&b| b == 7));
+}
+
+#[test]
+fn fits_header_from_camera() {
+    //given
+    let ctx_info = GetQHYCCDChipInfo_context();
+    ctx_info.expect().times(1).returning_st(
+        |_handle, chipw, chiph, imagew, imageh, pixelw, pixelh, bpp| unsafe {
+            *chipw = 3124.1;
+            *chiph = 500.5;
+            *imagew = 1024;
+            *imageh = 768;
+            *pixelw = 2.4;
+            *pixelh = 2.4;
+            *bpp = 16;
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .times(4)
+        .returning_st(|_handle, control| match control {
+            c if c == Control::CurTemp as u32 => QHYCCD_ERROR,
+            _ => QHYCCD_SUCCESS,
+        });
+    let ctx_param = GetQHYCCDParam_context();
+    ctx_param
+        .expect()
+        .times(3)
+        .returning_st(|_handle, control| match control {
+            c if c == Control::Exposure as u32 => 2_000_000.0,
+            c if c == Control::Gain as u32 => 30.0,
+            _ => QHYCCD_ERROR_F64,
+        });
+    let cam = new_camera();
+    //when
+    let header = cam.fits_header().unwrap();
+    //then
+    assert_eq!(
+        header.get("instrume"),
+        Some(&FitsValue::String("test_camera".to_owned()))
+    );
+    assert_eq!(header.get("XPIXSZ"), Some(&FitsValue::Float(2.4)));
+    assert_eq!(header.get("EXPTIME"), Some(&FitsValue::Float(2.0)));
+    assert_eq!(header.get("GAIN"), Some(&FitsValue::Float(30.0)));
+    assert_eq!(header.get("OFFSET"), None);
+    assert_eq!(header.get("CCD-TEMP"), None);
+}
+
+#[test]
+fn write_fits_keeps_cards_valid() {
+    //given
+    let image = ImageData {
+        data: vec![0],
+        width: 1,
+        height: 1,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    let mut header = FitsHeader::new();
+    header
+        .set("LONG", "x".repeat(67) + "'tail", "")
+        .set("OBSERVER", "Jürgen", "naïve")
+        .set("NAN", f64::NAN, "")
+        .set("INF", f64::INFINITY, "")
+        .set("EXPTIME", 1.5, "");
+    //when
+    let mut out = Vec::new();
+    image.write_fits(&mut out, &header).unwrap();
+    //then
+    let cards = cards(&out);
+    assert!(out.is_ascii());
+    assert_eq!(cards[5], format!("LONG    = '{}'", "x".repeat(67)));
+    assert_eq!(cards[6], "OBSERVER= 'J?rgen  ' / na?ve");
+    assert_eq!(cards[7], "EXPTIME =                  1.5");
+    assert_eq!(cards.len(), 8);
+}
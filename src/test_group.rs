@@ -0,0 +1,135 @@
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    ExpQHYCCDSingleFrame_context, GetQHYCCDMemLength_context, GetQHYCCDSingleFrame_context,
+    OpenQHYCCD_context, QHYCCD_SUCCESS,
+};
+
+const HANDLE_A: *const std::ffi::c_void = 0xa as *const std::ffi::c_void;
+const HANDLE_B: *const std::ffi::c_void = 0xb as *const std::ffi::c_void;
+
+fn new_camera(id: &str, handle: *const std::ffi::c_void) -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(handle);
+    let camera = Camera::new(id.to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+/// a 2x2 8 bit frame filled with the low byte of the handle, so the frames can be told apart
+fn frame_of_handle(
+    handle: *const std::ffi::c_void,
+    width: *mut u32,
+    height: *mut u32,
+    bpp: *mut u32,
+    channels: *mut u32,
+    buffer: *mut u8,
+) -> u32 {
+    unsafe {
+        *width = 2;
+        *height = 2;
+        *bpp = 8;
+        *channels = 1;
+        buffer.write_bytes(handle as usize as u8, 4);
+    }
+    QHYCCD_SUCCESS
+}
+
+#[test]
+fn capture_returns_a_frame_per_camera() {
+    //given
+    let cameras = [new_camera("cam_a", HANDLE_A), new_camera("cam_b", HANDLE_B)];
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let ctx_exposure = ExpQHYCCDSingleFrame_context();
+    ctx_exposure.expect().times(2).return_const(QHYCCD_SUCCESS);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().returning(frame_of_handle);
+    let group = CameraGroup::new(&cameras).unwrap();
+    //when
+    let frames = group.capture();
+    //then
+    assert_eq!(group.len(), 2);
+    let frames: Vec<GroupFrame> = frames.into_iter().map(Result::unwrap).collect();
+    assert_eq!(frames[0].camera, "cam_a");
+    assert_eq!(frames[0].image.data, vec![0xa; 4]);
+    assert_eq!(frames[1].camera, "cam_b");
+    assert_eq!(frames[1].image.data, vec![0xb; 4]);
+    assert!(frames.iter().any(|frame| frame.offset == Duration::ZERO));
+    assert!(frames
+        .iter()
+        .all(|frame| frame.offset < Duration::from_secs(1)));
+}
+
+#[test]
+fn capture_starts_exposures_after_all_cameras_are_ready() {
+    //given
+    let cameras = [new_camera("cam_a", HANDLE_A), new_camera("cam_b", HANDLE_B)];
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let group = CameraGroup::new(&cameras).unwrap();
+    let ready = Arc::new(AtomicBool::new(false));
+    ctx_size.checkpoint();
+    ctx_size
+        .expect()
+        .withf(|handle| *handle == HANDLE_A)
+        .return_const(4_u32);
+    let slow = ready.clone();
+    ctx_size
+        .expect()
+        .withf(|handle| *handle == HANDLE_B)
+        .returning(move |_handle| {
+            // camera b takes a while to get ready, camera a must not start without it
+            std::thread::sleep(Duration::from_millis(50));
+            slow.store(true, Ordering::SeqCst);
+            4
+        });
+    let early = Arc::new(AtomicBool::new(false));
+    let started = ready.clone();
+    let started_early = early.clone();
+    let ctx_exposure = ExpQHYCCDSingleFrame_context();
+    ctx_exposure.expect().times(2).returning(move |_handle| {
+        if !started.load(Ordering::SeqCst) {
+            started_early.store(true, Ordering::SeqCst);
+        }
+        QHYCCD_SUCCESS
+    });
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().returning(frame_of_handle);
+    //when
+    let frames = group.capture();
+    //then
+    assert!(frames.iter().all(Result::is_ok));
+    assert!(!early.load(Ordering::SeqCst));
+}
+
+#[test]
+fn capture_reports_failing_camera_and_keeps_the_others() {
+    //given
+    let cameras = [new_camera("cam_a", HANDLE_A), new_camera("cam_b", HANDLE_B)];
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let ctx_exposure = ExpQHYCCDSingleFrame_context();
+    ctx_exposure
+        .expect()
+        .withf(|handle| *handle == HANDLE_A)
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    ctx_exposure
+        .expect()
+        .withf(|handle| *handle == HANDLE_B)
+        .times(1)
+        .return_const(QHYCCD_ERROR);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().returning(frame_of_handle);
+    let group = CameraGroup::new(&cameras).unwrap();
+    //when
+    let frames = group.capture();
+    //then
+    let frame = frames[0].as_ref().unwrap();
+    assert_eq!(frame.camera, "cam_a");
+    assert_eq!(frame.offset, Duration::ZERO);
+    assert!(frames[1].is_err());
+}
@@ -0,0 +1,89 @@
+use super::*;
+
+fn image(data: Vec<u8>, width: u32, height: u32, bits_per_pixel: u32, channels: u32) -> ImageData {
+    ImageData {
+        data,
+        width,
+        height,
+        bits_per_pixel,
+        channels,
+        metadata: None,
+    }
+}
+
+#[test]
+fn as_u8_slice_strips_buffer_tail() {
+    //given
+    let image = image(vec![1, 2, 3, 4, 0, 0, 0, 0], 2, 2, 8, 1);
+    //when
+    let res = image.as_u8_slice();
+    //then
+    assert_eq!(res, &[1, 2, 3, 4]);
+}
+
+#[test]
+fn as_u8_slice_short_buffer() {
+    //given
+    let image = image(vec![1, 2], 2, 2, 8, 1);
+    //when
+    let res = image.as_u8_slice();
+    //then
+    assert_eq!(res, &[1, 2]);
+}
+
+#[test]
+fn as_u16_slice_success() {
+    //given
+    let mut image = image(
+        vec![0x01, 0x00, 0x00, 0x01, 0xff, 0xff, 0x34, 0x12, 0, 0],
+        2,
+        2,
+        16,
+        1,
+    );
+    //when
+    let res = image.as_u16_slice();
+    //then
+    assert_eq!(res, Some(&[0x0001_u16, 0x0100, 0xffff, 0x1234][..]));
+    assert!(std::ptr::eq(
+        res.unwrap().as_ptr() as *const u8,
+        image.data.as_ptr()
+    ));
+    image.as_u16_slice_mut().unwrap()[0] = 0x0302;
+    assert_eq!(&image.data[..2], &[0x02, 0x03]);
+}
+
+#[test]
+fn as_u16_slice_8bit_image() {
+    //given
+    let image = image(vec![1, 2, 3, 4], 2, 2, 8, 1);
+    //when
+    let res = image.as_u16_slice();
+    //then
+    assert!(res.is_none());
+}
+
+#[test]
+fn rows_with_channels() {
+    //given
+    let image = image((0..12).collect(), 2, 2, 8, 3);
+    //when
+    let rows: Vec<&[u8]> = image.rows().collect();
+    //then
+    assert_eq!(image.row_stride(), 6);
+    assert_eq!(
+        rows,
+        vec![&[0, 1, 2, 3, 4, 5][..], &[6, 7, 8, 9, 10, 11][..]]
+    );
+}
+
+#[test]
+fn rows_u16_success() {
+    //given
+    let image = image(vec![1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0], 3, 2, 16, 1);
+    //when
+    let rows: Vec<&[u16]> = image.rows_u16().unwrap().collect();
+    //then
+    assert_eq!(image.row_stride(), 6);
+    assert_eq!(rows, vec![&[1_u16, 2, 3][..], &[4, 5, 6][..]]);
+}
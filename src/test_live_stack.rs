@@ -0,0 +1,126 @@
+use std::sync::atomic::{AtomicU8, Ordering};
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    BeginQHYCCDLive_context, GetQHYCCDLiveFrame_context, GetQHYCCDMemLength_context,
+    OpenQHYCCD_context, StopQHYCCDLive_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn wait_for(condition: impl Fn() -> bool) {
+    let deadline = std::time::Instant::now() + Duration::from_secs(5);
+    while !condition() {
+        assert!(std::time::Instant::now() < deadline, "timed out");
+        std::thread::sleep(Duration::from_millis(1));
+    }
+}
+
+fn live_stream(cam: &Camera) -> LiveStream {
+    cam.begin_live_stream(LiveStreamOptions {
+        depth: 2,
+        policy: OverflowPolicy::DropOldest,
+        poll_interval: Duration::from_millis(1),
+    })
+    .unwrap()
+}
+
+#[test]
+fn live_stack_averages_frames() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let counter = Arc::new(AtomicU8::new(0));
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            // alternates between 10 and 20
+            let value = 10 + 10 * (counter.fetch_add(1, Ordering::SeqCst) % 2);
+            buffer.write_bytes(value, 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let stacker = live_stream(&cam)
+        .stack(LiveStackOptions {
+            kappa: None,
+            snapshot_interval: Duration::ZERO,
+        })
+        .unwrap();
+    //when
+    wait_for(|| stacker.latest().is_some_and(|stack| stack.frames >= 20));
+    let stack = stacker.latest().unwrap();
+    //then
+    assert_eq!((stack.width, stack.height, stack.channels), (2, 2, 1));
+    // frames dropped by the stream may tip the balance a little
+    assert!(stack.data.iter().all(|&sample| sample == stack.data[0]));
+    assert!((12.0..=18.0).contains(&stack.data[0]), "{:?}", stack);
+    assert!(stacker.is_running());
+    assert!(stacker.stop().is_ok());
+}
+
+#[test]
+fn live_stack_rejects_outliers_and_resets() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let counter = Arc::new(AtomicU8::new(0));
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            std::thread::sleep(Duration::from_millis(2));
+            // a meteor crosses every tenth frame
+            let value = match counter.fetch_add(1, Ordering::SeqCst) % 10 {
+                9 => 250,
+                _ => 40,
+            };
+            buffer.write_bytes(value, 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let stacker = live_stream(&cam)
+        .stack(LiveStackOptions {
+            kappa: Some(3.0),
+            snapshot_interval: Duration::ZERO,
+        })
+        .unwrap();
+    //when
+    wait_for(|| stacker.frames() >= 30);
+    stacker.reset();
+    wait_for(|| stacker.frames() < 30);
+    wait_for(|| stacker.latest().is_some_and(|stack| stack.frames >= 30));
+    let stack = stacker.latest().unwrap();
+    //then
+    assert!(
+        stack.data.iter().all(|&sample| sample == 40.0),
+        "{:?}",
+        stack
+    );
+    assert!(stacker.stop().is_ok());
+}
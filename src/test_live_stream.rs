@@ -0,0 +1,287 @@
+use std::sync::atomic::{AtomicU8, Ordering};
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    BeginQHYCCDLive_context, GetQHYCCDLiveFrame_context, GetQHYCCDMemLength_context,
+    OpenQHYCCD_context, SetQHYCCDParam_context, StopQHYCCDLive_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn wait_for(condition: impl Fn() -> bool) {
+    let deadline = std::time::Instant::now() + Duration::from_secs(5);
+    while !condition() {
+        assert!(std::time::Instant::now() < deadline, "timed out");
+        std::thread::sleep(Duration::from_millis(1));
+    }
+}
+
+#[test]
+fn live_stream_delivers_frames() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let counter = Arc::new(AtomicU8::new(0));
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame
+        .expect()
+        .withf(|handle, _width, _height, _bpp, _channels, _buffer| *handle == TEST_HANDLE)
+        .returning(
+            move |_handle, width, height, bpp, channels, buffer| unsafe {
+                let count = counter.fetch_add(1, Ordering::SeqCst);
+                // every other call there is no new frame yet
+                if count % 2 == 1 {
+                    return QHYCCD_ERROR;
+                }
+                *width = 2;
+                *height = 2;
+                *bpp = 8;
+                *channels = 1;
+                buffer.write_bytes(count, 4);
+                QHYCCD_SUCCESS
+            },
+        );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let stream = cam
+        .begin_live_stream(LiveStreamOptions {
+            depth: 2,
+            policy: OverflowPolicy::BlockProducer,
+            poll_interval: Duration::from_millis(1),
+        })
+        .unwrap();
+    let first = stream.next_frame().unwrap();
+    let second = stream.next_frame().unwrap();
+    //then
+    assert_eq!(first.width, 2);
+    assert_eq!(first.data, vec![0, 0, 0, 0]);
+    assert_eq!(second.data, vec![2, 2, 2, 2]);
+    assert_eq!(stream.dropped_frames(), 0);
+    assert!(stream.is_running());
+    drop(first);
+    drop(second);
+    assert!(stream.stop().is_ok());
+}
+
+#[test]
+fn live_stream_drop_oldest() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let counter = Arc::new(AtomicU8::new(0));
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            buffer.write_bytes(counter.fetch_add(1, Ordering::SeqCst), 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let stream = cam
+        .begin_live_stream(LiveStreamOptions {
+            depth: 1,
+            policy: OverflowPolicy::DropOldest,
+            poll_interval: Duration::from_millis(1),
+        })
+        .unwrap();
+    //when
+    wait_for(|| stream.dropped_frames() > 2);
+    let frame = stream.try_next_frame();
+    //then
+    assert!(frame.is_some());
+    assert!(frame.unwrap().data[0] > 0);
+    assert!(stream.stop().is_ok());
+}
+
+#[test]
+fn live_stream_capture_error_stops_stream() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(2).returning(|_handle| {
+        static CALLS: AtomicU8 = AtomicU8::new(0);
+        // the first call sizes the pool, the second one fails in the capture thread
+        match CALLS.fetch_add(1, Ordering::SeqCst) {
+            0 => 4,
+            _ => QHYCCD_ERROR,
+        }
+    });
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let stream = cam.begin_live_stream(LiveStreamOptions::default()).unwrap();
+    //when
+    let res = stream.next_frame();
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::LiveStreamStoppedError.to_string()
+    );
+    assert!(!stream.is_running());
+    assert!(stream.stop().is_ok());
+}
+
+#[test]
+fn live_stream_begin_live_fail() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_ERROR);
+    let cam = new_camera();
+    //when
+    let res = cam.begin_live_stream(LiveStreamOptions::default());
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.err().unwrap().to_string(),
+        QHYError::BeginLiveError {
+            error_code: QHYCCD_ERROR
+        }
+        .to_string()
+    );
+}
+
+#[test]
+fn live_stream_next_frame_timeout() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().return_const(QHYCCD_ERROR);
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let stream = cam.begin_live_stream(LiveStreamOptions::default()).unwrap();
+    //when
+    let res = stream.next_frame_timeout(Duration::from_millis(20));
+    //then
+    assert!(res.is_ok());
+    assert!(res.unwrap().is_none());
+    assert_eq!(stream.delivered_frames(), 0);
+    drop(stream);
+}
+
+#[test]
+fn live_stream_frames_carry_metadata() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            buffer.write_bytes(1, 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    cam.set_parameter(Control::Exposure, 20000.0).unwrap();
+    let stream = cam
+        .begin_live_stream(LiveStreamOptions {
+            depth: 1,
+            policy: OverflowPolicy::DropOldest,
+            poll_interval: Duration::from_millis(1),
+        })
+        .unwrap();
+    //when
+    wait_for(|| stream.dropped_frames() > 2);
+    let first = stream.next_frame().unwrap();
+    let second = stream.next_frame().unwrap();
+    //then
+    let (first, second) = (first.metadata.unwrap(), second.metadata.unwrap());
+    assert!(second.sequence > first.sequence);
+    // the frames dropped in between leave a gap
+    assert_eq!(
+        second.sequence - first.sequence - 1,
+        second.dropped - first.dropped
+    );
+    assert!(first.dropped >= 2);
+    assert!(second.captured >= first.captured);
+    assert_eq!(first.exposure, Some(Duration::from_millis(20)));
+    assert_eq!(
+        first.exposure_start(),
+        Some(first.exposure_end - Duration::from_millis(20))
+    );
+    assert!(first.exposure_end <= first.timestamp);
+    assert!(first.latency() > Duration::ZERO);
+    drop(stream);
+}
+
+#[test]
+fn live_stream_polls_through_a_worker() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const(4_u32);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            buffer.write_bytes(7, 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(0);
+    let cam = new_camera();
+    let worker = cam.spawn_worker().unwrap();
+    let stream = worker
+        .begin_live_stream(LiveStreamOptions {
+            depth: 2,
+            policy: OverflowPolicy::BlockProducer,
+            poll_interval: Duration::from_millis(1),
+        })
+        .unwrap();
+    //when
+    let first = stream.next_frame().unwrap();
+    let executed = worker.executed();
+    worker.stop().unwrap();
+    while stream.next_frame().is_ok() {}
+    //then
+    assert_eq!(first.data, vec![7, 7, 7, 7]);
+    // begin_live and at least the poll of the first frame
+    assert!(executed >= 2);
+    assert!(!stream.is_running());
+    // live mode can not be ended anymore without the worker
+    assert!(matches!(
+        stream.stop().unwrap_err().downcast_ref::<QHYError>(),
+        Some(WorkerStoppedError)
+    ));
+}
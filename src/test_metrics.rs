@@ -0,0 +1,179 @@
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    BeginQHYCCDLive_context, ExpQHYCCDSingleFrame_context, GetQHYCCDLiveFrame_context,
+    GetQHYCCDMemLength_context, GetQHYCCDSingleFrame_context, OpenQHYCCD_context,
+    StopQHYCCDLive_context, QHYCCD_SUCCESS,
+};
+use std::time::Duration;
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+#[test]
+fn metrics_count_single_frames() {
+    //given
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    let mut calls = 0;
+    ctx_frame.expect().times(2).returning_st(
+        move |_handle, width, height, bpp, channels, _buffer| unsafe {
+            calls += 1;
+            if calls == 2 {
+                return QHYCCD_ERROR;
+            }
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let pool = FramePool::new(2, 4);
+    //when
+    cam.start_single_frame_exposure().unwrap();
+    let image = cam.get_single_frame_pooled(&pool).unwrap();
+    let res = cam.get_single_frame(4);
+    let metrics = cam.clone().metrics();
+    //then
+    assert!(res.is_err());
+    assert_eq!(image.data.len(), 4);
+    assert_eq!(metrics.single.frames, 1);
+    assert_eq!(metrics.single.errors, 1);
+    assert_eq!(metrics.single.bytes, 4);
+    assert_eq!(metrics.single.latency.count, 1);
+    assert_eq!(metrics.live.frames, 0);
+    assert!(metrics.exposure_started.is_some());
+    assert!(metrics.last_frame >= metrics.exposure_started);
+    assert!(metrics.exposure_ended >= metrics.last_frame);
+    assert_eq!(
+        metrics.pool,
+        Some(PoolOccupancy {
+            capacity: 2,
+            available: 2
+        })
+    );
+}
+
+#[test]
+fn metrics_tell_not_ready_from_errors() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    let mut calls = 0;
+    ctx_frame.expect().times(3).returning_st(
+        move |_handle, width, height, bpp, channels, _buffer| unsafe {
+            calls += 1;
+            match calls {
+                1 => QHYCCD_ERROR,
+                2 => 7,
+                _ => {
+                    *width = 2;
+                    *height = 1;
+                    *bpp = 16;
+                    *channels = 1;
+                    QHYCCD_SUCCESS
+                }
+            }
+        },
+    );
+    let cam = new_camera();
+    let mut buffer = vec![0_u8; 4];
+    //when
+    let not_ready = cam.poll_live_frame_into(&mut buffer);
+    let failed = cam.poll_live_frame_into(&mut buffer);
+    let frame = cam.poll_live_frame_into(&mut buffer);
+    let metrics = cam.metrics();
+    //then
+    assert_eq!(not_ready.unwrap(), None);
+    assert!(failed.is_err());
+    assert!(frame.unwrap().is_some());
+    assert_eq!(metrics.live.not_ready, 1);
+    assert_eq!(metrics.live.errors, 1);
+    assert_eq!(metrics.live.frames, 1);
+    assert_eq!(metrics.live.bytes, 4);
+    assert_eq!(metrics.pool, None);
+}
+
+#[test]
+fn reset_metrics_clears_counters() {
+    //given
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    let _ = cam.get_single_frame(4);
+    //when
+    cam.reset_metrics();
+    //then
+    let metrics = cam.metrics();
+    assert_eq!(metrics.single.errors, 0);
+    assert_eq!(metrics.bytes_per_second(), 0.0);
+}
+
+#[test]
+fn latency_histogram_quantiles() {
+    //given
+    let mut buckets = [0; LATENCY_BUCKETS];
+    buckets[0] = 1;
+    buckets[3] = 2;
+    buckets[12] = 1;
+    let histogram = LatencyHistogram {
+        count: 4,
+        total: Duration::from_micros(3000),
+        max: Duration::from_micros(2990),
+        buckets,
+    };
+    //when
+    let median = histogram.quantile(0.5);
+    let max = histogram.quantile(1.0);
+    //then
+    assert_eq!(median, Duration::from_micros(8));
+    assert_eq!(max, Duration::from_micros(2990));
+    assert_eq!(histogram.mean(), Duration::from_micros(750));
+    assert_eq!(histogram.quantile(0.0), Duration::from_micros(1));
+}
+
+#[test]
+fn latency_histogram_mean_of_many_calls() {
+    //given
+    let histogram = LatencyHistogram {
+        count: 1 << 32,
+        total: Duration::from_micros(3 << 32),
+        max: Duration::from_micros(10),
+        buckets: [0; LATENCY_BUCKETS],
+    };
+    //when
+    let mean = histogram.mean();
+    //then
+    assert_eq!(mean, Duration::from_micros(3));
+}
+
+#[test]
+fn metrics_time_live_mode() {
+    //given
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    cam.begin_live().unwrap();
+    let live = cam.metrics();
+    cam.end_live().unwrap();
+    let stopped = cam.metrics();
+    //then
+    assert!(live.exposure_started.is_some());
+    assert_eq!(live.exposure_ended, None);
+    assert!(stopped.exposure_ended >= stopped.exposure_started);
+}
@@ -0,0 +1,220 @@
+use std::collections::HashMap;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDParam_context, InitQHYCCD_context, OpenQHYCCD_context, SetQHYCCDBitsMode_context,
+    SetQHYCCDParam_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+/// an open camera whose capabilities are already cached: gain, offset and transfer bits from 0 to 100 in
+/// steps of 1 and usb traffic without a range
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    let ranged = ControlCapability {
+        value: QHYCCD_SUCCESS,
+        min_max_step: Some((0.0, 100.0, 1.0)),
+    };
+    let controls = HashMap::from([
+        (Control::Gain, ranged),
+        (Control::Offset, ranged),
+        (Control::TransferBit, ranged),
+        (
+            Control::UsbTraffic,
+            ControlCapability {
+                value: QHYCCD_SUCCESS,
+                min_max_step: None,
+            },
+        ),
+    ]);
+    camera
+        .handle
+        .set_capabilities(Some(Arc::new(CameraCapabilities {
+            controls,
+            ccd_info: None,
+            effective_area: None,
+            overscan_area: None,
+            readout_modes: Vec::new(),
+        })));
+    camera
+}
+
+#[test]
+fn apply_sends_only_changed_values() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf_st(|handle, control, value| {
+            *handle == TEST_HANDLE && *control == Control::Gain as u32 && *value == 10.0
+        })
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    ctx_set
+        .expect()
+        .withf_st(|_handle, control, _value| *control == Control::Offset as u32)
+        .times(2)
+        .return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let first = cam.apply(&[(Control::Gain, 10.0), (Control::Offset, 20.0)]);
+    let second = cam.apply(&[(Control::Gain, 10.0), (Control::Offset, 21.0)]);
+    //then
+    assert!(matches!(first.as_slice(), [Ok(true), Ok(true)]));
+    assert!(matches!(second.as_slice(), [Ok(false), Ok(true)]));
+}
+
+#[test]
+fn apply_knows_values_from_set_parameter() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    cam.set_parameter(Control::Gain, 10.0).unwrap();
+    let res = cam.apply(&[(Control::Gain, 10.0)]);
+    //then
+    assert!(matches!(res.as_slice(), [Ok(false)]));
+}
+
+#[test]
+fn apply_sends_everything_again_after_init() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_init = InitQHYCCD_context();
+    ctx_init.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let first = cam.apply(&[(Control::Gain, 10.0)]);
+    cam.init().unwrap();
+    let second = cam.apply(&[(Control::Gain, 10.0)]);
+    //then
+    assert!(matches!(first.as_slice(), [Ok(true)]));
+    assert!(matches!(second.as_slice(), [Ok(true)]));
+}
+
+#[test]
+fn apply_sends_transfer_bits_again_after_set_bit_mode() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf_st(|_handle, control, value| {
+            *control == Control::TransferBit as u32 && *value == 16.0
+        })
+        .times(2)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_bits = SetQHYCCDBitsMode_context();
+    ctx_bits
+        .expect()
+        .withf_st(|_handle, bits| *bits == 8)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let first = cam.apply(&[(Control::TransferBit, 16.0)]);
+    cam.set_bit_mode(8).unwrap();
+    let second = cam.apply(&[(Control::TransferBit, 16.0)]);
+    //then
+    assert!(matches!(first.as_slice(), [Ok(true)]));
+    assert!(matches!(second.as_slice(), [Ok(true)]));
+}
+
+#[test]
+fn apply_retries_after_failure() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().times(1).return_const_st(QHYCCD_ERROR);
+    ctx_set.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let first = cam.apply(&[(Control::Gain, 10.0)]);
+    let second = cam.apply(&[(Control::Gain, 10.0)]);
+    //then
+    assert!(first[0].is_err());
+    assert!(matches!(second.as_slice(), [Ok(true)]));
+}
+
+#[test]
+fn apply_rejects_invalid_values_without_sdk_calls() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf_st(|_handle, control, _value| *control == Control::UsbTraffic as u32)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    //when
+    let res = cam.apply(&[
+        (Control::Gain, 101.0),
+        (Control::Gain, 10.5),
+        (Control::Exposure, 1000.0),
+        (Control::UsbTraffic, 1234.0),
+    ]);
+    //then
+    assert_eq!(res.len(), 4);
+    for invalid in &res[..2] {
+        assert!(matches!(
+            invalid.as_ref().unwrap_err().downcast_ref::<QHYError>(),
+            Some(InvalidParameterError {
+                control: Control::Gain,
+                ..
+            })
+        ));
+    }
+    assert!(matches!(
+        res[2].as_ref().unwrap_err().downcast_ref::<QHYError>(),
+        Some(IsControlAvailableError {
+            control: Control::Exposure
+        })
+    ));
+    assert!(matches!(res[3], Ok(true)));
+}
+
+#[test]
+fn apply_on_closed_camera() {
+    //given
+    let cam = Camera::new("test_camera".to_owned());
+    //when
+    let res = cam.apply(&[(Control::Gain, 10.0), (Control::Offset, 20.0)]);
+    //then
+    assert_eq!(res.len(), 2);
+    assert!(res.iter().all(Result::is_err));
+}
+
+#[test]
+fn read_many_returns_a_result_per_control() {
+    //given
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get
+        .expect()
+        .withf_st(|handle, _control| *handle == TEST_HANDLE)
+        .times(2)
+        .returning_st(|_handle, control| match control {
+            c if c == Control::Gain as u32 => 10.0,
+            _ => QHYCCD_ERROR_F64,
+        });
+    let cam = new_camera();
+    //when
+    let res = cam.read_many(&[Control::Gain, Control::Offset, Control::Exposure]);
+    //then
+    assert_eq!(res[0].as_ref().unwrap(), &10.0);
+    assert!(matches!(
+        res[1].as_ref().unwrap_err().downcast_ref::<QHYError>(),
+        Some(GetParameterError {
+            control: Control::Offset
+        })
+    ));
+    assert!(matches!(
+        res[2].as_ref().unwrap_err().downcast_ref::<QHYError>(),
+        Some(IsControlAvailableError {
+            control: Control::Exposure
+        })
+    ));
+}
@@ -0,0 +1,101 @@
+use super::*;
+
+#[test]
+fn new_preallocates() {
+    //given
+    //when
+    let pool = FramePool::new(3, 16);
+    //then
+    assert_eq!(pool.capacity(), 3);
+    assert_eq!(pool.available(), 3);
+    assert_eq!(pool.buffer_size(), 16);
+}
+
+#[test]
+fn acquire_and_return() {
+    //given
+    let pool = FramePool::new(2, 16);
+    //when
+    let buffer = pool.acquire();
+    //then
+    assert_eq!(buffer.len(), 16);
+    assert_eq!(pool.available(), 1);
+    drop(buffer);
+    assert_eq!(pool.available(), 2);
+}
+
+#[test]
+fn acquire_allocates_when_empty() {
+    //given
+    let pool = FramePool::new(1, 16);
+    let first = pool.acquire();
+    //when
+    let second = pool.acquire();
+    //then
+    assert_eq!(second.len(), 16);
+    drop(first);
+    drop(second);
+    assert_eq!(pool.available(), 1);
+}
+
+#[test]
+fn try_acquire_empty() {
+    //given
+    let pool = FramePool::new(1, 16);
+    let _first = pool.try_acquire().unwrap();
+    //when
+    let second = pool.try_acquire();
+    //then
+    assert!(second.is_none());
+}
+
+#[test]
+fn resize_drops_outstanding_buffers() {
+    //given
+    let pool = FramePool::new(2, 16);
+    let buffer = pool.acquire();
+    //when
+    pool.resize(32);
+    drop(buffer);
+    //then
+    assert_eq!(pool.available(), 1);
+    assert_eq!(pool.acquire().len(), 32);
+}
+
+#[test]
+fn pooled_image_returns_buffer() {
+    //given
+    let pool = FramePool::new(1, 4);
+    let mut buffer = pool.acquire();
+    buffer.copy_from_slice(&[1, 2, 3, 4]);
+    //when
+    let image = buffer.into_image(FrameInfo {
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+    });
+    //then
+    assert_eq!(image.data, vec![1, 2, 3, 4]);
+    assert_eq!(image.width, 2);
+    assert_eq!(pool.available(), 0);
+    std::thread::spawn(move || drop(image)).join().unwrap();
+    assert_eq!(pool.available(), 1);
+}
+
+#[test]
+fn pooled_image_into_image_detaches() {
+    //given
+    let pool = FramePool::new(1, 4);
+    let image = pool.acquire().into_image(FrameInfo {
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+    });
+    //when
+    let image = image.into_image();
+    //then
+    assert_eq!(image.data.len(), 4);
+    assert_eq!(pool.available(), 0);
+}
@@ -0,0 +1,276 @@
+use std::collections::HashMap;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    BeginQHYCCDLive_context, GetQHYCCDChipInfo_context, GetQHYCCDEffectiveArea_context,
+    GetQHYCCDMemLength_context, GetQHYCCDNumberOfReadModes_context, GetQHYCCDOverScanArea_context,
+    GetQHYCCDParamMinMaxStep_context, InitQHYCCD_context, IsQHYCCDControlAvailable_context,
+    OpenQHYCCD_context, SetQHYCCDBinMode_context, SetQHYCCDBitsMode_context,
+    SetQHYCCDParam_context, SetQHYCCDReadMode_context, SetQHYCCDResolution_context,
+    SetQHYCCDStreamMode_context, StopQHYCCDLive_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+/// an open camera with gain from 0 to 100 and exposure without a range in its cached capabilities
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    let controls = HashMap::from([
+        (
+            Control::Gain,
+            ControlCapability {
+                value: QHYCCD_SUCCESS,
+                min_max_step: Some((0.0, 100.0, 1.0)),
+            },
+        ),
+        (
+            Control::Exposure,
+            ControlCapability {
+                value: QHYCCD_SUCCESS,
+                min_max_step: None,
+            },
+        ),
+    ]);
+    camera
+        .handle
+        .set_capabilities(Some(Arc::new(CameraCapabilities {
+            controls,
+            ccd_info: None,
+            effective_area: None,
+            overscan_area: None,
+            readout_modes: Vec::new(),
+        })));
+    camera
+}
+
+fn area(width: u32, height: u32) -> CCDChipArea {
+    CCDChipArea {
+        start_x: 0,
+        start_y: 0,
+        width,
+        height,
+    }
+}
+
+fn science() -> CaptureConfig {
+    CaptureConfig {
+        stream_mode: Some(StreamMode::LiveMode),
+        bit_mode: Some(16),
+        bin: Some(1),
+        roi: Some(area(200, 100)),
+        parameters: vec![(Control::Gain, 30.0)],
+        ..Default::default()
+    }
+}
+
+#[test]
+fn reconfigure_changes_only_what_differs() {
+    //given
+    let ctx_stream = SetQHYCCDStreamMode_context();
+    ctx_stream.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_init = InitQHYCCD_context();
+    ctx_init.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bits = SetQHYCCDBitsMode_context();
+    ctx_bits
+        .expect()
+        .withf_st(|_handle, bits| *bits == 16)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_bin = SetQHYCCDBinMode_context();
+    ctx_bin
+        .expect()
+        .withf_st(|_handle, x, y| (*x, *y) == (1, 1))
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    ctx_bin
+        .expect()
+        .withf_st(|_handle, x, y| (*x, *y) == (2, 2))
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_roi = SetQHYCCDResolution_context();
+    ctx_roi.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param
+        .expect()
+        .withf_st(|_handle, control, _value| *control == Control::Gain as u32)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size
+        .expect()
+        .times(1)
+        .return_const_st(200 * 100 * 2_u32);
+    ctx_size.expect().times(1).return_const_st(50 * 50 * 2_u32);
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    let pool = FramePool::new(2, 16);
+    let focus = CaptureConfig {
+        bin: Some(2),
+        roi: Some(area(50, 50)),
+        ..science()
+    };
+    //when
+    let first = cam.reconfigure(&science(), Some(&pool)).unwrap();
+    cam.begin_live().unwrap();
+    let second = cam.reconfigure(&focus, Some(&pool)).unwrap();
+    //then
+    assert_eq!(
+        first,
+        Reconfiguration {
+            initialized: true,
+            live_restarted: false,
+            changes: 5,
+            image_size: 40000,
+        }
+    );
+    assert_eq!(
+        second,
+        Reconfiguration {
+            initialized: false,
+            live_restarted: true,
+            changes: 2,
+            image_size: 5000,
+        }
+    );
+    assert_eq!(pool.buffer_size(), 5000);
+}
+
+#[test]
+fn reconfigure_restores_settings_after_init() {
+    //given
+    let ctx_read_mode = SetQHYCCDReadMode_context();
+    ctx_read_mode
+        .expect()
+        .withf_st(|_handle, mode| *mode == 1)
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_stream = SetQHYCCDStreamMode_context();
+    ctx_stream.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_init = InitQHYCCD_context();
+    ctx_init.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bits = SetQHYCCDBitsMode_context();
+    ctx_bits.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bin = SetQHYCCDBinMode_context();
+    ctx_bin.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_roi = SetQHYCCDResolution_context();
+    ctx_roi
+        .expect()
+        .withf_st(|_handle, _x, _y, width, height| (*width, *height) == (200, 100))
+        .times(2)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param
+        .expect()
+        .withf_st(|_handle, control, value| *control == Control::Gain as u32 && *value == 30.0)
+        .times(2)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(2).return_const_st(40000_u32);
+    // the readout mode drops the cached capabilities, apply queries them again
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .returning_st(|_handle, control| match control {
+            c if c == Control::Gain as u32 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        });
+    let ctx_range = GetQHYCCDParamMinMaxStep_context();
+    ctx_range.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_modes = GetQHYCCDNumberOfReadModes_context();
+    ctx_modes.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_chip = GetQHYCCDChipInfo_context();
+    ctx_chip.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_effective = GetQHYCCDEffectiveArea_context();
+    ctx_effective.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_overscan = GetQHYCCDOverScanArea_context();
+    ctx_overscan.expect().return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    cam.reconfigure(&science(), None).unwrap();
+    //when
+    let res = cam.reconfigure(
+        &CaptureConfig {
+            readout_mode: Some(1),
+            ..Default::default()
+        },
+        None,
+    );
+    //then
+    let res = res.unwrap();
+    assert!(res.initialized);
+    // readout mode, stream mode, bit mode, binning, ROI and gain
+    assert_eq!(res.changes, 6);
+}
+
+#[test]
+fn reconfigure_reports_the_first_failure() {
+    //given
+    let ctx_stream = SetQHYCCDStreamMode_context();
+    ctx_stream.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_init = InitQHYCCD_context();
+    ctx_init.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let cam = new_camera();
+    //when
+    let res = cam.reconfigure(&science(), None);
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(InitCameraError {
+            error_code: QHYCCD_ERROR
+        })
+    ));
+}
+
+#[test]
+fn reconfigure_starts_live_mode_again_after_a_failure() {
+    //given
+    let ctx_stream = SetQHYCCDStreamMode_context();
+    ctx_stream.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_init = InitQHYCCD_context();
+    ctx_init.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bits = SetQHYCCDBitsMode_context();
+    ctx_bits.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_bin = SetQHYCCDBinMode_context();
+    ctx_bin
+        .expect()
+        .withf_st(|_handle, x, y| (*x, *y) == (1, 1))
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    ctx_bin
+        .expect()
+        .withf_st(|_handle, x, y| (*x, *y) == (2, 2))
+        .times(1)
+        .return_const_st(QHYCCD_ERROR);
+    let ctx_roi = SetQHYCCDResolution_context();
+    ctx_roi.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_param = SetQHYCCDParam_context();
+    ctx_param.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().times(1).return_const_st(40000_u32);
+    let ctx_begin = BeginQHYCCDLive_context();
+    ctx_begin.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let ctx_stop = StopQHYCCDLive_context();
+    ctx_stop.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let cam = new_camera();
+    cam.reconfigure(&science(), None).unwrap();
+    cam.begin_live().unwrap();
+    let focus = CaptureConfig {
+        bin: Some(2),
+        ..science()
+    };
+    //when
+    let res = cam.reconfigure(&focus, None);
+    //then
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(SetBinModeError {
+            error_code: QHYCCD_ERROR
+        })
+    ));
+    assert!(cam.handle.modes().live);
+}
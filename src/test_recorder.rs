@@ -0,0 +1,244 @@
+use std::sync::atomic::{AtomicU8, Ordering};
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDLiveFrame_context, GetQHYCCDMemLength_context, OpenQHYCCD_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn temp_path(name: &str) -> std::path::PathBuf {
+    std::env::temp_dir().join(format!("qhyccd-rs-{}-{}.ser", std::process::id(), name))
+}
+
+fn read_i32(bytes: &[u8], offset: usize) -> i32 {
+    i32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+#[test]
+fn ser_recorder_writes_header_frames_and_timestamps() {
+    //given
+    let path = temp_path("frames");
+    let info = FrameInfo {
+        width: 3,
+        height: 2,
+        bits_per_pixel: 16,
+        channels: 1,
+    };
+    let options = SerOptions {
+        observer: "observer".to_owned(),
+        telescope: "a telescope with a name longer than forty bytes".to_owned(),
+        bayer: Some(BayerMode::RGGB),
+        ..Default::default()
+    };
+    let mut recorder = SerRecorder::create(&path, info, 100, options).unwrap();
+    let frames: Vec<ImageData> = (0..3_u8)
+        .map(|frame| ImageData {
+            data: vec![frame; 12],
+            width: 3,
+            height: 2,
+            bits_per_pixel: 16,
+            channels: 1,
+            metadata: None,
+        })
+        .collect();
+    //when
+    for frame in &frames {
+        recorder.write_frame(frame).unwrap();
+    }
+    let res = recorder.finish();
+    //then
+    let written = std::fs::read(&path).unwrap();
+    std::fs::remove_file(&path).unwrap();
+    assert_eq!(res.unwrap(), 3);
+    assert_eq!(written.len(), 178 + 3 * 12 + 3 * 8);
+    assert_eq!(&written[..14], b"LUCAM-RECORDER");
+    assert_eq!(read_i32(&written, 18), 8);
+    assert_eq!(
+        (
+            read_i32(&written, 26),
+            read_i32(&written, 30),
+            read_i32(&written, 34),
+            read_i32(&written, 38)
+        ),
+        (3, 2, 16, 3)
+    );
+    assert_eq!(&written[42..50], b"observer");
+    assert_eq!(
+        &written[122..162],
+        b"a telescope with a name longer than fort"
+    );
+    for frame in 0..3 {
+        let start = 178 + frame * 12;
+        assert!(written[start..start + 12].iter().all(|&b| b == frame as u8));
+    }
+    let ticks: Vec<u64> = written[178 + 36..]
+        .chunks_exact(8)
+        .map(|bytes| u64::from_le_bytes(bytes.try_into().unwrap()))
+        .collect();
+    // after 2020-01-01
+    assert!(ticks[0] > 637_134_336_000_000_000);
+    assert!(ticks.windows(2).all(|pair| pair[0] <= pair[1]));
+    assert_eq!(&written[162..170], &ticks[0].to_le_bytes());
+}
+
+#[test]
+fn ser_recorder_records_live_frames_in_place() {
+    //given
+    // the SDK asks for more room than the frame takes
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(8_u32);
+    let counter = AtomicU8::new(0);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame.expect().returning_st(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            let count = counter.fetch_add(1, Ordering::SeqCst);
+            if count == 1 {
+                return QHYCCD_ERROR;
+            }
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            // the SDK fills its whole buffer
+            buffer.write_bytes(count + 1, 8);
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let path = temp_path("live");
+    let info = FrameInfo {
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+    };
+    let mut recorder = SerRecorder::create(&path, info, 2, SerOptions::default()).unwrap();
+    //when
+    let recorded: Vec<bool> = (0..3)
+        .map(|_| recorder.record_live_frame(&cam).unwrap())
+        .collect();
+    let full = recorder.record_live_frame(&cam);
+    drop(recorder);
+    //then
+    let written = std::fs::read(&path).unwrap();
+    std::fs::remove_file(&path).unwrap();
+    assert_eq!(recorded, vec![true, false, true]);
+    assert!(matches!(
+        full.unwrap_err().downcast_ref::<QHYError>(),
+        Some(RecorderFullError { capacity: 2 })
+    ));
+    assert_eq!(written.len(), 178 + 2 * 4 + 2 * 8);
+    assert_eq!(read_i32(&written, 38), 2);
+    assert_eq!(&written[178..186], &[1, 1, 1, 1, 3, 3, 3, 3]);
+}
+
+#[test]
+fn ser_recorder_rejects_other_frames() {
+    //given
+    let path = temp_path("mismatch");
+    let info = FrameInfo {
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+    };
+    let mut recorder = SerRecorder::create(&path, info, 2, SerOptions::default()).unwrap();
+    let image = ImageData {
+        data: vec![0; 6],
+        width: 3,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    let short = ImageData {
+        data: vec![0; 3],
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    };
+    //when
+    let res = recorder.write_frame(&image);
+    let truncated = recorder.write_frame(&short);
+    let frames = recorder.frames();
+    let unsupported = SerRecorder::create(
+        temp_path("unsupported"),
+        FrameInfo {
+            channels: 4,
+            ..info
+        },
+        2,
+        SerOptions::default(),
+    );
+    drop(recorder);
+    //then
+    std::fs::remove_file(&path).unwrap();
+    assert!(matches!(
+        res.unwrap_err().downcast_ref::<QHYError>(),
+        Some(FrameMismatchError { width: 3, .. })
+    ));
+    assert!(matches!(
+        truncated.unwrap_err().downcast_ref::<QHYError>(),
+        Some(BufferTooSmallError {
+            needed: 4,
+            available: 3
+        })
+    ));
+    assert_eq!(frames, 0);
+    assert!(matches!(
+        unsupported.unwrap_err().downcast_ref::<QHYError>(),
+        Some(UnsupportedImageError { channels: 4, .. })
+    ));
+}
+
+#[test]
+fn ser_recorder_allocates_the_whole_file_up_front() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(8_u32);
+    let ctx_frame = GetQHYCCDLiveFrame_context();
+    ctx_frame
+        .expect()
+        .returning_st(|_handle, width, height, bpp, channels, _buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        });
+    let cam = new_camera();
+    let path = temp_path("allocate");
+    let info = FrameInfo {
+        width: 2,
+        height: 2,
+        bits_per_pixel: 8,
+        channels: 1,
+    };
+    let mut recorder = SerRecorder::create(&path, info, 3, SerOptions::default()).unwrap();
+    let created = std::fs::metadata(&path).unwrap();
+    //when
+    recorder.record_live_frame(&cam).unwrap();
+    let reserved = std::fs::metadata(&path).unwrap();
+    drop(recorder);
+    //then
+    std::fs::remove_file(&path).unwrap();
+    assert_eq!(created.len(), 178 + 3 * 4);
+    // the SDK buffer behind the last slot is reserved with the first frame
+    assert_eq!(reserved.len(), 178 + 2 * 4 + 8);
+    #[cfg(target_os = "linux")]
+    {
+        use std::os::unix::fs::MetadataExt;
+        assert!(created.blocks() * 512 >= created.len());
+    }
+}
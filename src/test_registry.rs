@@ -0,0 +1,134 @@
+use std::cell::RefCell;
+use std::rc::Rc;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    CloseQHYCCD_context, GetQHYCCDId_context, InitQHYCCDResource_context, OpenQHYCCD_context,
+    ReleaseQHYCCDResource_context, ScanQHYCCD_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+/// the ids the mocked SDK lists, change them to plug and unplug cameras
+type Connected = Rc<RefCell<Vec<&'static str>>>;
+
+/// scan and id expectations listing `connected`, they are returned so they outlive the registry
+fn mock_scan(connected: &Connected) -> impl Sized {
+    let ctx_scan = ScanQHYCCD_context();
+    let listed = connected.clone();
+    ctx_scan
+        .expect()
+        .returning_st(move || listed.borrow().len() as u32);
+    let ctx_id = GetQHYCCDId_context();
+    let listed = connected.clone();
+    ctx_id.expect().returning_st(move |index, c_id| unsafe {
+        let id = format!("{}\0", listed.borrow()[index as usize]);
+        c_id.copy_from(id.as_ptr() as *const c_char, id.len());
+        QHYCCD_SUCCESS
+    });
+    (ctx_scan, ctx_id)
+}
+
+fn new_registry() -> DeviceRegistry {
+    let ctx_init = InitQHYCCDResource_context();
+    ctx_init.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let sdk = Sdk::new_with(SdkOptions {
+        probe_filter_wheels: false,
+        ..Default::default()
+    })
+    .unwrap();
+    DeviceRegistry::new(sdk)
+}
+
+fn capabilities() -> Arc<CameraCapabilities> {
+    Arc::new(CameraCapabilities {
+        controls: HashMap::new(),
+        ccd_info: None,
+        effective_area: None,
+        overscan_area: None,
+        readout_modes: Vec::new(),
+    })
+}
+
+#[test]
+fn rescan_tracks_lost_added_and_recovered_cameras() {
+    //given
+    let connected: Connected = Rc::new(RefCell::new(vec!["QHY600M-1", "QHY268C-2"]));
+    let _scan = mock_scan(&connected);
+    let ctx_release = ReleaseQHYCCDResource_context();
+    ctx_release
+        .expect()
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(2).return_const_st(TEST_HANDLE);
+    let ctx_close = CloseQHYCCD_context();
+    // the SDK can not close a camera that is gone, it is closed anyway
+    ctx_close.expect().times(1).return_const_st(QHYCCD_ERROR);
+    let registry = new_registry();
+    let events = registry.subscribe();
+    let camera = registry.camera("QHY600M-1").unwrap();
+    camera.open().unwrap();
+    camera.handle.set_capabilities(Some(capabilities()));
+    //when
+    *connected.borrow_mut() = vec!["QHY268C-2", "QHY294M-3"];
+    let lost = registry.rescan().unwrap();
+    let lost_open = camera.is_open().unwrap();
+    *connected.borrow_mut() = vec!["QHY600M-1", "QHY268C-2", "QHY294M-3"];
+    let back = registry.rescan().unwrap();
+    let unchanged = registry.rescan().unwrap();
+    //then
+    assert_eq!(
+        lost,
+        vec![
+            DeviceEvent::Lost("QHY600M-1".to_owned()),
+            DeviceEvent::Added("QHY294M-3".to_owned()),
+        ]
+    );
+    assert!(!lost_open);
+    assert_eq!(back, vec![DeviceEvent::Recovered("QHY600M-1".to_owned())]);
+    assert!(unchanged.is_empty());
+    assert!(camera.is_open().unwrap());
+    assert!(camera.handle.capabilities().is_some());
+    assert_eq!(registry.cameras().len(), 3);
+    assert_eq!(events.try_iter().collect::<Vec<_>>(), [lost, back].concat());
+}
+
+#[test]
+fn recover_reopens_only_the_reset_camera() {
+    //given
+    let connected: Connected = Rc::new(RefCell::new(vec!["QHY600M-1", "QHY268C-2"]));
+    let _scan = mock_scan(&connected);
+    let ctx_release = ReleaseQHYCCDResource_context();
+    ctx_release
+        .expect()
+        .times(1)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open
+        .expect()
+        .withf_st(|id| unsafe { CStr::from_ptr(*id) }.to_str() == Ok("QHY600M-1"))
+        .times(2)
+        .return_const_st(TEST_HANDLE);
+    let ctx_close = CloseQHYCCD_context();
+    ctx_close.expect().times(1).return_const_st(QHYCCD_SUCCESS);
+    let registry = new_registry();
+    let camera = registry.camera("QHY600M-1").unwrap();
+    camera.open().unwrap();
+    camera.handle.set_capabilities(Some(capabilities()));
+    camera.handle.applied().insert(Control::Gain, 30.0);
+    //when
+    let res = registry.recover("QHY600M-1");
+    let missing = registry.recover("QHY174M-9");
+    //then
+    assert!(res.is_ok());
+    assert!(camera.is_open().unwrap());
+    assert!(camera.handle.capabilities().is_some());
+    // the camera reset, the values it had are gone
+    assert!(camera.handle.applied().is_empty());
+    assert!(!registry.camera("QHY268C-2").unwrap().is_open().unwrap());
+    assert!(matches!(
+        missing.unwrap_err().downcast_ref::<QHYError>(),
+        Some(DeviceNotFoundError { id }) if id == "QHY174M-9"
+    ));
+}
@@ -351,3 +351,134 @@ fn new_fail_close() {
     assert_eq!(sdk.filter_wheels().count(), 0);
     assert!(sdk.filter_wheels().last().is_none());
 }
+
+#[test]
+fn new_with_parallel_keep_open() {
+    //given
+    let ctx_init = InitQHYCCDResource_context();
+    ctx_init.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_scan = ScanQHYCCD_context();
+    ctx_scan.expect().times(1).return_const(2_u32);
+    let ctx_id = GetQHYCCDId_context();
+    ctx_id
+        .expect()
+        .times(2)
+        .returning(|index, c_id| match index {
+            0 => unsafe {
+                let cam_id = "QHY178M-222b16468c5966524\0";
+                c_id.copy_from(cam_id.as_ptr() as *const c_char, cam_id.len());
+                QHYCCD_SUCCESS
+            },
+            1 => unsafe {
+                let cam_id = "QHY178M-222b16468c5966525\0";
+                c_id.copy_from(cam_id.as_ptr() as *const c_char, cam_id.len());
+                QHYCCD_SUCCESS
+            },
+            _ => panic!("too many calls"),
+        });
+    const ADDR1: *const core::ffi::c_void = 0xdeadbeef as *mut std::ffi::c_void;
+    const ADDR2: *const core::ffi::c_void = 0xdeadbeea as *mut std::ffi::c_void;
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open
+        .expect()
+        .times(2)
+        .returning(|c_id| match unsafe { CStr::from_ptr(c_id) }.to_str() {
+            Ok("QHY178M-222b16468c5966524") => ADDR1,
+            Ok("QHY178M-222b16468c5966525") => ADDR2,
+            _ => panic!("invalid id"),
+        });
+    let ctx_plugged = IsQHYCCDCFWPlugged_context();
+    ctx_plugged
+        .expect()
+        .times(2)
+        .returning(|handle| match handle {
+            ADDR1 => QHYCCD_SUCCESS,
+            ADDR2 => QHYCCD_ERROR,
+            _ => panic!("invalid handle"),
+        });
+    let ctx_close = CloseQHYCCD_context();
+    ctx_close.expect().never();
+    let ctx_release = ReleaseQHYCCDResource_context();
+    ctx_release.expect().return_const(QHYCCD_SUCCESS);
+    //when
+    let sdk = Sdk::new_with(SdkOptions {
+        parallel: true,
+        probe_filter_wheels: true,
+        keep_open: true,
+    })
+    .unwrap();
+    //then
+    let ids: Vec<_> = sdk.cameras().map(|camera| camera.id().to_owned()).collect();
+    assert_eq!(
+        ids,
+        vec!["QHY178M-222b16468c5966524", "QHY178M-222b16468c5966525"]
+    );
+    assert!(sdk.cameras().all(|camera| camera.is_open().unwrap()));
+    assert_eq!(sdk.filter_wheels().count(), 1);
+    assert!(sdk.filter_wheels().last().unwrap().is_open().unwrap());
+}
+
+#[test]
+fn new_with_lazy_filter_wheels() {
+    //given
+    let ctx_init = InitQHYCCDResource_context();
+    ctx_init.expect().times(1).return_const(QHYCCD_SUCCESS);
+    let ctx_scan = ScanQHYCCD_context();
+    ctx_scan.expect().times(1).return_const(2_u32);
+    let ctx_id = GetQHYCCDId_context();
+    ctx_id
+        .expect()
+        .times(2)
+        .returning(|index, c_id| match index {
+            0 => unsafe {
+                let cam_id = "QHY178M-222b16468c5966524\0";
+                c_id.copy_from(cam_id.as_ptr() as *const c_char, cam_id.len());
+                QHYCCD_SUCCESS
+            },
+            1 => unsafe {
+                let cam_id = "QHY178M-222b16468c5966525\0";
+                c_id.copy_from(cam_id.as_ptr() as *const c_char, cam_id.len());
+                QHYCCD_SUCCESS
+            },
+            _ => panic!("too many calls"),
+        });
+    let ctx_release = ReleaseQHYCCDResource_context();
+    ctx_release.expect().return_const(QHYCCD_SUCCESS);
+    let sdk = Sdk::new_with(SdkOptions {
+        parallel: true,
+        probe_filter_wheels: false,
+        keep_open: false,
+    })
+    .unwrap();
+    assert_eq!(sdk.cameras().count(), 2);
+    const ADDR1: *const core::ffi::c_void = 0xdeadbeef as *mut std::ffi::c_void;
+    const ADDR2: *const core::ffi::c_void = 0xdeadbeea as *mut std::ffi::c_void;
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open
+        .expect()
+        .times(2)
+        .returning(|c_id| match unsafe { CStr::from_ptr(c_id) }.to_str() {
+            Ok("QHY178M-222b16468c5966524") => ADDR1,
+            Ok("QHY178M-222b16468c5966525") => ADDR2,
+            _ => panic!("invalid id"),
+        });
+    let ctx_plugged = IsQHYCCDCFWPlugged_context();
+    ctx_plugged
+        .expect()
+        .times(2)
+        .returning(|handle| match handle {
+            ADDR1 => QHYCCD_ERROR,
+            ADDR2 => QHYCCD_SUCCESS,
+            _ => panic!("invalid handle"),
+        });
+    let ctx_close = CloseQHYCCD_context();
+    ctx_close.expect().times(2).return_const(QHYCCD_SUCCESS);
+    //when
+    let filter_wheels: Vec<_> = sdk.filter_wheels().collect();
+    //then
+    assert_eq!(filter_wheels.len(), 1);
+    assert_eq!(filter_wheels[0].id(), "QHY178M-222b16468c5966525");
+    assert!(sdk.cameras().all(|camera| !camera.is_open().unwrap()));
+    // detected only once
+    assert_eq!(sdk.filter_wheels().count(), 1);
+}
@@ -0,0 +1,342 @@
+use std::cell::{Cell, RefCell};
+use std::rc::Rc;
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    ExpQHYCCDSingleFrame_context, GetQHYCCDCFWStatus_context, GetQHYCCDExposureRemaining_context,
+    GetQHYCCDMemLength_context, GetQHYCCDParam_context, GetQHYCCDSingleFrame_context,
+    IsQHYCCDControlAvailable_context, OpenQHYCCD_context, SetQHYCCDParam_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn step(count: u32, exposure_ms: u64, filter: Option<u32>) -> SequenceStep {
+    SequenceStep {
+        count,
+        exposure: Duration::from_millis(exposure_ms),
+        gain: Some(10.0),
+        filter,
+    }
+}
+
+fn one_worker() -> SequencerOptions {
+    SequencerOptions {
+        workers: 1,
+        queue_depth: 1,
+        filter_timeout: Duration::from_secs(1),
+    }
+}
+
+#[test]
+fn run_changes_settings_only_when_needed() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_SUCCESS);
+    let parameters = Rc::new(RefCell::new(Vec::new()));
+    let ctx_set = SetQHYCCDParam_context();
+    let sent = parameters.clone();
+    ctx_set
+        .expect()
+        .withf_st(|handle, _control, _value| *handle == TEST_HANDLE)
+        .returning_st(move |_handle, control, value| {
+            sent.borrow_mut().push((control, value));
+            QHYCCD_SUCCESS
+        });
+    let ctx_get = GetQHYCCDParam_context();
+    let position = parameters.clone();
+    ctx_get.expect().returning_st(move |_handle, _control| {
+        position
+            .borrow()
+            .iter()
+            .rev()
+            .find(|(control, _)| *control == Control::CfwPort as u32)
+            .map_or(QHYCCD_ERROR_F64, |(_, value)| *value)
+    });
+    // a camera without the status call, the wheel position is read instead
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    ctx_status.expect().return_const_st(QHYCCD_ERROR);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const_st(0_u32);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(3).return_const_st(QHYCCD_SUCCESS);
+    let counter = Cell::new(0_u8);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().times(3).returning_st(
+        move |_handle, width, height, bpp, channels, buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            counter.set(counter.get() + 1);
+            buffer.write_bytes(counter.get(), 4);
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let fw = FilterWheel::new(cam.clone());
+    let sequencer = Sequencer::new(&cam, Some(&fw), one_worker());
+    let frames = Mutex::new(Vec::new());
+    //when
+    let res = sequencer.run(&[step(2, 1, Some(0)), step(1, 2, Some(1))], |frame| {
+        frames
+            .lock()
+            .unwrap()
+            .push((frame.index, frame.step, frame.filter, frame.image.data[0]));
+        Ok(())
+    });
+    //then
+    assert!(res.is_ok());
+    assert_eq!(res.unwrap().frames, 3);
+    assert_eq!(
+        frames.into_inner().unwrap(),
+        vec![(0, 0, Some(0), 1), (1, 0, Some(0), 2), (2, 1, Some(1), 3)]
+    );
+    assert_eq!(
+        *parameters.borrow(),
+        vec![
+            (Control::CfwPort as u32, 48.0),
+            (Control::Exposure as u32, 1000.0),
+            (Control::Gain as u32, 10.0),
+            (Control::CfwPort as u32, 49.0),
+            (Control::Exposure as u32, 2000.0),
+        ]
+    );
+}
+
+#[test]
+fn run_stops_when_sink_fails() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().return_const_st(QHYCCD_SUCCESS);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().return_const_st(QHYCCD_SUCCESS);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame
+        .expect()
+        .returning_st(|_handle, width, height, bpp, channels, _buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        });
+    let cam = new_camera();
+    let sequencer = Sequencer::new(&cam, None, one_worker());
+    let calls = Mutex::new(0);
+    //when
+    let res = sequencer.run(&[step(10, 1, None)], |_frame| {
+        *calls.lock().unwrap() += 1;
+        Err(eyre!("disk full"))
+    });
+    //then
+    assert!(res.is_err());
+    assert_eq!(res.unwrap_err().to_string(), "disk full");
+    assert_eq!(calls.into_inner().unwrap(), 1);
+}
+
+#[test]
+fn run_keeps_frames_taken_before_camera_fails() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set.expect().return_const_st(QHYCCD_SUCCESS);
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(2).return_const_st(QHYCCD_SUCCESS);
+    let first = Cell::new(true);
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().times(2).returning_st(
+        move |_handle, width, height, bpp, channels, _buffer| unsafe {
+            if !first.replace(false) {
+                return QHYCCD_ERROR;
+            }
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let sequencer = Sequencer::new(&cam, None, one_worker());
+    let calls = Mutex::new(0);
+    //when
+    let res = sequencer.run(&[step(5, 1, None)], |_frame| {
+        *calls.lock().unwrap() += 1;
+        Ok(())
+    });
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::GetSingleFrameError {
+            error_code: QHYCCD_ERROR
+        }
+        .to_string()
+    );
+    assert_eq!(calls.into_inner().unwrap(), 1);
+}
+
+#[test]
+fn run_without_filter_wheel_fails() {
+    //given
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().never();
+    let cam = new_camera();
+    let sequencer = Sequencer::new(&cam, None, SequencerOptions::default());
+    //when
+    let res = sequencer.run(&[step(1, 1, Some(2))], |_frame| Ok(()));
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::SequencerNoFilterWheelError.to_string()
+    );
+}
+
+#[test]
+fn run_moves_the_filter_during_the_readout() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_SUCCESS);
+    let events = Rc::new(RefCell::new(Vec::new()));
+    let position = Rc::new(Cell::new(b'N'));
+    let ctx_set = SetQHYCCDParam_context();
+    let (sent, target) = (events.clone(), position.clone());
+    ctx_set
+        .expect()
+        .returning_st(move |_handle, control, value| {
+            if control == Control::CfwPort as u32 {
+                sent.borrow_mut().push(format!("move {}", value - 48.0));
+                target.set(value as u8);
+            }
+            QHYCCD_SUCCESS
+        });
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    ctx_status
+        .expect()
+        .returning_st(move |_handle, status| unsafe {
+            *status = position.get() as c_char;
+            QHYCCD_SUCCESS
+        });
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    let waited = events.clone();
+    ctx_remaining.expect().returning_st(move |_handle| {
+        waited.borrow_mut().push("remaining".to_owned());
+        0
+    });
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    let exposed = events.clone();
+    ctx_exp.expect().times(3).returning_st(move |_handle| {
+        exposed.borrow_mut().push("expose".to_owned());
+        QHYCCD_SUCCESS
+    });
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    let read = events.clone();
+    ctx_frame.expect().times(3).returning_st(
+        move |_handle, width, height, bpp, channels, _buffer| unsafe {
+            read.borrow_mut().push("readout".to_owned());
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let fw = FilterWheel::new(cam.clone());
+    let sequencer = Sequencer::new(&cam, Some(&fw), one_worker());
+    //when
+    let res = sequencer.run(&[step(1, 1, Some(2)), step(2, 1, Some(3))], |_frame| Ok(()));
+    //then
+    assert_eq!(res.unwrap().frames, 3);
+    assert_eq!(
+        *events.borrow(),
+        vec![
+            "move 2",
+            "expose",
+            "remaining",
+            "move 3",
+            "readout",
+            "expose",
+            "readout",
+            "expose",
+            "readout",
+        ]
+    );
+    assert_eq!(fw.position(), Some(3));
+}
+
+#[test]
+fn run_moves_the_filter_without_waiting_for_a_second_exposure() {
+    //given
+    let ctx_size = GetQHYCCDMemLength_context();
+    ctx_size.expect().return_const_st(4_u32);
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available.expect().return_const_st(QHYCCD_SUCCESS);
+    let position = Rc::new(Cell::new(b'N'));
+    let ctx_set = SetQHYCCDParam_context();
+    let target = position.clone();
+    ctx_set
+        .expect()
+        .returning_st(move |_handle, control, value| {
+            if control == Control::CfwPort as u32 {
+                target.set(value as u8);
+            }
+            QHYCCD_SUCCESS
+        });
+    let ctx_status = GetQHYCCDCFWStatus_context();
+    ctx_status
+        .expect()
+        .returning_st(move |_handle, status| unsafe {
+            *status = position.get() as c_char;
+            QHYCCD_SUCCESS
+        });
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const_st(0_u32);
+    // like the SDK, the start of a single frame returns once the exposure is done
+    let ctx_exp = ExpQHYCCDSingleFrame_context();
+    ctx_exp.expect().times(2).returning_st(|_handle| {
+        std::thread::sleep(Duration::from_millis(200));
+        QHYCCD_SUCCESS
+    });
+    let ctx_frame = GetQHYCCDSingleFrame_context();
+    ctx_frame.expect().times(2).returning_st(
+        |_handle, width, height, bpp, channels, _buffer| unsafe {
+            *width = 2;
+            *height = 2;
+            *bpp = 8;
+            *channels = 1;
+            QHYCCD_SUCCESS
+        },
+    );
+    let cam = new_camera();
+    let fw = FilterWheel::new(cam.clone());
+    let sequencer = Sequencer::new(&cam, Some(&fw), one_worker());
+    let started = Instant::now();
+    //when
+    let res = sequencer.run(&[step(1, 200, Some(2)), step(1, 200, Some(3))], |_frame| {
+        Ok(())
+    });
+    //then
+    let elapsed = started.elapsed();
+    assert_eq!(res.unwrap().frames, 2);
+    assert_eq!(fw.position(), Some(3));
+    // two exposures, another 200ms wait after the first one would push it past 600ms
+    assert!(elapsed < Duration::from_millis(550), "{:?}", elapsed);
+}
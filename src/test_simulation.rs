@@ -0,0 +1,247 @@
+use super::*;
+use std::time::{Duration, Instant};
+
+fn open(simulator: &SimCamera, index: u32) -> *const std::ffi::c_void {
+    unsafe {
+        assert!(simulator.ScanQHYCCD() > index);
+        let mut id: [c_char; 32] = [0; 32];
+        assert_eq!(
+            simulator.GetQHYCCDId(index, id.as_mut_ptr()),
+            QHYCCD_SUCCESS
+        );
+        let handle = simulator.OpenQHYCCD(id.as_ptr());
+        assert!(!handle.is_null());
+        handle
+    }
+}
+
+fn single_frame(simulator: &SimCamera, handle: *const std::ffi::c_void) -> (FrameInfo, Vec<u8>) {
+    let mut buffer = vec![0u8; unsafe { simulator.GetQHYCCDMemLength(handle) } as usize];
+    let (mut width, mut height, mut bpp, mut channels) = (0, 0, 0, 0);
+    unsafe {
+        assert_eq!(simulator.ExpQHYCCDSingleFrame(handle), QHYCCD_SUCCESS);
+        assert_eq!(
+            simulator.GetQHYCCDSingleFrame(
+                handle,
+                &mut width,
+                &mut height,
+                &mut bpp,
+                &mut channels,
+                buffer.as_mut_ptr()
+            ),
+            QHYCCD_SUCCESS
+        );
+    }
+    let info = FrameInfo {
+        width,
+        height,
+        bits_per_pixel: bpp,
+        channels,
+    };
+    buffer.truncate(info.data_len());
+    (info, buffer)
+}
+
+#[test]
+fn simulation_finds_configured_cameras() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        cameras: 3,
+        ..Default::default()
+    });
+    //when
+    let handle = open(&simulator, 2);
+    //then
+    let mut id: [c_char; 32] = [0; 32];
+    unsafe {
+        assert_eq!(simulator.GetQHYCCDId(2, id.as_mut_ptr()), QHYCCD_SUCCESS);
+        assert_eq!(CStr::from_ptr(id.as_ptr()).to_str().unwrap(), "SIM-0002");
+        assert_eq!(simulator.GetQHYCCDId(3, id.as_mut_ptr()), QHYCCD_ERROR);
+        assert_eq!(simulator.CloseQHYCCD(handle), QHYCCD_SUCCESS);
+        assert_eq!(simulator.InitQHYCCD(handle), QHYCCD_ERROR);
+    }
+}
+
+#[test]
+fn simulation_single_frame_takes_exposure_and_readout() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        width: 200,
+        height: 100,
+        // 20000 pixels in 20ms
+        pixel_rate: 1e6,
+        usb_bandwidth: f64::INFINITY,
+        ..Default::default()
+    });
+    let handle = open(&simulator, 0);
+    unsafe {
+        assert_eq!(
+            simulator.SetQHYCCDParam(handle, Control::Exposure as u32, 10_000.0),
+            QHYCCD_SUCCESS
+        );
+    }
+    //when
+    let started = Instant::now();
+    let (info, _) = single_frame(&simulator, handle);
+    let elapsed = started.elapsed();
+    //then
+    assert_eq!(
+        (info.width, info.height, info.bits_per_pixel),
+        (200, 100, 16)
+    );
+    assert!(elapsed >= Duration::from_millis(30), "{elapsed:?}");
+    // 8 bit and 2x2 binning read out four times faster
+    unsafe {
+        assert_eq!(simulator.SetQHYCCDBitsMode(handle, 8), QHYCCD_SUCCESS);
+        assert_eq!(simulator.SetQHYCCDBinMode(handle, 2, 2), QHYCCD_SUCCESS);
+    }
+    let started = Instant::now();
+    let (info, buffer) = single_frame(&simulator, handle);
+    let elapsed = started.elapsed();
+    assert_eq!((info.width, info.height, info.bits_per_pixel), (100, 50, 8));
+    assert_eq!(buffer.len(), 5000);
+    assert!(elapsed >= Duration::from_millis(15), "{elapsed:?}");
+    assert!(elapsed < Duration::from_millis(30), "{elapsed:?}");
+}
+
+#[test]
+fn simulation_shares_usb_bandwidth() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        cameras: 2,
+        width: 100,
+        height: 100,
+        pixel_rate: f64::INFINITY,
+        // 20000 bytes per frame in 20ms
+        usb_bandwidth: 1e6,
+        ..Default::default()
+    });
+    let handles = [open(&simulator, 0) as usize, unsafe {
+        let mut id: [c_char; 32] = [0; 32];
+        simulator.GetQHYCCDId(1, id.as_mut_ptr());
+        simulator.OpenQHYCCD(id.as_ptr()) as usize
+    }];
+    //when
+    let started = Instant::now();
+    std::thread::scope(|scope| {
+        for handle in handles {
+            let simulator = &simulator;
+            scope.spawn(move || single_frame(simulator, handle as *const std::ffi::c_void));
+        }
+    });
+    //then
+    let elapsed = started.elapsed();
+    assert!(elapsed >= Duration::from_millis(40), "{elapsed:?}");
+}
+
+#[test]
+fn simulation_live_frames_follow_exposure() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        width: 64,
+        height: 64,
+        pixel_rate: f64::INFINITY,
+        usb_bandwidth: f64::INFINITY,
+        ..Default::default()
+    });
+    let handle = open(&simulator, 0);
+    let mut buffer = vec![0u8; 64 * 64 * 2];
+    let (mut width, mut height, mut bpp, mut channels) = (0, 0, 0, 0);
+    let mut poll = || unsafe {
+        simulator.GetQHYCCDLiveFrame(
+            handle,
+            &mut width,
+            &mut height,
+            &mut bpp,
+            &mut channels,
+            buffer.as_mut_ptr(),
+        )
+    };
+    //when
+    unsafe {
+        assert_eq!(
+            simulator.SetQHYCCDParam(handle, Control::Exposure as u32, 20_000.0),
+            QHYCCD_SUCCESS
+        );
+        assert_eq!(simulator.BeginQHYCCDLive(handle), QHYCCD_SUCCESS);
+    }
+    let not_ready = poll();
+    std::thread::sleep(Duration::from_millis(25));
+    let ready = poll();
+    let too_early = poll();
+    //then
+    assert_eq!(not_ready, QHYCCD_ERROR);
+    assert_eq!(ready, QHYCCD_SUCCESS);
+    assert_eq!(too_early, QHYCCD_ERROR);
+    assert_eq!((width, height), (64, 64));
+}
+
+#[test]
+fn simulation_renders_stars() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        width: 256,
+        height: 256,
+        pixel_rate: f64::INFINITY,
+        usb_bandwidth: f64::INFINITY,
+        stars: 20,
+        ..Default::default()
+    });
+    let handle = open(&simulator, 0);
+    //when
+    let (_, buffer) = single_frame(&simulator, handle);
+    let (_, again) = single_frame(&simulator, handle);
+    //then
+    let image = ImageData {
+        data: buffer,
+        width: 256,
+        height: 256,
+        bits_per_pixel: 16,
+        channels: 1,
+        metadata: None,
+    };
+    let samples = image.as_u16_slice().unwrap();
+    let mut sorted = samples.to_vec();
+    sorted.sort_unstable();
+    let median = sorted[sorted.len() / 2];
+    assert!((1000..1064).contains(&median), "{median}");
+    // the brightest pixels are stars far above the background
+    assert!(sorted[sorted.len() - 1] > 5000);
+    assert_eq!(image.data, again);
+}
+
+#[test]
+fn simulation_filter_wheel_takes_time_per_slot() {
+    //given
+    let simulator = SimCamera::new(SimulationConfig {
+        filter_wheel: true,
+        filter_slot_time: Duration::from_millis(20),
+        ..Default::default()
+    });
+    let handle = open(&simulator, 0);
+    let status = |simulator: &SimCamera| {
+        let mut status: [c_char; 64] = [0; 64];
+        assert_eq!(
+            unsafe { simulator.GetQHYCCDCFWStatus(handle, status.as_mut_ptr()) },
+            QHYCCD_SUCCESS
+        );
+        status[0] as u8
+    };
+    //when
+    let before = status(&simulator);
+    let started = Instant::now();
+    // from slot 0 to 5 of 7 is two slots backwards
+    assert_eq!(
+        unsafe { simulator.SetQHYCCDParam(handle, Control::CfwPort as u32, 53.0) },
+        QHYCCD_SUCCESS
+    );
+    let moving = status(&simulator);
+    while status(&simulator) == b'N' {
+        std::thread::sleep(Duration::from_millis(1));
+    }
+    //then
+    let elapsed = started.elapsed();
+    assert_eq!((before, moving, status(&simulator)), (b'0', b'N', b'5'));
+    assert!(elapsed >= Duration::from_millis(40), "{:?}", elapsed);
+    assert!(elapsed < Duration::from_millis(250), "{:?}", elapsed);
+}
@@ -0,0 +1,168 @@
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDExposureRemaining_context, GetQHYCCDParam_context, IsQHYCCDControlAvailable_context,
+    OpenQHYCCD_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    camera
+}
+
+fn wait_for(condition: impl Fn() -> bool) {
+    let deadline = std::time::Instant::now() + Duration::from_secs(5);
+    while !condition() {
+        assert!(std::time::Instant::now() < deadline, "timed out");
+        std::thread::sleep(Duration::from_millis(1));
+    }
+}
+
+#[test]
+fn telemetry_publishes_samples() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .times(4)
+        .returning_st(|_handle, control| match control {
+            c if c == Control::CurTemp as u32 => QHYCCD_SUCCESS,
+            c if c == Control::CurPWM as u32 => QHYCCD_SUCCESS,
+            c if c == Control::CfwPort as u32 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        });
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get
+        .expect()
+        .returning(|_handle, control| match control {
+            c if c == Control::CurTemp as u32 => -10.5,
+            c if c == Control::CurPWM as u32 => 128.0,
+            c if c == Control::CfwPort as u32 => 50.0,
+            _ => QHYCCD_ERROR_F64,
+        });
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(5000_u32);
+    let cam = new_camera();
+    //when
+    let poller = cam.start_telemetry(TelemetryOptions::default()).unwrap();
+    let reader = poller.reader();
+    wait_for(|| reader.latest().samples > 0);
+    //then
+    let telemetry = reader.latest();
+    assert_eq!(telemetry.temperature, Some(-10.5));
+    assert_eq!(telemetry.cooler_pwm, Some(128.0));
+    assert_eq!(telemetry.cooler_target, None);
+    assert_eq!(telemetry.filter_position, Some(2));
+    assert_eq!(telemetry.remaining_exposure_us, Some(5000));
+    assert!(telemetry.sampled_at.is_some());
+    assert_eq!(poller.latest(), telemetry);
+    poller.stop();
+    assert_eq!(reader.latest(), telemetry);
+}
+
+#[test]
+fn telemetry_skips_filter_wheel_when_disabled() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .withf_st(|_handle, control| *control != Control::CfwPort as u32)
+        .times(3)
+        .return_const_st(QHYCCD_SUCCESS);
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get
+        .expect()
+        .withf(|_handle, control| *control != Control::CfwPort as u32)
+        .return_const(1.0);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(QHYCCD_ERROR);
+    let cam = new_camera();
+    //when
+    let poller = cam
+        .start_telemetry(TelemetryOptions {
+            filter_wheel: false,
+            ..Default::default()
+        })
+        .unwrap();
+    wait_for(|| poller.latest().samples > 0);
+    //then
+    let telemetry = poller.latest();
+    assert_eq!(telemetry.cooler_target, Some(1.0));
+    assert_eq!(telemetry.filter_position, None);
+    assert_eq!(telemetry.remaining_exposure_us, None);
+}
+
+#[test]
+fn telemetry_stops_without_waiting_for_the_interval() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .times(4)
+        .return_const_st(QHYCCD_ERROR);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(0_u32);
+    let cam = new_camera();
+    let poller = cam
+        .start_telemetry(TelemetryOptions {
+            interval: Duration::from_secs(3600),
+            ..Default::default()
+        })
+        .unwrap();
+    wait_for(|| poller.latest().samples > 0);
+    //when
+    let started = std::time::Instant::now();
+    poller.stop();
+    //then
+    assert!(started.elapsed() < Duration::from_secs(5));
+}
+
+#[test]
+fn telemetry_needs_open_camera() {
+    //given
+    let cam = Camera::new("test_camera".to_owned());
+    //when
+    let res = cam.start_telemetry(TelemetryOptions::default());
+    //then
+    assert!(res.is_err());
+}
+
+#[test]
+fn telemetry_samples_through_a_worker() {
+    //given
+    let ctx_available = IsQHYCCDControlAvailable_context();
+    ctx_available
+        .expect()
+        .returning(|_handle, control| match control {
+            c if c == Control::CurTemp as u32 => QHYCCD_SUCCESS,
+            _ => QHYCCD_ERROR,
+        });
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get.expect().return_const(-5.0);
+    let ctx_remaining = GetQHYCCDExposureRemaining_context();
+    ctx_remaining.expect().return_const(0_u32);
+    let cam = new_camera();
+    let worker = cam.spawn_worker().unwrap();
+    //when
+    let poller = worker
+        .start_telemetry(TelemetryOptions {
+            interval: Duration::from_millis(1),
+            ..Default::default()
+        })
+        .unwrap();
+    let reader = poller.reader();
+    wait_for(|| reader.latest().samples > 1);
+    worker.stop().unwrap();
+    poller.stop();
+    //then
+    // sampling ended with the worker, the reader keeps the last sample
+    let telemetry = reader.latest();
+    assert_eq!(telemetry.temperature, Some(-5.0));
+    assert!(telemetry.samples >= 2);
+}
@@ -0,0 +1,82 @@
+use super::*;
+
+fn image_4x3() -> ImageData {
+    ImageData {
+        data: (0..12).collect(),
+        width: 4,
+        height: 3,
+        bits_per_pixel: 8,
+        channels: 1,
+        metadata: None,
+    }
+}
+
+#[test]
+fn view_rows_borrow_image() {
+    //given
+    let image = image_4x3();
+    //when
+    let view = image
+        .view(CCDChipArea {
+            start_x: 1,
+            start_y: 1,
+            width: 3,
+            height: 2,
+        })
+        .unwrap();
+    //then
+    let rows: Vec<&[u8]> = view.rows().collect();
+    assert_eq!(rows, vec![&[5, 6, 7][..], &[9, 10, 11][..]]);
+    assert!(std::ptr::eq(rows[0].as_ptr(), &image.data[5]));
+    assert_eq!(view.to_image().data, vec![5, 6, 7, 9, 10, 11]);
+}
+
+#[test]
+fn view_rows_u16() {
+    //given
+    let image = ImageData {
+        data: (0..8_u16).flat_map(|v| v.to_le_bytes()).collect(),
+        width: 2,
+        height: 2,
+        bits_per_pixel: 16,
+        channels: 2,
+        metadata: None,
+    };
+    //when
+    let view = image
+        .view(CCDChipArea {
+            start_x: 1,
+            start_y: 0,
+            width: 1,
+            height: 2,
+        })
+        .unwrap();
+    //then
+    let rows: Vec<&[u16]> = view.rows_u16().unwrap().collect();
+    assert_eq!(rows, vec![&[2, 3][..], &[6, 7][..]]);
+}
+
+#[test]
+fn view_outside_of_image() {
+    //given
+    let image = image_4x3();
+    //when
+    let res = image.view(CCDChipArea {
+        start_x: 2,
+        start_y: 0,
+        width: 3,
+        height: 1,
+    });
+    //then
+    assert!(res.is_err());
+    assert_eq!(
+        res.unwrap_err().to_string(),
+        QHYError::InvalidAreaError {
+            start_x: 2,
+            start_y: 0,
+            width: 3,
+            height: 1
+        }
+        .to_string()
+    );
+}
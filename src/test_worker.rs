@@ -0,0 +1,193 @@
+use std::collections::HashMap;
+use std::sync::mpsc::{self, Sender};
+use std::time::Duration;
+
+use super::*;
+use crate::mocks::mock_libqhyccd_sys::{
+    GetQHYCCDParam_context, OpenQHYCCD_context, SetQHYCCDParam_context, QHYCCD_SUCCESS,
+};
+
+const TEST_HANDLE: *const std::ffi::c_void = 0xdeadbeef as *const std::ffi::c_void;
+
+/// an open camera with gain and offset in its cached capabilities
+fn new_camera() -> Camera {
+    let ctx_open = OpenQHYCCD_context();
+    ctx_open.expect().times(1).return_const_st(TEST_HANDLE);
+    let camera = Camera::new("test_camera".to_owned());
+    camera.open().unwrap();
+    let controls = [Control::Gain, Control::Offset]
+        .into_iter()
+        .map(|control| {
+            (
+                control,
+                ControlCapability {
+                    value: QHYCCD_SUCCESS,
+                    min_max_step: None,
+                },
+            )
+        })
+        .collect::<HashMap<_, _>>();
+    camera
+        .handle
+        .set_capabilities(Some(Arc::new(CameraCapabilities {
+            controls,
+            ccd_info: None,
+            effective_area: None,
+            overscan_area: None,
+            readout_modes: Vec::new(),
+        })));
+    camera
+}
+
+/// keeps the worker busy until the returned sender is dropped or sent to
+fn hold(worker: &CameraWorker) -> (Sender<()>, Pending<()>) {
+    let (release, released) = mpsc::channel::<()>();
+    let (started, running) = mpsc::channel();
+    let pending = worker.submit(Priority::Control, move |_camera| {
+        started.send(()).unwrap();
+        let _ = released.recv();
+        Ok(())
+    });
+    running.recv().unwrap();
+    (release, pending)
+}
+
+#[test]
+fn worker_executes_by_priority() {
+    //given
+    let worker = Camera::new("test_camera".to_owned())
+        .spawn_worker()
+        .unwrap();
+    let order = Arc::new(Mutex::new(Vec::new()));
+    let (release, held) = hold(&worker);
+    let queued: Vec<Pending<()>> = [
+        Priority::Telemetry,
+        Priority::Control,
+        Priority::Readout,
+        Priority::Telemetry,
+        Priority::Readout,
+    ]
+    .into_iter()
+    .enumerate()
+    .map(|(index, priority)| {
+        let order = order.clone();
+        worker.submit(priority, move |_camera| {
+            order.lock().unwrap().push(index);
+            Ok(())
+        })
+    })
+    .collect();
+    assert_eq!(worker.queued(), 5);
+    //when
+    release.send(()).unwrap();
+    held.wait().unwrap();
+    queued
+        .into_iter()
+        .for_each(|pending| pending.wait().unwrap());
+    //then
+    assert_eq!(*order.lock().unwrap(), vec![2, 4, 1, 0, 3]);
+    assert_eq!(worker.executed(), 6);
+    assert_eq!(
+        worker
+            .call(Priority::Readout, |camera| Ok(camera.id().to_owned()))
+            .unwrap(),
+        "test_camera"
+    );
+}
+
+#[test]
+fn worker_coalesces_writes_and_reads() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf(|_handle, control, value| *control == Control::Gain as u32 && *value == 20.0)
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    ctx_set
+        .expect()
+        .withf(|_handle, control, value| *control == Control::Offset as u32 && *value == 5.0)
+        .times(1)
+        .return_const(QHYCCD_SUCCESS);
+    let ctx_get = GetQHYCCDParam_context();
+    ctx_get
+        .expect()
+        .withf(|_handle, control| *control == Control::Gain as u32)
+        .times(1)
+        .return_const(20.0);
+    let worker = new_camera().spawn_worker().unwrap();
+    let (release, held) = hold(&worker);
+    let writes = [
+        worker.set_parameter(Control::Gain, 10.0),
+        worker.set_parameter(Control::Offset, 5.0),
+        worker.set_parameter(Control::Gain, 20.0),
+    ];
+    let reads = [
+        worker.get_parameter(Control::Gain),
+        worker.get_parameter(Control::Gain),
+    ];
+    //when
+    release.send(()).unwrap();
+    held.wait().unwrap();
+    //then
+    for write in writes {
+        assert!(write.wait().unwrap());
+    }
+    for read in reads {
+        assert_eq!(read.wait().unwrap(), 20.0);
+    }
+    assert_eq!(worker.coalesced(), 3);
+    // the hold, one batch of writes and one of reads
+    assert_eq!(worker.executed(), 3);
+    assert_eq!(worker.queued(), 0);
+}
+
+#[test]
+fn worker_keeps_writes_in_order_with_other_commands() {
+    //given
+    let ctx_set = SetQHYCCDParam_context();
+    ctx_set
+        .expect()
+        .withf(|_handle, control, _value| *control == Control::Gain as u32)
+        .times(2)
+        .return_const(QHYCCD_SUCCESS);
+    let worker = new_camera().spawn_worker().unwrap();
+    let (release, held) = hold(&worker);
+    let first = worker.set_parameter(Control::Gain, 10.0);
+    let between = worker.submit(Priority::Control, |camera| {
+        Ok(camera.handle.applied().get(&Control::Gain).copied())
+    });
+    let second = worker.set_parameter(Control::Gain, 20.0);
+    //when
+    release.send(()).unwrap();
+    held.wait().unwrap();
+    //then
+    assert!(first.wait().unwrap());
+    assert_eq!(between.wait().unwrap(), Some(10.0));
+    assert!(second.wait().unwrap());
+    assert_eq!(worker.coalesced(), 0);
+}
+
+#[test]
+fn worker_stop_drops_queued_commands() {
+    //given
+    let worker = Camera::new("test_camera".to_owned())
+        .spawn_worker()
+        .unwrap();
+    let (started, running) = mpsc::channel();
+    let busy = worker.submit(Priority::Control, move |_camera| {
+        started.send(()).unwrap();
+        std::thread::sleep(Duration::from_millis(50));
+        Ok(1)
+    });
+    running.recv().unwrap();
+    let queued = worker.submit(Priority::Readout, |_camera| Ok(2));
+    //when
+    worker.stop().unwrap();
+    //then
+    assert_eq!(busy.wait().unwrap(), 1);
+    assert!(matches!(
+        queued.wait().unwrap_err().downcast_ref::<QHYError>(),
+        Some(WorkerStoppedError)
+    ));
+}
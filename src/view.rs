@@ -0,0 +1,161 @@
+use eyre::{eyre, Result};
+
+use crate::QHYError::{BufferTooSmallError, InvalidAreaError};
+use crate::{CCDChipArea, FrameMetadata, ImageData};
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+/// A rectangular part of an `ImageData` that borrows the pixels of the image instead of copying them, see
+/// `ImageData::view`
+pub struct ImageView<'a> {
+    data: &'a [u8],
+    stride: usize,
+    start: usize,
+    width: u32,
+    height: u32,
+    bits_per_pixel: u32,
+    channels: u32,
+    metadata: Option<FrameMetadata>,
+}
+
+impl ImageData {
+    /// Returns a view of the whole image
+    pub fn full_view(&self) -> Result<ImageView<'_>> {
+        self.view(CCDChipArea {
+            start_x: 0,
+            start_y: 0,
+            width: self.width,
+            height: self.height,
+        })
+    }
+
+    /// Returns a view of `area` without copying any pixels. Unlike `set_roi` this does not touch the camera,
+    /// so it can be used to crop frames of a running live stream.
+    /// # Example
+    /// ```
+    /// use qhyccd_rs::{CCDChipArea, ImageData};
+    /// let image = ImageData { data: (0..16).collect(), width: 4, height: 4, bits_per_pixel: 8, channels: 1, metadata: None };
+    /// let view = image
+    ///     .view(CCDChipArea { start_x: 1, start_y: 2, width: 2, height: 2 })
+    ///     .expect("view failed");
+    /// let rows: Vec<&[u8]> = view.rows().collect();
+    /// assert_eq!(rows, vec![&[9, 10][..], &[13, 14][..]]);
+    /// ```
+    pub fn view(&self, area: CCDChipArea) -> Result<ImageView<'_>> {
+        let fits =
+            |start: u32, len: u32, max: u32| start.checked_add(len).is_some_and(|end| end <= max);
+        if !fits(area.start_x, area.width, self.width)
+            || !fits(area.start_y, area.height, self.height)
+        {
+            let error = InvalidAreaError {
+                start_x: area.start_x,
+                start_y: area.start_y,
+                width: area.width,
+                height: area.height,
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let needed = self.info().data_len();
+        if self.data.len() < needed {
+            let error = BufferTooSmallError {
+                needed,
+                available: self.data.len(),
+            };
+            tracing::error!(error = ?error);
+            return Err(eyre!(error));
+        }
+        let pixel_size = self.channels as usize * self.bytes_per_sample();
+        Ok(ImageView {
+            data: self.as_u8_slice(),
+            stride: self.row_stride(),
+            start: area.start_y as usize * self.row_stride() + area.start_x as usize * pixel_size,
+            width: area.width,
+            height: area.height,
+            bits_per_pixel: self.bits_per_pixel,
+            channels: self.channels,
+            metadata: self.metadata,
+        })
+    }
+}
+
+impl<'a> ImageView<'a> {
+    /// the width of the view in pixels
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    /// the height of the view in pixels
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    /// the number of bits per pixel of the underlying image
+    pub fn bits_per_pixel(&self) -> u32 {
+        self.bits_per_pixel
+    }
+
+    /// the number of channels of the underlying image
+    pub fn channels(&self) -> u32 {
+        self.channels
+    }
+
+    /// the metadata of the underlying image
+    pub fn metadata(&self) -> Option<FrameMetadata> {
+        self.metadata
+    }
+
+    /// Returns the number of bytes of a single sample, 1 for 8 bit and 2 for 16 bit images
+    pub fn bytes_per_sample(&self) -> usize {
+        (self.bits_per_pixel as usize).div_ceil(8)
+    }
+
+    /// the number of bytes of a row of the view
+    pub fn row_len(&self) -> usize {
+        self.width as usize * self.channels as usize * self.bytes_per_sample()
+    }
+
+    /// Returns row `y` of the view as bytes
+    pub fn row(&self, y: u32) -> &'a [u8] {
+        let start = self.start + y as usize * self.stride;
+        &self.data[start..start + self.row_len()]
+    }
+
+    /// Returns an iterator over the rows of the view as bytes
+    pub fn rows(&self) -> impl ExactSizeIterator<Item = &'a [u8]> + '_ {
+        (0..self.height).map(|y| self.row(y))
+    }
+
+    /// Returns an iterator over the rows of a 16 bit view, `None` under the same conditions as
+    /// `ImageData::as_u16_slice`
+    pub fn rows_u16(&self) -> Option<impl ExactSizeIterator<Item = &'a [u16]> + '_> {
+        if self.bytes_per_sample() != 2 {
+            return None;
+        }
+        // Safety: every bit pattern is a valid u16, the start of every row is a multiple of 2 bytes from the
+        // start of the buffer so checking the buffer is enough
+        let (head, _, _) = unsafe { self.data.align_to::<u16>() };
+        if !head.is_empty() {
+            return None;
+        }
+        Some((0..self.height).map(|y| {
+            let (_, samples, _) = unsafe { self.row(y).align_to::<u16>() };
+            samples
+        }))
+    }
+
+    /// Copies the pixels of the view into a new image
+    pub fn to_image(&self) -> ImageData {
+        let mut data = Vec::with_capacity(self.row_len() * self.height as usize);
+        for row in self.rows() {
+            data.extend_from_slice(row);
+        }
+        ImageData {
+            data,
+            width: self.width,
+            height: self.height,
+            bits_per_pixel: self.bits_per_pixel,
+            channels: self.channels,
+            metadata: self.metadata,
+        }
+    }
+}
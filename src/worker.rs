@@ -0,0 +1,502 @@
+use std::collections::VecDeque;
+use std::fmt::Debug;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+use eyre::{eyre, Result};
+
+use crate::QHYError::WorkerStoppedError;
+use crate::{Camera, Control, FramePool, ImageData, PooledImageData};
+
+#[derive(Debug, PartialEq, Eq, PartialOrd, Ord, Hash, Clone, Copy)]
+/// The queue a command of a `CameraWorker` waits in, the worker always takes the next command from the
+/// first queue that is not empty
+pub enum Priority {
+    /// frame readout, a frame left in the SDK too long is overwritten by the next one
+    Readout,
+    /// mode changes, parameters and exposures
+    Control,
+    /// temperatures, cooler power and other readings that can wait
+    Telemetry,
+}
+
+impl Priority {
+    const COUNT: usize = 3;
+
+    fn index(self) -> usize {
+        self as usize
+    }
+}
+
+/// takes the camera and the executed counter, which it counts up before replying
+type Call = Box<dyn FnOnce(&Camera, &AtomicU64) + Send>;
+
+/// a value to set and everyone waiting for it to be set
+struct Write {
+    control: Control,
+    value: f64,
+    replies: Vec<Sender<Result<bool>>>,
+}
+
+/// a control to read and everyone waiting for its value
+struct Read {
+    control: Control,
+    replies: Vec<Sender<Result<f64>>>,
+}
+
+enum Command {
+    Call(Call),
+    /// passed to `Camera::apply` at once, later writes to the same control replace the value
+    Writes(Vec<Write>),
+    /// passed to `Camera::read_many` at once, a control is read once for all waiting on it
+    Reads(Vec<Read>),
+}
+
+struct Queue {
+    commands: [VecDeque<Command>; Priority::COUNT],
+    /// set by `stop`, nothing is queued anymore
+    closed: bool,
+}
+
+impl Queue {
+    fn len(&self) -> usize {
+        self.commands.iter().map(VecDeque::len).sum()
+    }
+
+    fn pop(&mut self) -> Option<Command> {
+        self.commands.iter_mut().find_map(VecDeque::pop_front)
+    }
+}
+
+pub(crate) struct Shared {
+    queue: Mutex<Queue>,
+    ready: Condvar,
+    executed: AtomicU64,
+    coalesced: AtomicU64,
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, Queue> {
+        self.queue
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// queues `command` unless the worker stopped, in which case its replies are dropped
+    fn push(&self, priority: Priority, command: Command) {
+        let mut queue = self.lock();
+        if queue.closed {
+            return;
+        }
+        queue.commands[priority.index()].push_back(command);
+        drop(queue);
+        self.ready.notify_one();
+    }
+}
+
+/// The result of a command queued on a `CameraWorker`
+pub struct Pending<T> {
+    reply: Receiver<Result<T>>,
+}
+
+impl<T> Pending<T> {
+    fn new() -> (Sender<Result<T>>, Self) {
+        let (sender, reply) = mpsc::channel();
+        (sender, Self { reply })
+    }
+
+    /// Waits for the command to be executed, returns an error if the worker stopped before it was
+    pub fn wait(self) -> Result<T> {
+        self.reply.recv().unwrap_or_else(|_| stopped())
+    }
+
+    /// Waits at most `timeout` for the command, returns `Ok(None)` if it did not run in time
+    pub fn wait_timeout(&self, timeout: Duration) -> Result<Option<T>> {
+        match self.reply.recv_timeout(timeout) {
+            Ok(result) => result.map(Some),
+            Err(mpsc::RecvTimeoutError::Timeout) => Ok(None),
+            Err(mpsc::RecvTimeoutError::Disconnected) => stopped(),
+        }
+    }
+}
+
+impl<T> Debug for Pending<T> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Pending").finish_non_exhaustive()
+    }
+}
+
+fn stopped<T>() -> Result<T> {
+    tracing::error!(error = ?WorkerStoppedError);
+    Err(eyre!(WorkerStoppedError))
+}
+
+fn submit<T, F>(shared: &Shared, priority: Priority, command: F) -> Pending<T>
+where
+    T: Send + 'static,
+    F: FnOnce(&Camera) -> Result<T> + Send + 'static,
+{
+    let (reply, pending) = Pending::new();
+    shared.push(
+        priority,
+        Command::Call(Box::new(move |camera, executed| {
+            let result = command(camera);
+            executed.fetch_add(1, Ordering::Relaxed);
+            // the caller may have dropped the pending result
+            let _ = reply.send(result);
+        })),
+    );
+    pending
+}
+
+#[derive(Clone)]
+/// where a component with its own thread sends its SDK calls, straight to the camera or queued on a
+/// `CameraWorker`
+pub(crate) enum Executor {
+    Direct(Camera),
+    Worker { camera: Camera, shared: Arc<Shared> },
+}
+
+impl Executor {
+    pub(crate) fn camera(&self) -> &Camera {
+        match self {
+            Self::Direct(camera) | Self::Worker { camera, .. } => camera,
+        }
+    }
+
+    /// runs `command` on the camera, on the worker thread with `priority` if there is a worker. Fails with
+    /// `WorkerStoppedError` once the worker stopped.
+    pub(crate) fn run<T, F>(&self, priority: Priority, command: F) -> Result<T>
+    where
+        T: Send + 'static,
+        F: FnOnce(&Camera) -> Result<T> + Send + 'static,
+    {
+        match self {
+            Self::Direct(camera) => command(camera),
+            Self::Worker { shared, .. } => submit(shared, priority, command).wait(),
+        }
+    }
+}
+
+/// A thread that owns all SDK calls of a camera. The vendor SDK is not reliably thread safe, so instead of
+/// calling the camera from telemetry, UI and capture threads at the same time every call is queued as a
+/// command and executed one after another, in order of its `Priority`: frame readout before controls before
+/// telemetry. A readout waits for at most the one command that is running, never for a queue of telemetry.
+///
+/// Commands are closures taking the `Camera`, see `submit`. Parameter writes and reads can be queued with
+/// `set_parameter` and `get_parameter` instead. While the worker is busy these are coalesced: writes queued
+/// one after another are sent in one `Camera::apply` batch in which the last value for a control wins, and
+/// reads of the same control are answered by a single `Camera::read_many`.
+///
+/// `start_telemetry`, `start_cooler` and `begin_live_stream` start those components on the worker, so their
+/// threads queue their SDK calls as well. The serialization only holds for calls made through the worker.
+/// Stopping or dropping it joins the thread
+/// after the running command, commands still queued are dropped and their `Pending::wait` fails.
+/// # Example
+/// ```no_run
+/// use qhyccd_rs::{Sdk,StreamMode,Control,FramePool,Priority};
+/// let sdk = Sdk::new().expect("SDK::new failed");
+/// let camera = sdk.cameras().last().expect("no camera found");
+/// camera.open().expect("open failed");
+/// let worker = camera.spawn_worker().expect("spawn_worker failed");
+/// worker
+///     .call(Priority::Control, |camera| {
+///         camera.set_stream_mode(StreamMode::LiveMode)?;
+///         camera.init()?;
+///         camera.begin_live()
+///     })
+///     .expect("begin_live failed");
+/// worker.set_parameter(Control::Exposure, 10_000.0).wait().expect("set_parameter failed");
+/// let pool = FramePool::for_camera(worker.camera(), 4).expect("FramePool::for_camera failed");
+/// let frame = worker.get_live_frame_pooled(&pool);
+/// let temperature = worker.get_parameter(Control::CurTemp);
+/// println!("{}°C", temperature.wait().expect("get_parameter failed"));
+/// let image = frame.wait().expect("get_live_frame_pooled failed");
+/// println!("{}x{}", image.width, image.height);
+/// worker.stop().expect("stop failed");
+/// ```
+pub struct CameraWorker {
+    camera: Camera,
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl CameraWorker {
+    pub(crate) fn start(camera: &Camera) -> Result<Self> {
+        let shared = Arc::new(Shared {
+            queue: Mutex::new(Queue {
+                commands: Default::default(),
+                closed: false,
+            }),
+            ready: Condvar::new(),
+            executed: AtomicU64::new(0),
+            coalesced: AtomicU64::new(0),
+        });
+        let thread = {
+            let camera = camera.clone();
+            let shared = shared.clone();
+            thread::Builder::new()
+                .name(format!("qhyccd-sdk-{}", camera.id()))
+                .spawn(move || work(camera, shared))
+        };
+        match thread {
+            Ok(thread) => Ok(Self {
+                camera: camera.clone(),
+                shared,
+                thread: Some(thread),
+            }),
+            Err(error) => {
+                tracing::error!(error = ?error);
+                Err(eyre!(error))
+            }
+        }
+    }
+
+    /// Queues `command` with `priority`, it is executed on the worker thread
+    pub fn submit<T, F>(&self, priority: Priority, command: F) -> Pending<T>
+    where
+        T: Send + 'static,
+        F: FnOnce(&Camera) -> Result<T> + Send + 'static,
+    {
+        submit(&self.shared, priority, command)
+    }
+
+    /// Queues `command` with `priority` and waits for its result
+    pub fn call<T, F>(&self, priority: Priority, command: F) -> Result<T>
+    where
+        T: Send + 'static,
+        F: FnOnce(&Camera) -> Result<T> + Send + 'static,
+    {
+        self.submit(priority, command).wait()
+    }
+
+    /// Queues setting `control` to `value` with `Priority::Control`. If the last queued control command is a
+    /// batch of writes the value joins it. Returns what `Camera::apply` returns for the control.
+    pub fn set_parameter(&self, control: Control, value: f64) -> Pending<bool> {
+        let (reply, pending) = Pending::new();
+        let mut queue = self.shared.lock();
+        if queue.closed {
+            return pending;
+        }
+        let commands = &mut queue.commands[Priority::Control.index()];
+        // only the tail, so the writes still happen before or after the commands queued around them
+        if let Some(Command::Writes(writes)) = commands.back_mut() {
+            match writes.iter_mut().find(|write| write.control == control) {
+                Some(write) => {
+                    write.value = value;
+                    write.replies.push(reply);
+                }
+                None => writes.push(Write {
+                    control,
+                    value,
+                    replies: vec![reply],
+                }),
+            }
+            self.shared.coalesced.fetch_add(1, Ordering::Relaxed);
+            return pending;
+        }
+        commands.push_back(Command::Writes(vec![Write {
+            control,
+            value,
+            replies: vec![reply],
+        }]));
+        drop(queue);
+        self.shared.ready.notify_one();
+        pending
+    }
+
+    /// Queues reading `control` with `Priority::Telemetry`. Reads queued while an earlier batch is still
+    /// waiting join it, and share the value if they are for the same control.
+    pub fn get_parameter(&self, control: Control) -> Pending<f64> {
+        let (reply, pending) = Pending::new();
+        let mut queue = self.shared.lock();
+        if queue.closed {
+            return pending;
+        }
+        let commands = &mut queue.commands[Priority::Telemetry.index()];
+        // readings do not depend on the order, any waiting batch will do
+        let batch = commands.iter_mut().find_map(|command| match command {
+            Command::Reads(reads) => Some(reads),
+            _ => None,
+        });
+        if let Some(reads) = batch {
+            match reads.iter_mut().find(|read| read.control == control) {
+                Some(read) => read.replies.push(reply),
+                None => reads.push(Read {
+                    control,
+                    replies: vec![reply],
+                }),
+            }
+            self.shared.coalesced.fetch_add(1, Ordering::Relaxed);
+            return pending;
+        }
+        commands.push_back(Command::Reads(vec![Read {
+            control,
+            replies: vec![reply],
+        }]));
+        drop(queue);
+        self.shared.ready.notify_one();
+        pending
+    }
+
+    /// Queues `Camera::get_live_frame_pooled` with `Priority::Readout`
+    pub fn get_live_frame_pooled(&self, pool: &FramePool) -> Pending<PooledImageData> {
+        let pool = pool.clone();
+        self.submit(Priority::Readout, move |camera| {
+            camera.get_live_frame_pooled(&pool)
+        })
+    }
+
+    /// Queues `Camera::get_single_frame` with a buffer of `get_image_size` bytes with `Priority::Readout`
+    pub fn get_single_frame(&self) -> Pending<ImageData> {
+        self.submit(Priority::Readout, |camera| {
+            let buffer_size = camera.get_image_size()?;
+            camera.get_single_frame(buffer_size)
+        })
+    }
+
+    /// Returns the number of commands waiting, a batch of writes or reads counts once
+    pub fn queued(&self) -> usize {
+        self.shared.lock().len()
+    }
+
+    /// Returns the number of commands executed so far
+    pub fn executed(&self) -> u64 {
+        self.shared.executed.load(Ordering::Relaxed)
+    }
+
+    /// Returns the number of writes and reads that joined a queued batch instead of becoming a command
+    pub fn coalesced(&self) -> u64 {
+        self.shared.coalesced.load(Ordering::Relaxed)
+    }
+
+    /// Returns the camera the commands are executed on
+    pub fn camera(&self) -> &Camera {
+        &self.camera
+    }
+
+    pub(crate) fn executor(&self) -> Executor {
+        Executor::Worker {
+            camera: self.camera.clone(),
+            shared: self.shared.clone(),
+        }
+    }
+
+    /// Stops the worker after the running command, commands still queued are dropped
+    pub fn stop(mut self) -> Result<()> {
+        self.shutdown();
+        Ok(())
+    }
+
+    fn shutdown(&mut self) {
+        let Some(thread) = self.thread.take() else {
+            return;
+        };
+        let mut queue = self.shared.lock();
+        queue.closed = true;
+        let dropped = queue.len();
+        queue.commands.iter_mut().for_each(VecDeque::clear);
+        drop(queue);
+        self.shared.ready.notify_all();
+        if dropped > 0 {
+            tracing::debug!(camera = %self.camera.id(), dropped, "worker commands dropped");
+        }
+        if thread.join().is_err() {
+            tracing::error!("camera worker thread panicked");
+        }
+    }
+}
+
+impl Debug for CameraWorker {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("CameraWorker")
+            .field("camera", &self.camera)
+            .field("queued", &self.queued())
+            .field("executed", &self.executed())
+            .field("coalesced", &self.coalesced())
+            .finish()
+    }
+}
+
+impl Drop for CameraWorker {
+    fn drop(&mut self) {
+        self.shutdown()
+    }
+}
+
+fn work(camera: Camera, shared: Arc<Shared>) {
+    loop {
+        let mut queue = shared.lock();
+        let command = loop {
+            if queue.closed {
+                return;
+            }
+            if let Some(command) = queue.pop() {
+                break command;
+            }
+            queue = shared
+                .ready
+                .wait(queue)
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+        };
+        drop(queue);
+        execute(&camera, command, &shared.executed);
+    }
+}
+
+/// runs `command` and counts it in `executed` before the replies go out, so a caller woken by its reply
+/// already sees it counted
+fn execute(camera: &Camera, command: Command, executed: &AtomicU64) {
+    match command {
+        Command::Call(call) => call(camera, executed),
+        Command::Writes(writes) => {
+            let settings: Vec<(Control, f64)> = writes
+                .iter()
+                .map(|write| (write.control, write.value))
+                .collect();
+            let results = camera.apply(&settings);
+            executed.fetch_add(1, Ordering::Relaxed);
+            for (write, result) in writes.into_iter().zip(results) {
+                reply_all(write.replies, result);
+            }
+        }
+        Command::Reads(reads) => {
+            let controls: Vec<Control> = reads.iter().map(|read| read.control).collect();
+            let results = camera.read_many(&controls);
+            executed.fetch_add(1, Ordering::Relaxed);
+            for (read, result) in reads.into_iter().zip(results) {
+                reply_all(read.replies, result);
+            }
+        }
+    }
+}
+
+/// sends `result` to every waiter, the error is formatted for all but the first since a report can not be
+/// cloned
+fn reply_all<T: Copy>(replies: Vec<Sender<Result<T>>>, result: Result<T>) {
+    match result {
+        Ok(value) => replies.into_iter().for_each(|reply| {
+            let _ = reply.send(Ok(value));
+        }),
+        Err(report) => {
+            let message = format!("{:#}", report);
+            let mut replies = replies.into_iter();
+            if let Some(first) = replies.next() {
+                let _ = first.send(Err(report));
+            }
+            replies.for_each(|reply| {
+                let _ = reply.send(Err(eyre!(message.clone())));
+            });
+        }
+    }
+}
+
+impl Camera {
+    /// Starts a `CameraWorker` executing the SDK calls for this camera on its own thread
+    pub fn spawn_worker(&self) -> Result<CameraWorker> {
+        CameraWorker::start(self)
+    }
+}